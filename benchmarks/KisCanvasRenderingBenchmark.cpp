@@ -0,0 +1,562 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "KisCanvasRenderingBenchmark.h"
+
+#include <QTest>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QThread>
+#include <QStandardPaths>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoCanvasResourceProvider.h>
+
+#include <KisDocument.h>
+#include <KisPart.h>
+#include <kis_image.h>
+#include <kis_paint_layer.h>
+#include <kis_update_info.h>
+#include <kis_canvas_resource_provider.h>
+#include <kis_painting_information_builder.h>
+#include <kis_tool_freehand_helper.h>
+#include <kis_smoothing_options.h>
+#include <brushengine/kis_paintop_preset.h>
+
+#include "stroke_testing_utils.h"
+
+#include "canvas/kis_coordinates_converter.h"
+#include "canvas/kis_prescaled_projection.h"
+#include "canvas/kis_display_color_converter.h"
+#include "canvas/kis_canvas_updates_compressor.h"
+#include "opengl/KisOpenGLUpdateInfoBuilder.h"
+#include "opengl/kis_texture_tile_info_pool.h"
+#include "opengl/kis_texture_tile_update_info.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const QSize canvasSize(1600, 1000);
+
+/**
+ * Collects per-frame timings, update latencies and the amount of
+ * converted data and prints a summary when the sequence is over
+ */
+class FrameStatistics
+{
+public:
+    FrameStatistics(const QString &name)
+        : m_name(name)
+    {
+    }
+
+    void startFrame() {
+        m_timer.start();
+    }
+
+    void endFrame(qint64 bytesConverted, qint64 bytesDrawn = 0) {
+        m_frameTimes.append(m_timer.nsecsElapsed());
+        m_bytesConverted += bytesConverted;
+        m_bytesDrawn += bytesDrawn;
+    }
+
+    void addLatency(qint64 latency) {
+        m_latencies.append(latency);
+    }
+
+    void report() {
+        if (m_frameTimes.isEmpty()) return;
+
+        QVector<qint64> times = m_frameTimes;
+        std::sort(times.begin(), times.end());
+
+        qint64 totalTime = 0;
+        Q_FOREACH (qint64 t, times) {
+            totalTime += t;
+        }
+
+        qDebug() << m_name << "frames:" << times.size();
+        qDebug() << "    frame time (ms):"
+                 << "mean" << totalTime / 1e6 / times.size()
+                 << "p50" << percentile(times, 0.50)
+                 << "p90" << percentile(times, 0.90)
+                 << "max" << percentile(times, 1.0);
+
+        if (!m_latencies.isEmpty()) {
+            QVector<qint64> latencies = m_latencies;
+            std::sort(latencies.begin(), latencies.end());
+
+            qDebug() << "    update latency (ms):"
+                     << "p50" << percentile(latencies, 0.50)
+                     << "p90" << percentile(latencies, 0.90)
+                     << "max" << percentile(latencies, 1.0);
+        }
+
+        qDebug() << "    per frame:"
+                 << "converted" << m_bytesConverted / times.size() / 1024 << "KiB"
+                 << "drawn" << m_bytesDrawn / times.size() / 1024 << "KiB";
+    }
+
+private:
+    static qreal percentile(const QVector<qint64> &sortedValues, qreal portion) {
+        const int index = qBound(0, qRound(portion * (sortedValues.size() - 1)), sortedValues.size() - 1);
+        return sortedValues[index] / 1e6;
+    }
+
+private:
+    QString m_name;
+    QElapsedTimer m_timer;
+    QVector<qint64> m_frameTimes;
+    QVector<qint64> m_latencies;
+    qint64 m_bytesConverted = 0;
+    qint64 m_bytesDrawn = 0;
+};
+
+struct QPainterCanvasSetup
+{
+    QPainterCanvasSetup(KisImageSP image) {
+        converter.setResolution(image->xRes(), image->yRes());
+        converter.setZoom(1.0);
+        converter.setImage(image);
+        converter.setCanvasWidgetSize(canvasSize);
+        converter.setDocumentOffset(QPoint());
+
+        projection.setCoordinatesConverter(&converter);
+        projection.setMonitorProfile(0,
+                                     KoColorConversionTransformation::internalRenderingIntent(),
+                                     KoColorConversionTransformation::internalConversionFlags());
+        projection.setImage(image);
+        projection.notifyCanvasSizeChanged(canvasSize);
+
+        lastConvertedBytes = projection.numConvertedBytes();
+        lastDrawnBytes = projection.numDrawnBytes();
+    }
+
+    /**
+     * Ends the frame with the bytes the projection has converted and
+     * drawn since the previous frame. The patches prepared by the
+     * prefetch worker are counted in the frame they have been finished in.
+     */
+    void endFrame(FrameStatistics &stats) {
+        const qint64 convertedBytes = projection.numConvertedBytes();
+        const qint64 drawnBytes = projection.numDrawnBytes();
+
+        stats.endFrame(convertedBytes - lastConvertedBytes, drawnBytes - lastDrawnBytes);
+
+        lastConvertedBytes = convertedBytes;
+        lastDrawnBytes = drawnBytes;
+    }
+
+    KisCoordinatesConverter converter;
+    KisPrescaledProjection projection;
+    qint64 lastConvertedBytes = 0;
+    qint64 lastDrawnBytes = 0;
+};
+
+KisStrokeRecording generateSyntheticRecording(const QRect &bounds)
+{
+    /**
+     * Emulates a tablet with 200 events per second drawing a loop
+     * with varying pressure
+     */
+
+    KisStrokeRecording recording(0.0, "synthetic");
+
+    const int numEvents = 600;
+    const qreal eventInterval = 5.0; // ms
+    const QPointF center = QRectF(bounds).center();
+    const qreal radius = 0.35 * qMin(bounds.width(), bounds.height());
+
+    QPointF lastPos;
+
+    for (int i = 0; i < numEvents; i++) {
+        const qreal t = qreal(i) / numEvents;
+        const qreal angle = 4.0 * M_PI * t;
+
+        const QPointF pos = center + radius * QPointF(std::cos(angle), std::sin(0.5 * angle) * std::sin(angle));
+        const qreal time = i * eventInterval;
+        const qreal speed = i > 0 ? QLineF(lastPos, pos).length() / eventInterval : 0.0;
+        const qreal pressure = qBound(0.0, 0.5 + 0.45 * std::sin(6 * M_PI * t), 1.0);
+
+        recording.addEvent(KisPaintInformation(pos, pressure, 0.0, 0.0, 0.0, 0.0, 1.0, time, speed));
+        lastPos = pos;
+    }
+
+    return recording;
+}
+
+/**
+ * Paints a recorded stroke on the image through the freehand helper
+ * at the pace it has been recorded with
+ */
+class ReplayFreehandHelper : public KisToolFreehandHelper
+{
+public:
+    ReplayFreehandHelper(KisPaintingInformationBuilder *infoBuilder)
+        : KisToolFreehandHelper(infoBuilder, KUndo2MagicString(), new KisSmoothingOptions(false))
+    {
+        smoothingOptions()->setSmoothingType(KisSmoothingOptions::NO_SMOOTHING);
+    }
+
+    /**
+     * \p idleCallback is called repeatedly in the GUI thread while
+     * the replay waits for the next event and for the image to finish
+     */
+    void replay(const KisStrokeRecording &recording,
+                KoCanvasResourceProvider *resourceManager,
+                KisImageSP image,
+                KisNodeSP node,
+                std::function<void()> idleCallback)
+    {
+        const QVector<KisPaintInformation> &events = recording.events();
+
+        QElapsedTimer timer;
+        timer.start();
+
+        initPaintImpl(recording.startAngle(), events.first(),
+                      resourceManager, image, node, image.data());
+
+        for (int i = 1; i < events.size(); i++) {
+            const qreal eventTime = events[i].currentTime() - events.first().currentTime();
+
+            while (timer.elapsed() < eventTime) {
+                idleCallback();
+                QThread::yieldCurrentThread();
+            }
+
+            continuePaintImpl(events[i]);
+        }
+
+        endPaint();
+
+        while (!image->isIdle()) {
+            idleCallback();
+            QThread::yieldCurrentThread();
+        }
+        idleCallback();
+    }
+};
+
+KisOpenGLUpdateInfoBuilder* createUpdateInfoBuilder(KisTextureTileInfoPoolRegistry &poolRegistry)
+{
+    KisOpenGLUpdateInfoBuilder *builder = new KisOpenGLUpdateInfoBuilder();
+
+    builder->setTextureInfoPool(poolRegistry.getPool(256, 256));
+    builder->setConversionOptions(
+        ConversionOptions(KoColorSpaceRegistry::instance()->rgb8(),
+                          KoColorConversionTransformation::internalRenderingIntent(),
+                          KoColorConversionTransformation::internalConversionFlags()));
+    builder->setTextureBorder(8);
+    builder->setEffectiveTextureSize(QSize(256 - 16, 256 - 16));
+
+    return builder;
+}
+
+}
+
+void KisCanvasRenderingBenchmark::initTestCase()
+{
+    // the smoothing options save themselves into the config, keep it away from kritarc
+    QStandardPaths::setTestModeEnabled(true);
+
+    m_doc = KisPart::instance()->createDocument();
+    QVERIFY(m_doc->loadNativeFormat(QString(FILES_DATA_DIR) + QDir::separator() + "load_test.kra"));
+
+    m_image = m_doc->image();
+    m_image->refreshGraph();
+    m_image->waitForDone();
+
+    m_preset = new KisPaintOpPreset(QString(FILES_DATA_DIR) + QDir::separator() + "softbrush_30px.kpp");
+    QVERIFY(m_preset->load());
+
+    const QString recordingFileName = qgetenv("KRITA_REPLAY_STROKE");
+
+    if (!recordingFileName.isEmpty()) {
+        QVERIFY(m_recording.load(recordingFileName));
+    } else {
+        m_recording = generateSyntheticRecording(m_image->bounds());
+    }
+
+    QVERIFY(!m_recording.isEmpty());
+}
+
+void KisCanvasRenderingBenchmark::cleanupTestCase()
+{
+    m_preset = 0;
+    m_image = 0;
+    delete m_doc;
+}
+
+void KisCanvasRenderingBenchmark::replayStroke(std::function<void(const QRect&)> imageUpdateCallback,
+                                               std::function<void()> idleCallback)
+{
+    KisPaintLayerSP layer = new KisPaintLayer(m_image, "stroke", OPACITY_OPAQUE_U8, m_image->colorSpace());
+    m_image->addNode(layer, m_image->root());
+    m_image->waitForDone();
+
+    QScopedPointer<KoCanvasResourceProvider> resourceManager(
+        utils::createResourceManager(m_image, layer, QString()));
+
+    QVariant i;
+    i.setValue(m_preset);
+    resourceManager->setResource(KisCanvasResourceProvider::CurrentPaintOpPreset, i);
+
+    QMetaObject::Connection connection =
+        connect(m_image.data(), &KisImage::sigImageUpdated, this,
+                [imageUpdateCallback] (const QRect &rc) { imageUpdateCallback(rc); },
+                Qt::DirectConnection);
+
+    KisPaintingInformationBuilder infoBuilder;
+    ReplayFreehandHelper helper(&infoBuilder);
+    helper.replay(m_recording, resourceManager.data(), m_image, layer, idleCallback);
+
+    disconnect(connection);
+
+    m_image->removeNode(layer);
+    m_image->refreshGraph();
+    m_image->waitForDone();
+}
+
+QVector<QRect> KisCanvasRenderingBenchmark::strokeUpdateRects()
+{
+    if (m_strokeUpdateRects.isEmpty()) {
+        QMutex mutex;
+
+        replayStroke(
+            [this, &mutex] (const QRect &rc) {
+                QMutexLocker l(&mutex);
+                m_strokeUpdateRects.append(rc);
+            },
+            [] () {});
+    }
+
+    return m_strokeUpdateRects;
+}
+
+void KisCanvasRenderingBenchmark::benchmarkPan()
+{
+    QPainterCanvasSetup s(m_image);
+    FrameStatistics stats("Pan");
+
+    QBENCHMARK_ONCE {
+        QPoint offset;
+        const QPoint step(12, 7);
+
+        for (int i = 0; i < 120; i++) {
+            stats.startFrame();
+
+            const QPointF before = s.converter.imageRectInViewportPixels().topLeft();
+            offset += i < 60 ? step : -step;
+            s.converter.setDocumentOffset(offset);
+            const QPointF after = s.converter.imageRectInViewportPixels().topLeft();
+
+            s.projection.viewportMoved(after - before);
+
+            s.endFrame(stats);
+
+            // pan at the pace of the display to let the prefetching work
+            QThread::msleep(16);
+        }
+    }
+
+    stats.report();
+}
+
+void KisCanvasRenderingBenchmark::benchmarkZoom()
+{
+    QPainterCanvasSetup s(m_image);
+    FrameStatistics stats("Zoom");
+
+    QBENCHMARK_ONCE {
+        for (int i = 0; i < 40; i++) {
+            stats.startFrame();
+
+            s.converter.setZoom(0.25 * std::pow(2.0, 3.0 * i / 39));
+            s.projection.notifyZoomChanged();
+
+            s.endFrame(stats);
+        }
+    }
+
+    stats.report();
+}
+
+void KisCanvasRenderingBenchmark::benchmarkRotate()
+{
+    QPainterCanvasSetup s(m_image);
+    FrameStatistics stats("Rotate");
+
+    const QPointF center = QRectF(QPointF(), canvasSize).center();
+
+    QBENCHMARK_ONCE {
+        for (int i = 0; i < 36; i++) {
+            stats.startFrame();
+
+            s.converter.rotate(center, 10.0);
+            s.projection.preScale();
+
+            s.endFrame(stats);
+        }
+    }
+
+    stats.report();
+}
+
+void KisCanvasRenderingBenchmark::benchmarkStrokeQPainter()
+{
+    QPainterCanvasSetup s(m_image);
+    FrameStatistics stats("Stroke (QPainter canvas)");
+
+    /**
+     * The updates are processed like KisCanvas2 does: the image thread
+     * converts the dirty rect, the GUI thread recalculates the prescaled
+     * image. The latency is measured from the moment the image has
+     * reported the update till the prescaled image is ready.
+     */
+    struct PendingUpdate {
+        KisUpdateInfoSP info;
+        qint64 time;
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QMutex mutex;
+    QVector<PendingUpdate> pendingUpdates;
+    QVector<QRect> updateRects;
+
+    auto imageUpdateCallback = [&] (const QRect &rc) {
+        const qint64 time = timer.nsecsElapsed();
+        KisUpdateInfoSP info = s.projection.updateCache(rc);
+
+        QMutexLocker l(&mutex);
+        pendingUpdates.append({info, time});
+        updateRects.append(rc);
+    };
+
+    auto idleCallback = [&] () {
+        QVector<PendingUpdate> updates;
+
+        {
+            QMutexLocker l(&mutex);
+            updates.swap(pendingUpdates);
+        }
+
+        Q_FOREACH (const PendingUpdate &update, updates) {
+            stats.startFrame();
+            s.projection.recalculateCache(update.info);
+            s.endFrame(stats);
+
+            stats.addLatency(timer.nsecsElapsed() - update.time);
+        }
+    };
+
+    QBENCHMARK_ONCE {
+        replayStroke(imageUpdateCallback, idleCallback);
+    }
+
+    if (m_strokeUpdateRects.isEmpty()) {
+        m_strokeUpdateRects = updateRects;
+    }
+
+    stats.report();
+}
+
+void KisCanvasRenderingBenchmark::benchmarkStrokeOpenGLTiles()
+{
+    KisTextureTileInfoPoolRegistry poolRegistry;
+    QScopedPointer<KisOpenGLUpdateInfoBuilder> builder(createUpdateInfoBuilder(poolRegistry));
+
+    FrameStatistics stats("Stroke (OpenGL tiles)");
+
+    const QVector<QRect> updateRects = strokeUpdateRects();
+
+    QBENCHMARK_ONCE {
+        Q_FOREACH (const QRect &rc, updateRects) {
+            stats.startFrame();
+
+            KisOpenGLUpdateInfoSP info = builder->buildUpdateInfo(rc, m_image, true);
+
+            qint64 bytes = 0;
+            Q_FOREACH (KisTextureTileUpdateInfoSP tile, info->tileList) {
+                bytes += qint64(tile->realPatchRect().width()) * tile->realPatchRect().height() * tile->pixelSize();
+            }
+
+            stats.endFrame(bytes);
+        }
+    }
+
+    stats.report();
+}
+
+void KisCanvasRenderingBenchmark::benchmarkDisplayColorConverter()
+{
+    KisDisplayColorConverter *converter = KisDisplayColorConverter::dumbConverterInstance();
+    const KoColorSpace *cs = m_image->colorSpace();
+
+    QVector<KoColor> colors;
+    for (int i = 0; i < 4096; i++) {
+        colors.append(KoColor(QColor::fromHsv(i % 360, 128 + i % 128, 255 - i % 200), cs));
+    }
+
+    FrameStatistics stats("Display color converter");
+
+    QBENCHMARK_ONCE {
+        for (int frame = 0; frame < 10; frame++) {
+            stats.startFrame();
+
+            Q_FOREACH (const KoColor &color, colors) {
+                converter->toQColor(color);
+            }
+
+            stats.endFrame(qint64(colors.size()) * cs->pixelSize());
+        }
+    }
+
+    stats.report();
+}
+
+void KisCanvasRenderingBenchmark::benchmarkUpdatesCompressor()
+{
+    KisTextureTileInfoPoolRegistry poolRegistry;
+    QScopedPointer<KisOpenGLUpdateInfoBuilder> builder(createUpdateInfoBuilder(poolRegistry));
+
+    QVector<KisUpdateInfoSP> updates;
+    Q_FOREACH (const QRect &rc, strokeUpdateRects()) {
+        updates.append(builder->buildUpdateInfo(rc, m_image, false));
+    }
+
+    KisCanvasUpdatesCompressor compressor;
+    KisUpdateInfoList result;
+
+    QBENCHMARK {
+        result.clear();
+
+        Q_FOREACH (KisUpdateInfoSP info, updates) {
+            compressor.putUpdateInfo(info);
+        }
+
+        compressor.takeUpdateInfo(result);
+    }
+
+    qDebug() << "Updates compressor:" << updates.size() << "updates coalesced into" << result.size();
+}
+
+QTEST_MAIN(KisCanvasRenderingBenchmark)
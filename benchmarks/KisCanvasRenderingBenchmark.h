@@ -0,0 +1,80 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef KISCANVASRENDERINGBENCHMARK_H
+#define KISCANVASRENDERINGBENCHMARK_H
+
+#include <QtTest>
+
+#include <functional>
+
+#include <kis_types.h>
+#include <KisStrokeRecording.h>
+
+class KisDocument;
+
+/**
+ * Replays scripted pan/zoom/rotate sequences and a recorded stroke
+ * against the canvas rendering pipeline without creating any widgets
+ * or OpenGL contexts. Every sequence reports the time needed to prepare
+ * a frame and the number of bytes converted for the display and drawn
+ * into the prescaled image per frame. The stroke also reports the
+ * latency of the canvas updates.
+ *
+ * The stroke can be overridden with the environment:
+ *
+ *   KRITA_REPLAY_STROKE=/path/to/stroke.kstroke
+ */
+class KisCanvasRenderingBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchmarkPan();
+    void benchmarkZoom();
+    void benchmarkRotate();
+    void benchmarkStrokeQPainter();
+    void benchmarkStrokeOpenGLTiles();
+    void benchmarkDisplayColorConverter();
+    void benchmarkUpdatesCompressor();
+
+private:
+    /**
+     * Paints the recorded stroke on a temporary layer of the image.
+     * \p imageUpdateCallback is called in the image thread for every
+     * update the image reports, \p idleCallback is called in the GUI
+     * thread while the replay is waiting for the events and the image.
+     */
+    void replayStroke(std::function<void(const QRect&)> imageUpdateCallback,
+                      std::function<void()> idleCallback);
+
+    /**
+     * The rects the image has reported while painting the stroke
+     */
+    QVector<QRect> strokeUpdateRects();
+
+private:
+    KisDocument *m_doc = 0;
+    KisImageSP m_image;
+    KisPaintOpPresetSP m_preset;
+    KisStrokeRecording m_recording;
+    QVector<QRect> m_strokeUpdateRects;
+};
+
+#endif // KISCANVASRENDERINGBENCHMARK_H
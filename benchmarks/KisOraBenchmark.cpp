@@ -0,0 +1,161 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "KisOraBenchmark.h"
+
+#include <QTest>
+#include <QTemporaryDir>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <KisDocument.h>
+#include <KisPart.h>
+#include <kis_group_layer.h>
+#include <kis_image.h>
+#include <kis_layer_utils.h>
+#include <kis_paint_layer.h>
+
+namespace {
+
+const QSize documentSize(2000, 1500);
+const int numLayers = 120;
+const int layersPerGroup = 10;
+
+const QByteArray oraMimeType("image/openraster");
+
+KisDocument* createDocument()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisImageSP image = new KisImage(0, documentSize.width(), documentSize.height(), cs, "ora benchmark");
+
+    KisGroupLayerSP topLevelGroup;
+    KisGroupLayerSP group;
+
+    for (int i = 0; i < numLayers; i++) {
+        if (i % layersPerGroup == 0) {
+            const int groupIndex = i / layersPerGroup;
+            group = new KisGroupLayer(image, QString("group %1").arg(groupIndex), OPACITY_OPAQUE_U8);
+
+            // every second group is nested into the previous one
+            if (groupIndex % 2) {
+                image->addNode(group, topLevelGroup);
+            } else {
+                image->addNode(group, image->root());
+                topLevelGroup = group;
+            }
+        }
+
+        KisPaintLayerSP layer = new KisPaintLayer(image, QString("layer %1").arg(i), OPACITY_OPAQUE_U8);
+
+        const QRect rc((i * 37) % 1000, (i * 23) % 700, documentSize.width() / 2, documentSize.height() / 2);
+        layer->paintDevice()->fill(rc, KoColor(QColor::fromHsv(i * 3, 200, 255, 128), cs));
+        layer->paintDevice()->fill(rc.adjusted(100, 100, -100, -100), KoColor(QColor::fromHsv(i * 3 + 90, 150, 200), cs));
+
+        image->addNode(layer, group);
+    }
+
+    image->initialRefreshGraph();
+
+    KisDocument *doc = KisPart::instance()->createDocument();
+    doc->setCurrentImage(image);
+    doc->setFileBatchMode(true);
+    return doc;
+}
+
+void countLayers(KisNodeSP root, int *numPaintLayers, int *numGroups)
+{
+    *numPaintLayers = 0;
+    *numGroups = 0;
+
+    KisLayerUtils::recursiveApplyNodes(root,
+        [root, numPaintLayers, numGroups] (KisNodeSP node) {
+            if (dynamic_cast<KisPaintLayer*>(node.data())) {
+                (*numPaintLayers)++;
+            } else if (node != root && dynamic_cast<KisGroupLayer*>(node.data())) {
+                (*numGroups)++;
+            }
+        });
+}
+
+}
+
+void KisOraBenchmark::initTestCase()
+{
+    m_savedFileName = QDir::tempPath() + QLatin1String("/krita_ora_benchmark.ora");
+
+    QScopedPointer<KisDocument> doc(createDocument());
+    QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile(m_savedFileName), oraMimeType));
+}
+
+void KisOraBenchmark::cleanupTestCase()
+{
+    QFile::remove(m_savedFileName);
+}
+
+void KisOraBenchmark::benchmarkSave()
+{
+    QScopedPointer<KisDocument> doc(createDocument());
+
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + QLatin1String("/saved.ora");
+
+    QBENCHMARK {
+        QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile(fileName), oraMimeType));
+    }
+}
+
+void KisOraBenchmark::benchmarkLoad()
+{
+    QBENCHMARK {
+        QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+        doc->setFileBatchMode(true);
+        QVERIFY(doc->importDocument(QUrl::fromLocalFile(m_savedFileName)));
+        QVERIFY(doc->image());
+    }
+}
+
+void KisOraBenchmark::benchmarkRoundTrip()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + QLatin1String("/roundtrip.ora");
+
+    QBENCHMARK {
+        QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+        doc->setFileBatchMode(true);
+        QVERIFY(doc->importDocument(QUrl::fromLocalFile(m_savedFileName)));
+        QVERIFY(doc->image());
+
+        doc->image()->waitForDone();
+        QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile(fileName), oraMimeType));
+    }
+
+    QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+    doc->setFileBatchMode(true);
+    QVERIFY(doc->importDocument(QUrl::fromLocalFile(fileName)));
+
+    int numPaintLayers = 0;
+    int numGroups = 0;
+    countLayers(doc->image()->root(), &numPaintLayers, &numGroups);
+
+    QCOMPARE(numPaintLayers, numLayers);
+    QCOMPARE(numGroups, numLayers / layersPerGroup);
+    QCOMPARE(int(doc->image()->root()->childCount()), (numLayers / layersPerGroup + 1) / 2);
+}
+
+QTEST_MAIN(KisOraBenchmark)
@@ -0,0 +1,142 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "KisPrescaledProjectionBenchmark.h"
+
+#include <QTest>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_image.h>
+#include <kis_paint_layer.h>
+#include <kis_paint_device.h>
+#include <kis_update_info.h>
+
+#include "canvas/kis_coordinates_converter.h"
+#include "canvas/kis_prescaled_projection.h"
+
+namespace {
+
+const QRect imageRect(0, 0, 4096, 4096);
+
+KisImageSP createImage()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "canvas benchmark");
+
+    KisPaintLayerSP layer = new KisPaintLayer(image, "layer", OPACITY_OPAQUE_U8, cs);
+    image->addNode(layer, image->rootLayer());
+
+    const int step = 256;
+    for (int y = 0; y < imageRect.height(); y += step) {
+        for (int x = 0; x < imageRect.width(); x += step) {
+            const QColor color(x * 255 / imageRect.width(), y * 255 / imageRect.height(), 128);
+            layer->paintDevice()->fill(QRect(x, y, step, step), KoColor(color, cs));
+        }
+    }
+
+    image->initialRefreshGraph();
+    return image;
+}
+
+void updateCanvas(KisPrescaledProjection &projection, const QRect &rc)
+{
+    KisUpdateInfoSP info = projection.updateCache(rc);
+    projection.recalculateCache(info);
+}
+
+}
+
+void KisPrescaledProjectionBenchmark::initTestCase()
+{
+    // make sure the color conversion plugins are loaded before measuring
+    KoColorSpaceRegistry::instance();
+}
+
+void KisPrescaledProjectionBenchmark::benchmarkFullUpdate()
+{
+    KisImageSP image = createImage();
+
+    KisCoordinatesConverter converter;
+    converter.setImage(image);
+
+    KisPrescaledProjection projection;
+    projection.setCoordinatesConverter(&converter);
+    projection.setMonitorProfile(0,
+                                 KoColorConversionTransformation::internalRenderingIntent(),
+                                 KoColorConversionTransformation::internalConversionFlags());
+    projection.setImage(image);
+
+    QBENCHMARK {
+        updateCanvas(projection, imageRect);
+    }
+}
+
+void KisPrescaledProjectionBenchmark::benchmarkStrokeUpdates()
+{
+    KisImageSP image = createImage();
+
+    KisCoordinatesConverter converter;
+    converter.setImage(image);
+
+    KisPrescaledProjection projection;
+    projection.setCoordinatesConverter(&converter);
+    projection.setMonitorProfile(0,
+                                 KoColorConversionTransformation::internalRenderingIntent(),
+                                 KoColorConversionTransformation::internalConversionFlags());
+    projection.setImage(image);
+
+    const int dabSize = 128;
+
+    QBENCHMARK {
+        for (int i = 0; i < 256; i++) {
+            const QRect dirtyRect((i * 61) % (imageRect.width() - dabSize),
+                                  (i * 37) % (imageRect.height() - dabSize),
+                                  dabSize, dabSize);
+            updateCanvas(projection, dirtyRect);
+        }
+    }
+}
+
+void KisPrescaledProjectionBenchmark::benchmarkMonitorProfileReset()
+{
+    KisImageSP image = createImage();
+
+    KisCoordinatesConverter converter;
+    converter.setImage(image);
+
+    KisPrescaledProjection projection;
+    projection.setCoordinatesConverter(&converter);
+    projection.setMonitorProfile(0,
+                                 KoColorConversionTransformation::internalRenderingIntent(),
+                                 KoColorConversionTransformation::internalConversionFlags());
+    projection.setImage(image);
+
+    /**
+     * The canvas resets the monitor profile on every change of the
+     * display settings, which should not invalidate the whole cache
+     */
+    QBENCHMARK {
+        projection.setMonitorProfile(0,
+                                     KoColorConversionTransformation::internalRenderingIntent(),
+                                     KoColorConversionTransformation::internalConversionFlags());
+        updateCanvas(projection, QRect(0, 0, 64, 64));
+    }
+}
+
+QTEST_MAIN(KisPrescaledProjectionBenchmark)
@@ -0,0 +1,157 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisPsdBenchmark.h"
+
+#include <QTest>
+#include <QTemporaryDir>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <KisDocument.h>
+#include <KisPart.h>
+#include <kis_image.h>
+#include <kis_paint_layer.h>
+
+#include <compression.h>
+
+namespace {
+
+const int planeWidth = 4096;
+const int planeHeight = 4096;
+
+const QSize documentSize(3000, 2000);
+const int numLayers = 40;
+
+const QByteArray psdMimeType("image/vnd.adobe.photoshop");
+
+/**
+ * A plane that looks like painted data: long runs of a flat color
+ * interrupted by noisy strokes
+ */
+QByteArray createPlane()
+{
+    QByteArray plane(planeWidth * planeHeight, 0);
+
+    for (int y = 0; y < planeHeight; y++) {
+        char *row = plane.data() + y * planeWidth;
+        for (int x = 0; x < planeWidth; x++) {
+            row[x] = ((x + y) / 97) % 4 ? char(y / 64) : char(rand());
+        }
+    }
+
+    return plane;
+}
+
+KisDocument* createDocument()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisImageSP image = new KisImage(0, documentSize.width(), documentSize.height(), cs, "psd benchmark");
+
+    for (int i = 0; i < numLayers; i++) {
+        KisPaintLayerSP layer = new KisPaintLayer(image, QString("layer %1").arg(i), OPACITY_OPAQUE_U8);
+
+        const QRect rc(i * 50, i * 30, documentSize.width() / 2, documentSize.height() / 2);
+        layer->paintDevice()->fill(rc, KoColor(QColor::fromHsv(i * 9, 200, 255, 128), cs));
+        layer->paintDevice()->fill(rc.adjusted(100, 100, -100, -100), KoColor(QColor::fromHsv(i * 9 + 90, 150, 200), cs));
+
+        image->addNode(layer, image->root());
+    }
+
+    image->initialRefreshGraph();
+
+    KisDocument *doc = KisPart::instance()->createDocument();
+    doc->setCurrentImage(image);
+    doc->setFileBatchMode(true);
+    return doc;
+}
+
+}
+
+void KisPsdBenchmark::initTestCase()
+{
+    m_plane = createPlane();
+
+    m_savedFileName = QDir::tempPath() + QLatin1String("/krita_psd_benchmark.psd");
+
+    QScopedPointer<KisDocument> doc(createDocument());
+    QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile(m_savedFileName), psdMimeType));
+}
+
+void KisPsdBenchmark::cleanupTestCase()
+{
+    QFile::remove(m_savedFileName);
+}
+
+void KisPsdBenchmark::benchmarkPackRowsSequential()
+{
+    QBENCHMARK {
+        for (int row = 0; row < planeHeight; row++) {
+            Compression::compress(QByteArray::fromRawData(m_plane.constData() + row * planeWidth, planeWidth), Compression::RLE);
+        }
+    }
+}
+
+void KisPsdBenchmark::benchmarkPackRows()
+{
+    QBENCHMARK {
+        Compression::compressRowsRLE(m_plane.constData(), planeWidth, planeHeight);
+    }
+}
+
+void KisPsdBenchmark::benchmarkUnpackRows()
+{
+    const QVector<QByteArray> rows = Compression::compressRowsRLE(m_plane.constData(), planeWidth, planeHeight);
+
+    QByteArray packed;
+    QVector<quint32> rowLengths;
+    Q_FOREACH (const QByteArray &row, rows) {
+        packed.append(row);
+        rowLengths.append(row.size());
+    }
+
+    QBENCHMARK {
+        Compression::uncompressRowsRLE(packed, rowLengths, planeWidth);
+    }
+}
+
+void KisPsdBenchmark::benchmarkSave()
+{
+    QScopedPointer<KisDocument> doc(createDocument());
+
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + QLatin1String("/saved.psd");
+
+    QBENCHMARK {
+        QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile(fileName), psdMimeType));
+    }
+}
+
+void KisPsdBenchmark::benchmarkLoad()
+{
+    QBENCHMARK {
+        QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+        doc->setFileBatchMode(true);
+        QVERIFY(doc->importDocument(QUrl::fromLocalFile(m_savedFileName)));
+        QVERIFY(doc->image());
+    }
+}
+
+QTEST_MAIN(KisPsdBenchmark)
@@ -0,0 +1,46 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef KISPSDBENCHMARK_H
+#define KISPSDBENCHMARK_H
+
+#include <QtTest>
+
+/**
+ * Measures PackBits (PSD RLE) packing and unpacking of whole channels,
+ * and saving and loading of a multi-layer PSD document.
+ */
+class KisPsdBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchmarkPackRowsSequential();
+    void benchmarkPackRows();
+    void benchmarkUnpackRows();
+
+    void benchmarkSave();
+    void benchmarkLoad();
+
+private:
+    QByteArray m_plane;
+    QString m_savedFileName;
+};
+
+#endif // KISPSDBENCHMARK_H
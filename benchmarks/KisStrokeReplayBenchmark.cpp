@@ -0,0 +1,434 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisStrokeReplayBenchmark.h"
+
+#include <QTest>
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <cmath>
+
+#include "kis_benchmark_values.h"
+#include "stroke_testing_utils.h"
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoCanvasResourceProvider.h>
+
+#include <kis_image.h>
+#include <kis_paint_layer.h>
+#include <kis_image_interfaces.h>
+#include <kis_canvas_resource_provider.h>
+#include <kis_painting_information_builder.h>
+#include <kis_tool_freehand_helper.h>
+#include <kis_smoothing_options.h>
+#include <kis_distance_information.h>
+#include <KisRunnableStrokeJobData.h>
+#include <strokes/KisFreehandStrokeInfo.h>
+#include <brushengine/kis_paintop_preset.h>
+
+
+namespace {
+
+KisStrokeRecording generateSyntheticRecording(int width, int height)
+{
+    /**
+     * Emulates a tablet with 200 events per second drawing a loose spiral
+     * with varying speed, pressure and tilt
+     */
+
+    KisStrokeRecording recording(0.0, "synthetic");
+
+    const int numEvents = 1000;
+    const qreal eventInterval = 5.0; // ms
+    const QPointF center(0.5 * width, 0.5 * height);
+    const qreal maxRadius = 0.45 * qMin(width, height);
+
+    QPointF lastPos = center;
+
+    for (int i = 0; i < numEvents; i++) {
+        const qreal t = qreal(i) / numEvents;
+        const qreal angle = 8 * M_PI * t + 0.3 * std::sin(40 * M_PI * t);
+        const qreal radius = maxRadius * (0.05 + 0.95 * t);
+
+        const QPointF pos = center + radius * QPointF(std::cos(angle), std::sin(angle));
+        const qreal time = i * eventInterval;
+        const qreal speed = i > 0 ? QLineF(lastPos, pos).length() / eventInterval : 0.0;
+
+        const qreal pressure = qBound(0.0, 0.5 + 0.45 * std::sin(6 * M_PI * t), 1.0);
+        const qreal xTilt = 30.0 * std::cos(2 * M_PI * t);
+        const qreal yTilt = 30.0 * std::sin(2 * M_PI * t);
+
+        recording.addEvent(KisPaintInformation(pos, pressure, xTilt, yTilt, 0.0, 0.0, 1.0, time, speed));
+        lastPos = pos;
+    }
+
+    return recording;
+}
+
+/**
+ * A freehand helper that takes its input from a recording and works as its
+ * own strokes facade: it forwards all the jobs to the image and appends a
+ * marker job after every event to measure the latency of the dabs.
+ *
+ * The dabs of a job become visible only when the job issues its update,
+ * so the latency of a dab is measured from the submission of the event
+ * that produced it till the completion of the jobs of that event. The
+ * marker job also counts the dabs painted so far, which tells how many
+ * dabs every event has produced.
+ */
+class ReplayFreehandHelper : public KisToolFreehandHelper, public KisStrokesFacade
+{
+public:
+    ReplayFreehandHelper(KisPaintingInformationBuilder *infoBuilder, KisSmoothingOptions *smoothingOptions)
+        : KisToolFreehandHelper(infoBuilder, KUndo2MagicString(), smoothingOptions)
+    {
+    }
+
+    /**
+     * When \p realTime is true, the events are submitted at the pace they
+     * have been recorded with, and the event loop runs in the meantime.
+     * The stabilizer paints from a timer, so it needs that.
+     */
+    void replay(const KisStrokeRecording &recording,
+                KoCanvasResourceProvider *resourceManager,
+                KisImageSP image,
+                KisNodeSP node,
+                bool realTime)
+    {
+        m_image = image;
+
+        const QVector<KisPaintInformation> &events = recording.events();
+
+        m_submitTime.fill(0, events.size());
+        m_completionTime.fill(0, events.size());
+        m_dabsPainted.fill(0, events.size());
+        m_numDabs = 0;
+        m_strokeProcessedTime = 0;
+
+        m_timer.start();
+
+        initPaintImpl(recording.startAngle(), events.first(),
+                      resourceManager, image, node, this);
+        addLatencyMarker(0);
+
+        for (int i = 1; i < events.size(); i++) {
+            if (realTime) {
+                waitTillEventTime(events[i].currentTime() - events.first().currentTime());
+            }
+
+            continuePaintImpl(events[i]);
+            addLatencyMarker(i);
+        }
+
+        endPaint();
+
+        image->waitForDone();
+        m_totalTime = m_timer.nsecsElapsed();
+    }
+
+    QVector<qint64> dabLatencies() const {
+        QVector<qint64> result;
+        int lastDabsPainted = 0;
+
+        for (int i = 0; i < m_submitTime.size(); i++) {
+            const qint64 latency = m_completionTime[i] - m_submitTime[i];
+
+            for (int dab = lastDabsPainted; dab < m_dabsPainted[i]; dab++) {
+                result << latency;
+            }
+            lastDabsPainted = qMax(lastDabsPainted, m_dabsPainted[i]);
+        }
+        return result;
+    }
+
+    int numDabs() const {
+        return m_numDabs;
+    }
+
+    qint64 strokeProcessedTime() const {
+        return m_strokeProcessedTime;
+    }
+
+    qint64 totalTime() const {
+        return m_totalTime;
+    }
+
+protected:
+    void createPainters(QVector<KisFreehandStrokeInfo*> &strokeInfos,
+                        const KisDistanceInformation &startDist) override
+    {
+        KisToolFreehandHelper::createPainters(strokeInfos, startDist);
+        m_strokeInfos = strokeInfos;
+    }
+
+public:
+    KisStrokeId startStroke(KisStrokeStrategy *strokeStrategy) override {
+        m_strokeId = m_image->startStroke(strokeStrategy);
+        return m_strokeId;
+    }
+
+    void addJob(KisStrokeId id, KisStrokeJobData *data) override {
+        m_image->addJob(id, data);
+    }
+
+    void endStroke(KisStrokeId id) override {
+        /**
+         * The stroke infos are still owned by the stroke here, so we can
+         * safely read the dab counters in a sequential job
+         */
+        const QVector<KisFreehandStrokeInfo*> strokeInfos = m_strokeInfos;
+
+        m_image->addJob(id, new KisRunnableStrokeJobData(
+            [this, strokeInfos] () {
+                m_numDabs = countDabs(strokeInfos);
+                m_strokeProcessedTime = m_timer.nsecsElapsed();
+            },
+            KisStrokeJobData::SEQUENTIAL));
+
+        m_image->endStroke(id);
+        m_strokeInfos.clear();
+    }
+
+    bool cancelStroke(KisStrokeId id) override {
+        m_strokeInfos.clear();
+        return m_image->cancelStroke(id);
+    }
+
+private:
+    static int countDabs(const QVector<KisFreehandStrokeInfo*> &strokeInfos) {
+        int numDabs = 0;
+        Q_FOREACH (KisFreehandStrokeInfo *info, strokeInfos) {
+            numDabs += info->dragDistance->currentDabSeqNo();
+        }
+        return numDabs;
+    }
+
+    void waitTillEventTime(qreal eventTime) {
+        const qint64 timeLeft = qint64(eventTime) - m_timer.elapsed();
+
+        if (timeLeft > 0) {
+            QTest::qWait(int(timeLeft));
+        }
+    }
+
+    void addLatencyMarker(int eventIndex) {
+        m_submitTime[eventIndex] = m_timer.nsecsElapsed();
+
+        const QVector<KisFreehandStrokeInfo*> strokeInfos = m_strokeInfos;
+
+        m_image->addJob(m_strokeId, new KisRunnableStrokeJobData(
+            [this, eventIndex, strokeInfos] () {
+                m_completionTime[eventIndex] = m_timer.nsecsElapsed();
+                m_dabsPainted[eventIndex] = countDabs(strokeInfos);
+            },
+            KisStrokeJobData::SEQUENTIAL));
+    }
+
+private:
+    KisImageSP m_image;
+    KisStrokeId m_strokeId;
+    QVector<KisFreehandStrokeInfo*> m_strokeInfos;
+
+    QElapsedTimer m_timer;
+    QVector<qint64> m_submitTime;
+    QVector<qint64> m_completionTime;
+    QVector<int> m_dabsPainted;
+    int m_numDabs = 0;
+    qint64 m_strokeProcessedTime = 0;
+    qint64 m_totalTime = 0;
+};
+
+qreal percentile(const QVector<qint64> &sortedValues, qreal portion)
+{
+    if (sortedValues.isEmpty()) return 0.0;
+
+    const int index = qBound(0, qRound(portion * (sortedValues.size() - 1)), sortedValues.size() - 1);
+    return sortedValues[index] / 1e6;
+}
+
+}
+
+void KisStrokeReplayBenchmark::initTestCase()
+{
+    // the smoothing options save themselves into the config, keep it away from kritarc
+    QStandardPaths::setTestModeEnabled(true);
+
+    m_dataPath = QString(FILES_DATA_DIR) + QDir::separator();
+
+    const QString recordingFileName = qgetenv("KRITA_REPLAY_STROKE");
+
+    if (!recordingFileName.isEmpty()) {
+        QVERIFY(m_recording.load(recordingFileName));
+        qDebug() << "Replaying" << recordingFileName
+                 << "recorded with" << m_recording.presetName();
+    } else {
+        m_recording = generateSyntheticRecording(TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT);
+    }
+
+    QVERIFY(!m_recording.isEmpty());
+}
+
+void KisStrokeReplayBenchmark::testRecordingRoundTrip()
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QVERIFY(m_recording.save(&buffer));
+    buffer.close();
+
+    KisStrokeRecording loaded;
+    buffer.open(QIODevice::ReadOnly);
+    QVERIFY(loaded.load(&buffer));
+
+    QCOMPARE(loaded.events().size(), m_recording.events().size());
+    QCOMPARE(loaded.presetName(), m_recording.presetName());
+
+    for (int i = 0; i < loaded.events().size(); i++) {
+        const KisPaintInformation &lhs = loaded.events()[i];
+        const KisPaintInformation &rhs = m_recording.events()[i];
+
+        // the events are stored in single precision
+        QVERIFY(qAbs(lhs.pos().x() - rhs.pos().x()) < 1e-2);
+        QVERIFY(qAbs(lhs.pos().y() - rhs.pos().y()) < 1e-2);
+        QVERIFY(qAbs(lhs.pressure() - rhs.pressure()) < 1e-5);
+        QVERIFY(qAbs(lhs.currentTime() - rhs.currentTime()) < 1e-2);
+    }
+}
+
+void KisStrokeReplayBenchmark::testRecordingWithBrokenEventCount()
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+
+    {
+        QDataStream stream(&buffer);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+        // the header of a valid recording that claims 4G events and has none
+        stream << quint32(0x4b535452) << quint16(1);
+        stream << qreal(0.0) << QString("broken");
+        stream << quint32(0xffffffff);
+    }
+    buffer.close();
+
+    KisStrokeRecording loaded;
+    buffer.open(QIODevice::ReadOnly);
+    QVERIFY(!loaded.load(&buffer));
+    QVERIFY(loaded.isEmpty());
+}
+
+void KisStrokeReplayBenchmark::benchmarkReplay(const QString &presetFileName,
+                                               KisSmoothingOptions::SmoothingType smoothingType)
+{
+    const QString presetPath =
+        QFileInfo(presetFileName).isAbsolute() ?
+        presetFileName : m_dataPath + presetFileName;
+
+    KisPaintOpPresetSP preset = new KisPaintOpPreset(presetPath);
+    QVERIFY2(preset->load(), qPrintable(QString("failed to load preset %1").arg(presetPath)));
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT, cs, "stroke replay image");
+    KisPaintLayerSP layer = new KisPaintLayer(image, "layer", OPACITY_OPAQUE_U8, cs);
+    image->addNode(layer, image->root());
+    image->waitForDone();
+
+    QScopedPointer<KoCanvasResourceProvider> resourceManager(
+        utils::createResourceManager(image, layer, QString()));
+
+    QVariant i;
+    i.setValue(preset);
+    resourceManager->setResource(KisCanvasResourceProvider::CurrentPaintOpPreset, i);
+
+    /**
+     * The smoothing options use their default values. The stabilizer is
+     * driven by a timer, so its strokes are replayed in real time with a
+     * running event loop, the other modes are replayed as fast as possible.
+     */
+    KisSmoothingOptions *smoothingOptions = new KisSmoothingOptions(false);
+    smoothingOptions->setSmoothingType(smoothingType);
+    const bool realTime = smoothingType == KisSmoothingOptions::STABILIZER;
+
+    KisPaintingInformationBuilder infoBuilder;
+    ReplayFreehandHelper helper(&infoBuilder, smoothingOptions);
+
+    QBENCHMARK_ONCE {
+        helper.replay(m_recording, resourceManager.data(), image, layer, realTime);
+    }
+
+    QVector<qint64> latencies = helper.dabLatencies();
+    std::sort(latencies.begin(), latencies.end());
+
+    const qreal strokeTime = helper.strokeProcessedTime() / 1e6;
+    const qreal totalTime = helper.totalTime() / 1e6;
+
+    qDebug() << "Preset:" << preset->name() << "events:" << m_recording.events().size()
+             << "smoothing:" << smoothingType;
+    qDebug() << "    dabs:" << helper.numDabs()
+             << "throughput:" << (strokeTime > 0 ? helper.numDabs() / strokeTime * 1000.0 : 0.0) << "dabs/s";
+    qDebug() << "    dab latency (ms):"
+             << "p50" << percentile(latencies, 0.50)
+             << "p90" << percentile(latencies, 0.90)
+             << "p99" << percentile(latencies, 0.99)
+             << "max" << percentile(latencies, 1.0);
+    qDebug() << "    stroke time:" << strokeTime << "ms"
+             << "projection flush:" << totalTime - strokeTime << "ms"
+             << "total:" << totalTime << "ms";
+}
+
+void KisStrokeReplayBenchmark::softbrushReplay()
+{
+    benchmarkReplay("softbrush_30px.kpp");
+}
+
+void KisStrokeReplayBenchmark::autobrush70pxReplay()
+{
+    benchmarkReplay("AutoBrush_70px_rotated.kpp");
+}
+
+void KisStrokeReplayBenchmark::autobrush300pxReplay()
+{
+    benchmarkReplay("autobrush_300px.kpp");
+}
+
+void KisStrokeReplayBenchmark::weightedSmoothingReplay()
+{
+    benchmarkReplay("softbrush_30px.kpp", KisSmoothingOptions::WEIGHTED_SMOOTHING);
+}
+
+void KisStrokeReplayBenchmark::stabilizerReplay()
+{
+    benchmarkReplay("softbrush_30px.kpp", KisSmoothingOptions::STABILIZER);
+}
+
+void KisStrokeReplayBenchmark::environmentPresetReplay()
+{
+    const QString presetFileName = qgetenv("KRITA_REPLAY_PRESET");
+
+    if (presetFileName.isEmpty()) {
+        QSKIP("KRITA_REPLAY_PRESET is not set");
+    }
+
+    benchmarkReplay(presetFileName);
+}
+
+QTEST_MAIN(KisStrokeReplayBenchmark)
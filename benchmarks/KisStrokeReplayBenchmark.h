@@ -0,0 +1,67 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISSTROKEREPLAYBENCHMARK_H
+#define KISSTROKEREPLAYBENCHMARK_H
+
+#include <QtTest>
+
+#include <KisStrokeRecording.h>
+#include <kis_smoothing_options.h>
+
+/**
+ * Replays a recorded freehand stroke (see KisStrokeRecording) through
+ * KisToolFreehandHelper, the paintop and the update scheduler of a headless
+ * image and reports dab throughput, per-dab latency percentiles and the
+ * time needed to flush the projection after the stroke has ended.
+ *
+ * The stroke and the preset can be overridden with the environment:
+ *
+ *   KRITA_REPLAY_STROKE=/path/to/stroke.kstroke
+ *   KRITA_REPLAY_PRESET=/path/to/preset.kpp (or a file in benchmarks/data)
+ *
+ * Recordings are produced by Krita itself when stroke recording is enabled
+ * in the Performance page of the preferences. When no recording is given,
+ * a synthetic 'tablet-like' stroke is generated.
+ */
+class KisStrokeReplayBenchmark : public QObject
+{
+    Q_OBJECT
+private:
+    void benchmarkReplay(const QString &presetFileName,
+                         KisSmoothingOptions::SmoothingType smoothingType = KisSmoothingOptions::NO_SMOOTHING);
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testRecordingRoundTrip();
+    void testRecordingWithBrokenEventCount();
+
+    void softbrushReplay();
+    void autobrush70pxReplay();
+    void autobrush300pxReplay();
+    void weightedSmoothingReplay();
+    void stabilizerReplay();
+    void environmentPresetReplay();
+
+private:
+    QString m_dataPath;
+    KisStrokeRecording m_recording;
+};
+
+#endif // KISSTROKEREPLAYBENCHMARK_H
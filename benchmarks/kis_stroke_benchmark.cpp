@@ -27,6 +27,7 @@ inline double drand48()
 #endif
 
 #include <QTest>
+#include <QTransform>
 
 #include "kis_stroke_benchmark.h"
 #include "kis_benchmark_values.h"
@@ -49,6 +50,12 @@ inline double drand48()
 #include <kis_painter.h>
 #include <brushengine/kis_paintop_registry.h>
 
+#include <kis_resources_snapshot.h>
+#include <strokes/freehand_stroke.h>
+#include <strokes/KisFreehandStrokeInfo.h>
+#include <KisAsyncronousStrokeUpdateHelper.h>
+#include <kis_distance_information.h>
+
 //#define SAVE_OUTPUT
 
 static const int LINES = 20;
@@ -402,6 +409,30 @@ void KisStrokeBenchmark::roundMarkerRectangleHalfPixel()
 
 
 
+void KisStrokeBenchmark::softbrushMultihand16()
+{
+    QString presetFileName = "softbrush_30px.kpp";
+    benchmarkMultihand(presetFileName, 16, false);
+}
+
+void KisStrokeBenchmark::softbrushMultihand16Parallel()
+{
+    QString presetFileName = "softbrush_30px.kpp";
+    benchmarkMultihand(presetFileName, 16, true);
+}
+
+void KisStrokeBenchmark::autobrush70pxMultihand16()
+{
+    QString presetFileName = "AutoBrush_70px_rotated.kpp";
+    benchmarkMultihand(presetFileName, 16, false);
+}
+
+void KisStrokeBenchmark::autobrush70pxMultihand16Parallel()
+{
+    QString presetFileName = "AutoBrush_70px_rotated.kpp";
+    benchmarkMultihand(presetFileName, 16, true);
+}
+
 /*
 void KisStrokeBenchmark::predefinedBrush()
 {
@@ -593,6 +624,92 @@ void KisStrokeBenchmark::benchmarkStroke(QString presetFileName)
 #endif
 }
 
+void KisStrokeBenchmark::benchmarkMultihand(QString presetFileName, int numHands, bool parallelHands)
+{
+    KisPaintOpPresetSP preset = new KisPaintOpPreset(m_dataPath + presetFileName);
+    bool loadedOk = preset->load();
+    if (!loadedOk){
+        dbgKrita << "The preset was not loaded correctly. Done.";
+        return;
+    } else {
+        dbgKrita << "preset : " << presetFileName << "hands:" << numHands << "parallel:" << parallelHands;
+    }
+
+    /**
+     * The multihand stroke goes through the strokes framework, so it needs
+     * a layer that is really attached to the image
+     */
+    KisImageSP image = new KisImage(0, TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT, m_colorSpace, "multihand stroke image");
+    KisLayerSP layer = new KisPaintLayer(image, "multihand layer", OPACITY_OPAQUE_U8, m_colorSpace);
+    image->addNode(layer, image->root());
+    image->waitForDone();
+
+    const QPointF center(0.5 * TEST_IMAGE_WIDTH, 0.5 * TEST_IMAGE_HEIGHT);
+
+    QVector<QTransform> transforms;
+    for (int i = 0; i < numHands; i++) {
+        transforms << QTransform::fromTranslate(-center.x(), -center.y()) *
+                      QTransform().rotate(360.0 * i / numHands) *
+                      QTransform::fromTranslate(center.x(), center.y());
+    }
+
+    // a spiral-like curve running away from the center of the symmetry
+    const int numSegments = 50;
+    QVector<KisPaintInformation> points;
+    for (int i = 0; i <= numSegments; i++) {
+        const qreal t = qreal(i) / numSegments;
+        const qreal radius = 0.05 * TEST_IMAGE_HEIGHT + 0.4 * t * TEST_IMAGE_HEIGHT;
+        const qreal angle = 0.5 * M_PI * t;
+
+        points << KisPaintInformation(center + radius * QPointF(cos(angle), sin(angle)), t);
+    }
+
+    QBENCHMARK {
+        KisResourcesSnapshotSP resources = new KisResourcesSnapshot(image, layer);
+        resources->setBrush(preset);
+        resources->setFGColorOverride(KoColor(Qt::black, m_colorSpace));
+
+        QVector<KisFreehandStrokeInfo*> strokeInfos;
+        for (int i = 0; i < numHands; i++) {
+            strokeInfos << new KisFreehandStrokeInfo();
+        }
+
+        KisStrokeStrategy *stroke =
+            new FreehandStrokeStrategy(resources, strokeInfos, kundo2_noi18n("multihand_stroke"));
+
+        KisStrokeId strokeId = image->startStroke(stroke);
+
+        for (int j = 1; j < points.size(); j++) {
+            QVector<FreehandStrokeStrategy::Data*> hands;
+
+            for (int i = 0; i < numHands; i++) {
+                KisPaintInformation pi1 = points[j - 1];
+                KisPaintInformation pi2 = points[j];
+                pi1.setPos(transforms[i].map(pi1.pos()));
+                pi2.setPos(transforms[i].map(pi2.pos()));
+
+                hands << new FreehandStrokeStrategy::Data(i, pi1, pi2);
+            }
+
+            if (parallelHands) {
+                image->addJob(strokeId, new FreehandStrokeStrategy::MultihandData(hands));
+            } else {
+                Q_FOREACH (FreehandStrokeStrategy::Data *hand, hands) {
+                    image->addJob(strokeId, hand);
+                }
+            }
+        }
+
+        image->addJob(strokeId, new KisAsyncronousStrokeUpdateHelper::UpdateData(true));
+        image->endStroke(strokeId);
+        image->waitForDone();
+    }
+
+#ifdef SAVE_OUTPUT
+    layer->paintDevice()->convertToQImage(0).save(m_outputPath + presetFileName + "_multihand" + OUTPUT_FORMAT);
+#endif
+}
+
 static const int COUNT = 1000000;
 void KisStrokeBenchmark::benchmarkRand48()
 {
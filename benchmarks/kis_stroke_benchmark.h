@@ -68,6 +68,7 @@ private:
         inline void benchmarkLine(QString presetFileName);
         inline void benchmarkCircle(QString presetFileName);
         inline void benchmarkRectangle(QString presetFileName);
+        inline void benchmarkMultihand(QString presetFileName, int numHands, bool parallelHands);
 
 private Q_SLOTS:
     void initTestCase();
@@ -135,6 +136,12 @@ private Q_SLOTS:
     void roundMarkerRandomLinesHalfPixel();
     void roundMarkerRectangleHalfPixel();
 
+    // Radial symmetry (multihand tool) benchmarks
+    void softbrushMultihand16();
+    void softbrushMultihand16Parallel();
+    void autobrush70pxMultihand16();
+    void autobrush70pxMultihand16Parallel();
+
 /*
     void predefinedBrush();
     void predefinedBrushRL();
@@ -34,6 +34,7 @@
 #include "kis_types.h"
 #include "kis_sequential_iterator.h"
 #include "kis_transform_worker.h"
+#include "KisThumbnailPyramid.h"
 
 
 
@@ -157,5 +158,40 @@ void KisThumbnailBenchmark::benchmarkCreateThumbnailHiQcreateThumbOversample4x()
     image.save("createThumbnailHiQcreateThumbOversample4x.png");
 }
 
+void KisThumbnailBenchmark::benchmarkCreateThumbnailPyramid()
+{
+    QImage image;
+
+    QBENCHMARK{
+        KisThumbnailPyramid pyramid;
+        image = pyramid.createThumbnail(m_dev, QRect(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT),
+                                        QSize(THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT),
+                                        m_colorSpace->profile());
+    }
+
+    image.save("createThumbnailPyramid.png");
+}
+
+void KisThumbnailBenchmark::benchmarkCreateThumbnailPyramidIncremental()
+{
+    QImage image;
+    KisThumbnailPyramid pyramid;
+
+    const QRect imageRect(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT);
+    const QSize thumbnailSize(THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT);
+
+    image = pyramid.createThumbnail(m_dev, imageRect, thumbnailSize, m_colorSpace->profile());
+
+    int i = 0;
+
+    QBENCHMARK{
+        // emulate a stroke touching a small part of the image
+        pyramid.addDirtyRect(QRect((i * 97) % IMAGE_WIDTH, (i * 61) % IMAGE_HEIGHT, 200, 200));
+        image = pyramid.createThumbnail(m_dev, imageRect, thumbnailSize, m_colorSpace->profile());
+        i++;
+    }
+
+    image.save("createThumbnailPyramidIncremental.png");
+}
 
 QTEST_MAIN(KisThumbnailBenchmark)
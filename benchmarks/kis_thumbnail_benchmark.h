@@ -49,6 +49,9 @@ private Q_SLOTS:
     void benchmarkCreateThumbnailHiQcreateThumbOversample3x();
     void benchmarkCreateThumbnailHiQcreateThumbOversample4x();
 
+    void benchmarkCreateThumbnailPyramid();
+    void benchmarkCreateThumbnailPyramidIncremental();
+
 };
 
 
@@ -298,6 +298,21 @@ void KisAutoBrush::generateMaskAndApplyMaskOrCreateDab(KisFixedPaintDeviceSP dst
                             centerX, centerY,
                             angle);
 
+    /**
+     * Large soft dabs are mostly transparent, so let the applicator record
+     * which part of every row is really painted. KisPainter will skip the
+     * rest of the dab when compositing it.
+     */
+    QVector<KisFixedPaintDevice::RowSpan> rowSpans;
+    const bool canTrackRowSpans = dst->bounds() == QRect(0, 0, dstWidth, dstHeight);
+
+    if (canTrackRowSpans) {
+        rowSpans.resize(dstHeight);
+        data.rowSpans = rowSpans.data();
+    } else {
+        dst->resetRowSpans();
+    }
+
     KisBrushMaskApplicatorBase *applicator = d->shape->applicator();
     applicator->initializeData(&data);
 
@@ -316,6 +331,10 @@ void KisAutoBrush::generateMaskAndApplyMaskOrCreateDab(KisFixedPaintDeviceSP dst
         QRect rect(0, 0, dstWidth, dstHeight);
         applicator->process(rect);
     }
+
+    if (canTrackRowSpans) {
+        dst->setRowSpans(rowSpans);
+    }
 }
 
 
@@ -0,0 +1,160 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisDisplacementGrid.h"
+
+#include <QVarLengthArray>
+
+#include <algorithm>
+
+#include "kis_assert.h"
+
+
+KisDisplacementGrid::KisDisplacementGrid()
+{
+}
+
+KisDisplacementGrid::KisDisplacementGrid(const QRect &rect, int step)
+    : m_rect(rect),
+      m_step(qMax(1, step))
+{
+    if (m_rect.isEmpty()) return;
+
+    m_cols = (m_rect.width() + m_step - 1) / m_step + 1;
+    m_rows = (m_rect.height() + m_step - 1) / m_step + 1;
+
+    m_dx.resize(m_cols * m_rows);
+    m_dy.resize(m_cols * m_rows);
+}
+
+QRect KisDisplacementGrid::rect() const
+{
+    return m_rect;
+}
+
+int KisDisplacementGrid::step() const
+{
+    return m_step;
+}
+
+bool KisDisplacementGrid::isEmpty() const
+{
+    return m_dx.isEmpty();
+}
+
+void KisDisplacementGrid::interpolateRow(int x, int y, int width, float *dx, float *dy) const
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(!isEmpty());
+    KIS_SAFE_ASSERT_RECOVER_RETURN(x >= m_rect.x() && x + width <= m_rect.x() + m_rect.width());
+    KIS_SAFE_ASSERT_RECOVER_RETURN(y >= m_rect.y() && y < m_rect.y() + m_rect.height());
+
+    /**
+     * First, interpolate the two neighbouring rows of nodes vertically
+     * into the row buffers, then interpolate the buffers horizontally
+     * for every pixel
+     */
+
+    const int localY = y - m_rect.y();
+    const int row = localY / m_step;
+    const float fy = float(localY - row * m_step) / m_step;
+
+    const int firstCol = (x - m_rect.x()) / m_step;
+    const int lastCol = qMin(m_cols - 1, (x + width - 1 - m_rect.x()) / m_step + 1);
+    const int numCols = lastCol - firstCol + 1;
+
+    QVarLengthArray<float, 128> rowBufferX(numCols);
+    QVarLengthArray<float, 128> rowBufferY(numCols);
+
+    const float *topX = m_dx.constData() + row * m_cols + firstCol;
+    const float *topY = m_dy.constData() + row * m_cols + firstCol;
+    const float *bottomX = topX + m_cols;
+    const float *bottomY = topY + m_cols;
+
+    float *bufX = rowBufferX.data();
+    float *bufY = rowBufferY.data();
+
+    for (int i = 0; i < numCols; i++) {
+        bufX[i] = topX[i] + fy * (bottomX[i] - topX[i]);
+        bufY[i] = topY[i] + fy * (bottomY[i] - topY[i]);
+    }
+
+    const float invStep = 1.0f / m_step;
+    int localX = x - m_rect.x() - firstCol * m_step;
+    int pixel = 0;
+
+    while (pixel < width) {
+        const int col = localX / m_step;
+        const int cellStart = col * m_step;
+        const int cellPixels = qMin(width - pixel, cellStart + m_step - localX);
+
+        const float x0 = bufX[col];
+        const float y0 = bufY[col];
+        const float stepX = (bufX[col + 1] - x0) * invStep;
+        const float stepY = (bufY[col + 1] - y0) * invStep;
+        const int offset = localX - cellStart;
+
+        float *dstX = dx + pixel;
+        float *dstY = dy + pixel;
+
+        for (int i = 0; i < cellPixels; i++) {
+            dstX[i] = x0 + (offset + i) * stepX;
+            dstY[i] = y0 + (offset + i) * stepY;
+        }
+
+        pixel += cellPixels;
+        localX += cellPixels;
+    }
+}
+
+QPointF KisDisplacementGrid::valueAt(const QPointF &pt) const
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(!isEmpty(), QPointF());
+
+    const qreal localX = qBound(qreal(0.0), pt.x() - m_rect.x(), qreal((m_cols - 1) * m_step));
+    const qreal localY = qBound(qreal(0.0), pt.y() - m_rect.y(), qreal((m_rows - 1) * m_step));
+
+    const int col = qMin(m_cols - 2, int(localX / m_step));
+    const int row = qMin(m_rows - 2, int(localY / m_step));
+
+    const qreal fx = localX / m_step - col;
+    const qreal fy = localY / m_step - row;
+
+    const int tl = row * m_cols + col;
+    const int tr = tl + 1;
+    const int bl = tl + m_cols;
+    const int br = bl + 1;
+
+    const qreal topX = m_dx[tl] + fx * (m_dx[tr] - m_dx[tl]);
+    const qreal topY = m_dy[tl] + fx * (m_dy[tr] - m_dy[tl]);
+    const qreal bottomX = m_dx[bl] + fx * (m_dx[br] - m_dx[bl]);
+    const qreal bottomY = m_dy[bl] + fx * (m_dy[br] - m_dy[bl]);
+
+    return QPointF(topX + fy * (bottomX - topX),
+                   topY + fy * (bottomY - topY));
+}
+
+QRectF KisDisplacementGrid::valueBounds() const
+{
+    if (isEmpty()) return QRectF();
+
+    const auto rangeX = std::minmax_element(m_dx.constBegin(), m_dx.constEnd());
+    const auto rangeY = std::minmax_element(m_dy.constBegin(), m_dy.constEnd());
+
+    return QRectF(QPointF(*rangeX.first, *rangeY.first),
+                  QPointF(*rangeX.second, *rangeY.second));
+}
@@ -0,0 +1,108 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISDISPLACEMENTGRID_H
+#define KISDISPLACEMENTGRID_H
+
+#include <QRect>
+#include <QRectF>
+#include <QPointF>
+#include <QVector>
+
+#include "kritaimage_export.h"
+
+/**
+ * A vector field sampled on a coarse regular grid.
+ *
+ * Deformation-like brushes (deform paintop, liquify) calculate a
+ * displacement for every pixel or every mesh point, which usually involves
+ * trigonometry or exponents. When the field is smooth, it is much cheaper
+ * to calculate it only in the nodes of a coarse grid and interpolate the
+ * rest bilinearly.
+ *
+ * The grid covers \p rect with nodes placed every \p step pixels starting
+ * at rect.topLeft(). The last row/column of nodes is placed at or beyond
+ * the right/bottom edge of the rect, so every point of the rect is covered
+ * by a complete cell.
+ */
+class KRITAIMAGE_EXPORT KisDisplacementGrid
+{
+public:
+    KisDisplacementGrid();
+    KisDisplacementGrid(const QRect &rect, int step);
+
+    QRect rect() const;
+    int step() const;
+    bool isEmpty() const;
+
+    /**
+     * Calculates the value of the field in every node of the grid.
+     *
+     * \p func is called as `QPointF func(const QPointF &pt)` with the
+     * position of the node
+     */
+    template <class Func>
+    void fill(Func func) {
+        float *dx = m_dx.data();
+        float *dy = m_dy.data();
+
+        for (int row = 0; row < m_rows; row++) {
+            const qreal y = m_rect.y() + row * m_step;
+
+            for (int col = 0; col < m_cols; col++) {
+                const QPointF value = func(QPointF(m_rect.x() + col * m_step, y));
+                *dx++ = value.x();
+                *dy++ = value.y();
+            }
+        }
+    }
+
+    /**
+     * Bilinearly interpolates the field for \p width pixels of row \p y
+     * starting at \p x. The results are written into \p dx and \p dy arrays.
+     *
+     * The inner loop works on plain float arrays, so it is vectorized by
+     * the compiler.
+     */
+    void interpolateRow(int x, int y, int width, float *dx, float *dy) const;
+
+    /**
+     * Bilinearly interpolates the field at an arbitrary point. The point is
+     * clamped to the rect of the grid.
+     */
+    QPointF valueAt(const QPointF &pt) const;
+
+    /**
+     * @return the bounding rect of the values stored in the nodes. Since
+     * the interpolated values never leave the range of the nodes of their
+     * cell, it bounds every value returned by interpolateRow() and
+     * valueAt() as well.
+     */
+    QRectF valueBounds() const;
+
+private:
+    QRect m_rect;
+    int m_step = 1;
+    int m_cols = 0;
+    int m_rows = 0;
+
+    QVector<float> m_dx;
+    QVector<float> m_dy;
+};
+
+#endif // KISDISPLACEMENTGRID_H
@@ -0,0 +1,244 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "KisThumbnailPyramid.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegion>
+#include <QPointer>
+
+#include <utility>
+
+#include <KoColorSpace.h>
+#include <KoUpdater.h>
+
+#include "kis_paint_device.h"
+#include "kis_painter.h"
+#include "kis_lod_transform.h"
+#include "kis_transform_worker.h"
+#include "kis_filter_strategy.h"
+
+
+namespace {
+
+/**
+ * The maximum level of detail of the cached level, level 8 is 1/256
+ * of the original size, which is enough even for very big canvases
+ */
+const int maxLevelOfDetail = 8;
+
+/**
+ * When the dirty region becomes too fragmented, it is cheaper to
+ * resample its bounding rect than to keep merging the rects
+ */
+const int maxDirtyRects = 64;
+
+}
+
+struct KisThumbnailPyramid::Private
+{
+    /**
+     * The source device scaled down by 2^levelOfDetail
+     */
+    KisPaintDeviceSP level;
+    int levelOfDetail = 0;
+
+    /**
+     * The source is tracked with a weak pointer, so a new device
+     * allocated at the address of a deleted one is never mistaken
+     * for the device the level was generated from
+     */
+    KisPaintDeviceWSP sourceDevice;
+    const KoColorSpace *colorSpace = 0;
+    QRect syncedRect;
+
+    /**
+     * The dirty region is accumulated under its own lock, so the
+     * update threads are not blocked while the level is resampled
+     */
+    QMutex dirtyLock;
+    QRegion dirtyRegion;
+    bool fullyDirty = true;
+
+    QMutex syncLock;
+
+    int chooseLevelOfDetail(const QRect &sourceRect, const QSize &size) const;
+    void resetLevel();
+};
+
+KisThumbnailPyramid::KisThumbnailPyramid()
+    : m_d(new Private)
+{
+}
+
+KisThumbnailPyramid::~KisThumbnailPyramid()
+{
+}
+
+void KisThumbnailPyramid::addDirtyRect(const QRect &rc)
+{
+    if (rc.isEmpty()) return;
+
+    QMutexLocker l(&m_d->dirtyLock);
+    if (!m_d->fullyDirty) {
+        m_d->dirtyRegion += rc;
+
+        if (m_d->dirtyRegion.rectCount() > maxDirtyRects) {
+            m_d->dirtyRegion = m_d->dirtyRegion.boundingRect();
+        }
+    }
+}
+
+void KisThumbnailPyramid::invalidate()
+{
+    {
+        QMutexLocker l(&m_d->dirtyLock);
+        m_d->fullyDirty = true;
+        m_d->dirtyRegion = QRegion();
+    }
+
+    /**
+     * Don't wait for a thumbnail being generated in another thread,
+     * the level will be dropped on the next request anyway
+     */
+    if (m_d->syncLock.tryLock()) {
+        m_d->resetLevel();
+        m_d->syncLock.unlock();
+    }
+}
+
+int KisThumbnailPyramid::cachedLevelOfDetail() const
+{
+    QMutexLocker l(&m_d->syncLock);
+    return m_d->level ? m_d->levelOfDetail : 0;
+}
+
+int KisThumbnailPyramid::Private::chooseLevelOfDetail(const QRect &sourceRect, const QSize &size) const
+{
+    int lod = 0;
+
+    while (lod < maxLevelOfDetail &&
+           (sourceRect.width() >> (lod + 1)) >= 2 * size.width() &&
+           (sourceRect.height() >> (lod + 1)) >= 2 * size.height()) {
+        lod++;
+    }
+
+    return lod;
+}
+
+void KisThumbnailPyramid::Private::resetLevel()
+{
+    level = 0;
+    levelOfDetail = 0;
+    sourceDevice = 0;
+    colorSpace = 0;
+    syncedRect = QRect();
+}
+
+KisPaintDeviceSP KisThumbnailPyramid::levelForSize(KisPaintDeviceSP source, const QRect &sourceRect, const QSize &size, int *lod)
+{
+    *lod = m_d->chooseLevelOfDetail(sourceRect, size);
+    if (!*lod) return source;
+
+    QMutexLocker l(&m_d->syncLock);
+
+    QRegion dirtyRegion;
+    bool fullyDirty = false;
+
+    {
+        QMutexLocker dirtyLocker(&m_d->dirtyLock);
+        std::swap(dirtyRegion, m_d->dirtyRegion);
+        std::swap(fullyDirty, m_d->fullyDirty);
+    }
+
+    if (fullyDirty ||
+        !m_d->level ||
+        m_d->levelOfDetail != *lod ||
+        !m_d->sourceDevice.isValid() ||
+        m_d->sourceDevice != source.data() ||
+        m_d->colorSpace != source->colorSpace()) {
+
+        m_d->resetLevel();
+
+        m_d->level = new KisPaintDevice(source->colorSpace());
+        m_d->level->prepareClone(source);
+        m_d->levelOfDetail = *lod;
+        m_d->sourceDevice = source;
+        m_d->colorSpace = source->colorSpace();
+
+        dirtyRegion = QRegion();
+    }
+
+    /**
+     * The areas that were already synced are updated where they are
+     * dirty only, the rest of the requested rect is generated from
+     * scratch
+     */
+    const QRect requestedRect = source->extent() | sourceRect;
+    dirtyRegion += QRegion(requestedRect) - QRegion(m_d->syncedRect);
+
+    Q_FOREACH (const QRect &rc, dirtyRegion.rects()) {
+        source->generateLodCloneDevice(m_d->level, KisLodTransform::alignedRect(rc, *lod), *lod);
+    }
+
+    m_d->syncedRect |= requestedRect;
+
+    return m_d->level;
+}
+
+QImage KisThumbnailPyramid::createThumbnail(KisPaintDeviceSP source, const QRect &sourceRect, const QSize &size,
+                                            const KoColorProfile *profile,
+                                            KoColorConversionTransformation::Intent renderingIntent,
+                                            KoColorConversionTransformation::ConversionFlags conversionFlags)
+{
+    if (size.isEmpty() || sourceRect.isEmpty()) {
+        return QImage();
+    }
+
+    int lod = 0;
+    KisPaintDeviceSP level = levelForSize(source, sourceRect, size, &lod);
+
+    /**
+     * Partially covered pixels on the right and bottom edges are
+     * skipped, they would blend the default pixel into the thumbnail
+     */
+    const QRect levelRect(KisLodTransform::coordToLodCoord(sourceRect.x(), lod),
+                          KisLodTransform::coordToLodCoord(sourceRect.y(), lod),
+                          qMax(1, sourceRect.width() >> lod),
+                          qMax(1, sourceRect.height() >> lod));
+
+    KisPaintDeviceSP dev = new KisPaintDevice(source->colorSpace());
+
+    {
+        QMutexLocker l(&m_d->syncLock);
+        KisPainter::copyAreaOptimized(QPoint(), level, dev, levelRect);
+    }
+
+    const qreal scaleX = qreal(size.width()) / levelRect.width();
+    const qreal scaleY = qreal(size.height()) / levelRect.height();
+
+    QPointer<KoUpdater> updater = new KoDummyUpdater();
+
+    KisTransformWorker worker(dev, scaleX, scaleY, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, updater, KisFilterStrategyRegistry::instance()->value("Bicubic"));
+    worker.run();
+
+    delete updater;
+
+    const QRect thumbnailRect = dev->exactBounds() & QRect(QPoint(), size);
+    return dev->convertToQImage(profile, thumbnailRect, renderingIntent, conversionFlags);
+}
@@ -0,0 +1,101 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef KISTHUMBNAILPYRAMID_H
+#define KISTHUMBNAILPYRAMID_H
+
+#include <QScopedPointer>
+#include <QImage>
+
+#include <KoColorConversionTransformation.h>
+
+#include "kis_types.h"
+#include "kritaimage_export.h"
+
+class KoColorProfile;
+
+/**
+ * KisThumbnailPyramid keeps a downscaled copy of a paint device that
+ * is used for creating thumbnails of it. The copy is generated with
+ * the same box filter as the LoD planes of KisPaintDevice and is
+ * updated incrementally: the owner reports the changed areas of the
+ * source device with addDirtyRect() and only these areas are
+ * resampled when the next thumbnail is requested.
+ *
+ * Only one level of detail is kept at a time: the smallest one that
+ * is still at least twice as big as the requested size. It is
+ * generated from the source device directly, so the intermediate
+ * levels are never allocated. The memory cost is therefore 1/4^lod of
+ * the source device (at most 1/4 of it); requesting a thumbnail of a
+ * different size drops the level and generates a new one. Use
+ * invalidate() to free the level when thumbnails are not needed
+ * anymore.
+ *
+ * addDirtyRect() and invalidate() may be called from any thread.
+ */
+class KRITAIMAGE_EXPORT KisThumbnailPyramid
+{
+public:
+    KisThumbnailPyramid();
+    ~KisThumbnailPyramid();
+
+    /**
+     * Marks \p rc of the source device as changed
+     */
+    void addDirtyRect(const QRect &rc);
+
+    /**
+     * Drops the cached level and frees its memory. Changes of the
+     * color space or replacement of the source device are detected
+     * automatically
+     */
+    void invalidate();
+
+    /**
+     * Brings the cached level in sync with \p source and returns the
+     * level most suitable for creating a thumbnail of \p size out of
+     * \p sourceRect. The level of detail of the returned device is
+     * written into \p lod. When no downscaling is needed, \p source
+     * itself is returned and \p lod is set to zero.
+     */
+    KisPaintDeviceSP levelForSize(KisPaintDeviceSP source, const QRect &sourceRect, const QSize &size, int *lod);
+
+    /**
+     * Creates a thumbnail of \p sourceRect scaled to \p size with a
+     * bicubic filter and converts it into \p profile.
+     *
+     * Like KisPaintDevice::convertToQImage(), the thumbnail is cropped
+     * to the non-transparent area, so it may be smaller than \p size
+     * and it is null when \p sourceRect is fully transparent.
+     */
+    QImage createThumbnail(KisPaintDeviceSP source, const QRect &sourceRect, const QSize &size,
+                           const KoColorProfile *profile,
+                           KoColorConversionTransformation::Intent renderingIntent = KoColorConversionTransformation::internalRenderingIntent(),
+                           KoColorConversionTransformation::ConversionFlags conversionFlags = KoColorConversionTransformation::internalConversionFlags());
+
+    /**
+     * \return the level of detail of the cached level or zero if
+     * no level is cached
+     */
+    int cachedLevelOfDetail() const;
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISTHUMBNAILPYRAMID_H
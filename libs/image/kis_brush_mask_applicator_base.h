@@ -42,6 +42,7 @@ struct MaskProcessingData {
             cosa = cos(_angle);
             sina = sin(_angle);
             pixelSize = colorSpace->pixelSize();
+            rowSpans = 0;
         }
 
 
@@ -57,6 +58,13 @@ struct MaskProcessingData {
     double sina;
 
     qint32 pixelSize;
+
+    /**
+     * If not null, the applicator writes the span of the non-transparent
+     * pixels of every processed row here. The array should have one
+     * element per row of the device.
+     */
+    KisFixedPaintDevice::RowSpan *rowSpans;
 };
 
 class KisBrushMaskApplicatorBase
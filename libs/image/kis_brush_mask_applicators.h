@@ -115,6 +115,9 @@ void KisBrushMaskVectorApplicator<MaskGenerator, _impl>::processVector(const QRe
 
         processor.template process<_impl>(buffer, simdWidth, y, m_d->cosa, m_d->sina, m_d->centerX, m_d->centerY);
 
+        int spanStart = width;
+        int spanEnd = 0;
+
         if (m_d->randomness != 0.0 || m_d->density != 1.0) {
             for (int x = 0; x < width; x++) {
 
@@ -134,13 +137,34 @@ void KisBrushMaskVectorApplicator<MaskGenerator, _impl>::processVector(const QRe
                     }
                 }
 
+                if (alphaValue != OPACITY_TRANSPARENT_U8) {
+                    spanStart = qMin(spanStart, x);
+                    spanEnd = x + 1;
+                }
+
                 m_d->colorSpace->applyAlphaU8Mask(dabPointer, &alphaValue, 1);
                 dabPointer += m_d->pixelSize;
             }
         } else {
             m_d->colorSpace->applyInverseNormedFloatMask(dabPointer, buffer, width);
             dabPointer += width * m_d->pixelSize;
+
+            if (m_d->rowSpans) {
+                // the buffer is inverted, 1.0 means fully transparent pixel
+                spanStart = 0;
+                while (spanStart < width && buffer[spanStart] >= 1.0f) spanStart++;
+
+                spanEnd = width;
+                while (spanEnd > spanStart && buffer[spanEnd - 1] >= 1.0f) spanEnd--;
+            }
         }//endfor x
+
+        if (m_d->rowSpans) {
+            KisFixedPaintDevice::RowSpan &span = m_d->rowSpans[y];
+            span.start = spanStart < spanEnd ? rect.x() + spanStart : 0;
+            span.end = spanStart < spanEnd ? rect.x() + spanEnd : 0;
+        }
+
         dabPointer += offset;
     }//endfor y
     Vc::free(buffer);
@@ -163,6 +187,9 @@ void KisBrushMaskScalarApplicator<MaskGenerator, _impl>::processScalar(const QRe
     double invss = 1.0 / supersample;
     int samplearea = pow2(supersample);
     for (int y = rect.y(); y < rect.y() + rect.height(); y++) {
+        int spanStart = rect.x() + rect.width();
+        int spanEnd = rect.x();
+
         for (int x = rect.x(); x < rect.x() + rect.width(); x++) {
             int value = 0;
             for (int sy = 0; sy < supersample; sy++) {
@@ -192,9 +219,21 @@ void KisBrushMaskScalarApplicator<MaskGenerator, _impl>::processScalar(const QRe
                 }
             }
 
+            if (alphaValue != OPACITY_TRANSPARENT_U8) {
+                spanStart = qMin(spanStart, x);
+                spanEnd = x + 1;
+            }
+
             m_d->colorSpace->applyAlphaU8Mask(dabPointer, &alphaValue, 1);
             dabPointer += m_d->pixelSize;
         }//endfor x
+
+        if (m_d->rowSpans) {
+            KisFixedPaintDevice::RowSpan &span = m_d->rowSpans[y];
+            span.start = spanStart < spanEnd ? spanStart : 0;
+            span.end = spanStart < spanEnd ? spanEnd : 0;
+        }
+
         dabPointer += offset;
     }//endfor y
 }
@@ -24,6 +24,8 @@
 #include "kis_iterator_ng.h"
 
 
+#include <QVector>
+
 #include <KoColorSpace.h>
 #include <KoMixColorsOp.h>
 
@@ -232,7 +234,9 @@ public:
         const KoColor defaultPixelObject = m_src->defaultPixel();
         const quint8 *defaultPixel = defaultPixelObject.data();
         const quint8 *borderPixel = defaultPixel;
-        quint8 *srcLineBuf = new quint8[pixelSize * (rightSrcBorder - leftSrcBorder)];
+
+        m_srcLineBuf.resize(pixelSize * (rightSrcBorder - leftSrcBorder));
+        quint8 *srcLineBuf = m_srcLineBuf.data();
 
         int i = leftSrcBorder;
         quint8 *bufPtr = srcLineBuf;
@@ -262,26 +266,48 @@ public:
             memcpy(bufPtr, borderPixel, pixelSize);
         }
 
-        const quint8 **colors = new const quint8* [buffer->maxSpan()];
+        /**
+         * Collect the blend spans of the whole line first and mix them
+         * with a single call to the mix op. The buffers are reused for
+         * all the lines processed by the applicator.
+         */
+        const int maxSpan = buffer->maxSpan();
+        const int numDstPixels = dstEnd - dstStart;
+
+        m_colors.resize(numDstPixels * maxSpan);
+        m_weights.resize(numDstPixels * maxSpan);
+        m_spans.resize(numDstPixels);
+        m_dstLineBuf.resize(pixelSize * numDstPixels);
+
+        const quint8 **colorsPtr = m_colors.data();
+        qint16 *weightsPtr = m_weights.data();
+        quint32 *spansPtr = m_spans.data();
 
-        T dstIt = tmp::createIterator<T>(m_dst, dstStart, line, dstEnd - dstStart);
         for (int i = dstStart; i < dstEnd; i++) {
             BlendSpan span = calculateBlendSpan(i, line, buffer);
 
             int bufIndexStart = span.firstBlendPixel - leftSrcBorder;
             int bufIndexEnd = bufIndexStart + span.weights->span;
 
-            const quint8 **colorsPtr = colors;
             for (int j = bufIndexStart; j < bufIndexEnd; j++) {
                 *(colorsPtr++) = srcLineBuf + j * pixelSize;
             }
 
-            mixOp->mixColors(colors, span.weights->weight, span.weights->span, dstIt->rawData());
-            dstIt->nextPixel();
+            memcpy(weightsPtr, span.weights->weight, span.weights->span * sizeof(qint16));
+            weightsPtr += span.weights->span;
+
+            *(spansPtr++) = span.weights->span;
         }
 
-        delete[] colors;
-        delete[] srcLineBuf;
+        quint8 *dstLineBuf = m_dstLineBuf.data();
+        mixOp->mixColorsRow(m_colors.constData(), m_weights.constData(), m_spans.constData(), dstLineBuf, numDstPixels);
+
+        T dstIt = tmp::createIterator<T>(m_dst, dstStart, line, numDstPixels);
+        quint8 *dstBufPtr = dstLineBuf;
+        for (int i = dstStart; i < dstEnd; i++, dstBufPtr += pixelSize) {
+            memcpy(dstIt->rawData(), dstBufPtr, pixelSize);
+            dstIt->nextPixel();
+        }
 
         return LinePos(dstStart, qMax(0, dstEnd - dstStart));
     }
@@ -332,6 +358,12 @@ private:
     qreal m_shear;
     qreal m_dx;
     bool m_clampToEdge;
+
+    QVector<quint8> m_srcLineBuf;
+    QVector<quint8> m_dstLineBuf;
+    QVector<const quint8*> m_colors;
+    QVector<qint16> m_weights;
+    QVector<quint32> m_spans;
 };
 
 #endif /* __KIS_FILTER_WEIGHTS_APPLICATOR_H */
@@ -23,6 +23,8 @@
 #include <KoColorModelStandardIds.h>
 #include "kis_debug.h"
 
+#include <algorithm>
+
 KisFixedPaintDevice::KisFixedPaintDevice(const KoColorSpace* colorSpace, KisOptimizedByteArray::MemoryAllocatorSP allocator)
         : m_colorSpace(colorSpace),
           m_data(allocator)
@@ -39,6 +41,7 @@ KisFixedPaintDevice::KisFixedPaintDevice(const KisFixedPaintDevice& rhs)
     m_bounds = rhs.m_bounds;
     m_colorSpace = rhs.m_colorSpace;
     m_data = rhs.m_data;
+    m_rowSpans = rhs.m_rowSpans;
 }
 
 KisFixedPaintDevice& KisFixedPaintDevice::operator=(const KisFixedPaintDevice& rhs)
@@ -55,12 +58,15 @@ KisFixedPaintDevice& KisFixedPaintDevice::operator=(const KisFixedPaintDevice& r
         m_data = rhs.m_data;
     }
 
+    m_rowSpans = rhs.m_rowSpans;
+
     return *this;
 }
 
 void KisFixedPaintDevice::setRect(const QRect& rc)
 {
     m_bounds = rc;
+    m_rowSpans.clear();
 }
 
 
@@ -84,6 +90,7 @@ quint32 KisFixedPaintDevice::pixelSize() const
 bool KisFixedPaintDevice::initialize(quint8 defaultValue)
 {
     m_data.fill(defaultValue, m_bounds.height() * m_bounds.width() * pixelSize());
+    m_rowSpans.clear();
 
     return true;
 }
@@ -255,6 +262,8 @@ void KisFixedPaintDevice::fill(const QRect &rc, const KoColor &color)
 
 void KisFixedPaintDevice::fill(qint32 x, qint32 y, qint32 w, qint32 h, const quint8 *fillPixel)
 {
+    m_rowSpans.clear();
+
     if (m_data.isEmpty() || m_bounds.isEmpty()) {
         setRect(QRect(x, y, w, h));
         reallocateBufferWithoutInitialization();
@@ -367,4 +376,75 @@ void KisFixedPaintDevice::mirror(bool horizontal, bool vertical)
         delete [] row;
     }
 
+    if (!m_rowSpans.isEmpty()) {
+        if (horizontal) {
+            for (auto it = m_rowSpans.begin(); it != m_rowSpans.end(); ++it) {
+                const qint32 start = it->start;
+                it->start = w - it->end;
+                it->end = w - start;
+            }
+        }
+
+        if (vertical) {
+            std::reverse(m_rowSpans.begin(), m_rowSpans.end());
+        }
+    }
+}
+
+void KisFixedPaintDevice::setRowSpans(const QVector<RowSpan> &spans)
+{
+    KIS_SAFE_ASSERT_RECOVER(spans.size() == m_bounds.height()) {
+        m_rowSpans.clear();
+        return;
+    }
+
+    m_rowSpans = spans;
+}
+
+const QVector<KisFixedPaintDevice::RowSpan>& KisFixedPaintDevice::rowSpans() const
+{
+    return m_rowSpans;
+}
+
+bool KisFixedPaintDevice::hasRowSpans() const
+{
+    return !m_rowSpans.isEmpty();
+}
+
+void KisFixedPaintDevice::resetRowSpans()
+{
+    m_rowSpans.clear();
+}
+
+QRect KisFixedPaintDevice::nonTransparentRect(const QRect &rc) const
+{
+    if (m_rowSpans.isEmpty()) return rc;
+
+    const QRect clippedRect = rc & m_bounds;
+
+    const int x0 = clippedRect.left() - m_bounds.left();
+    const int x1 = clippedRect.right() - m_bounds.left() + 1;
+
+    int top = -1;
+    int bottom = -1;
+    int left = x1;
+    int right = x0;
+
+    for (int y = clippedRect.top(); y <= clippedRect.bottom(); y++) {
+        const RowSpan &span = m_rowSpans[y - m_bounds.top()];
+
+        const int start = qMax(span.start, x0);
+        const int end = qMin(span.end, x1);
+        if (start >= end) continue;
+
+        if (top < 0) top = y;
+        bottom = y;
+
+        left = qMin(left, start);
+        right = qMax(right, end);
+    }
+
+    if (top < 0) return QRect();
+
+    return QRect(m_bounds.left() + left, top, right - left, bottom - top + 1);
 }
@@ -25,6 +25,7 @@
 
 #include <QRect>
 #include <QImage>
+#include <QVector>
 #include "KisOptimizedByteArray.h"
 
 class KoColor;
@@ -39,6 +40,18 @@ class KoColor;
 class KRITAIMAGE_EXPORT KisFixedPaintDevice : public KisShared
 {
 
+public:
+
+    /**
+     * A span of a row of the device that may contain non-transparent
+     * pixels. Columns are counted from the left border of bounds(), the
+     * span is empty when start == end.
+     */
+    struct RowSpan {
+        qint32 start = 0;
+        qint32 end = 0;
+    };
+
 public:
 
     KisFixedPaintDevice(const KoColorSpace* colorSpace,
@@ -203,11 +216,35 @@ public:
      */
     void mirror(bool horizontal, bool vertical);
 
+    /**
+     * Attach a run-length description of the non-transparent area of
+     * the device: one span per row of bounds(). Everything outside the
+     * spans is guaranteed to be fully transparent, so KisPainter may skip
+     * compositing of these pixels.
+     *
+     * The spans are produced by the brush mask applicators after the
+     * dab is rendered. They are dropped by all the methods that resize
+     * or refill the device. If you write into data() directly and make
+     * some transparent pixels opaque, call resetRowSpans() manually.
+     */
+    void setRowSpans(const QVector<RowSpan> &spans);
+    const QVector<RowSpan>& rowSpans() const;
+    bool hasRowSpans() const;
+    void resetRowSpans();
+
+    /**
+     * @return the smallest subrect of \p rc (in device coordinates) that
+     * contains all the non-transparent pixels of the device. If the device
+     * has no row spans attached, \p rc is returned as it is.
+     */
+    QRect nonTransparentRect(const QRect &rc) const;
+
 private:
 
     const KoColorSpace* m_colorSpace;
     QRect m_bounds;
     KisOptimizedByteArray m_data;
+    QVector<RowSpan> m_rowSpans;
 };
 
 #endif
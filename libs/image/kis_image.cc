@@ -109,6 +109,7 @@
 #include "KisRunnableStrokeJobData.h"
 #include "KisRunnableStrokeJobUtils.h"
 #include "KisRunnableStrokeJobsInterface.h"
+#include "KisThumbnailPyramid.h"
 
 // #define SANITY_CHECKS
 
@@ -228,6 +229,12 @@ public:
     QAtomicInt disableUIUpdateSignals;
     KisLocklessStack<QRect> savedDisabledUIUpdates;
 
+    /**
+     * Downscaled copies of the projection used for generating
+     * thumbnails and document previews
+     */
+    KisThumbnailPyramid projectionThumbnailPyramid;
+
     KisProjectionUpdatesFilterSP projectionUpdatesFilter;
     KisImageSignalRouter signalRouter;
     KisImageAnimationInterface *animationInterface;
@@ -1494,21 +1501,7 @@ QImage KisImage::convertToQImage(const QSize& scaledImageSize, const KoColorProf
         return QImage();
     }
 
-    KisPaintDeviceSP dev = new KisPaintDevice(colorSpace());
-    KisPainter gc;
-    gc.copyAreaOptimized(QPoint(0, 0), projection(), dev, bounds());
-    gc.end();
-    double scaleX = qreal(scaledImageSize.width()) / width();
-    double scaleY = qreal(scaledImageSize.height()) / height();
-
-    QPointer<KoUpdater> updater = new KoDummyUpdater();
-
-    KisTransformWorker worker(dev, scaleX, scaleY, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, updater, KisFilterStrategyRegistry::instance()->value("Bicubic"));
-    worker.run();
-
-    delete updater;
-
-    return dev->convertToQImage(profile);
+    return m_d->projectionThumbnailPyramid.createThumbnail(projection(), bounds(), scaledImageSize, profile);
 }
 void KisImage::notifyLayersChanged()
 {
@@ -1971,8 +1964,10 @@ void KisImage::notifyProjectionUpdated(const QRect &rc)
 {
     KisUpdateTimeMonitor::instance()->reportUpdateFinished(rc);
 
+    const int lod = currentLevelOfDetail();
+    m_d->projectionThumbnailPyramid.addDirtyRect(!lod ? rc : KisLodTransform::upscaledRect(rc, lod));
+
     if (!m_d->disableUIUpdateSignals) {
-        int lod = currentLevelOfDetail();
         QRect dirtyRect = !lod ? rc : KisLodTransform::upscaledRect(rc, lod);
 
         if (dirtyRect.isEmpty()) return;
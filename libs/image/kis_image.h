@@ -159,6 +159,14 @@ public:
 
     /**
      * Render a thumbnail of the projection onto a QImage.
+     *
+     * The thumbnail is generated from a cached downscaled copy of the
+     * projection, which is updated incrementally on every projection
+     * update, so the repeated calls are cheap even for big images.
+     *
+     * The transparent margins of the thumbnail are cropped, so the
+     * returned image may be smaller than \p scaledImageSize and it is
+     * null when the projection is fully transparent.
      */
     QImage convertToQImage(const QSize& scaledImageSize, const KoColorProfile *profile);
 
@@ -57,10 +57,7 @@ void KisLayerProjectionPlane::applyImpl(KisPainter *painter, const QRect &rect,
 
     QRect needRect = rect;
 
-    if (m_d->layer->compositeOpId() != COMPOSITE_COPY &&
-        m_d->layer->compositeOpId() != COMPOSITE_DESTINATION_IN  &&
-        m_d->layer->compositeOpId() != COMPOSITE_DESTINATION_ATOP) {
-
+    if (KisPainter::compositeOpIgnoresTransparentSource(m_d->layer->compositeOpId())) {
         needRect &= device->extent();
     }
 
@@ -19,10 +19,20 @@
 #include "kis_liquify_transform_worker.h"
 
 #include "kis_grid_interpolation_tools.h"
+#include "KisDisplacementGrid.h"
 #include "kis_dom_utils.h"
 #include "krita_utils.h"
 
 
+/**
+ * For big brushes the displacement of the mesh points is calculated in the
+ * nodes of a coarse grid and interpolated for the rest of the points, which
+ * saves us from calculating exp() and trigonometry for every point. The
+ * Gaussian is smooth enough to be interpolated with a step of sigma / 4.
+ */
+const qreal displacementGridMinSigma = 64.0;
+const qreal displacementGridStepFactor = 0.25;
+
 struct Q_DECL_HIDDEN KisLiquifyTransformWorker::Private
 {
     Private(const QRect &_srcBounds,
@@ -47,6 +57,12 @@ struct Q_DECL_HIDDEN KisLiquifyTransformWorker::Private
 
     struct MapIndexesOp;
 
+    template <class ProcessOp>
+    KisDisplacementGrid createDisplacementGrid(ProcessOp op,
+                                               const QPointF &base,
+                                               qreal sigma,
+                                               const QRectF &clipRect);
+
     template <class ProcessOp>
     void processTransformedPixelsBuildUp(ProcessOp op,
                                          const QPointF &base,
@@ -216,6 +232,29 @@ void KisLiquifyTransformWorker::undoPoints(const QPointF &base,
     }
 }
 
+template <class ProcessOp>
+KisDisplacementGrid KisLiquifyTransformWorker::Private::
+createDisplacementGrid(ProcessOp op,
+                       const QPointF &base,
+                       qreal sigma,
+                       const QRectF &clipRect)
+{
+    if (sigma < displacementGridMinSigma) return KisDisplacementGrid();
+
+    KisDisplacementGrid grid(clipRect.toAlignedRect(),
+                             qRound(displacementGridStepFactor * sigma));
+
+    grid.fill(
+        [&] (const QPointF &pt) {
+            const QPointF diff = pt - base;
+            const qreal dist = KisAlgebra2D::norm(diff);
+            const qreal lambda = exp(-0.5 * pow2(dist / sigma));
+            return op(pt, base, diff, lambda) - pt;
+        });
+
+    return grid;
+}
+
 template <class ProcessOp>
 void KisLiquifyTransformWorker::Private::
 processTransformedPixelsBuildUp(ProcessOp op,
@@ -226,6 +265,8 @@ processTransformedPixelsBuildUp(ProcessOp op,
     QRectF clipRect(base.x() - maxDist, base.y() - maxDist,
                     2 * maxDist, 2 * maxDist);
 
+    const KisDisplacementGrid grid = createDisplacementGrid(op, base, sigma, clipRect);
+
     QVector<QPointF>::iterator it = transformedPoints.begin();
     QVector<QPointF>::iterator end = transformedPoints.end();
 
@@ -236,8 +277,12 @@ processTransformedPixelsBuildUp(ProcessOp op,
         qreal dist = KisAlgebra2D::norm(diff);
         if (dist > maxDist) continue;
 
-        const qreal lambda = exp(-0.5 * pow2(dist / sigma));
-        *it = op(*it, base, diff, lambda);
+        if (!grid.isEmpty()) {
+            *it += grid.valueAt(*it);
+        } else {
+            const qreal lambda = exp(-0.5 * pow2(dist / sigma));
+            *it = op(*it, base, diff, lambda);
+        }
     }
 }
 
@@ -259,6 +304,8 @@ processTransformedPixelsWash(ProcessOp op,
     KIS_ASSERT_RECOVER_RETURN(originalPoints.size() ==
                               transformedPoints.size());
 
+    const KisDisplacementGrid grid = createDisplacementGrid(op, base, sigma, clipRect);
+
     for (; it != end; ++it, ++refIt) {
         if (!clipRect.contains(*it)) continue;
 
@@ -266,8 +313,14 @@ processTransformedPixelsWash(ProcessOp op,
         qreal dist = KisAlgebra2D::norm(diff);
         if (dist > maxDist) continue;
 
-        const qreal lambda = exp(-0.5 * pow2(dist / sigma));
-        QPointF dstPt = op(*refIt, base, diff, lambda);
+        QPointF dstPt;
+
+        if (!grid.isEmpty()) {
+            dstPt = *refIt + grid.valueAt(*refIt);
+        } else {
+            const qreal lambda = exp(-0.5 * pow2(dist / sigma));
+            dstPt = op(*refIt, base, diff, lambda);
+        }
 
         if (kisDistance(dstPt, *refIt) > kisDistance(*it, *refIt)) {
             *it = (1.0 - flow) * (*it) + flow * dstPt;
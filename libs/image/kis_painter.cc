@@ -296,6 +296,13 @@ bool KisPainter::checkDeviceHasTransparency(KisPaintDeviceSP dev)
     return false;
 }
 
+bool KisPainter::compositeOpIgnoresTransparentSource(const QString &compositeOpId)
+{
+    return compositeOpId != COMPOSITE_COPY &&
+           compositeOpId != COMPOSITE_DESTINATION_IN  &&
+           compositeOpId != COMPOSITE_DESTINATION_ATOP;
+}
+
 void KisPainter::begin(KisPaintDeviceSP device)
 {
     begin(device, d->selection);
@@ -448,9 +455,7 @@ inline bool KisPainter::Private::tryReduceSourceRect(const KisPaintDevice *srcDe
      * directly copied (former case) or cloned from another area of
      * the image.
      */
-    if (compositeOp->id() != COMPOSITE_COPY &&
-        compositeOp->id() != COMPOSITE_DESTINATION_IN  &&
-        compositeOp->id() != COMPOSITE_DESTINATION_ATOP &&
+    if (compositeOpIgnoresTransparentSource() &&
         !srcDev->defaultBounds()->wrapAroundMode()) {
 
         /**
@@ -908,7 +913,22 @@ void KisPainter::bltFixed(qint32 dstX, qint32 dstY,
     /* Trying to read outside a KisFixedPaintDevice is inherently wrong and shouldn't be done,
     so crash if someone attempts to do this. Don't resize as it would obfuscate the mistake. */
     KIS_SAFE_ASSERT_RECOVER_RETURN(srcBounds.contains(srcRect));
-    Q_UNUSED(srcRect); // only used in above assertion
+
+    /* If the dab knows which of its pixels are fully transparent, don't
+    read, composite and write back the area that cannot change anyway */
+    if (srcDev->hasRowSpans() && d->compositeOpIgnoresTransparentSource()) {
+        const QRect nonTransparentRect = srcDev->nonTransparentRect(srcRect);
+        if (nonTransparentRect.isEmpty()) return;
+
+        if (nonTransparentRect != srcRect) {
+            dstX += nonTransparentRect.x() - srcX;
+            dstY += nonTransparentRect.y() - srcY;
+            srcX = nonTransparentRect.x();
+            srcY = nonTransparentRect.y();
+            srcWidth = nonTransparentRect.width();
+            srcHeight = nonTransparentRect.height();
+        }
+    }
 
     /* Create an intermediate byte array to hold information before it is written
     to the current paint device (aka: d->device) */
@@ -109,6 +109,13 @@ public:
     static KisPaintDeviceSP convertToAlphaAsGray(KisPaintDeviceSP src);
     static bool checkDeviceHasTransparency(KisPaintDeviceSP dev);
 
+    /**
+     * @return true if fully transparent source pixels never change the
+     * destination when composited with \p compositeOpId, so the painter
+     * may skip them
+     */
+    static bool compositeOpIgnoresTransparentSource(const QString &compositeOpId);
+
     /**
      * Start painting on the specified device. Not undoable.
      */
@@ -36,6 +36,11 @@ void KisPainter::Private::applyDevice(const QRect &applyRect,
     const int srcPixelSize = srcColorSpace->pixelSize();
     const int dabRowStride = srcPixelSize * dabRect.width();
 
+    const bool skipTransparentPixels =
+        dab.device->hasRowSpans() && compositeOpIgnoresTransparentSource();
+
+    // offset from image coordinates into the coordinates of the dab device
+    const QPoint dabOffset = dab.device->bounds().topLeft() - dabRect.topLeft();
 
     qint32 dstY = rc.y();
     qint32 rowsRemaining = rc.height();
@@ -64,10 +69,37 @@ void KisPainter::Private::applyDevice(const QRect &applyRect,
             localParamInfo.cols          = columns;
 
 
-            const int dabX = dstX - dabRect.x();
-            const int dabY = dstY - dabRect.y();
+            if (skipTransparentPixels) {
+                /**
+                 * Composite only the part of the tile that contains
+                 * non-transparent pixels of the dab
+                 */
+                const QRect chunkRect(dstX, dstY, columns, rows);
+                const QRect dabChunkRect =
+                    dab.device->nonTransparentRect(chunkRect.translated(dabOffset));
+
+                if (dabChunkRect.isEmpty()) {
+                    dstX += columns;
+                    columnsRemaining -= columns;
+                    continue;
+                }
+
+                const QRect effectiveRect = dabChunkRect.translated(-dabOffset);
+
+                dstIt->moveTo(effectiveRect.x(), effectiveRect.y());
+                localParamInfo.dstRowStart = dstIt->rawData();
+                localParamInfo.rows        = effectiveRect.height();
+                localParamInfo.cols        = effectiveRect.width();
+
+                const int dabX = effectiveRect.x() - dabRect.x();
+                const int dabY = effectiveRect.y() - dabRect.y();
+                localParamInfo.srcRowStart = dab.device->constData() + dabX * srcPixelSize + dabY * dabRowStride;
+            } else {
+                const int dabX = dstX - dabRect.x();
+                const int dabY = dstY - dabRect.y();
+                localParamInfo.srcRowStart = dab.device->constData() + dabX * srcPixelSize + dabY * dabRowStride;
+            }
 
-            localParamInfo.srcRowStart   = dab.device->constData() + dabX * srcPixelSize + dabY * dabRowStride;
             localParamInfo.srcRowStride  = dabRowStride;
             localParamInfo.setOpacityAndAverage(dab.opacity, dab.averageOpacity);
             localParamInfo.flow = dab.flow;
@@ -76,6 +76,10 @@ struct Q_DECL_HIDDEN KisPainter::Private {
     KisRunnableStrokeJobsInterface *runnableStrokeJobsInterface = 0;
     QScopedPointer<KisRunnableStrokeJobsInterface> fakeRunnableStrokeJobsInterface;
 
+    inline bool compositeOpIgnoresTransparentSource() const {
+        return KisPainter::compositeOpIgnoresTransparentSource(compositeOp->id());
+    }
+
     bool tryReduceSourceRect(const KisPaintDevice *srcDev,
                              QRect *srcRect,
                              qint32 *srcX,
@@ -0,0 +1,114 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KisDisplacementGridTest.h"
+
+#include <QTest>
+#include <QVector>
+#include <QtMath>
+
+#include "KisDisplacementGrid.h"
+
+namespace {
+QPointF linearField(const QPointF &pt) {
+    return QPointF(0.5 * pt.x() - 0.25 * pt.y() + 3.0,
+                   -0.125 * pt.x() + 0.75 * pt.y() - 1.0);
+}
+}
+
+void KisDisplacementGridTest::testLinearField()
+{
+    // the rect is not divisible by the step to check the last partial cell
+    KisDisplacementGrid grid(QRect(10, 20, 37, 29), 4);
+    grid.fill(linearField);
+
+    QCOMPARE(grid.rect(), QRect(10, 20, 37, 29));
+    QCOMPARE(grid.step(), 4);
+    QVERIFY(!grid.isEmpty());
+
+    const qreal eps = 1e-3;
+
+    for (int y = 20; y < 49; y++) {
+        for (int x = 10; x < 47; x++) {
+            const QPointF pt(x + 0.3, y + 0.7);
+            const QPointF value = grid.valueAt(pt);
+            const QPointF expected = linearField(pt);
+
+            QVERIFY(qAbs(value.x() - expected.x()) < eps);
+            QVERIFY(qAbs(value.y() - expected.y()) < eps);
+        }
+    }
+}
+
+void KisDisplacementGridTest::testRowMatchesPoint()
+{
+    KisDisplacementGrid grid(QRect(-16, -16, 64, 64), 8);
+    grid.fill([] (const QPointF &pt) {
+        return QPointF(qSin(pt.x() * 0.1), qCos(pt.y() * 0.1));
+    });
+
+    const int width = 50;
+    QVector<float> dx(width);
+    QVector<float> dy(width);
+
+    for (int y = -16; y < 48; y += 3) {
+        grid.interpolateRow(-10, y, width, dx.data(), dy.data());
+
+        for (int i = 0; i < width; i++) {
+            const QPointF value = grid.valueAt(QPointF(-10 + i, y));
+
+            QVERIFY(qAbs(value.x() - dx[i]) < 1e-4);
+            QVERIFY(qAbs(value.y() - dy[i]) < 1e-4);
+        }
+    }
+}
+
+void KisDisplacementGridTest::testValueBounds()
+{
+    KisDisplacementGrid grid(QRect(-16, -16, 64, 64), 8);
+    grid.fill([] (const QPointF &pt) {
+        return QPointF(10.0 * qSin(pt.x() * 0.1), 5.0 * qCos(pt.y() * 0.1));
+    });
+
+    const QRectF bounds = grid.valueBounds();
+    QVERIFY(bounds.width() > 10.0);
+    QVERIFY(bounds.height() > 5.0);
+
+    const int width = 64;
+    QVector<float> dx(width);
+    QVector<float> dy(width);
+
+    for (int y = -16; y < 48; y++) {
+        grid.interpolateRow(-16, y, width, dx.data(), dy.data());
+
+        for (int i = 0; i < width; i++) {
+            QVERIFY(dx[i] >= bounds.left() - 1e-4 && dx[i] <= bounds.right() + 1e-4);
+            QVERIFY(dy[i] >= bounds.top() - 1e-4 && dy[i] <= bounds.bottom() + 1e-4);
+        }
+    }
+}
+
+void KisDisplacementGridTest::testEmpty()
+{
+    KisDisplacementGrid grid;
+    QVERIFY(grid.isEmpty());
+    QVERIFY(grid.valueBounds().isNull());
+}
+
+QTEST_MAIN(KisDisplacementGridTest)
@@ -0,0 +1,187 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "KisThumbnailPyramidTest.h"
+
+#include <QTest>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+
+#include "kis_paint_device.h"
+#include "KisThumbnailPyramid.h"
+
+
+namespace {
+
+KisPaintDeviceSP createPatternDevice(const QRect &rc)
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    dev->fill(rc, KoColor(Qt::white, cs));
+
+    for (int i = 0; i < 8; i++) {
+        const QRect stripe(rc.x() + i * rc.width() / 8, rc.y(), rc.width() / 16, rc.height());
+        dev->fill(stripe, KoColor(QColor::fromHsv(i * 45, 255, 255), cs));
+    }
+
+    return dev;
+}
+
+}
+
+void KisThumbnailPyramidTest::testLevelSelection()
+{
+    const QRect rc(0, 0, 1024, 768);
+    KisPaintDeviceSP dev = createPatternDevice(rc);
+
+    KisThumbnailPyramid pyramid;
+    int lod = -1;
+
+    KisPaintDeviceSP level = pyramid.levelForSize(dev, rc, QSize(128, 96), &lod);
+    QCOMPARE(lod, 2);
+    QCOMPARE(pyramid.cachedLevelOfDetail(), 2);
+    QCOMPARE(level->exactBounds(), QRect(0, 0, 256, 192));
+
+    level = pyramid.levelForSize(dev, rc, QSize(600, 450), &lod);
+    QCOMPARE(lod, 0);
+    QCOMPARE(level, dev);
+
+    level = pyramid.levelForSize(dev, rc, QSize(32, 24), &lod);
+    QCOMPARE(lod, 4);
+    QCOMPARE(pyramid.cachedLevelOfDetail(), 4);
+    QCOMPARE(level->exactBounds(), QRect(0, 0, 64, 48));
+
+    pyramid.invalidate();
+    QCOMPARE(pyramid.cachedLevelOfDetail(), 0);
+}
+
+void KisThumbnailPyramidTest::testUniformColor()
+{
+    const QRect rc(0, 0, 1000, 600);
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->fill(rc, KoColor(QColor(10, 200, 30), cs));
+
+    KisThumbnailPyramid pyramid;
+    QImage thumbnail = pyramid.createThumbnail(dev, rc, QSize(100, 60), cs->profile());
+
+    QCOMPARE(thumbnail.size(), QSize(100, 60));
+
+    for (int y = 0; y < thumbnail.height(); y++) {
+        for (int x = 0; x < thumbnail.width(); x++) {
+            QCOMPARE(thumbnail.pixel(x, y), qRgba(10, 200, 30, 255));
+        }
+    }
+}
+
+void KisThumbnailPyramidTest::testTransparentMarginsCropped()
+{
+    const QRect rc(0, 0, 1000, 600);
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    KisThumbnailPyramid pyramid;
+    QVERIFY(pyramid.createThumbnail(dev, rc, QSize(100, 60), cs->profile()).isNull());
+
+    // only the left half of the source is painted
+    const QRect paintedRect(0, 0, 500, 600);
+    dev->fill(paintedRect, KoColor(QColor(10, 200, 30), cs));
+    pyramid.addDirtyRect(paintedRect);
+
+    QImage thumbnail = pyramid.createThumbnail(dev, rc, QSize(100, 60), cs->profile());
+
+    QCOMPARE(thumbnail.height(), 60);
+    QVERIFY(thumbnail.width() >= 50);
+    QVERIFY(thumbnail.width() < 60);
+}
+
+void KisThumbnailPyramidTest::testIncrementalUpdate()
+{
+    const QRect rc(0, 0, 1024, 1024);
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QSize size(64, 64);
+
+    KisPaintDeviceSP dev = createPatternDevice(rc);
+
+    KisThumbnailPyramid pyramid;
+    const QImage initial = pyramid.createThumbnail(dev, rc, size, cs->profile());
+
+    const QRect changedRect(301, 517, 123, 77);
+    dev->fill(changedRect, KoColor(Qt::black, cs));
+    pyramid.addDirtyRect(changedRect);
+
+    const QImage updated = pyramid.createThumbnail(dev, rc, size, cs->profile());
+    QVERIFY(updated != initial);
+
+    KisThumbnailPyramid freshPyramid;
+    const QImage reference = freshPyramid.createThumbnail(dev, rc, size, cs->profile());
+
+    QCOMPARE(updated, reference);
+}
+
+void KisThumbnailPyramidTest::testColorSpaceChange()
+{
+    const QRect rc(0, 0, 512, 512);
+    KisPaintDeviceSP dev = createPatternDevice(rc);
+
+    KisThumbnailPyramid pyramid;
+    int lod = -1;
+
+    pyramid.levelForSize(dev, rc, QSize(64, 64), &lod);
+    QCOMPARE(lod, 2);
+
+    const KoColorSpace *cs16 = KoColorSpaceRegistry::instance()->rgb16();
+    dev->convertTo(cs16);
+
+    KisPaintDeviceSP level = pyramid.levelForSize(dev, rc, QSize(64, 64), &lod);
+    QCOMPARE(lod, 2);
+    QVERIFY(*level->colorSpace() == *cs16);
+}
+
+void KisThumbnailPyramidTest::testSourceReplaced()
+{
+    const QRect rc(0, 0, 512, 512);
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QSize size(64, 64);
+
+    KisThumbnailPyramid pyramid;
+
+    {
+        KisPaintDeviceSP dev = createPatternDevice(rc);
+        pyramid.createThumbnail(dev, rc, size, cs->profile());
+    }
+
+    /**
+     * The new device may be allocated at the same address as the
+     * deleted one, the level must be regenerated anyway
+     */
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->fill(rc, KoColor(Qt::black, cs));
+
+    const QImage thumbnail = pyramid.createThumbnail(dev, rc, size, cs->profile());
+
+    KisThumbnailPyramid freshPyramid;
+    const QImage reference = freshPyramid.createThumbnail(dev, rc, size, cs->profile());
+
+    QCOMPARE(thumbnail, reference);
+}
+
+QTEST_MAIN(KisThumbnailPyramidTest)
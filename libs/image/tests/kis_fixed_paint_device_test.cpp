@@ -367,4 +367,63 @@ void KisFixedPaintDeviceTest::testMirroring()
     }
 }
 
+void KisFixedPaintDeviceTest::testRowSpans()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect rc(0, 0, 8, 4);
+
+    KisFixedPaintDeviceSP fdev = new KisFixedPaintDevice(cs);
+    fdev->setRect(rc);
+    fdev->initialize();
+
+    setPixel(fdev, 2, 1, 255);
+    setPixel(fdev, 5, 2, 128);
+
+    QVector<KisFixedPaintDevice::RowSpan> spans(rc.height());
+    spans[1].start = 2;
+    spans[1].end = 3;
+    spans[2].start = 5;
+    spans[2].end = 6;
+
+    fdev->setRowSpans(spans);
+    QVERIFY(fdev->hasRowSpans());
+
+    QCOMPARE(fdev->nonTransparentRect(rc), QRect(2, 1, 4, 2));
+    QCOMPARE(fdev->nonTransparentRect(QRect(0, 0, 4, 4)), QRect(2, 1, 1, 1));
+    QVERIFY(fdev->nonTransparentRect(QRect(0, 3, 8, 1)).isEmpty());
+
+    // the spans should follow the mirrored pixels
+    fdev->mirror(true, true);
+    QCOMPARE(fdev->nonTransparentRect(rc), QRect(2, 1, 4, 2));
+    QCOMPARE(fdev->rowSpans()[1].start, 2);
+    QCOMPARE(fdev->rowSpans()[2].start, 5);
+    QCOMPARE(pixel(fdev, 5, 2), quint8(255));
+    QCOMPARE(pixel(fdev, 2, 1), quint8(128));
+
+    // the trimmed blit should give the same result as the dense one
+    KisPaintDeviceSP dev1 = new KisPaintDevice(cs);
+    dev1->fill(0, 0, 16, 16, KoColor(Qt::white, cs).data());
+    KisPaintDeviceSP dev2 = new KisPaintDevice(*dev1);
+
+    KisPainter gc1(dev1);
+    gc1.bltFixed(QPoint(3, 3), fdev, rc);
+
+    KisFixedPaintDeviceSP denseDev = new KisFixedPaintDevice(*fdev);
+    denseDev->resetRowSpans();
+
+    KisPainter gc2(dev2);
+    gc2.bltFixed(QPoint(3, 3), denseDev, rc);
+
+    QPoint errpoint;
+    if (!TestUtil::compareQImages(errpoint,
+                                  dev1->convertToQImage(0, 0, 0, 16, 16),
+                                  dev2->convertToQImage(0, 0, 0, 16, 16))) {
+        QFAIL(QString("Trimmed blit differs from the dense one at: %1,%2 \n").arg(errpoint.x()).arg(errpoint.y()).toLatin1());
+    }
+
+    // any refill drops the spans
+    fdev->fill(0, 0, 1, 1, KoColor(Qt::black, cs).data());
+    QVERIFY(!fdev->hasRowSpans());
+}
+
 QTEST_MAIN(KisFixedPaintDeviceTest)
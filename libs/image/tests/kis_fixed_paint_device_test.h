@@ -39,6 +39,7 @@ private Q_SLOTS:
     void testBltPerformance();
     void testMirroring_data();
     void testMirroring();
+    void testRowSpans();
 };
 
 #endif
@@ -154,4 +154,124 @@ void KisLiquifyTransformWorkerTest::testIdentityTransform()
     TestUtil::checkQImage(result, "liquify_transform_test", "liquify_dev", "identity");
 }
 
+namespace {
+enum LiquifyAction {
+    Translate,
+    Scale,
+    Rotate
+};
+
+QPointF exactLiquifyPoint(LiquifyAction action, const QPointF &pt,
+                          const QPointF &base, qreal sigma, qreal flow,
+                          bool useWashMode)
+{
+    const QPointF diff = pt - base;
+    const qreal dist = KisAlgebra2D::norm(diff);
+    if (dist > 3.0 * sigma) return pt;
+
+    const qreal lambda = exp(-0.5 * pow2(dist / sigma));
+
+    QPointF dstPt;
+
+    switch (action) {
+    case Translate:
+        dstPt = pt + lambda * QPointF(50, 0);
+        break;
+    case Scale:
+        dstPt = base + (1.0 + 0.5 * lambda) * diff;
+        break;
+    case Rotate: {
+        const qreal angle = M_PI / 8 * lambda;
+        dstPt = base + QPointF( std::cos(angle) * diff.x() + std::sin(angle) * diff.y(),
+                               -std::sin(angle) * diff.x() + std::cos(angle) * diff.y());
+        break;
+    }
+    }
+
+    return useWashMode ? (1.0 - flow) * pt + flow * dstPt : dstPt;
+}
+}
+
+void KisLiquifyTransformWorkerTest::testDisplacementGrid_data()
+{
+    QTest::addColumn<int>("action");
+    QTest::addColumn<qreal>("sigma");
+    QTest::addColumn<bool>("useWashMode");
+    QTest::addColumn<qreal>("tolerance");
+
+    /**
+     * Brushes with sigma < 64 use the exact calculation, so they check
+     * that the reference formulas match the worker
+     */
+    QTest::newRow("translate-exact") << int(Translate) << 50.0 << false << 1e-6;
+    QTest::newRow("rotate-exact") << int(Rotate) << 50.0 << false << 1e-6;
+
+    /**
+     * Bigger brushes interpolate the displacement over a grid with the
+     * step h = sigma / 4. The error of bilinear interpolation is at most
+     * h^2 / 8 * (max|f_xx| + max|f_yy|) per component. For the translation
+     * by D = 50 px the second derivatives of D * exp(-r^2 / (2 sigma^2))
+     * are at most D / sigma^2, which gives D / 64 = 0.78 px. The scale and
+     * rotation fields give bounds of the same order, and all the rows stay
+     * below 0.76 px when sampled densely, so 1 px leaves a safe margin.
+     */
+    QTest::newRow("translate-grid") << int(Translate) << 100.0 << false << 1.0;
+    QTest::newRow("scale-grid") << int(Scale) << 100.0 << false << 1.0;
+    QTest::newRow("rotate-grid") << int(Rotate) << 100.0 << false << 1.0;
+    QTest::newRow("translate-grid-wash") << int(Translate) << 100.0 << true << 1.0;
+    QTest::newRow("scale-grid-wash") << int(Scale) << 64.0 << true << 1.0;
+}
+
+void KisLiquifyTransformWorkerTest::testDisplacementGrid()
+{
+    QFETCH(int, action);
+    QFETCH(qreal, sigma);
+    QFETCH(bool, useWashMode);
+    QFETCH(qreal, tolerance);
+
+    TestUtil::TestProgressBar bar;
+    KoProgressUpdater pu(&bar);
+    KoUpdaterPtr updater = pu.startSubtask();
+
+    const int pixelPrecision = 8;
+    const QPointF base(301, 297);
+    const qreal flow = 0.7;
+
+    KisLiquifyTransformWorker worker(QRect(0, 0, 600, 600),
+                                     updater,
+                                     pixelPrecision);
+
+    switch (LiquifyAction(action)) {
+    case Translate:
+        worker.translatePoints(base, QPointF(50, 0), sigma, useWashMode, flow);
+        break;
+    case Scale:
+        worker.scalePoints(base, 0.5, sigma, useWashMode, flow);
+        break;
+    case Rotate:
+        worker.rotatePoints(base, M_PI / 8, sigma, useWashMode, flow);
+        break;
+    }
+
+    const QVector<QPointF> &originalPoints = worker.originalPoints();
+    const QVector<QPointF> &transformedPoints = worker.transformedPoints();
+
+    QCOMPARE(originalPoints.size(), transformedPoints.size());
+
+    qreal maxError = 0;
+
+    for (int i = 0; i < originalPoints.size(); i++) {
+        const QPointF expected =
+            exactLiquifyPoint(LiquifyAction(action), originalPoints[i],
+                              base, sigma, flow, useWashMode);
+
+        maxError = qMax(maxError, kisDistance(expected, transformedPoints[i]));
+    }
+
+    if (maxError > tolerance) {
+        qDebug() << ppVar(maxError) << ppVar(tolerance);
+        QFAIL("liquify displacement differs from the exact one");
+    }
+}
+
 QTEST_MAIN(KisLiquifyTransformWorkerTest)
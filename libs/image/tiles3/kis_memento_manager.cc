@@ -76,7 +76,8 @@
 KisMementoManager::KisMementoManager()
     : m_index(0),
       m_headsHashTable(0),
-      m_registrationBlocked(false)
+      m_registrationBlocked(false),
+      m_changeCount(0)
 {
     /**
      * Tile change/delete registration is enabled for all
@@ -90,7 +91,8 @@ KisMementoManager::KisMementoManager(const KisMementoManager& rhs)
         m_cancelledRevisions(rhs.m_cancelledRevisions),
         m_headsHashTable(rhs.m_headsHashTable, 0),
         m_currentMemento(rhs.m_currentMemento),
-        m_registrationBlocked(rhs.m_registrationBlocked)
+        m_registrationBlocked(rhs.m_registrationBlocked),
+        m_changeCount(rhs.m_changeCount.load())
 {
     Q_ASSERT_X(!m_registrationBlocked,
                "KisMementoManager", "(impossible happened) "
@@ -128,6 +130,8 @@ void KisMementoManager::registerTileChange(KisTile *tile)
 
     DEBUG_LOG_TILE_ACTION("reg. [C]", tile, tile->col(), tile->row());
 
+    m_changeCount.ref();
+
     KisMementoItemSP mi = m_index.getExistingTile(tile->col(), tile->row());
 
     if(!mi) {
@@ -150,6 +154,8 @@ void KisMementoManager::registerTileDeleted(KisTile *tile)
 
     DEBUG_LOG_TILE_ACTION("reg. [D]", tile, tile->col(), tile->row());
 
+    m_changeCount.ref();
+
     KisMementoItemSP mi = m_index.getExistingTile(tile->col(), tile->row());
 
     if(!mi) {
@@ -303,6 +309,7 @@ void KisMementoManager::rollback(KisTileHashTable *ht)
     Q_ASSERT(!namedTransactionInProgress());
 
     m_cancelledRevisions.prepend(changeList);
+    m_changeCount.ref();
     DEBUG_DUMP_MESSAGE("UNDONE");
 
     // Waking up pooler to prepare copies for us
@@ -333,6 +340,7 @@ void KisMementoManager::rollforward(KisTileHashTable *ht)
     m_currentMemento = changeList.memento;
     commit();
     unblockRegistration();
+    m_changeCount.ref();
     DEBUG_DUMP_MESSAGE("REDONE");
 }
 
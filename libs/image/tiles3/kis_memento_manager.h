@@ -20,6 +20,7 @@
 #define KIS_MEMENTO_MANAGER_
 
 #include <QList>
+#include <QAtomicInt>
 
 #include "kis_memento_item.h"
 #include "config-hash-table-implementaion.h"
@@ -110,6 +111,15 @@ public:
         return m_currentMemento;
     }
 
+    /**
+     * Returns a counter that changes every time a tile is changed,
+     * deleted, rolled back or rolled forward. If two values of the
+     * counter coincide, the tiles have not been touched in between.
+     */
+    int changeCount() const {
+        return m_changeCount.load();
+    }
+
     KisMementoSP currentMemento();
 
     void setDefaultTileData(KisTileData *defaultTileData);
@@ -169,6 +179,11 @@ protected:
      * \see rollforward()
      */
     bool m_registrationBlocked;
+
+    /**
+     * \see changeCount()
+     */
+    QAtomicInt m_changeCount;
 };
 
 #endif /* KIS_MEMENTO_MANAGER_ */
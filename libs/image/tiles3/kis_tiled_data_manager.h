@@ -191,6 +191,13 @@ public:
         //return true;
     }
 
+    /**
+     * \see KisMementoManager::changeCount()
+     */
+    int changeCount() const {
+        return m_mementoManager->changeCount();
+    }
+
     /**
      * Removes all the history that preceds the revision
      * pointed by oldestMemento. That is after calling to
@@ -19,6 +19,7 @@
 #include "kis_tile_compressor_2.h"
 #include "kis_lzf_compression.h"
 #include <QIODevice>
+#include <QBuffer>
 #include "kis_paint_device_writer.h"
 #define TILE_DATA_SIZE(pixelSize) ((pixelSize) * KisTileData::WIDTH * KisTileData::HEIGHT)
 
@@ -82,10 +83,26 @@ bool KisTileCompressor2::readTile(QIODevice *stream, KisTiledDataManager *dm)
 
         KisTileSP tile = dm->getTile(col, row, true);
 
-        stream->read(m_streamingBuffer.data(), dataSize);
+        /**
+         * When the stream lives in memory (e.g. it is an uncompressed entry
+         * of a memory-mapped .kra file), decompress the tile straight from
+         * it instead of copying it into the streaming buffer first. The data
+         * is only read by decompressTileData(), so it is safe to pass
+         * a read-only mapping here.
+         */
+        quint8 *tileStream = 0;
+
+        QBuffer *buffer = qobject_cast<QBuffer*>(stream);
+        if (buffer && dataSize > 0 && buffer->pos() + dataSize <= buffer->size()) {
+            tileStream = (quint8*)(buffer->data().constData() + buffer->pos());
+            buffer->seek(buffer->pos() + dataSize);
+        } else {
+            stream->read(m_streamingBuffer.data(), dataSize);
+            tileStream = (quint8*)m_streamingBuffer.data();
+        }
 
         tile->lockForWrite();
-        bool res = decompressTileData((quint8*)m_streamingBuffer.data(), dataSize, tile->tileData());
+        bool res = decompressTileData(tileStream, dataSize, tile->tileData());
         tile->unlockForWrite();
         return res;
     }
@@ -19,10 +19,12 @@
 
 #include "KoColorConversionCache.h"
 
+#include <QAtomicInt>
 #include <QHash>
 #include <QList>
 #include <QMutex>
 #include <QThreadStorage>
+#include <QVector>
 
 #include <KoColorSpace.h>
 
@@ -45,6 +47,17 @@ struct KoColorConversionCacheKey {
                 && (conversionFlags == rhs.conversionFlags);
     }
 
+    /**
+     * Compares the keys without dereferencing the color spaces. It is
+     * used by the thread-local caches, which may still keep pointers to
+     * the color spaces that have already been destroyed.
+     */
+    bool isSameAs(const KoColorConversionCacheKey& rhs) const {
+        return src == rhs.src && dst == rhs.dst
+                && renderingIntent == rhs.renderingIntent
+                && conversionFlags == rhs.conversionFlags;
+    }
+
     const KoColorSpace* src;
     const KoColorSpace* dst;
     KoColorConversionTransformation::Intent renderingIntent;
@@ -67,20 +80,105 @@ struct KoColorConversionCache::CachedTransformation {
     }
 
     bool available() {
-        return use == 0;
+        return use.load() == 0;
     }
 
     KoColorConversionTransformation* transfo;
-    int use;
+    QAtomicInt use;
 };
 
 typedef QPair<KoColorConversionCacheKey, KoCachedColorConversionTransformation> FastPathCacheItem;
 
+namespace {
+
+/**
+ * The number of transformations every thread keeps for itself. Most of
+ * the threads convert between two or three color spaces at a time (e.g.
+ * image -> display and back), so a few items are enough.
+ */
+const int maxThreadLocalItems = 8;
+
+/**
+ * A small MRU list of transformations owned by a single thread. Every
+ * transformation in the list is marked as used, so no other thread can
+ * pick it from the shared cache, hence the lookup needs no locking.
+ */
+struct ThreadLocalCache {
+    ThreadLocalCache(int _generation)
+        : generation(_generation)
+    {
+    }
+
+    ~ThreadLocalCache() {
+        clear();
+    }
+
+    void clear() {
+        qDeleteAll(items);
+        items.clear();
+    }
+
+    int generation;
+    QVector<FastPathCacheItem*> items;
+};
+
+}
+
 struct KoColorConversionCache::Private {
     QMultiHash< KoColorConversionCacheKey, CachedTransformation*> cache;
-    QMutex cacheMutex;
+    mutable QMutex cacheMutex;
+
+    /**
+     * Transformations of the destroyed color spaces that are still
+     * referenced by the local caches of other threads. They are deleted
+     * on the first lookup that sees the new generation after all the
+     * references are gone. Threads that exit without doing any lookup
+     * leave them till the next destroyed color space.
+     */
+    QList<CachedTransformation*> orphans;
+
+    /**
+     * Incremented every time a color space is destroyed. Thread-local
+     * caches of an older generation are dropped on the next lookup.
+     */
+    QAtomicInt generation;
+
+    QThreadStorage<ThreadLocalCache*> fastStorage;
+
+    ThreadLocalCache* localCache() {
+        const int currentGeneration = generation.loadAcquire();
+
+        ThreadLocalCache *cache = fastStorage.localData();
+
+        if (!cache) {
+            cache = new ThreadLocalCache(currentGeneration);
+            fastStorage.setLocalData(cache);
+        } else if (cache->generation != currentGeneration) {
+            cache->clear();
+            cache->generation = currentGeneration;
+
+            /**
+             * The stale items might have been the last references to
+             * the orphaned transformations, so reclaim them right now
+             * instead of waiting for the next destroyed color space
+             */
+            QMutexLocker lock(&cacheMutex);
+            deleteUnusedOrphans();
+        }
+
+        return cache;
+    }
 
-    QThreadStorage<FastPathCacheItem*> fastStorage;
+    void deleteUnusedOrphans() {
+        for (auto it = orphans.begin(); it != orphans.end();) {
+            if ((*it)->available()) {
+                delete *it;
+                it = orphans.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
 };
 
 
@@ -90,9 +188,12 @@ KoColorConversionCache::KoColorConversionCache() : d(new Private)
 
 KoColorConversionCache::~KoColorConversionCache()
 {
+    d->fastStorage.setLocalData(0);
+
     Q_FOREACH (CachedTransformation* transfo, d->cache) {
         delete transfo;
     }
+    qDeleteAll(d->orphans);
     delete d;
 }
 
@@ -103,56 +204,87 @@ KoCachedColorConversionTransformation KoColorConversionCache::cachedConverter(co
 {
     KoColorConversionCacheKey key(src, dst, _renderingIntent, _conversionFlags);
 
-    FastPathCacheItem *cacheItem =
-        d->fastStorage.localData();
+    ThreadLocalCache *localCache = d->localCache();
 
-    if (cacheItem) {
-        if (cacheItem->first == key) {
-            return cacheItem->second;
+    for (int i = 0; i < localCache->items.size(); i++) {
+        FastPathCacheItem *item = localCache->items[i];
+
+        if (item->first.isSameAs(key)) {
+            if (i > 0) {
+                localCache->items.move(i, 0);
+            }
+            return item->second;
         }
     }
 
-    cacheItem = 0;
+    FastPathCacheItem *cacheItem = 0;
 
-    QMutexLocker lock(&d->cacheMutex);
-    QList< CachedTransformation* > cachedTransfos = d->cache.values(key);
-    if (cachedTransfos.size() != 0) {
-        Q_FOREACH (CachedTransformation* ct, cachedTransfos) {
-            if (ct->available()) {
-                ct->transfo->setSrcColorSpace(src);
-                ct->transfo->setDstColorSpace(dst);
-
-                cacheItem = new FastPathCacheItem(key, KoCachedColorConversionTransformation(this, ct));
-                break;
+    {
+        QMutexLocker lock(&d->cacheMutex);
+        QList< CachedTransformation* > cachedTransfos = d->cache.values(key);
+        if (cachedTransfos.size() != 0) {
+            Q_FOREACH (CachedTransformation* ct, cachedTransfos) {
+                if (ct->available()) {
+                    ct->transfo->setSrcColorSpace(src);
+                    ct->transfo->setDstColorSpace(dst);
+
+                    cacheItem = new FastPathCacheItem(key, KoCachedColorConversionTransformation(this, ct));
+                    break;
+                }
             }
         }
+        if (!cacheItem) {
+            KoColorConversionTransformation* transfo = src->createColorConverter(dst, _renderingIntent, _conversionFlags);
+            CachedTransformation* ct = new CachedTransformation(transfo);
+            d->cache.insert(key, ct);
+            cacheItem = new FastPathCacheItem(key, KoCachedColorConversionTransformation(this, ct));
+        }
     }
-    if (!cacheItem) {
-        KoColorConversionTransformation* transfo = src->createColorConverter(dst, _renderingIntent, _conversionFlags);
-        CachedTransformation* ct = new CachedTransformation(transfo);
-        d->cache.insert(key, ct);
-        cacheItem = new FastPathCacheItem(key, KoCachedColorConversionTransformation(this, ct));
+
+    /**
+     * Evicted transformations become available for other threads
+     * as soon as their handle is destroyed
+     */
+    if (localCache->items.size() >= maxThreadLocalItems) {
+        delete localCache->items.takeLast();
     }
 
-    d->fastStorage.setLocalData(cacheItem);
+    localCache->items.prepend(cacheItem);
     return cacheItem->second;
 }
 
 void KoColorConversionCache::colorSpaceIsDestroyed(const KoColorSpace* cs)
 {
+    d->generation.ref();
     d->fastStorage.setLocalData(0);
 
     QMutexLocker lock(&d->cacheMutex);
     QMultiHash< KoColorConversionCacheKey, CachedTransformation*>::iterator endIt = d->cache.end();
     for (QMultiHash< KoColorConversionCacheKey, CachedTransformation*>::iterator it = d->cache.begin(); it != endIt;) {
         if (it.key().src == cs || it.key().dst == cs) {
-            Q_ASSERT(it.value()->available()); // That's terribely evil, if that assert fails, that means that someone is using a color transformation with a color space which is currently being deleted
-            delete it.value();
+            /**
+             * The transformation may still be referenced by a local cache
+             * of another thread, which will be cleared only on its next
+             * lookup. Keep it alive till then.
+             */
+            if (it.value()->available()) {
+                delete it.value();
+            } else {
+                d->orphans.append(it.value());
+            }
             it = d->cache.erase(it);
         } else {
             ++it;
         }
     }
+
+    d->deleteUnusedOrphans();
+}
+
+int KoColorConversionCache::numOrphanedTransformations() const
+{
+    QMutexLocker lock(&d->cacheMutex);
+    return d->orphans.size();
 }
 
 //--------- KoCachedColorConversionTransformation ----------//
@@ -168,18 +300,18 @@ KoCachedColorConversionTransformation::KoCachedColorConversionTransformation(KoC
     Q_ASSERT(transfo->available());
     d->cache = cache;
     d->transfo = transfo;
-    d->transfo->use++;
+    d->transfo->use.ref();
 }
 
 KoCachedColorConversionTransformation::KoCachedColorConversionTransformation(const KoCachedColorConversionTransformation& rhs) : d(new Private(*rhs.d))
 {
-    d->transfo->use++;
+    d->transfo->use.ref();
 }
 
 KoCachedColorConversionTransformation::~KoCachedColorConversionTransformation()
 {
-    d->transfo->use--;
-    Q_ASSERT(d->transfo->use >= 0);
+    d->transfo->use.deref();
+    Q_ASSERT(d->transfo->use.load() >= 0);
     delete d;
 }
 
@@ -24,13 +24,14 @@ class KoCachedColorConversionTransformation;
 class KoColorSpace;
 
 #include "KoColorConversionTransformation.h"
+#include "kritapigment_export.h"
 
 /**
  * This class holds a cache of KoColorConversionTransformations.
  *
  * This class is not part of public API, and can be changed without notice.
  */
-class KoColorConversionCache
+class KRITAPIGMENT_EXPORT KoColorConversionCache
 {
 public:
     struct CachedTransformation;
@@ -58,6 +59,14 @@ public:
      * @param src source color space
      */
     void colorSpaceIsDestroyed(const KoColorSpace* src);
+
+    /**
+     * The number of transformations of the destroyed color spaces that
+     * are still referenced by other threads.
+     *
+     * WARNING: used by the unittests only
+     */
+    int numOrphanedTransformations() const;
 private:
     struct Private;
     Private* const d;
@@ -70,7 +79,7 @@ private:
  *
  * This class is not part of public API, and can be changed without notice.
  */
-class KoCachedColorConversionTransformation
+class KRITAPIGMENT_EXPORT KoCachedColorConversionTransformation
 {
     friend class KoColorConversionCache;
 private:
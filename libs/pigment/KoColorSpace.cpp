@@ -432,6 +432,26 @@ bool KoColorSpace::convertPixelsTo(const quint8 * src,
     return true;
 }
 
+void KoColorSpace::fromQColors(const QColor *colors, quint8 *dst, int numColors, const KoColorProfile *profile) const
+{
+    const int pixelSize = this->pixelSize();
+
+    for (int i = 0; i < numColors; i++) {
+        fromQColor(colors[i], dst, profile);
+        dst += pixelSize;
+    }
+}
+
+void KoColorSpace::toQColors(const quint8 *src, QColor *colors, int numColors, const KoColorProfile *profile) const
+{
+    const int pixelSize = this->pixelSize();
+
+    for (int i = 0; i < numColors; i++) {
+        toQColor(src, &colors[i], profile);
+        src += pixelSize;
+    }
+}
+
 KoColorConversionTransformation * KoColorSpace::createProofingTransform(const KoColorSpace *dstColorSpace, const KoColorSpace *proofingSpace, KoColorConversionTransformation::Intent renderingIntent, KoColorConversionTransformation::Intent proofingIntent, KoColorConversionTransformation::ConversionFlags conversionFlags, quint8 *gamutWarning, double adaptationState) const
 {
     if (!d->iccEngine) {
@@ -302,6 +302,26 @@ public:
      */
     virtual void toQColor(const quint8 *src, QColor *c, const KoColorProfile * profile = 0) const = 0;
 
+    /**
+     * Converts \p numColors QColors into pixels at once. Color spaces can
+     * override it to do the conversion in one pass, which is much faster
+     * than calling fromQColor() for every color. The default
+     * implementation calls fromQColor() for every color.
+     *
+     * @param colors the array of \p numColors colors
+     * @param dst the buffer of at least numColors * pixelSize() bytes
+     * @param numColors the number of colors to convert
+     * @param profile the optional profile that describes the color values of QColor
+     */
+    virtual void fromQColors(const QColor *colors, quint8 *dst, int numColors, const KoColorProfile * profile = 0) const;
+
+    /**
+     * Converts \p numColors pixels into QColors at once.
+     *
+     * @see fromQColors()
+     */
+    virtual void toQColors(const quint8 *src, QColor *colors, int numColors, const KoColorProfile * profile = 0) const;
+
     /**
      * Convert the pixels in data to (8-bit BGRA) QImage using the specified profiles.
      *
@@ -76,6 +76,26 @@ public:
      */
     virtual void mixColors(const quint8 * const*colors, quint32 nColors, quint8 *dst) const = 0;
     virtual void mixColors(const quint8 *colors, quint32 nColors, quint8 *dst) const = 0;
+
+    /**
+     * Mix a row of \p nPixels destination pixels in one call. It is
+     * equivalent to calling weighted mixColors() for every destination
+     * pixel, but avoids a virtual call per pixel and lets the compiler
+     * keep the accumulators in registers.
+     *
+     * @param colors the array of pointers to the source pixels. The first
+     *               nColors[0] pointers are mixed into the first
+     *               destination pixel, the next nColors[1] ones into the
+     *               second one and so on
+     * @param weights the array of weights arranged in the same way as
+     *                \p colors. The sum of weights for every destination
+     *                pixel should be 255.
+     * @param nColors the array of \p nPixels numbers of source pixels
+     *                for every destination pixel
+     * @param dst the row of nPixels consecutive destination pixels
+     * @param nPixels the number of destination pixels
+     */
+    virtual void mixColorsRow(const quint8 * const*colors, const qint16 *weights, const quint32 *nColors, quint8 *dst, quint32 nPixels) const = 0;
 };
 
 #endif
@@ -46,6 +46,16 @@ public:
         mixColorsImpl(PointerToArray(colors, _CSTrait::pixelSize), NoWeightsSurrogate(nColors), nColors, dst);
     }
 
+    void mixColorsRow(const quint8 * const* colors, const qint16 *weights, const quint32 *nColors, quint8 *dst, quint32 nPixels) const override {
+        for (quint32 i = 0; i < nPixels; i++) {
+            mixColorsImpl(ArrayOfPointers(colors), WeightsWrapper(weights), nColors[i], dst);
+
+            colors += nColors[i];
+            weights += nColors[i];
+            dst += _CSTrait::pixelSize;
+        }
+    }
+
 private:
     struct ArrayOfPointers {
         ArrayOfPointers(const quint8 * const* colors)
@@ -155,10 +165,14 @@ private:
 
             weightsWrapper.premultiplyAlphaWithWeight(alphaTimesWeight);
 
+            /**
+             * The alpha channel is accumulated as well, its total is just
+             * never used. Having no branches in the loop lets the compiler
+             * process all the channels of the pixel with one SIMD
+             * instruction.
+             */
             for (int i = 0; i < (int)_CSTrait::channels_nb; i++) {
-                if (i != _CSTrait::alpha_pos) {
-                    totals[i] += color[i] * alphaTimesWeight;
-                }
+                totals[i] += color[i] * alphaTimesWeight;
             }
 
             totalAlpha += alphaTimesWeight;
@@ -19,6 +19,10 @@
 #include "KoColorSpacesBenchmark.h"
 
 #include <QTest>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QVector>
 #include <KoColorSpaceRegistry.h>
 #include <KoColorSpace.h>
 
@@ -146,4 +150,72 @@ void KoColorSpacesBenchmark::benchmarkSetAlpha2IndividualCall()
     END_BENCHMARK
 }
 
+namespace {
+
+/**
+ * Converts the data in small chunks, the way parallel merge jobs and
+ * texture updates do, so the cost of the conversion cache lookup is
+ * a noticeable part of the total time.
+ */
+struct ConversionRunner : public QRunnable
+{
+    ConversionRunner(const KoColorSpace *srcCS, const KoColorSpace *dstCS, int numChunks)
+        : m_srcCS(srcCS),
+          m_dstCS(dstCS),
+          m_numChunks(numChunks)
+    {
+    }
+
+    void run() override {
+        const int chunkSize = 64;
+        QVector<quint8> src(chunkSize * m_srcCS->pixelSize());
+        QVector<quint8> dst(chunkSize * m_dstCS->pixelSize());
+
+        for (int i = 0; i < m_numChunks; i++) {
+            m_srcCS->convertPixelsTo(src.constData(), dst.data(), m_dstCS, chunkSize,
+                                     KoColorConversionTransformation::internalRenderingIntent(),
+                                     KoColorConversionTransformation::internalConversionFlags());
+            m_dstCS->convertPixelsTo(dst.constData(), src.data(), m_srcCS, chunkSize,
+                                     KoColorConversionTransformation::internalRenderingIntent(),
+                                     KoColorConversionTransformation::internalConversionFlags());
+        }
+    }
+
+    const KoColorSpace *m_srcCS;
+    const KoColorSpace *m_dstCS;
+    int m_numChunks;
+};
+
+}
+
+void KoColorSpacesBenchmark::benchmarkConcurrentConversion_data()
+{
+    QTest::addColumn<int>("numThreads");
+
+    QTest::newRow("1 thread") << 1;
+    QTest::newRow("2 threads") << 2;
+    QTest::newRow("4 threads") << 4;
+    QTest::newRow("all threads") << QThread::idealThreadCount();
+}
+
+void KoColorSpacesBenchmark::benchmarkConcurrentConversion()
+{
+    QFETCH(int, numThreads);
+
+    const KoColorSpace *rgb8 = KoColorSpaceRegistry::instance()->rgb8();
+    const KoColorSpace *rgb16 = KoColorSpaceRegistry::instance()->rgb16();
+
+    const int numChunks = NB_PIXELS / 64;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+
+    QBENCHMARK {
+        for (int i = 0; i < numThreads; i++) {
+            pool.start(new ConversionRunner(rgb8, rgb16, numChunks / numThreads));
+        }
+        pool.waitForDone();
+    }
+}
+
 QTEST_MAIN(KoColorSpacesBenchmark)
@@ -63,3 +63,8 @@ KoCompositeOp* KoOptimizedCompositeOpFactory::createOverOp128(const KoColorSpace
 {
     return createOptimizedClass<KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128> >(cs);
 }
+
+KoMixColorsOp* KoOptimizedCompositeOpFactory::createMixColorsOp32(const KoColorSpace *cs)
+{
+    return createOptimizedClass<KoOptimizedMixColorsOpFactoryPerArch<KoOptimizedMixColorsOp32> >(cs);
+}
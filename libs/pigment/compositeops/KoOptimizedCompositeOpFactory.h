@@ -23,6 +23,7 @@
 #include "kritapigment_export.h"
 
 class KoCompositeOp;
+class KoMixColorsOp;
 class KoColorSpace;
 
 /**
@@ -46,6 +47,12 @@ public:
     static KoCompositeOp* createAlphaDarkenOpHard128(const KoColorSpace *cs);
     static KoCompositeOp* createAlphaDarkenOpCreamy128(const KoColorSpace *cs);
     static KoCompositeOp* createOverOp128(const KoColorSpace *cs);
+
+    /**
+     * Creates a mix colors op for 8-bit BGRA pixels that uses the
+     * vector instructions of the current CPU
+     */
+    static KoMixColorsOp* createMixColorsOp32(const KoColorSpace *cs);
 };
 
 #endif /* KOOPTIMIZEDCOMPOSITEOPFACTORY_H */
@@ -26,6 +26,7 @@
 #include "KoOptimizedCompositeOpAlphaDarken128.h"
 #include "KoOptimizedCompositeOpOver32.h"
 #include "KoOptimizedCompositeOpOver128.h"
+#include "KoOptimizedMixColorsOp32.h"
 
 #include <QString>
 #include "DebugPigment.h"
@@ -85,3 +86,12 @@ KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128>::create<Vc::
 {
     return new KoOptimizedCompositeOpOver128<Vc::CurrentImplementation::current()>(param);
 }
+
+template<>
+template<>
+KoOptimizedMixColorsOpFactoryPerArch<KoOptimizedMixColorsOp32>::ReturnType
+KoOptimizedMixColorsOpFactoryPerArch<KoOptimizedMixColorsOp32>::create<Vc::CurrentImplementation::current()>(ParamType param)
+{
+    Q_UNUSED(param);
+    return new KoOptimizedMixColorsOp32<Vc::CurrentImplementation::current()>();
+}
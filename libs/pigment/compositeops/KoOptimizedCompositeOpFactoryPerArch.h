@@ -25,6 +25,7 @@
 
 
 class KoCompositeOp;
+class KoMixColorsOp;
 class KoColorSpace;
 
 
@@ -56,5 +57,18 @@ struct KoOptimizedCompositeOpFactoryPerArch
     static ReturnType create(ParamType param);
 };
 
+template<Vc::Implementation _impl>
+class KoOptimizedMixColorsOp32;
+
+template<template<Vc::Implementation I> class MixColorsOp>
+struct KoOptimizedMixColorsOpFactoryPerArch
+{
+    typedef const KoColorSpace* ParamType;
+    typedef KoMixColorsOp* ReturnType;
+
+    template<Vc::Implementation _impl>
+    static ReturnType create(ParamType param);
+};
+
 
 #endif /* KOOPTIMIZEDCOMPOSITEOPFACTORYPERARCH_H */
@@ -23,6 +23,7 @@
 #include "KoCompositeOpAlphaDarken.h"
 #include "KoAlphaDarkenParamsWrapper.h"
 #include "KoCompositeOpOver.h"
+#include "KoMixColorsOpImpl.h"
 
 template<>
 template<>
@@ -72,3 +73,12 @@ KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128>::create<Vc::
 {
     return new KoCompositeOpOver<KoRgbF32Traits>(param);
 }
+
+template<>
+template<>
+KoOptimizedMixColorsOpFactoryPerArch<KoOptimizedMixColorsOp32>::ReturnType
+KoOptimizedMixColorsOpFactoryPerArch<KoOptimizedMixColorsOp32>::create<Vc::ScalarImpl>(ParamType param)
+{
+    Q_UNUSED(param);
+    return new KoMixColorsOpImpl<KoBgrU8Traits>();
+}
@@ -0,0 +1,125 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDMIXCOLORSOP32_H
+#define KOOPTIMIZEDMIXCOLORSOP32_H
+
+#include "KoMixColorsOpImpl.h"
+#include "KoColorSpaceTraits.h"
+#include "KoStreamedMath.h"
+
+/**
+ * Mixes weighted 8-bit BGRA pixels using vector instructions. The
+ * products of the channels, alpha and weight are accumulated in integer
+ * lanes, Vc::float_v::size() source pixels at a time, so the result is
+ * exactly the same as the one of KoMixColorsOpImpl<KoBgrU8Traits>.
+ *
+ * Only the weighted mixing of pixel arrays is vectorized, that is what
+ * the transform resampler and the sub-pixel samplers use. The rest is
+ * inherited from the generic implementation.
+ */
+template<Vc::Implementation _impl>
+class KoOptimizedMixColorsOp32 : public KoMixColorsOpImpl<KoBgrU8Traits>
+{
+    typedef typename KoStreamedMath<_impl>::int_v int_v;
+    typedef typename KoStreamedMath<_impl>::uint_v uint_v;
+
+public:
+    using KoMixColorsOpImpl<KoBgrU8Traits>::mixColors;
+
+    void mixColors(const quint8 * const* colors, const qint16 *weights, quint32 nColors, quint8 *dst) const override {
+        mixWeightedColors(colors, weights, nColors, dst);
+    }
+
+    void mixColorsRow(const quint8 * const* colors, const qint16 *weights, const quint32 *nColors, quint8 *dst, quint32 nPixels) const override {
+        for (quint32 i = 0; i < nPixels; i++) {
+            mixWeightedColors(colors, weights, nColors[i], dst);
+
+            colors += nColors[i];
+            weights += nColors[i];
+            dst += KoBgrU8Traits::pixelSize;
+        }
+    }
+
+private:
+    static inline void mixWeightedColors(const quint8 * const* colors, const qint16 *weights, quint32 nColors, quint8 *dst) {
+        const int vectorSize = Vc::float_v::size();
+        const uint_v lowByteMask(0xFF);
+
+        int_v blueTotals(Vc::Zero);
+        int_v greenTotals(Vc::Zero);
+        int_v redTotals(Vc::Zero);
+        int_v alphaTotals(Vc::Zero);
+
+        quint32 pixelsBuffer[vectorSize];
+        qint32 weightsBuffer[vectorSize];
+
+        quint32 i = 0;
+
+        for (; i + vectorSize <= nColors; i += vectorSize) {
+            for (int j = 0; j < vectorSize; j++) {
+                pixelsBuffer[j] = *reinterpret_cast<const quint32*>(colors[i + j]);
+                weightsBuffer[j] = weights[i + j];
+            }
+
+            uint_v pixels;
+            pixels.load(pixelsBuffer, Vc::Unaligned);
+
+            int_v pixelWeights;
+            pixelWeights.load(weightsBuffer, Vc::Unaligned);
+
+            const int_v alphaTimesWeight = int_v(pixels >> 24) * pixelWeights;
+
+            blueTotals += int_v(pixels & lowByteMask) * alphaTimesWeight;
+            greenTotals += int_v((pixels >> 8) & lowByteMask) * alphaTimesWeight;
+            redTotals += int_v((pixels >> 16) & lowByteMask) * alphaTimesWeight;
+            alphaTotals += alphaTimesWeight;
+        }
+
+        qint32 totals[3] = {blueTotals.sum(), greenTotals.sum(), redTotals.sum()};
+        qint32 totalAlpha = alphaTotals.sum();
+
+        for (; i < nColors; i++) {
+            const quint8 *color = colors[i];
+            const qint32 alphaTimesWeight = color[KoBgrU8Traits::alpha_pos] * weights[i];
+
+            totals[0] += color[0] * alphaTimesWeight;
+            totals[1] += color[1] * alphaTimesWeight;
+            totals[2] += color[2] * alphaTimesWeight;
+            totalAlpha += alphaTimesWeight;
+        }
+
+        const qint32 sumOfWeights = 255;
+        const qint32 maxAlpha = KoColorSpaceMathsTraits<quint8>::unitValue * sumOfWeights;
+
+        if (totalAlpha > maxAlpha) {
+            totalAlpha = maxAlpha;
+        }
+
+        if (totalAlpha > 0) {
+            for (int ch = 0; ch < 3; ch++) {
+                dst[ch] = qBound<qint32>(0, totals[ch] / totalAlpha, 255);
+            }
+            dst[KoBgrU8Traits::alpha_pos] = totalAlpha / sumOfWeights;
+        } else {
+            memset(dst, 0, KoBgrU8Traits::pixelSize);
+        }
+    }
+};
+
+#endif // KOOPTIMIZEDMIXCOLORSOP32_H
@@ -22,9 +22,12 @@
 #include "KoColorSpaceRegistry.h"
 
 #include <KoColor.h>
+#include <KoColorSpace.h>
+#include "kis_assert.h"
 
 #include <QBuffer>
 #include <QByteArray>
+#include <QVector>
 
 #define PREVIEW_WIDTH 64
 #define PREVIEW_HEIGHT 64
@@ -103,14 +106,29 @@ QImage KoAbstractGradient::generatePreview(int width, int height) const
     QRgb * lineA = reinterpret_cast<QRgb*>(image.scanLine(0));
     QRgb * lineB = reinterpret_cast<QRgb*>(image.scanLine(checkerSize));
 
-    KoColor c;
-    QColor color;
-    // first create the two reference lines
-    for (int x = 0; x < image.width(); ++x) {
+    const KoColorSpace *cs = colorSpace() ? colorSpace() : KoColorSpaceRegistry::instance()->rgb8();
+    KoColor c(cs);
+    const int pixelSize = cs->pixelSize();
+
+    // sample the gradient in its own color space and convert all the colors at once
+    QVector<quint8> pixels(image.width() * pixelSize);
+    QVector<QColor> colors(image.width());
 
+    for (int x = 0; x < image.width(); ++x) {
         qreal t = static_cast<qreal>(x) / (image.width() - 1);
         colorAt(c, t);
-        c.toQColor(&color);
+        KIS_SAFE_ASSERT_RECOVER(c.colorSpace() == cs) {
+            c.convertTo(cs);
+        }
+        memcpy(pixels.data() + x * pixelSize, c.data(), pixelSize);
+    }
+
+    cs->toQColors(pixels.constData(), colors.data(), colors.size());
+
+    // first create the two reference lines
+    for (int x = 0; x < image.width(); ++x) {
+
+        const QColor &color = colors[x];
         const qreal alpha = color.alphaF();
 
         int darkR = static_cast<int>((1 - alpha) * darkBackground + alpha * color.red() + 0.5);
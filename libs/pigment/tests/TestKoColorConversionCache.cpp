@@ -0,0 +1,185 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "TestKoColorConversionCache.h"
+
+#include <QTest>
+#include <QThread>
+#include <QSemaphore>
+#include <QAtomicInt>
+#include <QVector>
+
+#include <KoColorConversionCache.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorSpace.h>
+
+namespace {
+
+KoCachedColorConversionTransformation lookup(KoColorConversionCache *cache,
+                                             const KoColorSpace *src,
+                                             const KoColorSpace *dst)
+{
+    return cache->cachedConverter(src, dst,
+                                  KoColorConversionTransformation::internalRenderingIntent(),
+                                  KoColorConversionTransformation::internalConversionFlags());
+}
+
+/**
+ * Keeps a transformation in its thread-local cache while the main
+ * thread destroys the color space, then does one more lookup
+ */
+class OrphanThread : public QThread
+{
+public:
+    OrphanThread(KoColorConversionCache *cache,
+                 const KoColorSpace *src,
+                 const KoColorSpace *dst,
+                 const KoColorSpace *other)
+        : m_cache(cache), m_src(src), m_dst(dst), m_other(other)
+    {
+    }
+
+    void run() override {
+        lookup(m_cache, m_src, m_dst);
+        lookedUp.release();
+
+        invalidated.acquire();
+        lookup(m_cache, m_src, m_other);
+        lookedUpAgain.release();
+
+        finish.acquire();
+    }
+
+    QSemaphore lookedUp;
+    QSemaphore invalidated;
+    QSemaphore lookedUpAgain;
+    QSemaphore finish;
+
+private:
+    KoColorConversionCache *m_cache;
+    const KoColorSpace *m_src;
+    const KoColorSpace *m_dst;
+    const KoColorSpace *m_other;
+};
+
+/**
+ * Converts small chunks between all the pairs of the color spaces
+ * till it is stopped
+ */
+class ConversionThread : public QThread
+{
+public:
+    ConversionThread(KoColorConversionCache *cache,
+                     const QVector<const KoColorSpace*> &colorSpaces,
+                     QAtomicInt *stop)
+        : m_cache(cache), m_colorSpaces(colorSpaces), m_stop(stop)
+    {
+    }
+
+    void run() override {
+        const int numPixels = 64;
+        QVector<quint8> src(numPixels * 16, 0);
+        QVector<quint8> dst(numPixels * 16, 0);
+
+        while (!m_stop->loadAcquire()) {
+            Q_FOREACH (const KoColorSpace *srcCS, m_colorSpaces) {
+                Q_FOREACH (const KoColorSpace *dstCS, m_colorSpaces) {
+                    if (srcCS == dstCS) continue;
+
+                    KoCachedColorConversionTransformation transfo =
+                        lookup(m_cache, srcCS, dstCS);
+                    transfo.transformation()->transform(src.constData(), dst.data(), numPixels);
+                }
+            }
+        }
+    }
+
+private:
+    KoColorConversionCache *m_cache;
+    QVector<const KoColorSpace*> m_colorSpaces;
+    QAtomicInt *m_stop;
+};
+
+}
+
+void TestKoColorConversionCache::testOrphansReclaimedOnLookup()
+{
+    const KoColorSpace *rgb8 = KoColorSpaceRegistry::instance()->rgb8();
+    const KoColorSpace *rgb16 = KoColorSpaceRegistry::instance()->rgb16();
+    const KoColorSpace *lab16 = KoColorSpaceRegistry::instance()->lab16();
+
+    KoColorConversionCache cache;
+    OrphanThread thread(&cache, rgb8, rgb16, lab16);
+    thread.start();
+
+    thread.lookedUp.acquire();
+
+    // the color spaces are not really destroyed, the cache compares pointers only
+    cache.colorSpaceIsDestroyed(rgb16);
+    const int orphansAfterInvalidation = cache.numOrphanedTransformations();
+
+    thread.invalidated.release();
+    thread.lookedUpAgain.acquire();
+    const int orphansAfterLookup = cache.numOrphanedTransformations();
+
+    thread.finish.release();
+    thread.wait();
+
+    QCOMPARE(orphansAfterInvalidation, 1);
+    QCOMPARE(orphansAfterLookup, 0);
+}
+
+void TestKoColorConversionCache::testInvalidationDuringLookups()
+{
+    QVector<const KoColorSpace*> colorSpaces;
+    colorSpaces << KoColorSpaceRegistry::instance()->rgb8();
+    colorSpaces << KoColorSpaceRegistry::instance()->rgb16();
+    colorSpaces << KoColorSpaceRegistry::instance()->lab16();
+
+    KoColorConversionCache cache;
+    QAtomicInt stop(0);
+
+    QVector<ConversionThread*> threads;
+    const int numThreads = qMax(2, QThread::idealThreadCount());
+
+    for (int i = 0; i < numThreads; i++) {
+        threads << new ConversionThread(&cache, colorSpaces, &stop);
+        threads.last()->start();
+    }
+
+    for (int i = 0; i < 1000; i++) {
+        cache.colorSpaceIsDestroyed(colorSpaces[i % colorSpaces.size()]);
+        QThread::yieldCurrentThread();
+    }
+
+    stop.storeRelease(1);
+
+    Q_FOREACH (ConversionThread *thread, threads) {
+        thread->wait();
+    }
+    qDeleteAll(threads);
+
+    /**
+     * The local caches of the finished threads are gone, so the next
+     * invalidation should reclaim all the orphans
+     */
+    cache.colorSpaceIsDestroyed(colorSpaces.first());
+    QCOMPARE(cache.numOrphanedTransformations(), 0);
+}
+
+QTEST_GUILESS_MAIN(TestKoColorConversionCache)
@@ -2,6 +2,10 @@
 
 #include "KoColorSpaceAbstract.h"
 #include "KoColorSpaceTraits.h"
+#include "KoOptimizedCompositeOpFactory.h"
+
+#include <QScopedPointer>
+#include <QVector>
 
 #include <cfloat>
 
@@ -386,4 +390,119 @@ void TestKoColorSpaceAbstract::testMixColorsOpU8NoAlphaLinear()
 }
 
 
+void TestKoColorSpaceAbstract::testMixColorsRowU8()
+{
+    typedef KoColorSpaceTrait<quint8, 4, 3> U8ColorSpace;
+    KoMixColorsOpImpl<U8ColorSpace> *op = new KoMixColorsOpImpl<U8ColorSpace>;
+
+    const int numSrcPixels = 8;
+    const int numDstPixels = 4;
+    const int span = 3;
+
+    quint8 srcPixels[numSrcPixels][U8ColorSpace::channels_nb];
+    for (int i = 0; i < numSrcPixels; i++) {
+        for (int j = 0; j < (int)U8ColorSpace::channels_nb; j++) {
+            srcPixels[i][j] = (37 * i + 91 * j + 13) % 256;
+        }
+    }
+
+    const quint8 *pixelPtrs[numDstPixels * span];
+    qint16 weights[numDstPixels * span];
+    quint32 spans[numDstPixels];
+
+    const quint8 **pixelPtr = pixelPtrs;
+    qint16 *weightPtr = weights;
+
+    for (int i = 0; i < numDstPixels; i++) {
+        // the last pixel has a shorter span
+        spans[i] = i == numDstPixels - 1 ? span - 1 : span;
+
+        for (int j = 0; j < int(spans[i]); j++) {
+            *(pixelPtr++) = srcPixels[(2 * i + j) % numSrcPixels];
+        }
+
+        if (i == numDstPixels - 1) {
+            *(weightPtr++) = 180;
+            *(weightPtr++) = 75;
+        } else {
+            *(weightPtr++) = 64;
+            *(weightPtr++) = 128;
+            *(weightPtr++) = 63;
+        }
+    }
+
+    quint8 rowOutput[numDstPixels][U8ColorSpace::channels_nb];
+    op->mixColorsRow(pixelPtrs, weights, spans, rowOutput[0], numDstPixels);
+
+    int offset = 0;
+
+    for (int i = 0; i < numDstPixels; i++) {
+        quint8 expectedPixel[U8ColorSpace::channels_nb];
+        op->mixColors(pixelPtrs + offset, weights + offset, spans[i], expectedPixel);
+        offset += spans[i];
+
+        for (int j = 0; j < (int)U8ColorSpace::channels_nb; j++) {
+            QCOMPARE(rowOutput[i][j], expectedPixel[j]);
+        }
+    }
+
+    delete op;
+}
+
+void TestKoColorSpaceAbstract::testOptimizedMixColorsU8()
+{
+    KoMixColorsOpImpl<KoBgrU8Traits> referenceOp;
+    QScopedPointer<KoMixColorsOp> optimizedOp(KoOptimizedCompositeOpFactory::createMixColorsOp32(0));
+
+    const int numSrcPixels = 64;
+    QVector<quint8> srcPixels(numSrcPixels * KoBgrU8Traits::pixelSize);
+    for (int i = 0; i < srcPixels.size(); i++) {
+        srcPixels[i] = (37 * i + 13) % 256;
+    }
+    // fully transparent and fully opaque pixels
+    srcPixels[3] = 0;
+    srcPixels[7] = 255;
+
+    // spans longer and shorter than any vector size, to cover the tails
+    const int maxSpan = 19;
+
+    QVector<const quint8*> pixelPtrs;
+    QVector<qint16> weights;
+    QVector<quint32> spans;
+
+    for (int span = 1; span <= maxSpan; span++) {
+        int weightsLeft = 255;
+
+        for (int j = 0; j < span; j++) {
+            pixelPtrs << srcPixels.constData() + ((span * 7 + j * 3) % numSrcPixels) * KoBgrU8Traits::pixelSize;
+
+            // the filter weights may be negative
+            qint16 weight = j == span - 1 ? weightsLeft : (j % 3 == 2 ? -7 : 255 / span + 3);
+            weights << weight;
+            weightsLeft -= weight;
+        }
+
+        spans << span;
+    }
+
+    QVector<quint8> rowOutput(spans.size() * KoBgrU8Traits::pixelSize);
+    optimizedOp->mixColorsRow(pixelPtrs.constData(), weights.constData(), spans.constData(), rowOutput.data(), spans.size());
+
+    int offset = 0;
+
+    for (int i = 0; i < spans.size(); i++) {
+        quint8 expectedPixel[KoBgrU8Traits::pixelSize];
+        quint8 optimizedPixel[KoBgrU8Traits::pixelSize];
+
+        referenceOp.mixColors(pixelPtrs.constData() + offset, weights.constData() + offset, spans[i], expectedPixel);
+        optimizedOp->mixColors(pixelPtrs.constData() + offset, weights.constData() + offset, spans[i], optimizedPixel);
+        offset += spans[i];
+
+        for (int j = 0; j < (int)KoBgrU8Traits::channels_nb; j++) {
+            QCOMPARE(optimizedPixel[j], expectedPixel[j]);
+            QCOMPARE(rowOutput[i * KoBgrU8Traits::pixelSize + j], expectedPixel[j]);
+        }
+    }
+}
+
 QTEST_GUILESS_MAIN(TestKoColorSpaceAbstract)
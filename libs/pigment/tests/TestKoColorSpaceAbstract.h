@@ -11,6 +11,8 @@ private Q_SLOTS:
     void testMixColorsOpF32();
     void testMixColorsOpU8NoAlpha();
     void testMixColorsOpU8NoAlphaLinear();
+    void testMixColorsRowU8();
+    void testOptimizedMixColorsU8();
 };
 
 #endif
@@ -22,16 +22,16 @@
 #include "psd_utils.h"
 #include "kis_debug.h"
 #include <QtEndian>
+#include <QtConcurrent>
 
 // from gimp's psd-save.c
-static quint32 pack_pb_line (const QByteArray &src,
-                             QByteArray &dst)
+static quint32 pack_pb_line (const char *start,
+                             quint32 length,
+                             char *dst)
 {
-    quint32 length = src.size();
     quint32 remaining = length;
     quint8  i, j;
     quint32 dest_ptr = 0;
-    const char *start = src.constData();
 
     length = 0;
     while (remaining > 0)
@@ -89,7 +89,7 @@ static quint32 pack_pb_line (const QByteArray &src,
 
 
 // from gimp's psd-util.c
-quint32 decode_packbits(const char *src, char* dst, quint16 packed_len, quint32 unpacked_len)
+quint32 decode_packbits(const char *src, char* dst, quint32 packed_len, quint32 unpacked_len)
 {
     /*
      *  Decode a PackBits chunk.
@@ -198,6 +198,38 @@ quint32 decode_packbits(const char *src, char* dst, quint16 packed_len, quint32
     return return_val;
 }
 
+/**
+ * In the worst case PackBits adds one header byte for every 128 literal
+ * bytes, so the packed row always fits into this buffer.
+ */
+static inline int maxPackedSize(int size)
+{
+    return size + (size + 127) / 128 + 1;
+}
+
+static QByteArray packRow(const char *src, int size)
+{
+    QByteArray dst(maxPackedSize(size), Qt::Uninitialized);
+    const quint32 packed_len = pack_pb_line(src, size, dst.data());
+    dst.truncate(packed_len);
+    return dst;
+}
+
+/**
+ * Splits \p numRows rows into jobs of roughly 64 KiB each, so that
+ * narrow layers do not spend more time scheduling than packing.
+ */
+static QVector<int> rowJobs(int rowSize, int numRows, int *rowsPerJob)
+{
+    *rowsPerJob = qMax(1, 65536 / qMax(1, rowSize));
+
+    QVector<int> jobs;
+    for (int row = 0; row < numRows; row += *rowsPerJob) {
+        jobs << row;
+    }
+    return jobs;
+}
+
 QByteArray Compression::uncompress(quint32 unpacked_len, QByteArray bytes, Compression::CompressionType compressionType)
 {
     if (unpacked_len > 30000) return QByteArray();
@@ -246,13 +278,7 @@ QByteArray Compression::compress(QByteArray bytes, Compression::CompressionType
     case Uncompressed:
         return bytes;
     case RLE:
-    {
-        QByteArray dst;
-        int packed_len = pack_pb_line(bytes, dst);
-        Q_ASSERT(packed_len == dst.size());
-        Q_UNUSED(packed_len);
-        return dst;
-    }
+        return packRow(bytes.constData(), bytes.size());
     case ZIP:
     case ZIPWithPrediction:
         return qCompress(bytes);
@@ -263,3 +289,53 @@ QByteArray Compression::compress(QByteArray bytes, Compression::CompressionType
     return QByteArray();
 }
 
+QVector<QByteArray> Compression::compressRowsRLE(const char *data, int rowSize, int numRows)
+{
+    QVector<QByteArray> rows(numRows);
+    if (rowSize < 1) return rows;
+
+    int rowsPerJob = 1;
+    QVector<int> jobs = rowJobs(rowSize, numRows, &rowsPerJob);
+
+    QtConcurrent::blockingMap(jobs,
+        [&] (int firstRow) {
+            const int lastRow = qMin(firstRow + rowsPerJob, numRows);
+            for (int row = firstRow; row < lastRow; row++) {
+                rows[row] = packRow(data + qint64(row) * rowSize, rowSize);
+            }
+        });
+
+    return rows;
+}
+
+QByteArray Compression::uncompressRowsRLE(const QByteArray &bytes, const QVector<quint32> &rowLengths, int rowSize)
+{
+    const int numRows = rowLengths.size();
+
+    QVector<qint64> rowOffsets(numRows + 1);
+    rowOffsets[0] = 0;
+    for (int row = 0; row < numRows; row++) {
+        rowOffsets[row + 1] = rowOffsets[row] + rowLengths[row];
+    }
+
+    if (rowSize < 1 || rowOffsets[numRows] > bytes.size()) return QByteArray();
+
+    QByteArray result(qint64(numRows) * rowSize, 0);
+
+    int rowsPerJob = 1;
+    QVector<int> jobs = rowJobs(rowSize, numRows, &rowsPerJob);
+
+    QtConcurrent::blockingMap(jobs,
+        [&] (int firstRow) {
+            const int lastRow = qMin(firstRow + rowsPerJob, numRows);
+            for (int row = firstRow; row < lastRow; row++) {
+                if (!rowLengths[row]) continue;
+
+                decode_packbits(bytes.constData() + rowOffsets[row],
+                                result.data() + qint64(row) * rowSize,
+                                rowLengths[row], rowSize);
+            }
+        });
+
+    return result;
+}
@@ -19,6 +19,7 @@
 #define COMPRESSION_H
 
 #include <QByteArray>
+#include <QVector>
 #include "kritapsd_export.h"
 
 class KRITAPSD_EXPORT Compression
@@ -35,6 +36,23 @@ public:
 
     static QByteArray uncompress(quint32 unpacked_len, QByteArray bytes, CompressionType compressionType);
     static QByteArray compress(QByteArray bytes, CompressionType compressionType);
+
+    /**
+     * Packs \p numRows rows of \p rowSize bytes, stored one after another
+     * in \p data, with PackBits. PSD RLE rows are independent from each
+     * other, so they are packed on several threads and returned in order.
+     */
+    static QVector<QByteArray> compressRowsRLE(const char *data, int rowSize, int numRows);
+
+    /**
+     * Unpacks PackBits rows stored one after another in \p bytes. The
+     * packed size of every row is given by \p rowLengths, and each row
+     * unpacks to \p rowSize bytes. The rows are unpacked on several
+     * threads.
+     *
+     * @return the unpacked rows or an empty array if \p bytes is too short
+     */
+    static QByteArray uncompressRowsRLE(const QByteArray &bytes, const QVector<quint32> &rowLengths, int rowSize);
 };
 
 #endif // PSD_COMPRESSION_H
@@ -159,6 +159,11 @@ void KoLegacyZipStore::setCompressionEnabled(bool e)
     }
 }
 
+bool KoLegacyZipStore::isCompressionEnabled() const
+{
+    return m_pZip && m_pZip->compression() == KZip::DeflateCompression;
+}
+
 bool KoLegacyZipStore::doFinalize()
 {
     if (m_pZip && m_pZip->device() && !m_pZip->device()->inherits("QSaveFile")) {
@@ -42,6 +42,7 @@ public:
     ~KoLegacyZipStore() override;
 
     void setCompressionEnabled(bool e) override;
+    bool isCompressionEnabled() const override;
     qint64 write(const char* _data, qint64 _len) override;
 
     QStringList directoryList() const override;
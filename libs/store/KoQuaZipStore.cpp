@@ -28,15 +28,19 @@
 #include <quazipfileinfo.h>
 #include <quazipnewinfo.h>
 
+#include <QFile>
 #include <QTemporaryFile>
 #include <QTextCodec>
 #include <QByteArray>
 #include <QBuffer>
+#include <QPointer>
 
 #include <KConfig>
 #include <KSharedConfig>
 #include <KConfigGroup>
 
+#include <limits>
+
 struct KoQuaZipStore::Private {
 
     Private() {}
@@ -48,8 +52,70 @@ struct KoQuaZipStore::Private {
     bool usingSaveFile {false};
     QByteArray cache;
     QBuffer buffer;
+
+    QFile ownMappedFile;
+    QPointer<QFile> mappedFile;
+    uchar *mappedBase {0};
+    qint64 mappedSize {0};
+    QByteArray mappedEntry;
+    QBuffer mappedBuffer;
+
+    void mapFile(QFile *file);
+    QByteArray currentEntryInPlace() const;
 };
 
+void KoQuaZipStore::Private::mapFile(QFile *file)
+{
+    if (!file->isOpen() && !file->open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const qint64 size = file->size();
+    mappedBase = file->map(0, size);
+
+    if (!mappedBase) {
+        debugStore << "Could not map" << file->fileName() << "falling back to buffered reading";
+        return;
+    }
+
+    mappedFile = file;
+    mappedSize = size;
+}
+
+QByteArray KoQuaZipStore::Private::currentEntryInPlace() const
+{
+    if (!mappedBase) {
+        return QByteArray();
+    }
+
+    QuaZipFileInfo64 info;
+    if (!archive->getCurrentFileInfo(&info)) {
+        return QByteArray();
+    }
+
+    /**
+     * Only entries that are stored verbatim (method 0) and are not encrypted
+     * can be handed out directly from the mapped file.
+     */
+    if (info.method != 0 ||
+        (info.flags & 0x1) ||
+        info.compressedSize != info.uncompressedSize ||
+        info.uncompressedSize == 0 ||
+        info.uncompressedSize > quint64(std::numeric_limits<int>::max())) {
+
+        return QByteArray();
+    }
+
+    // the position of the entry's data right after its local header
+    const qint64 offset = qint64(unzGetCurrentFileZStreamPos64(archive->getUnzFile()));
+    if (offset <= 0 || offset + qint64(info.uncompressedSize) > mappedSize) {
+        return QByteArray();
+    }
+
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(mappedBase + offset),
+                                   int(info.uncompressedSize));
+}
+
 
 KoQuaZipStore::KoQuaZipStore(const QString &_filename, KoStore::Mode _mode, const QByteArray &appIdentification, bool writeMimetype)
     : KoStore(_mode, writeMimetype)
@@ -60,6 +126,10 @@ KoQuaZipStore::KoQuaZipStore(const QString &_filename, KoStore::Mode _mode, cons
     dd->archive = new QuaZip(_filename);
     init(appIdentification);
 
+    if (d->good && _mode == Read) {
+        dd->ownMappedFile.setFileName(_filename);
+        dd->mapFile(&dd->ownMappedFile);
+    }
 }
 
 KoQuaZipStore::KoQuaZipStore(QIODevice *dev, KoStore::Mode _mode, const QByteArray &appIdentification, bool writeMimetype)
@@ -68,6 +138,12 @@ KoQuaZipStore::KoQuaZipStore(QIODevice *dev, KoStore::Mode _mode, const QByteArr
 {
     dd->archive = new QuaZip(dev);
     init(appIdentification);
+
+    Q_D(KoStore);
+    QFile *file = qobject_cast<QFile*>(dev);
+    if (d->good && _mode == Read && file) {
+        dd->mapFile(file);
+    }
 }
 
 KoQuaZipStore::~KoQuaZipStore()
@@ -82,6 +158,14 @@ KoQuaZipStore::~KoQuaZipStore()
         finalize();
     }
 
+    if (d->stream == &dd->mappedBuffer) {
+        d->stream = 0;
+    }
+
+    if (dd->mappedFile && dd->mappedBase) {
+        dd->mappedFile->unmap(dd->mappedBase);
+    }
+
     delete dd->archive;
     delete dd->currentFile;
 }
@@ -97,6 +181,11 @@ void KoQuaZipStore::setCompressionEnabled(bool enabled)
     }
 }
 
+bool KoQuaZipStore::isCompressionEnabled() const
+{
+    return dd->compressionLevel != Z_NO_COMPRESSION;
+}
+
 qint64 KoQuaZipStore::write(const char *_data, qint64 _len)
 {
     Q_D(KoStore);
@@ -124,6 +213,12 @@ QStringList KoQuaZipStore::directoryList() const
     return dd->archive->getFileNameList();
 }
 
+QByteArray KoQuaZipStore::mappedData() const
+{
+    Q_D(const KoStore);
+    return d->isOpen && d->stream == &dd->mappedBuffer ? dd->mappedEntry : QByteArray();
+}
+
 void KoQuaZipStore::init(const QByteArray &appIdentification)
 {
     Q_D(KoStore);
@@ -188,7 +283,9 @@ bool KoQuaZipStore::openWrite(const QString &name)
     dd->currentFile = new QuaZipFile(dd->archive);
     QuaZipNewInfo newInfo(fixedPath);
     newInfo.setPermissions(QFileDevice::ReadOwner | QFileDevice::ReadGroup | QFileDevice::ReadOther);
-    bool r = dd->currentFile->open(QIODevice::WriteOnly, newInfo, 0, 0, Z_DEFLATED, dd->compressionLevel);
+    // uncompressed entries are stored verbatim, so that they can be mapped on loading
+    const int method = dd->compressionLevel == Z_NO_COMPRESSION ? 0 : Z_DEFLATED;
+    bool r = dd->currentFile->open(QIODevice::WriteOnly, newInfo, 0, 0, method, dd->compressionLevel);
     if (!r) {
         qWarning() << "Could not open" << name << dd->currentFile->getZipError();
     }
@@ -204,22 +301,13 @@ bool KoQuaZipStore::openRead(const QString &name)
 {
     Q_D(KoStore);
 
-    QString fixedPath = name;
-    fixedPath.replace("//", "/");
+    const QString fixedPath = readPath(name);
 
     delete d->stream;
     d->stream = 0;
     delete dd->currentFile;
     dd->currentFile = 0;
 
-    if (!currentPath().isEmpty() && !fixedPath.startsWith(currentPath())) {
-        fixedPath = currentPath() + '/' + fixedPath;
-    }
-
-    if (!d->substituteThis.isEmpty()) {
-        fixedPath = fixedPath.replace(d->substituteThis, d->substituteWith);
-    }
-
     if (!dd->archive->setCurrentFile(fixedPath)) {
         qWarning() << "\t\tCould not set current file" << dd->archive->getZipError() << fixedPath;
         return false;
@@ -230,11 +318,99 @@ bool KoQuaZipStore::openRead(const QString &name)
         qWarning() << "\t\t\tBut could not open!!!" << dd->archive->getZipError();
         return false;
     }
+
+    dd->mappedEntry = dd->currentEntryInPlace();
+    if (!dd->mappedEntry.isNull()) {
+        dd->mappedBuffer.setBuffer(&dd->mappedEntry);
+        dd->mappedBuffer.open(QIODevice::ReadOnly);
+        d->stream = &dd->mappedBuffer;
+        d->size = dd->mappedEntry.size();
+        return true;
+    }
+
     d->stream = dd->currentFile;
     d->size = dd->currentFile->size();
     return true;
 }
 
+QString KoQuaZipStore::readPath(const QString &name) const
+{
+    Q_D(const KoStore);
+
+    QString fixedPath = name;
+    fixedPath.replace("//", "/");
+
+    if (!currentPath().isEmpty() && !fixedPath.startsWith(currentPath())) {
+        fixedPath = currentPath() + '/' + fixedPath;
+    }
+
+    if (!d->substituteThis.isEmpty()) {
+        fixedPath = fixedPath.replace(d->substituteThis, d->substituteWith);
+    }
+
+    return fixedPath;
+}
+
+bool KoQuaZipStore::doCopyRawFile(KoStore *source, const QString &sourceName, const QString &name)
+{
+    KoQuaZipStore *sourceStore = dynamic_cast<KoQuaZipStore*>(source);
+    if (!sourceStore) {
+        return false;
+    }
+
+    QuaZip *sourceArchive = sourceStore->dd->archive;
+    if (!sourceArchive->setCurrentFile(sourceStore->readPath(sourceName))) {
+        return false;
+    }
+
+    QuaZipFileInfo64 info;
+    if (!sourceArchive->getCurrentFileInfo(&info)) {
+        return false;
+    }
+
+    // encrypted files and files compressed differently are rewritten by the caller
+    const bool compressed = dd->compressionLevel != Z_NO_COMPRESSION;
+    if ((info.flags & 0x1) ||
+        (info.method != 0 && info.method != Z_DEFLATED) ||
+        (info.method == Z_DEFLATED) != compressed) {
+
+        return false;
+    }
+
+    QuaZipFile sourceFile(sourceArchive);
+    int method = 0;
+    int level = 0;
+    if (!sourceFile.open(QIODevice::ReadOnly, &method, &level, true)) {
+        return false;
+    }
+
+    const QByteArray data = sourceFile.readAll();
+    sourceFile.close();
+
+    if (quint64(data.size()) != info.compressedSize) {
+        return false;
+    }
+
+    QString fixedPath = name;
+    fixedPath.replace("//", "/");
+
+    QuaZipNewInfo newInfo(fixedPath);
+    newInfo.setPermissions(QFileDevice::ReadOwner | QFileDevice::ReadGroup | QFileDevice::ReadOther);
+    newInfo.uncompressedSize = info.uncompressedSize;
+
+    // the CRC and the uncompressed size are taken from the source entry
+    QuaZipFile file(dd->archive);
+    if (!file.open(QIODevice::WriteOnly, newInfo, 0, info.crc, method, level, true)) {
+        qWarning() << "Could not open" << name << file.getZipError();
+        return false;
+    }
+
+    const bool result = file.write(data) == data.size();
+    file.close();
+
+    return result && file.getZipError() == ZIP_OK;
+}
+
 bool KoQuaZipStore::closeWrite()
 {
     Q_D(KoStore);
@@ -253,6 +429,11 @@ bool KoQuaZipStore::closeWrite()
 bool KoQuaZipStore::closeRead()
 {
     Q_D(KoStore);
+    if (d->stream == &dd->mappedBuffer) {
+        dd->mappedBuffer.close();
+        dd->mappedBuffer.setBuffer(0);
+        dd->mappedEntry = QByteArray();
+    }
     d->stream = 0;
     return true;
 }
@@ -37,9 +37,11 @@ public:
     ~KoQuaZipStore() override;
 
     void setCompressionEnabled(bool enabled) override;
+    bool isCompressionEnabled() const override;
     qint64 write(const char* _data, qint64 _len) override;
 
     QStringList directoryList() const override;
+    QByteArray mappedData() const override;
 
 protected:
     void init(const QByteArray& appIdentification);
@@ -51,8 +53,12 @@ protected:
     bool enterRelativeDirectory(const QString& dirName) override;
     bool enterAbsoluteDirectory(const QString& path) override;
     bool fileExists(const QString& absPath) const override;
+    bool doCopyRawFile(KoStore *source, const QString &sourceName, const QString &name) override;
 
 private:
+    /// the path of the file @p name in the archive with the current directory and the substitution applied
+    QString readPath(const QString &name) const;
+
     struct Private;
     const QScopedPointer<Private> dd;
     Q_DECLARE_PRIVATE(KoStore)
@@ -437,6 +437,44 @@ void KoStore::setCompressionEnabled(bool /*e*/)
 {
 }
 
+bool KoStore::isCompressionEnabled() const
+{
+    return false;
+}
+
+QByteArray KoStore::mappedData() const
+{
+    return QByteArray();
+}
+
+bool KoStore::copyRawFile(KoStore *source, const QString &sourceName, const QString &name)
+{
+    Q_D(KoStore);
+
+    if (d->mode != Write || d->isOpen ||
+        source->d_func()->mode != Read || source->d_func()->isOpen) {
+
+        return false;
+    }
+
+    const QString fileName = d->toExternalNaming(name);
+    if (fileName.length() > 512 || d->filesList.contains(fileName)) {
+        return false;
+    }
+
+    if (!doCopyRawFile(source, source->d_func()->toExternalNaming(sourceName), fileName)) {
+        return false;
+    }
+
+    d->filesList.append(fileName);
+    return true;
+}
+
+bool KoStore::doCopyRawFile(KoStore * /*source*/, const QString & /*sourceName*/, const QString & /*name*/)
+{
+    return false;
+}
+
 void KoStore::setSubstitution(const QString &name, const QString &substitution)
 {
     Q_D(KoStore);
@@ -264,6 +264,35 @@ public:
      */
     virtual void setCompressionEnabled(bool e);
 
+    /**
+     * @return true if the files opened for writing are compressed. Lets
+     * the callers restore the previous state after changing it with
+     * setCompressionEnabled()
+     */
+    virtual bool isCompressionEnabled() const;
+
+    /**
+     * Returns the contents of the currently opened file without copying them,
+     * if the backend can access them in place, e.g. an uncompressed entry of
+     * a memory-mapped ZIP file. The returned array does not own its data and
+     * must not be used after the file is closed.
+     *
+     * @return the raw contents or a null array if in-place access is not possible
+     */
+    virtual QByteArray mappedData() const;
+
+    /**
+     * Copies the file @p sourceName of @p source into the file @p name of
+     * this store as it is, without decompressing and compressing it again.
+     * The file is copied only if it is compressed the same way this store
+     * would compress it now. Neither store may have a file open; @p source
+     * must be opened for reading and this store for writing.
+     *
+     * @return true on success. If false is returned, nothing has been
+     * written and the caller should copy the contents in the usual way.
+     */
+    bool copyRawFile(KoStore *source, const QString &sourceName, const QString &name);
+
     /// When reading, in the paths in the store where name occurs, substitution is used.
     void setSubstitution(const QString &name, const QString &substitution);
 
@@ -321,6 +350,13 @@ protected:
      */
     virtual bool fileExists(const QString &absPath) const = 0;
 
+    /**
+     * Copies the raw file for copyRawFile(), @p sourceName and @p name are
+     * "absolute paths" in the corresponding archives. The default
+     * implementation doesn't support copying and returns false.
+     */
+    virtual bool doCopyRawFile(KoStore *source, const QString &sourceName, const QString &name);
+
 protected:
     KoStorePrivate *d_ptr;
 
@@ -0,0 +1,117 @@
+/* This file is part of the KDE project
+ * Copyright (c) 2019 Krita Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "TestKoStoreMappedData.h"
+
+#include <KoStore.h>
+
+#include <QTest>
+#include <QTemporaryDir>
+#include <QScopedPointer>
+
+namespace {
+
+QByteArray testData(int size)
+{
+    QByteArray data(size, '\0');
+    for (int i = 0; i < size; i++) {
+        data[i] = char((i * 7) ^ (i >> 8));
+    }
+    return data;
+}
+
+bool writeStore(const QString &fileName, const QByteArray &data, bool compressed)
+{
+    QScopedPointer<KoStore> store(KoStore::createStore(fileName, KoStore::Write, "application/x-krita-test", KoStore::Zip));
+    if (!store || store->bad()) return false;
+
+    store->setCompressionEnabled(compressed);
+
+    if (!store->open("layers/layer1")) return false;
+    if (store->write(data) != data.size()) return false;
+    if (!store->close()) return false;
+
+    return store->finalize();
+}
+
+}
+
+void TestKoStoreMappedData::testStoredEntryIsMapped()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + "/stored.zip";
+    const QByteArray data = testData(1 << 20);
+
+    QVERIFY(writeStore(fileName, data, false));
+
+    QScopedPointer<KoStore> store(KoStore::createStore(fileName, KoStore::Read, "", KoStore::Zip));
+    QVERIFY(store && !store->bad());
+
+    QVERIFY(store->open("layers/layer1"));
+    QCOMPARE(store->size(), qint64(data.size()));
+
+    const QByteArray mapped = store->mappedData();
+    QVERIFY(!mapped.isNull());
+    QCOMPARE(mapped, data);
+
+    // the regular reading interface is served from the same mapping
+    QVERIFY(store->seek(1000));
+    QCOMPARE(store->read(16), data.mid(1000, 16));
+    QVERIFY(store->seek(0));
+    QCOMPARE(store->device()->readAll(), data);
+
+    QVERIFY(store->close());
+    QVERIFY(store->mappedData().isNull());
+}
+
+void TestKoStoreMappedData::testCompressedEntryIsNotMapped()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + "/compressed.zip";
+    const QByteArray data = testData(1 << 16);
+
+    QVERIFY(writeStore(fileName, data, true));
+
+    QScopedPointer<KoStore> store(KoStore::createStore(fileName, KoStore::Read, "", KoStore::Zip));
+    QVERIFY(store && !store->bad());
+
+    QVERIFY(store->open("layers/layer1"));
+    QVERIFY(store->mappedData().isNull());
+    QCOMPARE(store->read(store->size()), data);
+    QVERIFY(store->close());
+}
+
+void TestKoStoreMappedData::testCompressionStateIsReported()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + "/state.zip";
+
+    QScopedPointer<KoStore> store(KoStore::createStore(fileName, KoStore::Write, "application/x-krita-test", KoStore::Zip));
+    QVERIFY(store && !store->bad());
+
+    store->setCompressionEnabled(false);
+    QVERIFY(!store->isCompressionEnabled());
+
+    store->setCompressionEnabled(true);
+    QVERIFY(store->isCompressionEnabled());
+
+    QVERIFY(store->finalize());
+}
+
+QTEST_GUILESS_MAIN(TestKoStoreMappedData)
@@ -39,8 +39,13 @@ KisCloneDocumentStroke::KisCloneDocumentStroke(KisDocument *document)
 {
     setClearsRedoOnStart(false);
     setRequestsOtherStrokesToEnd(false);
+
+    // the document waits for one of the signals, even when
+    // the stroke is cancelled before it has started
+    setNeedsExplicitCancel(true);
     enableJob(JOB_INIT, true, KisStrokeJobData::BARRIER, KisStrokeJobData::EXCLUSIVE);
     enableJob(JOB_FINISH, true, KisStrokeJobData::BARRIER, KisStrokeJobData::EXCLUSIVE);
+    enableJob(JOB_CANCEL, true, KisStrokeJobData::BARRIER, KisStrokeJobData::EXCLUSIVE);
 }
 
 KisCloneDocumentStroke::~KisCloneDocumentStroke()
@@ -58,3 +63,8 @@ void KisCloneDocumentStroke::finishStrokeCallback()
     doc->moveToThread(qApp->thread());
     emit sigDocumentCloned(doc);
 }
+
+void KisCloneDocumentStroke::cancelStrokeCallback()
+{
+    emit sigCloningCancelled();
+}
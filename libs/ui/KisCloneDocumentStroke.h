@@ -33,10 +33,22 @@ public:
 
     void initStrokeCallback() override;
     void finishStrokeCallback() override;
+    void cancelStrokeCallback() override;
 
 Q_SIGNALS:
+    /**
+     * Emitted from the image thread while the stroke is still holding
+     * the image in its exclusive job. The receiver takes the ownership
+     * of the clone.
+     */
     void sigDocumentCloned(KisDocument *image);
 
+    /**
+     * Emitted when the stroke has been cancelled before the document
+     * was cloned
+     */
+    void sigCloningCancelled();
+
 private:
     struct Private;
     const QScopedPointer<Private> m_d;
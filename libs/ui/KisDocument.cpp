@@ -72,6 +72,7 @@
 #include <QPainter>
 #include <QRect>
 #include <QScopedPointer>
+#include <QMutex>
 #include <QSize>
 #include <QStringList>
 #include <QtGlobal>
@@ -124,6 +125,7 @@
 #include "kis_config_notifier.h"
 #include "kis_async_action_feedback.h"
 #include "KisCloneDocumentStroke.h"
+#include "KisSavedPixelDataTracker.h"
 
 #include <KisMirrorAxisConfig.h>
 #include <KisDecorationsWrapperLayer.h>
@@ -145,6 +147,29 @@ using namespace std;
 namespace {
 constexpr int errorMessageTimeout = 5000;
 constexpr int successMessageTimeout = 1000;
+
+/**
+ * The size of the preview the native format stores in the file
+ */
+const QSize savingPreviewSize(256, 256);
+
+QImage generateImagePreview(KisImageSP image, const QSize &size)
+{
+    QSize newSize = image->bounds().size();
+    newSize.scale(size, Qt::KeepAspectRatio);
+
+    QImage preview = image->convertToQImage(newSize, 0);
+
+    if (preview.isNull()) {
+        preview = QImage(newSize, QImage::Format_ARGB32);
+        QPainter gc(&preview);
+        QBrush checkBrush = QBrush(KisCanvasWidgetBase::createCheckersImage(newSize.width() / 5));
+        gc.fillRect(preview.rect(), checkBrush);
+        gc.end();
+    }
+
+    return preview;
+}
 }
 
 
@@ -290,11 +315,14 @@ public:
     int autoSaveDelay = 300; // in seconds, 0 to disable.
     bool modifiedAfterAutosave = false;
     bool isAutosaving = false;
+    bool asyncAutosaveCloneRequested = false;
     bool disregardAutosaveFailure = false;
     int autoSaveFailureCount = 0;
 
     KUndo2Stack *undoStack = 0;
 
+    KisSavedPixelDataTracker savedPixelData;
+
     KisGuidesConfig guidesConfig;
     KisMirrorAxisConfig mirrorAxisConfig;
 
@@ -315,6 +343,20 @@ public:
     KisImageSP image;
     KisImageSP savingImage;
 
+    /**
+     * The preview of a document cloned for saving. It is generated from
+     * the original image, which keeps its thumbnail levels in sync with
+     * the projection, while the image of the clone has none of them yet.
+     */
+    QImage savingPreview;
+
+    /**
+     * The document cloned by KisCloneDocumentStroke for autosaving. It
+     * is put here by the image thread and taken by the GUI thread.
+     */
+    QMutex asyncAutosaveCloneMutex;
+    QScopedPointer<KisDocument> asyncAutosaveClone;
+
     KisNodeWSP preActivatedNode;
     KisShapeController* shapeController = 0;
     KoShapeController* koShapeController = 0;
@@ -857,7 +899,10 @@ KisDocument* KisDocument::lockAndCloneForSaving()
         return 0;
     }
 
-    return new KisDocument(*this);
+    KisDocument *doc = new KisDocument(*this);
+    doc->d->savedPixelData = d->savedPixelData.snapshotForSaving(d->image->root());
+    doc->d->savingPreview = generateImagePreview(d->image, savingPreviewSize);
+    return doc;
 }
 
 KisDocument *KisDocument::lockAndCreateSnapshot()
@@ -945,6 +990,8 @@ void KisDocument::copyFromDocumentImpl(const KisDocument &rhs, CopyPolicy policy
 
 bool KisDocument::exportDocumentSync(const QUrl &url, const QByteArray &mimeType, KisPropertiesConfigurationSP exportConfiguration)
 {
+    KisSavedPixelDataTracker committedPixelData;
+
     {
 
         /**
@@ -957,6 +1004,13 @@ bool KisDocument::exportDocumentSync(const QUrl &url, const QByteArray &mimeType
         if (!locker.successfullyLocked()) {
             return false;
         }
+
+        /**
+         * The document is saved without cloning, so the snapshot of the
+         * unchanged layers is taken from the document itself
+         */
+        committedPixelData = d->savedPixelData;
+        d->savedPixelData = committedPixelData.snapshotForSaving(d->image->root());
     }
 
     d->savingImage = d->image;
@@ -969,6 +1023,12 @@ bool KisDocument::exportDocumentSync(const QUrl &url, const QByteArray &mimeType
 
     d->savingImage = 0;
 
+    if (status.isOk() && mimeType == nativeFormatMimeType()) {
+        d->savedPixelData.commit(fileName);
+    } else {
+        d->savedPixelData = committedPixelData;
+    }
+
     return status.isOk();
 }
 
@@ -1082,6 +1142,19 @@ void KisDocument::slotChildCompletedSavingInBackground(KisImportExportErrorCode
         d->backgroundSaveDocument->d->isAutosaving = false;
     }
 
+    /**
+     * The layers written by a successful native save can be copied
+     * from the new file the next time. Autosave files are removed
+     * soon, so they are not worth tracking.
+     */
+    if (status.isOk() &&
+        d->backgroundSaveJob.mimeType == nativeFormatMimeType() &&
+        !(d->backgroundSaveJob.flags & KritaUtils::SaveInAutosaveMode)) {
+
+        d->savedPixelData = d->backgroundSaveDocument->d->savedPixelData;
+        d->savedPixelData.commit(d->backgroundSaveJob.filePath);
+    }
+
     d->backgroundSaveDocument.take()->deleteLater();
 
     KIS_ASSERT_RECOVER(d->backgroundSaveJob.isValid()) {
@@ -1109,6 +1182,10 @@ void KisDocument::slotChildCompletedSavingInBackground(KisImportExportErrorCode
 
 void KisDocument::slotAutoSaveImpl(std::unique_ptr<KisDocument> &&optionalClonedDocument)
 {
+    if (optionalClonedDocument) {
+        d->asyncAutosaveCloneRequested = false;
+    }
+
     if (!d->modified || !d->modifiedAfterAutosave) return;
     const QString autoSaveFileName = generateAutoSaveFileName(localFilePath());
 
@@ -1117,23 +1194,51 @@ void KisDocument::slotAutoSaveImpl(std::unique_ptr<KisDocument> &&optionalCloned
     KisUsageLogger::log(QString("Autosaving: %1").arg(autoSaveFileName));
 
     const bool hadClonedDocument = bool(optionalClonedDocument);
+    const bool imageIsIdle = d->image->isIdle();
     bool started = false;
 
-    if (d->image->isIdle() || hadClonedDocument) {
+    if (!hadClonedDocument && d->asyncAutosaveCloneRequested) {
+        // the clone is already on its way
+        emit statusBarMessage(i18n("Autosaving postponed: document is busy..."), errorMessageTimeout);
+        return;
+    }
+
+    if (imageIsIdle || hadClonedDocument) {
         started = initiateSavingInBackground(i18n("Autosaving..."),
                                              this, SLOT(slotCompleteAutoSaving(KritaUtils::ExportFileJob, KisImportExportErrorCode, QString)),
                                              KritaUtils::ExportFileJob(autoSaveFileName, nativeFormatMimeType(), KritaUtils::SaveIsExporting | KritaUtils::SaveInAutosaveMode),
                                              0,
                                              std::move(optionalClonedDocument));
-    } else {
-        emit statusBarMessage(i18n("Autosaving postponed: document is busy..."), errorMessageTimeout);
     }
 
-    if (!started && !hadClonedDocument && d->autoSaveFailureCount >= 3) {
+    /**
+     * When the image is busy, we don't wait for it to become idle and
+     * don't lock it from the GUI thread. Instead, the document is cloned
+     * by a stroke, between the strokes of the user. The clone shares the
+     * tiles with the original copy-on-write. Cloning still visits every
+     * tile of every device, but only to bump its reference count, so the
+     * stroke is short and the serialization runs in the background while
+     * painting goes on.
+     */
+    if (!started && !hadClonedDocument &&
+        (!imageIsIdle || d->autoSaveFailureCount >= 3)) {
+
+        if (!imageIsIdle) {
+            emit statusBarMessage(i18n("Autosaving postponed: document is busy..."), errorMessageTimeout);
+        }
+
+        d->asyncAutosaveCloneRequested = true;
+
+        /**
+         * The clone is handed over without blocking the stroke: the GUI
+         * thread may be waiting for the image itself at the moment
+         */
         KisCloneDocumentStroke *stroke = new KisCloneDocumentStroke(this);
         connect(stroke, SIGNAL(sigDocumentCloned(KisDocument*)),
-                this, SLOT(slotInitiateAsyncAutosaving(KisDocument*)),
-                Qt::BlockingQueuedConnection);
+                this, SLOT(slotAsyncAutosaveDocumentCloned(KisDocument*)),
+                Qt::DirectConnection);
+        connect(stroke, SIGNAL(sigCloningCancelled()),
+                this, SLOT(slotAsyncAutosaveCloningCancelled()));
 
         KisStrokeId strokeId = d->image->startStroke(stroke);
         d->image->endStroke(strokeId);
@@ -1152,9 +1257,47 @@ void KisDocument::slotAutoSave()
     slotAutoSaveImpl(std::unique_ptr<KisDocument>());
 }
 
-void KisDocument::slotInitiateAsyncAutosaving(KisDocument *clonedDocument)
+void KisDocument::slotAsyncAutosaveDocumentCloned(KisDocument *clonedDocument)
 {
-    slotAutoSaveImpl(std::unique_ptr<KisDocument>(clonedDocument));
+    /**
+     * We are in the image thread and the clone stroke still holds the
+     * image in its exclusive job, so the layers cannot change now. Only
+     * the image is accessed here, the tracker belongs to the GUI thread.
+     */
+    clonedDocument->d->savedPixelData = KisSavedPixelDataTracker::captureLayerStates(d->image->root());
+    clonedDocument->d->savingPreview = generateImagePreview(d->image, savingPreviewSize);
+
+    {
+        QMutexLocker l(&d->asyncAutosaveCloneMutex);
+        d->asyncAutosaveClone.reset(clonedDocument);
+    }
+
+    QMetaObject::invokeMethod(this, "slotInitiateAsyncAutosaving", Qt::QueuedConnection);
+}
+
+void KisDocument::slotInitiateAsyncAutosaving()
+{
+    std::unique_ptr<KisDocument> clonedDocument;
+
+    {
+        QMutexLocker l(&d->asyncAutosaveCloneMutex);
+        clonedDocument.reset(d->asyncAutosaveClone.take());
+    }
+
+    KIS_SAFE_ASSERT_RECOVER_RETURN(clonedDocument);
+
+    clonedDocument->d->savedPixelData =
+        d->savedPixelData.snapshotForSaving(clonedDocument->d->savedPixelData);
+
+    slotAutoSaveImpl(std::move(clonedDocument));
+}
+
+void KisDocument::slotAsyncAutosaveCloningCancelled()
+{
+    d->asyncAutosaveCloneRequested = false;
+
+    // the autosave interval was set to infinite while waiting for the clone
+    setEmergencyAutoSaveInterval();
 }
 
 void KisDocument::slotCompleteAutoSaving(const KritaUtils::ExportFileJob &job, KisImportExportErrorCode status, const QString &errorMessage)
@@ -1300,22 +1443,15 @@ bool KisDocument::isModified() const
 
 QPixmap KisDocument::generatePreview(const QSize& size)
 {
+    if (!d->savingPreview.isNull() && size == savingPreviewSize) {
+        return QPixmap::fromImage(d->savingPreview);
+    }
+
     KisImageSP image = d->image;
     if (d->savingImage) image = d->savingImage;
 
     if (image) {
-        QRect bounds = image->bounds();
-        QSize newSize = bounds.size();
-        newSize.scale(size, Qt::KeepAspectRatio);
-        QPixmap px = QPixmap::fromImage(image->convertToQImage(newSize, 0));
-        if (px.size() == QSize(0,0)) {
-            px = QPixmap(newSize);
-            QPainter gc(&px);
-            QBrush checkBrush = QBrush(KisCanvasWidgetBase::createCheckersImage(newSize.width() / 5));
-            gc.fillRect(px.rect(), checkBrush);
-            gc.end();
-        }
-        return px;
+        return QPixmap::fromImage(generateImagePreview(image, size));
     }
     return QPixmap(size);
 }
@@ -1516,8 +1652,16 @@ bool KisDocument::openFile()
         d->importExportManager->setUpdater(updater);
     }
 
+    d->savedPixelData.clear();
+
     KisImportExportErrorCode status = d->importExportManager->importDocument(localFilePath(), typeName);
 
+    if (typeName.toLatin1() == nativeFormatMimeType() && status.isOk()) {
+        d->savedPixelData.commit(localFilePath());
+    } else {
+        d->savedPixelData.clear();
+    }
+
     if (!status.isOk()) {
         if (window && window->viewManager()) {
             updater->cancel();
@@ -2232,11 +2376,21 @@ KisUndoStore* KisDocument::createUndoStore()
     return new KisDocumentUndoStore(this);
 }
 
+bool KisDocument::isWaitingForAutosaveClone() const
+{
+    return d->asyncAutosaveCloneRequested;
+}
+
 bool KisDocument::isAutosaving() const
 {
     return d->isAutosaving;
 }
 
+KisSavedPixelDataTracker* KisDocument::savedPixelDataTracker() const
+{
+    return &d->savedPixelData;
+}
+
 QString KisDocument::exportErrorToUserMessage(KisImportExportErrorCode status, const QString &errorMessage)
 {
     return errorMessage.isEmpty() ? status.errorMessage() : errorMessage;
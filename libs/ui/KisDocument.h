@@ -67,6 +67,7 @@ class KisGuidesConfig;
 class KisMirrorAxisConfig;
 class QDomDocument;
 class KisReferenceImagesLayer;
+class KisSavedPixelDataTracker;
 
 #define KIS_MIME_TYPE "application/x-krita"
 
@@ -238,6 +239,10 @@ public:
     /**
      * @brief Generates a preview picture of the document
      * @note The preview is used in the File Dialog and also to create the Thumbnail
+     *
+     * For a document cloned for saving, the 256x256 preview stored in the
+     * native format is generated from the original image at the moment of
+     * cloning.
      */
     QPixmap generatePreview(const QSize& size);
 
@@ -482,7 +487,9 @@ private Q_SLOTS:
 
     void slotCompleteSavingDocument(const KritaUtils::ExportFileJob &job, KisImportExportErrorCode status, const QString &errorMessage);
 
-    void slotInitiateAsyncAutosaving(KisDocument *clonedDocument);
+    void slotAsyncAutosaveDocumentCloned(KisDocument *clonedDocument);
+    void slotInitiateAsyncAutosaving();
+    void slotAsyncAutosaveCloningCancelled();
 
 private:
 
@@ -535,6 +542,18 @@ public:
 
     bool isAutosaving() const override;
 
+    /**
+     * @return true if the autosave is waiting for the busy image to be
+     * cloned by a stroke
+     */
+    bool isWaitingForAutosaveClone() const;
+
+    /**
+     * @return the tracker of the layers that have not changed since the
+     * document was last loaded from or saved to a native file
+     */
+    KisSavedPixelDataTracker* savedPixelDataTracker() const;
+
 public:
 
     QString localFilePath() const override;
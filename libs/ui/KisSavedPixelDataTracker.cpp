@@ -0,0 +1,227 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisSavedPixelDataTracker.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QHash>
+#include <QUuid>
+
+#include "kis_paint_device.h"
+#include "kis_paint_layer.h"
+#include "kis_datamanager.h"
+#include "kis_layer_utils.h"
+
+namespace {
+
+struct DeviceState
+{
+    const void *dataManager = 0;
+    const KoColorSpace *colorSpace = 0;
+    int sequenceNumber = 0;
+    int changeCount = 0;
+
+    bool isValid() const {
+        return dataManager;
+    }
+
+    bool operator==(const DeviceState &rhs) const {
+        return dataManager == rhs.dataManager &&
+            colorSpace == rhs.colorSpace &&
+            sequenceNumber == rhs.sequenceNumber &&
+            changeCount == rhs.changeCount;
+    }
+};
+
+DeviceState stateOf(KisPaintDeviceSP device)
+{
+    DeviceState state;
+
+    /**
+     * Animated devices store every frame in a separate entry and
+     * devices with a transaction in progress are about to change,
+     * so they are never considered unchanged.
+     */
+    if (!device || device->keyframeChannel() ||
+        device->dataManager()->hasCurrentMemento()) {
+
+        return state;
+    }
+
+    state.dataManager = device->dataManager().data();
+    state.colorSpace = device->colorSpace();
+    state.sequenceNumber = device->sequenceNumber();
+    state.changeCount = device->dataManager()->changeCount();
+
+    return state;
+}
+
+struct Entry
+{
+    QString location;
+    DeviceState state;
+};
+
+}
+
+struct KRITAUI_NO_EXPORT KisSavedPixelDataTracker::Private
+{
+    QString fileName;
+    qint64 fileSize = -1;
+    QDateTime fileModified;
+
+    QHash<QUuid, Entry> entries;
+    QHash<QUuid, Entry> recordedEntries;
+    QHash<QUuid, DeviceState> snapshotStates;
+
+    /**
+     * Only the entries of a snapshot have been checked against the
+     * current state of the layers
+     */
+    bool isSnapshot = false;
+
+    bool fileIsUnchanged() const {
+        if (fileName.isEmpty()) return false;
+
+        QFileInfo info(fileName);
+        return info.exists() &&
+            info.size() == fileSize &&
+            info.lastModified() == fileModified;
+    }
+};
+
+KisSavedPixelDataTracker::KisSavedPixelDataTracker()
+    : m_d(new Private)
+{
+}
+
+KisSavedPixelDataTracker::KisSavedPixelDataTracker(const KisSavedPixelDataTracker &rhs)
+    : m_d(new Private(*rhs.m_d))
+{
+}
+
+KisSavedPixelDataTracker& KisSavedPixelDataTracker::operator=(const KisSavedPixelDataTracker &rhs)
+{
+    if (this != &rhs) {
+        *m_d = *rhs.m_d;
+    }
+    return *this;
+}
+
+KisSavedPixelDataTracker::~KisSavedPixelDataTracker()
+{
+}
+
+void KisSavedPixelDataTracker::recordLoadedEntry(const QUuid &nodeUuid, KisPaintDeviceSP device, const QString &location)
+{
+    const DeviceState state = stateOf(device);
+    if (!state.isValid()) return;
+
+    m_d->recordedEntries.insert(nodeUuid, {location, state});
+}
+
+void KisSavedPixelDataTracker::recordSavedEntry(const QUuid &nodeUuid, const QString &location)
+{
+    auto it = m_d->snapshotStates.constFind(nodeUuid);
+    if (it == m_d->snapshotStates.constEnd()) return;
+
+    m_d->recordedEntries.insert(nodeUuid, {location, *it});
+}
+
+void KisSavedPixelDataTracker::commit(const QString &fileName)
+{
+    QFileInfo info(fileName);
+
+    m_d->fileName = info.absoluteFilePath();
+    m_d->fileSize = info.size();
+    m_d->fileModified = info.lastModified();
+
+    m_d->entries = m_d->recordedEntries;
+    m_d->recordedEntries.clear();
+    m_d->snapshotStates.clear();
+    m_d->isSnapshot = false;
+}
+
+void KisSavedPixelDataTracker::clear()
+{
+    *m_d = Private();
+}
+
+KisSavedPixelDataTracker KisSavedPixelDataTracker::snapshotForSaving(KisNodeSP root) const
+{
+    return snapshotForSaving(captureLayerStates(root));
+}
+
+KisSavedPixelDataTracker KisSavedPixelDataTracker::snapshotForSaving(const KisSavedPixelDataTracker &layerStates) const
+{
+    KisSavedPixelDataTracker snapshot;
+    snapshot.m_d->isSnapshot = true;
+    snapshot.m_d->snapshotStates = layerStates.m_d->snapshotStates;
+
+    if (m_d->fileIsUnchanged()) {
+        snapshot.m_d->fileName = m_d->fileName;
+        snapshot.m_d->fileSize = m_d->fileSize;
+        snapshot.m_d->fileModified = m_d->fileModified;
+
+        for (auto it = snapshot.m_d->snapshotStates.constBegin();
+             it != snapshot.m_d->snapshotStates.constEnd(); ++it) {
+
+            auto entryIt = m_d->entries.constFind(it.key());
+            if (entryIt != m_d->entries.constEnd() && entryIt->state == it.value()) {
+                snapshot.m_d->entries.insert(it.key(), *entryIt);
+            }
+        }
+    }
+
+    return snapshot;
+}
+
+KisSavedPixelDataTracker KisSavedPixelDataTracker::captureLayerStates(KisNodeSP root)
+{
+    KisSavedPixelDataTracker states;
+
+    KisLayerUtils::recursiveApplyNodes(root,
+        [&states] (KisNodeSP node) {
+            if (!dynamic_cast<KisPaintLayer*>(node.data())) return;
+
+            const DeviceState state = stateOf(node->paintDevice());
+            if (!state.isValid()) return;
+
+            states.m_d->snapshotStates.insert(node->uuid(), state);
+        });
+
+    return states;
+}
+
+QString KisSavedPixelDataTracker::sourceFileName() const
+{
+    /**
+     * The file is checked once again right before it is used, because
+     * the saver may be writing to the same location in place.
+     */
+    return m_d->isSnapshot && m_d->fileIsUnchanged() ? m_d->fileName : QString();
+}
+
+QString KisSavedPixelDataTracker::unchangedEntryLocation(const QUuid &nodeUuid) const
+{
+    if (!m_d->isSnapshot) return QString();
+
+    auto it = m_d->entries.constFind(nodeUuid);
+    return it != m_d->entries.constEnd() ? it->location : QString();
+}
@@ -0,0 +1,127 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISSAVEDPIXELDATATRACKER_H
+#define KISSAVEDPIXELDATATRACKER_H
+
+#include "kritaui_export.h"
+#include <QScopedPointer>
+#include "kis_types.h"
+
+class QUuid;
+
+/**
+ * KisSavedPixelDataTracker remembers which paint layers of a document
+ * have not changed since their pixel data was last written to (or read
+ * from) a .kra file, and where in that file the data lives. It lets the
+ * saver copy the unchanged entries verbatim from the previous file instead
+ * of encoding all the tiles again.
+ *
+ * The workflow is the following:
+ *
+ * 1) The loader calls recordLoadedEntry() for every paint device it reads,
+ *    and the document calls commit() when loading has finished.
+ *
+ * 2) Before saving, the document calls snapshotForSaving() on the original
+ *    image while it is locked, and passes the result to the cloned document
+ *    that is actually saved.
+ *
+ * 3) The saver asks unchangedEntryLocation() for every paint layer and
+ *    reports the entries it has written with recordSavedEntry().
+ *
+ * 4) When saving has succeeded, the document adopts the tracker of the
+ *    cloned document and commits it to the new file.
+ *
+ * Only the pixel data of non-animated paint layers is tracked. A layer is
+ * considered unchanged if its paint device still has the same data manager,
+ * color space, sequence number and tile change counter.
+ */
+class KRITAUI_EXPORT KisSavedPixelDataTracker
+{
+public:
+    KisSavedPixelDataTracker();
+    KisSavedPixelDataTracker(const KisSavedPixelDataTracker &rhs);
+    KisSavedPixelDataTracker& operator=(const KisSavedPixelDataTracker &rhs);
+    ~KisSavedPixelDataTracker();
+
+    /**
+     * Records that \p device of the node with \p nodeUuid has just been
+     * read from \p location
+     */
+    void recordLoadedEntry(const QUuid &nodeUuid, KisPaintDeviceSP device, const QString &location);
+
+    /**
+     * Records that the pixel data of the node with \p nodeUuid has been
+     * written to \p location. Only the nodes present in the snapshot
+     * are recorded.
+     */
+    void recordSavedEntry(const QUuid &nodeUuid, const QString &location);
+
+    /**
+     * Makes the recorded entries current and binds them to \p fileName,
+     * which should have been completely written or read by now
+     */
+    void commit(const QString &fileName);
+
+    /**
+     * Forgets everything, including the recorded entries
+     */
+    void clear();
+
+    /**
+     * Creates a tracker for saving a copy of the image with root \p root.
+     * It knows which layers have not changed since the last commit and
+     * remembers the state of all the layers to be committed after saving.
+     *
+     * The image should be locked while calling this function.
+     */
+    KisSavedPixelDataTracker snapshotForSaving(KisNodeSP root) const;
+
+    /**
+     * Same as above, but the layers are taken from \p layerStates,
+     * captured earlier with captureLayerStates()
+     */
+    KisSavedPixelDataTracker snapshotForSaving(const KisSavedPixelDataTracker &layerStates) const;
+
+    /**
+     * Captures the state of the paint layers of the image with root
+     * \p root to be passed to snapshotForSaving() later. It doesn't
+     * access any tracker, so it may be called from the image threads,
+     * e.g. by a stroke that holds the image in an exclusive job.
+     */
+    static KisSavedPixelDataTracker captureLayerStates(KisNodeSP root);
+
+    /**
+     * @return the file the unchanged entries can be copied from, or an
+     * empty string if it has been modified since it was committed
+     */
+    QString sourceFileName() const;
+
+    /**
+     * @return the location of the unchanged pixel data of the node with
+     * \p nodeUuid in sourceFileName(), or an empty string if the node
+     * needs to be saved from scratch
+     */
+    QString unchangedEntryLocation(const QUuid &nodeUuid) const;
+
+private:
+    struct Private;
+    QScopedPointer<Private> m_d;
+};
+
+#endif // KISSAVEDPIXELDATATRACKER_H
@@ -0,0 +1,88 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "KisViewportMotionPredictor.h"
+
+#include <QtGlobal>
+
+namespace {
+/**
+ * The weight of the newest sample in the smoothed velocity
+ */
+const qreal smoothingFactor = 0.4;
+
+/**
+ * The events coming after a longer pause start a new motion
+ */
+const qint64 stopTimeout = 150;
+
+/**
+ * The events coming in the same millisecond are accounted as if
+ * they came in this interval, otherwise the velocity explodes
+ */
+const qint64 minSampleInterval = 1;
+}
+
+KisViewportMotionPredictor::KisViewportMotionPredictor()
+    : m_lastTimestamp(0),
+      m_hasSamples(false)
+{
+}
+
+void KisViewportMotionPredictor::addMotion(const QPointF &offset, qint64 timestamp)
+{
+    if (!m_hasSamples || timestamp - m_lastTimestamp > stopTimeout) {
+        /**
+         * We have no idea how long the first motion took, so just
+         * remember the timestamp and wait for the next one
+         */
+        m_velocity = QPointF();
+        m_lastTimestamp = timestamp;
+        m_hasSamples = true;
+        return;
+    }
+
+    const qint64 interval = qMax(minSampleInterval, timestamp - m_lastTimestamp);
+    const QPointF sampleVelocity = offset / qreal(interval);
+
+    m_velocity = m_velocity.isNull() ?
+        sampleVelocity :
+        smoothingFactor * sampleVelocity + (1.0 - smoothingFactor) * m_velocity;
+
+    m_lastTimestamp = timestamp;
+}
+
+QPointF KisViewportMotionPredictor::predictedShift(qint64 timestamp, qint64 lookahead) const
+{
+    if (!m_hasSamples || timestamp - m_lastTimestamp > stopTimeout) {
+        return QPointF();
+    }
+
+    return m_velocity * qreal(lookahead);
+}
+
+void KisViewportMotionPredictor::reset()
+{
+    m_velocity = QPointF();
+    m_lastTimestamp = 0;
+    m_hasSamples = false;
+}
+
+QPointF KisViewportMotionPredictor::velocity() const
+{
+    return m_velocity;
+}
@@ -0,0 +1,69 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef KISVIEWPORTMOTIONPREDICTOR_H
+#define KISVIEWPORTMOTIONPREDICTOR_H
+
+#include "kritaui_export.h"
+
+#include <QPointF>
+
+/**
+ * Estimates the velocity of the canvas panning from the sequence of
+ * viewport offsets and predicts where the viewport is going to be in
+ * the nearest future. It is used for preparing the area of the image
+ * the user is moving toward before it actually becomes visible.
+ *
+ * The velocity is smoothed with an exponential moving average, so a
+ * single jerky event doesn't throw the prediction away. If no motion
+ * has been reported for stopTimeout, the viewport is considered to be
+ * at rest and no shift is predicted.
+ */
+class KRITAUI_EXPORT KisViewportMotionPredictor
+{
+public:
+    KisViewportMotionPredictor();
+
+    /**
+     * Reports that the viewport content has been shifted by \p offset
+     * (in viewport pixels) at time \p timestamp (in milliseconds)
+     */
+    void addMotion(const QPointF &offset, qint64 timestamp);
+
+    /**
+     * Returns the total shift of the viewport content expected during
+     * \p lookahead milliseconds after \p timestamp
+     */
+    QPointF predictedShift(qint64 timestamp, qint64 lookahead) const;
+
+    /**
+     * Forgets the history of the motion, e.g. when the zoom changes
+     */
+    void reset();
+
+    /**
+     * Current smoothed velocity in viewport pixels per millisecond
+     */
+    QPointF velocity() const;
+
+private:
+    QPointF m_velocity;
+    qint64 m_lastTimestamp;
+    bool m_hasSamples;
+};
+
+#endif // KISVIEWPORTMOTIONPREDICTOR_H
@@ -803,6 +803,10 @@ void KisCanvas2::updateCanvasProjection()
                                             QRect(), std::bit_or<QRect>());
 
         tryIssueCanvasUpdates(vRect);
+
+        Q_FOREACH (KisUpdateInfoSP info, infoObjects) {
+            KisStrokeSpeedMonitor::instance()->notifyCanvasUpdated(info->dirtyImageRect());
+        }
     };
 
     bool shouldExplicitlyIssueUpdates = false;
@@ -23,11 +23,12 @@
 #include <QMutex>
 #include <QMutexLocker>
 
+#include "kritaui_export.h"
 #include "kis_update_info.h"
 
 typedef QList<KisUpdateInfoSP> KisUpdateInfoList;
 
-class KisCanvasUpdatesCompressor
+class KRITAUI_EXPORT KisCanvasUpdatesCompressor
 {
 public:
     bool putUpdateInfo(KisUpdateInfoSP info);
@@ -18,6 +18,7 @@
 #include "kis_image_pyramid.h"
 
 #include <QBitArray>
+#include <QtConcurrent>
 #include <KoChannelInfo.h>
 #include <KoCompositeOp.h>
 #include <KoColorSpaceRegistry.h>
@@ -53,6 +54,11 @@
 #include <half.h>
 #endif
 
+/**
+ * The number of pixels converted by one job in retrieveImageData()
+ */
+static const quint32 retrieveJobPixels = 64 * 256;
+
 #define ceiledSize(sz) QSize(ceil((sz).width()), ceil((sz).height()))
 #define isOdd(x) ((x) & 0x01)
 
@@ -118,16 +124,31 @@ void KisImagePyramid::setMonitorProfile(const KoColorProfile* monitorProfile,
                                         KoColorConversionTransformation::Intent renderingIntent,
                                         KoColorConversionTransformation::ConversionFlags conversionFlags)
 {
-    m_monitorProfile = monitorProfile;
     /**
      * If you change pixel size here, don't forget to change it
      * in optimized function downsamplePixels()
      */
-    m_monitorColorSpace = KoColorSpaceRegistry::instance()->rgb8(monitorProfile);
+    const KoColorSpace *monitorColorSpace = KoColorSpaceRegistry::instance()->rgb8(monitorProfile);
+
+    /**
+     * The canvas resets the monitor profile every time the display
+     * settings are touched. If nothing has actually changed, the planes
+     * of the pyramid are still valid and we shouldn't drop them.
+     */
+    const bool needsRebuild =
+        m_pyramid.size() != m_pyramidHeight ||
+        monitorColorSpace != m_monitorColorSpace ||
+        renderingIntent != m_renderingIntent ||
+        conversionFlags != m_conversionFlags;
+
+    m_monitorProfile = monitorProfile;
+    m_monitorColorSpace = monitorColorSpace;
     m_renderingIntent = renderingIntent;
     m_conversionFlags = conversionFlags;
 
-    rebuildPyramid();
+    if (needsRebuild) {
+        rebuildPyramid();
+    }
 }
 
 void KisImagePyramid::setChannelFlags(const QBitArray &channelFlags)
@@ -280,58 +301,95 @@ void KisImagePyramid::retrieveImageData(const QRect &rect)
         if (m_channelFlags.size() != channelInfo.size()) {
             setChannelFlags(QBitArray());
         }
-        if (!m_channelFlags.isEmpty() && !m_allChannelsSelected) {
-            QScopedArrayPointer<quint8> dst(new quint8[projectionCs->pixelSize() * numPixels]);
-
-            int channelSize = channelInfo[m_selectedChannelIndex]->size();
-            int pixelSize = projectionCs->pixelSize();
-
-            KisConfig cfg(true);
-
-            if (m_onlyOneChannelSelected && !cfg.showSingleChannelAsColor()) {
-                int selectedChannelPos = channelInfo[m_selectedChannelIndex]->pos();
-                for (uint pixelIndex = 0; pixelIndex < numPixels; ++pixelIndex) {
-                    for (uint channelIndex = 0; channelIndex < projectionCs->channelCount(); ++channelIndex) {
-
-                        if (channelInfo[channelIndex]->channelType() == KoChannelInfo::COLOR) {
-                            memcpy(dst.data() + (pixelIndex * pixelSize) + (channelIndex * channelSize),
-                                   originalBytes.data() + (pixelIndex * pixelSize) + selectedChannelPos,
-                                   channelSize);
-                        }
-                        else if (channelInfo[channelIndex]->channelType() == KoChannelInfo::ALPHA) {
-                            memcpy(dst.data() + (pixelIndex * pixelSize) + (channelIndex * channelSize),
-                                   originalBytes.data()  + (pixelIndex * pixelSize) + (channelIndex * channelSize),
-                                   channelSize);
-                        }
-                    }
-                }
-            }
-            else {
-                for (uint pixelIndex = 0; pixelIndex < numPixels; ++pixelIndex) {
-                    for (uint channelIndex = 0; channelIndex < projectionCs->channelCount(); ++channelIndex) {
-                        if (m_channelFlags.testBit(channelIndex)) {
-                            memcpy(dst.data() + (pixelIndex * pixelSize) + (channelIndex * channelSize),
-                                   originalBytes.data()  + (pixelIndex * pixelSize) + (channelIndex * channelSize),
-                                   channelSize);
-                        }
-                        else {
-                            memset(dst.data() + (pixelIndex * pixelSize) + (channelIndex * channelSize), 0, channelSize);
-                        }
-                    }
+
+        const bool needsChannelFiltering = !m_channelFlags.isEmpty() && !m_allChannelsSelected;
+        const bool showSingleChannelAsColor = needsChannelFiltering && KisConfig(true).showSingleChannelAsColor();
+
+        const int srcPixelSize = projectionCs->pixelSize();
+        const int dstPixelSize = m_monitorColorSpace->pixelSize();
+
+        QScopedArrayPointer<quint8> dst(new quint8[dstPixelSize * numPixels]);
+
+        /**
+         * The pixels are independent from each other, so the conversion
+         * is split into chunks processed in parallel
+         */
+        auto convertChunk =
+            [&] (quint32 firstPixel) {
+                const quint32 numChunkPixels = qMin(retrieveJobPixels, numPixels - firstPixel);
+                const quint8 *src = originalBytes.data() + firstPixel * srcPixelSize;
+
+                QScopedArrayPointer<quint8> filteredBytes;
+
+                if (needsChannelFiltering) {
+                    filteredBytes.reset(new quint8[srcPixelSize * numChunkPixels]);
+                    filterChannels(projectionCs, src, filteredBytes.data(), numChunkPixels, showSingleChannelAsColor);
+                    src = filteredBytes.data();
                 }
 
+                projectionCs->convertPixelsTo(src, dst.data() + firstPixel * dstPixelSize,
+                                              m_monitorColorSpace, numChunkPixels,
+                                              m_renderingIntent, m_conversionFlags);
+            };
+
+        if (numPixels > retrieveJobPixels) {
+            QVector<quint32> chunks;
+            for (quint32 i = 0; i < numPixels; i += retrieveJobPixels) {
+                chunks.append(i);
             }
-            originalBytes.swap(dst);
+
+            QtConcurrent::blockingMap(chunks, convertChunk);
+        } else {
+            convertChunk(0);
         }
 
-        QScopedArrayPointer<quint8> dst(new quint8[m_monitorColorSpace->pixelSize() * numPixels]);
-        projectionCs->convertPixelsTo(originalBytes.data(), dst.data(), m_monitorColorSpace, numPixels, m_renderingIntent, m_conversionFlags);
         originalBytes.swap(dst);
     }
 
     m_pyramid[ORIGINAL_INDEX]->writeBytes(originalBytes.data(), rect);
 }
 
+void KisImagePyramid::filterChannels(const KoColorSpace *cs, const quint8 *src, quint8 *dst, quint32 numPixels, bool showSingleChannelAsColor) const
+{
+    QList<KoChannelInfo*> channelInfo = cs->channels();
+
+    int channelSize = channelInfo[m_selectedChannelIndex]->size();
+    int pixelSize = cs->pixelSize();
+
+    if (m_onlyOneChannelSelected && !showSingleChannelAsColor) {
+        int selectedChannelPos = channelInfo[m_selectedChannelIndex]->pos();
+        for (uint pixelIndex = 0; pixelIndex < numPixels; ++pixelIndex) {
+            for (uint channelIndex = 0; channelIndex < cs->channelCount(); ++channelIndex) {
+
+                if (channelInfo[channelIndex]->channelType() == KoChannelInfo::COLOR) {
+                    memcpy(dst + (pixelIndex * pixelSize) + (channelIndex * channelSize),
+                           src + (pixelIndex * pixelSize) + selectedChannelPos,
+                           channelSize);
+                }
+                else if (channelInfo[channelIndex]->channelType() == KoChannelInfo::ALPHA) {
+                    memcpy(dst + (pixelIndex * pixelSize) + (channelIndex * channelSize),
+                           src + (pixelIndex * pixelSize) + (channelIndex * channelSize),
+                           channelSize);
+                }
+            }
+        }
+    }
+    else {
+        for (uint pixelIndex = 0; pixelIndex < numPixels; ++pixelIndex) {
+            for (uint channelIndex = 0; channelIndex < cs->channelCount(); ++channelIndex) {
+                if (m_channelFlags.testBit(channelIndex)) {
+                    memcpy(dst + (pixelIndex * pixelSize) + (channelIndex * channelSize),
+                           src + (pixelIndex * pixelSize) + (channelIndex * channelSize),
+                           channelSize);
+                }
+                else {
+                    memset(dst + (pixelIndex * pixelSize) + (channelIndex * channelSize), 0, channelSize);
+                }
+            }
+        }
+    }
+}
+
 void KisImagePyramid::recalculateCache(KisPPUpdateInfoSP info)
 {
     KisPaintDevice *src;
@@ -411,27 +469,23 @@ void  KisImagePyramid::downsamplePixels(const quint8 *srcRow0,
                                         quint8 *dstRow,
                                         qint32 numSrcPixels)
 {
-    /**
-     * FIXME (mandatory): Use SSE and friends here.
-     */
-
-    qint16 b = 0;
-    qint16 g = 0;
-    qint16 r = 0;
-    qint16 a = 0;
-
     static const qint32 pixelSize = 4; // This is preview argb8 mode
 
+    /**
+     * The loop has no dependencies between the channels and the
+     * pixels and no branches, which gives the compiler a chance to
+     * auto-vectorize it. Whether it actually does depends on the
+     * compiler and the build flags, check KisPrescaledProjectionBenchmark
+     * before changing it.
+     */
     for (qint32 i = 0; i < numSrcPixels / 2; i++) {
-        b = srcRow0[0] + srcRow1[0] + srcRow0[4] + srcRow1[4];
-        g = srcRow0[1] + srcRow1[1] + srcRow0[5] + srcRow1[5];
-        r = srcRow0[2] + srcRow1[2] + srcRow0[6] + srcRow1[6];
-        a = srcRow0[3] + srcRow1[3] + srcRow0[7] + srcRow1[7];
-
-        dstRow[0] = b / 4;
-        dstRow[1] = g / 4;
-        dstRow[2] = r / 4;
-        dstRow[3] = a / 4;
+        for (qint32 ch = 0; ch < pixelSize; ch++) {
+            const quint16 sum =
+                quint16(srcRow0[ch]) + srcRow1[ch] +
+                srcRow0[ch + pixelSize] + srcRow1[ch + pixelSize];
+
+            dstRow[ch] = quint8(sum >> 2);
+        }
 
         dstRow += pixelSize;
         srcRow0 += 2 * pixelSize;
@@ -76,6 +76,14 @@ public:
 private:
 
     void retrieveImageData(const QRect &rect);
+
+    /**
+     * Applies the channel flags of the canvas to @numPixels pixels
+     * of @src and writes the result into @dst
+     */
+    void filterChannels(const KoColorSpace *cs, const quint8 *src, quint8 *dst,
+                        quint32 numPixels, bool showSingleChannelAsColor) const;
+
     void rebuildPyramid();
     void clearPyramid();
 
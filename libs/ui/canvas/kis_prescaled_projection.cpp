@@ -27,6 +27,10 @@
 #include <QPoint>
 #include <QSize>
 #include <QPainter>
+#include <QElapsedTimer>
+#include <QReadWriteLock>
+#include <QAtomicInteger>
+#include <QtConcurrent>
 
 #include <KoColorProfile.h>
 #include <KoViewConverter.h>
@@ -36,14 +40,28 @@
 #include "kis_config_notifier.h"
 #include "kis_image.h"
 #include "krita_utils.h"
+#include "kis_global.h"
 
 #include "kis_coordinates_converter.h"
+#include "KisViewportMotionPredictor.h"
 #include "kis_projection_backend.h"
 #include "kis_image_pyramid.h"
 #include "kis_display_filter.h"
 
 #define ceiledSize(sz) QSize(ceil((sz).width()), ceil((sz).height()))
 
+/**
+ * How far into the future (in milliseconds) the area exposed by
+ * panning is prepared
+ */
+static const qint64 prefetchLookahead = 100;
+
+/**
+ * Predicted shifts smaller than this (in viewport pixels) are
+ * not worth starting a worker
+ */
+static const qreal minPrefetchShift = 8.0;
+
 inline void copyQImageBuffer(uchar* dst, const uchar* src , qint32 deltaX, qint32 width)
 {
     if (deltaX >= 0) {
@@ -73,10 +91,19 @@ void copyQImage(qint32 deltaX, qint32 deltaY, QImage* dstImage, const QImage& sr
     }
 }
 
+struct PrefetchedPatch {
+    /// the rect covered by the patch in viewport pixels
+    QRect rect;
+    QImage image;
+};
+
+typedef QVector<PrefetchedPatch> PrefetchedPatches;
+
 struct KisPrescaledProjection::Private {
     Private()
         : viewportSize(0, 0)
         , projectionBackend(0) {
+        motionTimer.start();
     }
 
     QImage prescaledQImage;
@@ -87,6 +114,32 @@ struct KisPrescaledProjection::Private {
     KisImageWSP image;
     KisCoordinatesConverter *coordinatesConverter;
     KisProjectionBackend* projectionBackend;
+
+    KisViewportMotionPredictor motionPredictor;
+    QElapsedTimer motionTimer;
+
+    PrefetchedPatches prefetchedPatches;
+    QFuture<PrefetchedPatches> prefetchFuture;
+
+    /**
+     * The viewport shift that happened after the running
+     * prefetch had been started
+     */
+    QPoint prefetchFutureShift;
+
+    /**
+     * The prefetch worker reads the projection backend, while
+     * updateCache() writes it from the image thread. The worker
+     * holds the read lock while drawing every single patch.
+     */
+    QReadWriteLock backendLock;
+
+    /**
+     * Statistics for the benchmarks. The drawn bytes are also
+     * counted by the prefetch worker.
+     */
+    QAtomicInteger<qint64> convertedBytes;
+    QAtomicInteger<qint64> drawnBytes;
 };
 
 KisPrescaledProjection::KisPrescaledProjection()
@@ -104,6 +157,7 @@ KisPrescaledProjection::KisPrescaledProjection()
 
 KisPrescaledProjection::~KisPrescaledProjection()
 {
+    dropPrefetchedPatches();
     delete m_d->projectionBackend;
     delete m_d;
 }
@@ -112,6 +166,7 @@ KisPrescaledProjection::~KisPrescaledProjection()
 void KisPrescaledProjection::setImage(KisImageWSP image)
 {
     Q_ASSERT(image);
+    dropPrefetchedPatches();
     m_d->image = image;
     m_d->projectionBackend->setImage(image);
 }
@@ -126,6 +181,16 @@ void KisPrescaledProjection::setCoordinatesConverter(KisCoordinatesConverter *co
     m_d->coordinatesConverter = coordinatesConverter;
 }
 
+qint64 KisPrescaledProjection::numConvertedBytes() const
+{
+    return m_d->convertedBytes.load();
+}
+
+qint64 KisPrescaledProjection::numDrawnBytes() const
+{
+    return m_d->drawnBytes.load();
+}
+
 void KisPrescaledProjection::updateSettings()
 {
     KisImageConfig imageConfig(false);
@@ -170,6 +235,37 @@ void KisPrescaledProjection::viewportMoved(const QPointF &offset)
     }
 
     QPainter gc(&newImage);
+
+    /**
+     * Take the newly exposed area from the prefetched patches
+     * if they are available
+     */
+    collectPrefetchedPatches(false);
+    m_d->prefetchFutureShift += alignedOffset;
+
+    const QRect keptPrefetchArea =
+        kisGrowRect(newViewportRect, qMax(newViewportRect.width(), newViewportRect.height()));
+
+    for (auto it = m_d->prefetchedPatches.begin(); it != m_d->prefetchedPatches.end();) {
+        it->rect.translate(alignedOffset);
+
+        if (!it->rect.intersects(keptPrefetchArea)) {
+            it = m_d->prefetchedPatches.erase(it);
+            continue;
+        }
+
+        const QRegion usedRegion = updateRegion & it->rect;
+
+        gc.setCompositionMode(QPainter::CompositionMode_Source);
+        Q_FOREACH (const QRect &rc, usedRegion.rects()) {
+            gc.drawImage(rc.topLeft(), it->image, rc.translated(-it->rect.topLeft()));
+        }
+        gc.setCompositionMode(QPainter::CompositionMode_SourceOver);
+
+        updateRegion -= usedRegion;
+        ++it;
+    }
+
     QVector<QRect> rects = updateRegion.rects();
 
     Q_FOREACH (const QRect &rect, rects) {
@@ -189,11 +285,153 @@ void KisPrescaledProjection::viewportMoved(const QPointF &offset)
     }
 
     m_d->prescaledQImage = newImage;
+
+    m_d->motionPredictor.addMotion(alignedOffset, m_d->motionTimer.elapsed());
+    schedulePrefetch();
+}
+
+void KisPrescaledProjection::schedulePrefetch()
+{
+    if (m_d->prefetchFuture.isRunning()) return;
+
+    const QRect viewportRect(QPoint(0, 0), m_d->viewportSize);
+
+    QPointF shift = m_d->motionPredictor.predictedShift(m_d->motionTimer.elapsed(), prefetchLookahead);
+    if (shift.manhattanLength() < minPrefetchShift) return;
+
+    // there is no use in preparing more than one viewport ahead
+    shift.rx() = qBound(-qreal(viewportRect.width()), shift.x(), qreal(viewportRect.width()));
+    shift.ry() = qBound(-qreal(viewportRect.height()), shift.y(), qreal(viewportRect.height()));
+
+    /**
+     * The content of the viewport moves by the shift, so the area
+     * that will be exposed lies on the opposite side
+     */
+    QRegion prefetchRegion = QRegion(viewportRect.translated(-shift.toPoint()));
+    prefetchRegion -= viewportRect;
+
+    Q_FOREACH (const PrefetchedPatch &patch, m_d->prefetchedPatches) {
+        prefetchRegion -= patch.rect;
+    }
+
+    if (prefetchRegion.isEmpty()) return;
+
+    /**
+     * The coordinates converter is not thread-safe, so all the
+     * geometry is calculated here, in the GUI thread. The worker
+     * only reads the backend and scales the patches.
+     */
+    QVector<QPair<QRect, QVector<KisPPUpdateInfoSP>>> jobs;
+
+    Q_FOREACH (const QRect &rect, prefetchRegion.rects()) {
+        QRect imageRect =
+            m_d->coordinatesConverter->viewportToImage(rect).toAlignedRect();
+        imageRect &= m_d->image->bounds();
+        if (imageRect.isEmpty()) continue;
+
+        QVector<QRect> patches =
+            KritaUtils::splitRectIntoPatches(imageRect, m_d->updatePatchSize);
+
+        QVector<KisPPUpdateInfoSP> infos;
+
+        Q_FOREACH (const QRect& rc, patches) {
+            QRect viewportPatch =
+                m_d->coordinatesConverter->imageToViewport(rc).toAlignedRect();
+
+            KisPPUpdateInfoSP info = getInitialUpdateInformation(QRect());
+            fillInUpdateInformation(viewportPatch, info, rect);
+            infos.append(info);
+        }
+
+        jobs.append(qMakePair(rect, infos));
+    }
+
+    if (jobs.isEmpty()) return;
+
+    m_d->prefetchFutureShift = QPoint();
+    m_d->prefetchFuture = QtConcurrent::run(
+        [this, jobs] () {
+            PrefetchedPatches result;
+
+            for (auto it = jobs.begin(); it != jobs.end(); ++it) {
+                PrefetchedPatch patch;
+                patch.rect = it->first;
+                patch.image = QImage(patch.rect.size(), QImage::Format_ARGB32);
+                patch.image.fill(0);
+
+                QPainter gc(&patch.image);
+                gc.translate(-patch.rect.topLeft());
+
+                Q_FOREACH (KisPPUpdateInfoSP info, it->second) {
+                    QReadLocker locker(&m_d->backendLock);
+                    drawUsingBackend(gc, info);
+                }
+
+                result.append(patch);
+            }
+
+            return result;
+        });
+}
+
+void KisPrescaledProjection::collectPrefetchedPatches(bool waitForFinished)
+{
+    if (m_d->prefetchFuture.isCanceled()) return;
+
+    if (waitForFinished) {
+        m_d->prefetchFuture.waitForFinished();
+    } else if (!m_d->prefetchFuture.isFinished()) {
+        return;
+    }
+
+    if (!m_d->prefetchFuture.resultCount()) return;
+
+    PrefetchedPatches patches = m_d->prefetchFuture.result();
+    m_d->prefetchFuture = QFuture<PrefetchedPatches>();
+
+    for (auto it = patches.begin(); it != patches.end(); ++it) {
+        it->rect.translate(m_d->prefetchFutureShift);
+        m_d->prefetchedPatches.append(*it);
+    }
+
+    m_d->prefetchFutureShift = QPoint();
+}
+
+void KisPrescaledProjection::dropPrefetchedPatches()
+{
+    m_d->prefetchFuture.waitForFinished();
+    m_d->prefetchFuture = QFuture<PrefetchedPatches>();
+    m_d->prefetchedPatches.clear();
+    m_d->prefetchFutureShift = QPoint();
+    m_d->motionPredictor.reset();
+}
+
+void KisPrescaledProjection::dropPrefetchedPatches(const QRect &viewportRect)
+{
+    collectPrefetchedPatches(true);
+
+    for (auto it = m_d->prefetchedPatches.begin(); it != m_d->prefetchedPatches.end();) {
+        if (it->rect.intersects(viewportRect)) {
+            it = m_d->prefetchedPatches.erase(it);
+        } else {
+            ++it;
+        }
+    }
 }
 
 void KisPrescaledProjection::slotImageSizeChanged(qint32 w, qint32 h)
 {
-    m_d->projectionBackend->setImageSize(w, h);
+    /**
+     * The prefetched patches are useless after the resize, and the
+     * worker must not read the backend while it is being resized
+     */
+    dropPrefetchedPatches();
+
+    {
+        QWriteLocker locker(&m_d->backendLock);
+        m_d->projectionBackend->setImageSize(w, h);
+    }
+
     // viewport size is cropped by the size of the image
     // so we need to update it as well
     updateViewportSize();
@@ -215,7 +453,21 @@ KisUpdateInfoSP KisPrescaledProjection::updateCache(const QRect &dirtyImageRect)
     if (croppedImageRect.isEmpty()) return new KisPPUpdateInfo();
 
     KisPPUpdateInfoSP info = getInitialUpdateInformation(croppedImageRect);
-    m_d->projectionBackend->updateCache(croppedImageRect);
+
+    {
+        /**
+         * We are in the image thread, so we cannot touch the prefetch
+         * state here. Just don't let the worker read the backend while
+         * it is being written. The patches covering the rect are dropped
+         * later in recalculateCache().
+         */
+        QWriteLocker locker(&m_d->backendLock);
+        m_d->projectionBackend->updateCache(croppedImageRect);
+    }
+
+    m_d->convertedBytes.fetchAndAddRelaxed(
+        qint64(croppedImageRect.width()) * croppedImageRect.height() *
+        m_d->image->projection()->pixelSize());
 
     return info;
 }
@@ -229,6 +481,11 @@ void KisPrescaledProjection::recalculateCache(KisUpdateInfoSP info)
         m_d->coordinatesConverter->
         imageToViewport(ppInfo->dirtyImageRectVar).toAlignedRect();
 
+    // the prefetched patches are scaled with a border as well
+    if (!m_d->prefetchedPatches.isEmpty() || m_d->prefetchFuture.isRunning()) {
+        dropPrefetchedPatches(kisGrowRect(rawViewRect, 2));
+    }
+
     fillInUpdateInformation(rawViewRect, ppInfo);
 
     m_d->projectionBackend->recalculateCache(ppInfo);
@@ -241,6 +498,8 @@ void KisPrescaledProjection::preScale()
 {
     if (!m_d->image) return;
 
+    dropPrefetchedPatches();
+
     m_d->prescaledQImage.fill(0);
 
     QRect viewportRect(QPoint(0, 0), m_d->viewportSize);
@@ -263,16 +522,19 @@ void KisPrescaledProjection::preScale()
 
 void KisPrescaledProjection::setMonitorProfile(const KoColorProfile *monitorProfile, KoColorConversionTransformation::Intent renderingIntent, KoColorConversionTransformation::ConversionFlags conversionFlags)
 {
+    dropPrefetchedPatches();
     m_d->projectionBackend->setMonitorProfile(monitorProfile, renderingIntent, conversionFlags);
 }
 
 void KisPrescaledProjection::setChannelFlags(const QBitArray &channelFlags)
 {
+    dropPrefetchedPatches();
     m_d->projectionBackend->setChannelFlags(channelFlags);
 }
 
 void KisPrescaledProjection::setDisplayFilter(QSharedPointer<KisDisplayFilter> displayFilter)
 {
+    dropPrefetchedPatches();
     m_d->projectionBackend->setDisplayFilter(displayFilter);
 }
 
@@ -323,12 +585,16 @@ KisPPUpdateInfoSP KisPrescaledProjection::getInitialUpdateInformation(const QRec
 }
 
 void KisPrescaledProjection::fillInUpdateInformation(const QRect &viewportRect,
-                                                     KisPPUpdateInfoSP info)
+                                                     KisPPUpdateInfoSP info,
+                                                     const QRect &allowedViewportRect)
 {
     m_d->coordinatesConverter->imageScale(&info->scaleX, &info->scaleY);
 
     // first, crop the part of the view rect that is outside of the canvas
-    QRect croppedViewRect = viewportRect.intersected(QRect(QPoint(0, 0), m_d->viewportSize));
+    QRect croppedViewRect = viewportRect.intersected(
+        !allowedViewportRect.isNull() ?
+            allowedViewportRect :
+            QRect(QPoint(0, 0), m_d->viewportSize));
 
     // second, align this rect to the KisImage's pixels and pixels
     // of projection backend.
@@ -387,6 +653,9 @@ void KisPrescaledProjection::drawUsingBackend(QPainter &gc, KisPPUpdateInfoSP in
 {
     if (info->imageRect.isEmpty()) return;
 
+    const QRect drawnRect = info->viewportRect.toAlignedRect();
+    m_d->drawnBytes.fetchAndAddRelaxed(qint64(drawnRect.width()) * drawnRect.height() * 4);
+
     if (info->transfer == KisPPUpdateInfo::DIRECT) {
         m_d->projectionBackend->drawFromOriginalImage(gc, info);
     } else /* if info->transfer == KisPPUpdateInformation::PATCH */ {
@@ -63,6 +63,21 @@ public:
 
     void setCoordinatesConverter(KisCoordinatesConverter *coordinatesConverter);
 
+    /**
+     * The number of image bytes converted into the display color
+     * space by updateCache() since the projection has been created.
+     * Used by the benchmarks.
+     */
+    qint64 numConvertedBytes() const;
+
+    /**
+     * The number of bytes of the prescaled image drawn from the
+     * projection backend since the projection has been created,
+     * including the patches drawn by the prefetch worker. Used by
+     * the benchmarks.
+     */
+    qint64 numDrawnBytes() const;
+
 public Q_SLOTS:
 
     /**
@@ -153,11 +168,15 @@ private:
      * is supposed to have already been set up in the previous step of the
      * update in getInitialUpdateInformation(). Though it is allowed to
      * be null rect.
+     * @param allowedViewportRect the rect @p viewportRect is cropped with.
+     * By default it is the visible viewport. The prefetching code passes
+     * the area outside of it.
      *
      * @see getInitialUpdateInformation()
      */
     void fillInUpdateInformation(const QRect &viewportRect,
-                                 KisPPUpdateInfoSP info);
+                                 KisPPUpdateInfoSP info,
+                                 const QRect &allowedViewportRect = QRect());
 
     /**
      * Initiates the process of prescaled image update
@@ -173,6 +192,30 @@ private:
      */
     void drawUsingBackend(QPainter &gc, KisPPUpdateInfoSP info);
 
+    /**
+     * Starts preparing the area of the image the viewport is moving
+     * toward on a worker thread
+     */
+    void schedulePrefetch();
+
+    /**
+     * Takes the prefetched patches if the worker has finished
+     * preparing them. If @p waitForFinished is true, waits for
+     * the running worker.
+     */
+    void collectPrefetchedPatches(bool waitForFinished);
+
+    /**
+     * Discards all the prefetched data, e.g. when the zoom or
+     * display settings change
+     */
+    void dropPrefetchedPatches();
+
+    /**
+     * Discards the prefetched patches intersecting @p viewportRect
+     */
+    void dropPrefetchedPatches(const QRect &viewportRect);
+
     struct Private;
     Private * const m_d;
 };
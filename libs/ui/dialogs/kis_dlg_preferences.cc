@@ -210,6 +210,7 @@ GeneralTab::GeneralTab(QWidget *_parent, const char *_name)
     m_autosaveSpinBox->setValue(autosaveInterval / 60);
     m_autosaveCheckBox->setChecked(autosaveInterval > 0);
     chkHideAutosaveFiles->setChecked(cfg.readEntry<bool>("autosavefileshidden", true));
+    chkAutosaveMergedImage->setChecked(cfg.autoSaveMergedImage());
 
     m_chkCompressKra->setChecked(cfg.compressKra());
     chkZip64->setChecked(cfg.useZip64());
@@ -265,6 +266,7 @@ void GeneralTab::setDefault()
     //convert to minutes
     m_autosaveSpinBox->setValue(cfg.autoSaveInterval(true) / 60);
     chkHideAutosaveFiles->setChecked(true);
+    chkAutosaveMergedImage->setChecked(cfg.autoSaveMergedImage(true));
 
     m_undoStackSize->setValue(cfg.undoStackLimit(true));
 
@@ -897,11 +899,15 @@ PerformanceTab::PerformanceTab(QWidget *parent, const char *name)
 
     lblSwapFileLocation->setText(cfg.swapDir());
     connect(bnSwapFile, SIGNAL(clicked()), SLOT(selectSwapDir()));
+    connect(bnStrokeRecordingDirectory, SIGNAL(clicked()), SLOT(selectStrokeRecordingDir()));
+    connect(chkStrokeRecording, SIGNAL(toggled(bool)), bnStrokeRecordingDirectory, SLOT(setEnabled(bool)));
 
     sliderThreadsLimit->setRange(1, QThread::idealThreadCount());
     sliderFrameClonesLimit->setRange(1, QThread::idealThreadCount());
     sliderFpsLimit->setRange(20, 300);
     sliderFpsLimit->setSuffix(i18n(" fps"));
+    sliderStrokePrediction->setRange(0, 50);
+    sliderStrokePrediction->setSuffix(i18n(" ms"));
 
     connect(sliderThreadsLimit, SIGNAL(valueChanged(int)), SLOT(slotThreadsLimitChanged(int)));
     connect(sliderFrameClonesLimit, SIGNAL(valueChanged(int)), SLOT(slotFrameClonesLimitChanged(int)));
@@ -958,6 +964,14 @@ void PerformanceTab::load(bool requestDefault)
         KisConfig cfg2(true);
         chkOpenGLFramerateLogging->setChecked(cfg2.enableOpenGLFramerateLogging(requestDefault));
         chkBrushSpeedLogging->setChecked(cfg2.enableBrushSpeedLogging(requestDefault));
+        sliderStrokePrediction->setValue(cfg2.strokePredictionTime(requestDefault));
+
+        const QString recordingDir = cfg2.strokeRecordingDirectory(requestDefault);
+        chkStrokeRecording->setChecked(!recordingDir.isEmpty());
+        bnStrokeRecordingDirectory->setEnabled(chkStrokeRecording->isChecked());
+        lblStrokeRecordingDirectory->setText(
+            !recordingDir.isEmpty() ? recordingDir :
+            QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/stroke_recordings");
         chkDisableVectorOptimizations->setChecked(cfg2.enableAmdVectorizationWorkaround(requestDefault));
 #ifdef Q_OS_WIN
         chkDisableAVXOptimizations->setChecked(cfg2.disableAVXOptimizations(requestDefault));
@@ -1003,6 +1017,9 @@ void PerformanceTab::save()
         KisConfig cfg2(true);
         cfg2.setEnableOpenGLFramerateLogging(chkOpenGLFramerateLogging->isChecked());
         cfg2.setEnableBrushSpeedLogging(chkBrushSpeedLogging->isChecked());
+        cfg2.setStrokePredictionTime(sliderStrokePrediction->value());
+        cfg2.setStrokeRecordingDirectory(chkStrokeRecording->isChecked() ?
+                                         lblStrokeRecordingDirectory->text() : QString());
         cfg2.setEnableAmdVectorizationWorkaround(chkDisableVectorOptimizations->isChecked());
 #ifdef Q_OS_WIN
         cfg2.setDisableAVXOptimizations(chkDisableAVXOptimizations->isChecked());
@@ -1031,6 +1048,17 @@ void PerformanceTab::selectSwapDir()
     lblSwapFileLocation->setText(swapDir);
 }
 
+void PerformanceTab::selectStrokeRecordingDir()
+{
+    const QString recordingDir =
+        QFileDialog::getExistingDirectory(0, i18nc("@title:window", "Select a directory for stroke recordings"),
+                                          lblStrokeRecordingDirectory->text());
+    if (recordingDir.isEmpty()) {
+        return;
+    }
+    lblStrokeRecordingDirectory->setText(recordingDir);
+}
+
 void PerformanceTab::slotThreadsLimitChanged(int value)
 {
     KisSignalsBlocker b(sliderFrameClonesLimit);
@@ -1619,6 +1647,7 @@ bool KisDlgPreferences::editPreferences()
         cfg.setMDIBackgroundImage(dialog->m_general->m_backgroundimage->text());
         cfg.setAutoSaveInterval(dialog->m_general->autoSaveInterval());
         cfg.writeEntry("autosavefileshidden", dialog->m_general->chkHideAutosaveFiles->isChecked());
+        cfg.setAutoSaveMergedImage(dialog->m_general->chkAutosaveMergedImage->isChecked());
 
         cfg.setBackupFile(dialog->m_general->m_backupFileCheckBox->isChecked());
         cfg.writeEntry("backupfilelocation", dialog->m_general->cmbBackupFileLocation->currentIndex());
@@ -1087,6 +1087,16 @@ void KisConfig::setAutoSaveInterval(int seconds)  const
     return m_cfg.writeEntry("AutoSaveInterval", seconds);
 }
 
+bool KisConfig::autoSaveMergedImage(bool defaultValue) const
+{
+    return (defaultValue ? false : m_cfg.readEntry("AutoSaveMergedImage", false));
+}
+
+void KisConfig::setAutoSaveMergedImage(bool value) const
+{
+    m_cfg.writeEntry("AutoSaveMergedImage", value);
+}
+
 bool KisConfig::backupFile(bool defaultValue) const
 {
     return (defaultValue ? true : m_cfg.readEntry("CreateBackupFile", true));
@@ -1937,6 +1947,26 @@ void KisConfig::setEnableBrushSpeedLogging(bool value) const
     m_cfg.writeEntry("enableBrushSpeedLogging", value);
 }
 
+QString KisConfig::strokeRecordingDirectory(bool defaultValue) const
+{
+    return (defaultValue ? QString() : m_cfg.readEntry("strokeRecordingDirectory", QString()));
+}
+
+void KisConfig::setStrokeRecordingDirectory(const QString &value) const
+{
+    m_cfg.writeEntry("strokeRecordingDirectory", value);
+}
+
+int KisConfig::strokePredictionTime(bool defaultValue) const
+{
+    return (defaultValue ? 0 : m_cfg.readEntry("strokePredictionTime", 0));
+}
+
+void KisConfig::setStrokePredictionTime(int value) const
+{
+    m_cfg.writeEntry("strokePredictionTime", value);
+}
+
 void KisConfig::setEnableAmdVectorizationWorkaround(bool value)
 {
     m_cfg.writeEntry("amdDisableVectorWorkaround", value);
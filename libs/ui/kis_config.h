@@ -293,6 +293,9 @@ public:
     int autoSaveInterval(bool defaultValue = false) const;
     void setAutoSaveInterval(int seconds) const;
 
+    bool autoSaveMergedImage(bool defaultValue = false) const;
+    void setAutoSaveMergedImage(bool value) const;
+
     bool backupFile(bool defaultValue = false) const;
     void setBackupFile(bool backupFile) const;
 
@@ -548,6 +551,21 @@ public:
     void setEnableBrushSpeedLogging(bool value) const;
     bool enableBrushSpeedLogging(bool defaultValue = false) const;
 
+    /**
+     * When non-empty, every freehand stroke is recorded into a file in
+     * this directory, which can later be replayed by KisStrokeReplayBenchmark
+     */
+    void setStrokeRecordingDirectory(const QString &value) const;
+    QString strokeRecordingDirectory(bool defaultValue = false) const;
+
+    /**
+     * The time (in ms) the freehand stroke is extrapolated ahead of the
+     * last tablet event to hide the painting latency. Zero disables the
+     * prediction.
+     */
+    void setStrokePredictionTime(int value) const;
+    int strokePredictionTime(bool defaultValue = false) const;
+
     void setEnableAmdVectorizationWorkaround(bool value);
     bool enableAmdVectorizationWorkaround(bool defaultValue = false) const;
 
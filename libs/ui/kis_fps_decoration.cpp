@@ -131,6 +131,10 @@ QString KisFpsDecoration::getText() const
                 .arg(monitor->avgRenderingSpeed(), 0, 'f', 1);
         lines << QString("Average brush framerate: %1 fps")
                 .arg(monitor->avgFps(), 0, 'f', 1);
+
+        lines << QString("Last/average input latency (ms): %1/%2")
+                .arg(monitor->lastInputLatency(), 0, 'f', 1)
+                .arg(monitor->avgInputLatency(), 0, 'f', 1);
     }
 
     return lines.join('\n');
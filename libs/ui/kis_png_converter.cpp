@@ -31,12 +31,15 @@
 #include <KoStoreDevice.h>
 
 #include <limits.h>
+#include <limits>
 #include <stdio.h>
 #include <zlib.h>
 
 #include <QBuffer>
 #include <QFile>
 #include <QApplication>
+#include <QtConcurrent>
+#include <QtEndian>
 
 #include <klocalizedstring.h>
 #include <QUrl>
@@ -322,6 +325,149 @@ private:
     quint8* m_buf;
 };
 
+/**
+ * Row converters between the sample layout of PNG and the pixel layout
+ * of Krita's RGBA and GrayA color spaces. They work on whole rows of
+ * plain memory without any per-pixel branches, so that the compiler
+ * can vectorize them, and they convert 16-bit samples from and to the
+ * network byte order of PNG on the fly.
+ */
+typedef void (*PNGRowConverter)(const quint8 *src, quint8 *dst, int width);
+
+template <bool swapBytes, typename T>
+inline T pngSample(T value)
+{
+    return swapBytes ? qbswap(value) : value;
+}
+
+template <typename T, bool hasAlpha, bool swapBytes>
+void rgbRowFromPNG(const quint8 *srcBytes, quint8 *dstBytes, int width)
+{
+    const T *src = reinterpret_cast<const T*>(srcBytes);
+    T *dst = reinterpret_cast<T*>(dstBytes);
+    const int srcChannels = hasAlpha ? 4 : 3;
+
+    for (int i = 0; i < width; i++) {
+        dst[0] = pngSample<swapBytes>(src[2]);
+        dst[1] = pngSample<swapBytes>(src[1]);
+        dst[2] = pngSample<swapBytes>(src[0]);
+        dst[3] = hasAlpha ? pngSample<swapBytes>(src[3]) : std::numeric_limits<T>::max();
+
+        src += srcChannels;
+        dst += 4;
+    }
+}
+
+template <typename T, bool hasAlpha, bool swapBytes>
+void grayRowFromPNG(const quint8 *srcBytes, quint8 *dstBytes, int width)
+{
+    const T *src = reinterpret_cast<const T*>(srcBytes);
+    T *dst = reinterpret_cast<T*>(dstBytes);
+    const int srcChannels = hasAlpha ? 2 : 1;
+
+    for (int i = 0; i < width; i++) {
+        dst[0] = pngSample<swapBytes>(src[0]);
+        dst[1] = hasAlpha ? pngSample<swapBytes>(src[1]) : std::numeric_limits<T>::max();
+
+        src += srcChannels;
+        dst += 2;
+    }
+}
+
+template <typename T, bool hasAlpha, bool swapBytes>
+void rgbRowToPNG(const quint8 *srcBytes, quint8 *dstBytes, int width)
+{
+    const T *src = reinterpret_cast<const T*>(srcBytes);
+    T *dst = reinterpret_cast<T*>(dstBytes);
+    const int dstChannels = hasAlpha ? 4 : 3;
+
+    for (int i = 0; i < width; i++) {
+        dst[0] = pngSample<swapBytes>(src[2]);
+        dst[1] = pngSample<swapBytes>(src[1]);
+        dst[2] = pngSample<swapBytes>(src[0]);
+        if (hasAlpha) {
+            dst[3] = pngSample<swapBytes>(src[3]);
+        }
+
+        src += 4;
+        dst += dstChannels;
+    }
+}
+
+template <typename T, bool hasAlpha, bool swapBytes>
+void grayRowToPNG(const quint8 *srcBytes, quint8 *dstBytes, int width)
+{
+    const T *src = reinterpret_cast<const T*>(srcBytes);
+    T *dst = reinterpret_cast<T*>(dstBytes);
+    const int dstChannels = hasAlpha ? 2 : 1;
+
+    for (int i = 0; i < width; i++) {
+        dst[0] = pngSample<swapBytes>(src[0]);
+        if (hasAlpha) {
+            dst[1] = pngSample<swapBytes>(src[1]);
+        }
+
+        src += 2;
+        dst += dstChannels;
+    }
+}
+
+// PNG stores 16-bit samples in network byte order
+#ifndef WORDS_BIGENDIAN
+const bool swap16BitSamples = true;
+#else
+const bool swap16BitSamples = false;
+#endif
+
+template <typename T, bool swapBytes>
+PNGRowConverter selectRowFromPNG(bool isRgb, bool hasAlpha)
+{
+    return isRgb ?
+        (hasAlpha ? &rgbRowFromPNG<T, true, swapBytes> : &rgbRowFromPNG<T, false, swapBytes>) :
+        (hasAlpha ? &grayRowFromPNG<T, true, swapBytes> : &grayRowFromPNG<T, false, swapBytes>);
+}
+
+template <typename T, bool swapBytes>
+PNGRowConverter selectRowToPNG(bool isRgb, bool hasAlpha)
+{
+    return isRgb ?
+        (hasAlpha ? &rgbRowToPNG<T, true, swapBytes> : &rgbRowToPNG<T, false, swapBytes>) :
+        (hasAlpha ? &grayRowToPNG<T, true, swapBytes> : &grayRowToPNG<T, false, swapBytes>);
+}
+
+/**
+ * @return the converter from a PNG row of \p colorType into Krita's
+ * pixels or null if the row needs to be unpacked sample by sample
+ */
+PNGRowConverter rowFromPNGConverter(int colorType, int colorDepth)
+{
+    const bool isRgb = colorType == PNG_COLOR_TYPE_RGB || colorType == PNG_COLOR_TYPE_RGB_ALPHA;
+    const bool isGray = colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA;
+    const bool hasAlpha = colorType == PNG_COLOR_TYPE_RGB_ALPHA || colorType == PNG_COLOR_TYPE_GRAY_ALPHA;
+
+    if (!isRgb && !isGray) return 0;
+
+    return colorDepth == 8 ? selectRowFromPNG<quint8, false>(isRgb, hasAlpha) :
+           colorDepth == 16 ? selectRowFromPNG<quint16, swap16BitSamples>(isRgb, hasAlpha) :
+           0;
+}
+
+/**
+ * @return the converter from Krita's pixels into a PNG row of
+ * \p colorType or null if the row needs to be packed sample by sample
+ */
+PNGRowConverter rowToPNGConverter(int colorType, int colorDepth, bool hasAlpha)
+{
+    const bool isRgb = colorType == PNG_COLOR_TYPE_RGB || colorType == PNG_COLOR_TYPE_RGB_ALPHA;
+    const bool isGray = colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA;
+
+    if (!isRgb && !isGray) return 0;
+
+    return colorDepth == 8 ? selectRowToPNG<quint8, false>(isRgb, hasAlpha) :
+           colorDepth == 16 ? selectRowToPNG<quint16, swap16BitSamples>(isRgb, hasAlpha) :
+           0;
+}
+
 class KisPNGReaderAbstract
 {
 public:
@@ -376,6 +522,246 @@ private:
     int y;
 };
 
+/**
+ * The rows of the image are split into chunks of this size that are
+ * filtered and deflated in parallel, like pigz does. Each chunk is
+ * primed with the last 32 KiB of the previous one, so the compression
+ * ratio is almost the same as for a single zlib stream.
+ */
+const int parallelDeflateChunkSize = 256 * 1024;
+const int deflateDictionarySize = 32 * 1024;
+
+inline int paethPredictor(int a, int b, int c)
+{
+    const int p = a + b - c;
+    const int pa = qAbs(p - a);
+    const int pb = qAbs(p - b);
+    const int pc = qAbs(p - c);
+
+    return (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+}
+
+/**
+ * Applies PNG filter \p filter to \p row. \p prevRow is null for the
+ * first row of the image. Returns the sum of absolute values of the
+ * filtered bytes, which libpng uses for choosing the filter
+ */
+quint64 applyRowFilter(int filter, const quint8 *row, const quint8 *prevRow, int rowBytes, int bpp, quint8 *dst)
+{
+    quint64 cost = 0;
+
+    for (int i = 0; i < rowBytes; i++) {
+        const int a = i >= bpp ? row[i - bpp] : 0;
+        const int b = prevRow ? prevRow[i] : 0;
+        const int c = prevRow && i >= bpp ? prevRow[i - bpp] : 0;
+
+        int predicted = 0;
+
+        switch (filter) {
+        case PNG_FILTER_VALUE_SUB:
+            predicted = a;
+            break;
+        case PNG_FILTER_VALUE_UP:
+            predicted = b;
+            break;
+        case PNG_FILTER_VALUE_AVG:
+            predicted = (a + b) >> 1;
+            break;
+        case PNG_FILTER_VALUE_PAETH:
+            predicted = paethPredictor(a, b, c);
+            break;
+        default:
+            break;
+        }
+
+        dst[i] = quint8(row[i] - predicted);
+        cost += qAbs(int(qint8(dst[i])));
+    }
+
+    return cost;
+}
+
+/**
+ * Filters rows [firstRow, lastRow) into the format stored in IDAT
+ * chunks: every row is prefixed with the type of the filter applied
+ */
+QByteArray filterRows(png_byte **rows, int firstRow, int lastRow, int rowBytes, int bpp, bool useFilters)
+{
+    const int filteredRowBytes = rowBytes + 1;
+
+    QByteArray result(filteredRowBytes * (lastRow - firstRow), Qt::Uninitialized);
+    QVector<quint8> candidate(rowBytes);
+
+    for (int y = firstRow; y < lastRow; y++) {
+        const quint8 *row = rows[y];
+        const quint8 *prevRow = y > 0 ? rows[y - 1] : 0;
+        quint8 *dst = reinterpret_cast<quint8*>(result.data()) + (y - firstRow) * filteredRowBytes;
+
+        dst[0] = PNG_FILTER_VALUE_NONE;
+        quint64 bestCost = applyRowFilter(PNG_FILTER_VALUE_NONE, row, prevRow, rowBytes, bpp, dst + 1);
+
+        if (!useFilters) continue;
+
+        for (int filter = PNG_FILTER_VALUE_SUB; filter <= PNG_FILTER_VALUE_PAETH; filter++) {
+            const quint64 cost = applyRowFilter(filter, row, prevRow, rowBytes, bpp, candidate.data());
+
+            if (cost < bestCost) {
+                bestCost = cost;
+                dst[0] = filter;
+                memcpy(dst + 1, candidate.constData(), rowBytes);
+            }
+        }
+    }
+
+    return result;
+}
+
+struct DeflatedChunk
+{
+    QByteArray data;
+    uLong adler = 0;
+    uLong rawSize = 0;
+    bool isValid = false;
+};
+
+DeflatedChunk deflateRows(png_byte **rows, int firstRow, int lastRow, int numRows, int rowBytes, int bpp, bool useFilters, int compressionLevel)
+{
+    DeflatedChunk chunk;
+
+    const QByteArray raw = filterRows(rows, firstRow, lastRow, rowBytes, bpp, useFilters);
+    chunk.adler = adler32(adler32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(raw.constData()), raw.size());
+    chunk.rawSize = raw.size();
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+
+    // raw deflate: the zlib header and checksum are written separately
+    if (deflateInit2(&stream, compressionLevel, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return chunk;
+    }
+
+    if (firstRow > 0) {
+        const int dictRows = (deflateDictionarySize + rowBytes) / (rowBytes + 1);
+        const QByteArray dict = filterRows(rows, qMax(0, firstRow - dictRows), firstRow, rowBytes, bpp, useFilters);
+        const int dictSize = qMin(dict.size(), deflateDictionarySize);
+
+        deflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(dict.constData()) + dict.size() - dictSize, dictSize);
+    }
+
+    const bool isLastChunk = lastRow == numRows;
+    const int flush = isLastChunk ? Z_FINISH : Z_SYNC_FLUSH;
+
+    chunk.data.resize(deflateBound(&stream, raw.size()) + 16);
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(raw.constData()));
+    stream.avail_in = raw.size();
+    stream.next_out = reinterpret_cast<Bytef*>(chunk.data.data());
+    stream.avail_out = chunk.data.size();
+
+    int result = Z_OK;
+
+    forever {
+        if (!stream.avail_out) {
+            chunk.data.resize(chunk.data.size() + deflateDictionarySize);
+            stream.next_out = reinterpret_cast<Bytef*>(chunk.data.data()) + stream.total_out;
+            stream.avail_out = chunk.data.size() - stream.total_out;
+        }
+
+        result = deflate(&stream, flush);
+
+        if (result == Z_STREAM_END) break;
+        if (result != Z_OK && result != Z_BUF_ERROR) break;
+        if (flush == Z_SYNC_FLUSH && stream.avail_out) break;
+    }
+
+    chunk.isValid = isLastChunk ? result == Z_STREAM_END : result == Z_OK || result == Z_BUF_ERROR;
+    chunk.data.resize(stream.total_out);
+
+    deflateEnd(&stream);
+
+    return chunk;
+}
+
+/**
+ * Writes the image data (IDAT chunks) and the IEND chunk of a
+ * non-interlaced PNG. The rows are filtered and deflated in parallel
+ * chunks joined with sync flush markers, so the result is a single
+ * valid zlib stream.
+ */
+bool writeImageDataParallel(png_structp png_ptr, png_byte **rows, int numRows, int rowBytes, int bpp,
+                            bool useFilters, int compressionLevel)
+{
+    if (numRows <= 0 || rowBytes <= 0) return false;
+
+    const int rowsPerChunk = qMax(1, parallelDeflateChunkSize / (rowBytes + 1));
+    const int numChunks = (numRows + rowsPerChunk - 1) / rowsPerChunk;
+
+    QVector<int> chunkIndexes;
+    for (int i = 0; i < numChunks; i++) {
+        chunkIndexes.append(i);
+    }
+
+    QVector<DeflatedChunk> chunks(numChunks);
+
+    QtConcurrent::blockingMap(chunkIndexes, [&] (int chunkIndex) {
+        const int firstRow = chunkIndex * rowsPerChunk;
+        const int lastRow = qMin(numRows, firstRow + rowsPerChunk);
+        chunks[chunkIndex] = deflateRows(rows, firstRow, lastRow, numRows, rowBytes, bpp, useFilters, compressionLevel);
+    });
+
+    uLong adler = adler32(0L, Z_NULL, 0);
+    Q_FOREACH (const DeflatedChunk &chunk, chunks) {
+        if (!chunk.isValid) return false;
+        adler = adler32_combine(adler, chunk.adler, chunk.rawSize);
+    }
+
+    const int compressionFlags =
+        compressionLevel <= 1 ? 0 :
+        compressionLevel <= 5 ? 1 :
+        compressionLevel == 6 ? 2 : 3;
+
+    quint8 zlibHeader[2];
+    zlibHeader[0] = 0x78; // deflate with 32 KiB window
+    zlibHeader[1] = compressionFlags << 6;
+    zlibHeader[1] += 31 - (zlibHeader[0] * 256 + zlibHeader[1]) % 31;
+
+    quint8 zlibTrailer[4];
+    qToBigEndian<quint32>(adler, zlibTrailer);
+
+    png_byte idatChunkName[5] = { 73,  68,  65,  84, '\0' };
+    png_byte iendChunkName[5] = { 73,  69,  78,  68, '\0' };
+
+    for (int i = 0; i < numChunks; i++) {
+        const bool isFirstChunk = i == 0;
+        const bool isLastChunk = i == numChunks - 1;
+
+        const QByteArray &data = chunks[i].data;
+        const png_uint_32 length =
+            (isFirstChunk ? sizeof(zlibHeader) : 0) +
+            data.size() +
+            (isLastChunk ? sizeof(zlibTrailer) : 0);
+
+        png_write_chunk_start(png_ptr, idatChunkName, length);
+
+        if (isFirstChunk) {
+            png_write_chunk_data(png_ptr, zlibHeader, sizeof(zlibHeader));
+        }
+
+        png_write_chunk_data(png_ptr, reinterpret_cast<png_bytep>(const_cast<char*>(data.constData())), data.size());
+
+        if (isLastChunk) {
+            png_write_chunk_data(png_ptr, zlibTrailer, sizeof(zlibTrailer));
+        }
+
+        png_write_chunk_end(png_ptr);
+    }
+
+    png_write_chunk(png_ptr, iendChunkName, 0, 0);
+    png_write_flush(png_ptr);
+
+    return true;
+}
+
 
 static
 void _read_fn(png_structp png_ptr, png_bytep data, png_size_t length)
@@ -411,6 +797,23 @@ void _flush_fn(png_structp png_ptr)
 }
 
 KisImportExportErrorCode KisPNGConverter::buildImage(QIODevice* iod)
+{
+    return buildImageImpl(iod, 0);
+}
+
+KisPaintDeviceSP KisPNGConverter::loadDeviceFromIODevice(QIODevice *iod)
+{
+    KisPNGConverter pngConv(0, true);
+    KisPaintDeviceSP device;
+
+    if (!pngConv.buildImageImpl(iod, &device).isOk()) {
+        return 0;
+    }
+
+    return device;
+}
+
+KisImportExportErrorCode KisPNGConverter::buildImageImpl(QIODevice* iod, KisPaintDeviceSP *standaloneDevice)
 {
     dbgFile << "Start decoding PNG File";
 
@@ -484,11 +887,7 @@ KisImportExportErrorCode KisPNGConverter::buildImage(QIODevice* iod)
     int color_nb_bits, color_type, interlace_type;
     png_get_IHDR(png_ptr, info_ptr, &width, &height, &color_nb_bits, &color_type, &interlace_type, 0, 0);
     dbgFile << "width = " << width << " height = " << height << " color_nb_bits = " << color_nb_bits << " color_type = " << color_type << " interlace_type = " << interlace_type << endl;
-    // swap byteorder on little endian machines.
-#ifndef WORDS_BIGENDIAN
-    if (color_nb_bits > 8)
-        png_set_swap(png_ptr);
-#endif
+    // 16-bit samples are swapped to the host byte order by the row converters
 
     // Determine the colorspace
     QPair<QString, QString> csName = getColorSpaceForColorType(color_type, color_nb_bits);
@@ -639,7 +1038,7 @@ KisImportExportErrorCode KisPNGConverter::buildImage(QIODevice* iod)
     }
 
     // Creating the KisImageSP
-    if (m_image == 0) {
+    if (!standaloneDevice && m_image == 0) {
         KisUndoStore *store = m_doc ? m_doc->createUndoStore() : new KisSurrogateUndoStore();
         m_image = new KisImage(store, width, height, cs, "built image");
     }
@@ -649,16 +1048,24 @@ KisImportExportErrorCode KisPNGConverter::buildImage(QIODevice* iod)
     png_uint_32 x_resolution, y_resolution;
 
     png_get_pHYs(png_ptr, info_ptr, &x_resolution, &y_resolution, &unit_type);
-    if (x_resolution > 0 && y_resolution > 0 && unit_type == PNG_RESOLUTION_METER) {
+    if (!standaloneDevice && x_resolution > 0 && y_resolution > 0 && unit_type == PNG_RESOLUTION_METER) {
         m_image->setResolution((double) POINT_TO_CM(x_resolution) / 100.0, (double) POINT_TO_CM(y_resolution) / 100.0); // It is the "invert" macro because we convert from pointer-per-inchs to points
     }
 
     double coeff = quint8_MAX / (double)(pow((double)2, color_nb_bits) - 1);
-    KisPaintLayerSP layer = new KisPaintLayer(m_image.data(), m_image -> nextLayerName(), UCHAR_MAX);
+    KisPaintLayerSP layer;
+    KisPaintDeviceSP device;
+
+    if (standaloneDevice) {
+        device = new KisPaintDevice(cs);
+    } else {
+        layer = new KisPaintLayer(m_image.data(), m_image -> nextLayerName(), UCHAR_MAX);
+        device = layer->paintDevice();
+    }
 
     // Read comments/texts...
     png_get_text(png_ptr, info_ptr, &text_ptr, &num_comments);
-    if (m_doc) {
+    if (m_doc && layer) {
         KoDocumentInfo * info = m_doc->documentInfo();
         dbgFile << "There are " << num_comments << " comments in the text";
         for (int i = 0; i < num_comments; i++) {
@@ -723,71 +1130,36 @@ KisImportExportErrorCode KisPNGConverter::buildImage(QIODevice* iod)
         }
     }
 
-    for (png_uint_32 y = 0; y < height; y++) {
-        KisHLineIteratorSP it = layer -> paintDevice() -> createHLineIteratorNG(0, y, width);
+    /**
+     * The rows are converted into Krita's pixel layout in a band buffer,
+     * which is then color transformed and written into the device at once
+     */
+    const PNGRowConverter rowConverter = rowFromPNGConverter(color_type, color_nb_bits);
+    const int pixelSize = device->pixelSize();
+    const int bandHeight = qBound(1, int(height), 64);
+    QVector<quint8> band(bandHeight * width * pixelSize);
+    int bandStart = 0;
 
+    for (png_uint_32 y = 0; y < height; y++) {
         png_bytep row_pointer = reader->readLine();
+        quint8 *d = band.data() + (int(y) - bandStart) * width * pixelSize;
 
-        switch (color_type) {
-        case PNG_COLOR_TYPE_GRAY:
-        case PNG_COLOR_TYPE_GRAY_ALPHA:
-            if (color_nb_bits == 16) {
-                quint16 *src = reinterpret_cast<quint16 *>(row_pointer);
-                do {
-                    quint16 *d = reinterpret_cast<quint16 *>(it->rawData());
-                    d[0] = *(src++);
-                    if (hasalpha) {
-                        d[1] = *(src++);
-                    } else {
-                        d[1] = quint16_MAX;
-                    }
-                    if (transform) transform->transformInPlace(reinterpret_cast<quint8*>(d), reinterpret_cast<quint8*>(d), 1);
-                } while (it->nextPixel());
-            } else  {
-                KisPNGReadStream stream(row_pointer, color_nb_bits);
-                do {
-                    quint8 *d = it->rawData();
-                    d[0] = (quint8)(stream.nextValue() * coeff);
-                    if (hasalpha) {
-                        d[1] = (quint8)(stream.nextValue() * coeff);
-                    } else {
-                        d[1] = UCHAR_MAX;
-                    }
-                    if (transform) transform->transformInPlace(d, d, 1);
-                } while (it->nextPixel());
-            }
+        if (rowConverter) {
+            rowConverter(row_pointer, d, width);
+        } else if (color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_GRAY_ALPHA) {
             // FIXME:should be able to read 1 and 4 bits depth and scale them to 8 bits"
-            break;
-        case PNG_COLOR_TYPE_RGB:
-        case PNG_COLOR_TYPE_RGB_ALPHA:
-            if (color_nb_bits == 16) {
-                quint16 *src = reinterpret_cast<quint16 *>(row_pointer);
-                do {
-                    quint16 *d = reinterpret_cast<quint16 *>(it->rawData());
-                    d[2] = *(src++);
-                    d[1] = *(src++);
-                    d[0] = *(src++);
-                    if (hasalpha) d[3] = *(src++);
-                    else d[3] = quint16_MAX;
-                    if (transform) transform->transformInPlace(reinterpret_cast<quint8 *>(d), reinterpret_cast<quint8*>(d), 1);
-                } while (it->nextPixel());
-            } else {
-                KisPNGReadStream stream(row_pointer, color_nb_bits);
-                do {
-                    quint8 *d = it->rawData();
-                    d[2] = (quint8)(stream.nextValue() * coeff);
+            KisPNGReadStream stream(row_pointer, color_nb_bits);
+            for (png_uint_32 x = 0; x < width; x++, d += pixelSize) {
+                d[0] = (quint8)(stream.nextValue() * coeff);
+                if (hasalpha) {
                     d[1] = (quint8)(stream.nextValue() * coeff);
-                    d[0] = (quint8)(stream.nextValue() * coeff);
-                    if (hasalpha) d[3] = (quint8)(stream.nextValue() * coeff);
-                    else d[3] = UCHAR_MAX;
-                    if (transform) transform->transformInPlace(d, d, 1);
-                } while (it->nextPixel());
+                } else {
+                    d[1] = UCHAR_MAX;
+                }
             }
-            break;
-        case PNG_COLOR_TYPE_PALETTE: {
+        } else if (color_type == PNG_COLOR_TYPE_PALETTE) {
             KisPNGReadStream stream(row_pointer, color_nb_bits);
-            do {
-                quint8 *d = it->rawData();
+            for (png_uint_32 x = 0; x < width; x++, d += pixelSize) {
                 quint8 index = stream.nextValue();
                 quint8 alpha = palette_alpha[ index ];
                 if (alpha == 0) {
@@ -799,14 +1171,28 @@ KisImportExportErrorCode KisPNGConverter::buildImage(QIODevice* iod)
                     d[0] = c.blue;
                     d[3] = alpha;
                 }
-            } while (it->nextPixel());
-        }
-            break;
-        default:
+            }
+        } else {
             return ImportExportCodes::FormatFeaturesUnsupported;
         }
+
+        const int rowsInBand = int(y) - bandStart + 1;
+
+        if (rowsInBand == bandHeight || y == height - 1) {
+            // the palette entries are used as they are, only gray and RGB samples are transformed
+            if (transform && color_type != PNG_COLOR_TYPE_PALETTE) {
+                transform->transformInPlace(band.data(), band.data(), rowsInBand * width);
+            }
+            device->writeBytes(band.data(), QRect(0, bandStart, width, rowsInBand));
+            bandStart = y + 1;
+        }
+    }
+
+    if (layer) {
+        m_image->addNode(layer.data(), m_image->rootLayer().data());
+    } else {
+        *standaloneDevice = device;
     }
-    m_image->addNode(layer.data(), m_image->rootLayer().data());
 
     png_read_end(png_ptr, end_info);
     iod->close();
@@ -840,39 +1226,27 @@ KisImageSP KisPNGConverter::image()
     return m_image;
 }
 
-bool KisPNGConverter::saveDeviceToStore(const QString &filename, const QRect &imageRect, const qreal xRes, const qreal yRes, KisPaintDeviceSP dev, KoStore *store, KisMetaData::Store* metaData)
+bool KisPNGConverter::saveDeviceToStore(const QString &filename, const QRect &imageRect, const qreal xRes, const qreal yRes, KisPaintDeviceSP dev, KoStore *store, KisMetaData::Store* metaData, int compression)
 {
-    if (store->open(filename)) {
+    /**
+     * The PNG data is already deflated in parallel, compressing it
+     * once more with the store's single-threaded deflate is useless
+     */
+    const bool compressionEnabled = store->isCompressionEnabled();
+    store->setCompressionEnabled(false);
+    bool storeOpened = store->open(filename);
+    store->setCompressionEnabled(compressionEnabled);
+
+    if (storeOpened) {
         KoStoreDevice io(store);
         if (!io.open(QIODevice::WriteOnly)) {
             dbgFile << "Could not open for writing:" << filename;
             return false;
         }
-        KisPNGConverter pngconv(0);
-        vKisAnnotationSP_it annotIt = 0;
-        KisMetaData::Store* metaDataStore = 0;
-        if (metaData) {
-            metaDataStore = new KisMetaData::Store(*metaData);
-        }
-        KisPNGOptions options;
-        options.compression = 0;
-        options.interlace = false;
-        options.tryToSaveAsIndexed = false;
-        options.alpha = true;
-        options.saveSRGBProfile = false;
-
-        if (dev->colorSpace()->id() != "RGBA") {
-            dev = new KisPaintDevice(*dev.data());
-            dev->convertTo(KoColorSpaceRegistry::instance()->rgb8());
-        }
-
-        KisImportExportErrorCode success = pngconv.buildFile(&io, imageRect, xRes, yRes, dev, annotIt, annotIt, options, metaDataStore);
-        if (!success.isOk()) {
+        if (!saveDeviceToIODevice(&io, imageRect, xRes, yRes, dev, metaData, compression)) {
             dbgFile << "Saving PNG failed:" << filename;
-            delete metaDataStore;
             return false;
         }
-        delete metaDataStore;
         io.close();
         if (!store->close()) {
             return false;
@@ -885,6 +1259,32 @@ bool KisPNGConverter::saveDeviceToStore(const QString &filename, const QRect &im
 
 }
 
+bool KisPNGConverter::saveDeviceToIODevice(QIODevice *io, const QRect &imageRect, const qreal xRes, const qreal yRes, KisPaintDeviceSP dev, KisMetaData::Store* metaData, int compression)
+{
+    KisPNGConverter pngconv(0);
+    vKisAnnotationSP_it annotIt = 0;
+    KisMetaData::Store* metaDataStore = 0;
+    if (metaData) {
+        metaDataStore = new KisMetaData::Store(*metaData);
+    }
+    KisPNGOptions options;
+    options.compression = compression;
+    options.interlace = false;
+    options.tryToSaveAsIndexed = false;
+    options.alpha = true;
+    options.saveSRGBProfile = false;
+
+    if (dev->colorSpace()->id() != "RGBA") {
+        dev = new KisPaintDevice(*dev.data());
+        dev->convertTo(KoColorSpaceRegistry::instance()->rgb8());
+    }
+
+    KisImportExportErrorCode success = pngconv.buildFile(io, imageRect, xRes, yRes, dev, annotIt, annotIt, options, metaDataStore);
+    delete metaDataStore;
+
+    return success.isOk();
+}
+
 
 KisImportExportErrorCode KisPNGConverter::buildFile(const QString &filename, const QRect &imageRect, const qreal xRes, const qreal yRes, KisPaintDeviceSP device, vKisAnnotationSP_it annotationsStart, vKisAnnotationSP_it annotationsEnd, KisPNGOptions options, KisMetaData::Store* metaData)
 {
@@ -1262,11 +1662,7 @@ KisImportExportErrorCode KisPNGConverter::buildFile(QIODevice* iodevice, const Q
     png_write_info(png_ptr, info_ptr);
     png_write_flush(png_ptr);
 
-    // swap byteorder on little endian machines.
-#ifndef WORDS_BIGENDIAN
-    if (color_nb_bits > 8)
-        png_set_swap(png_ptr);
-#endif
+    // the row converters already produce 16-bit samples in network byte order
 
     // Write the PNG
     //     png_write_png(png_ptr, info_ptr, PNG_TRANSFORM_IDENTITY, 0);
@@ -1297,77 +1693,73 @@ KisImportExportErrorCode KisPNGConverter::buildFile(QIODevice* iodevice, const Q
     // Fill the data structure
     RowPointersStruct rowPointers(imageRect.size(), device->pixelSize());
 
-    int row = 0;
-    for (int y = imageRect.y(); y < imageRect.y() + imageRect.height(); y++, row++) {
-        KisHLineConstIteratorSP it = device->createHLineConstIteratorNG(imageRect.x(), y, imageRect.width());
-
-        switch (color_type) {
-        case PNG_COLOR_TYPE_GRAY:
-        case PNG_COLOR_TYPE_GRAY_ALPHA:
-            if (color_nb_bits == 16) {
-                quint16 *dst = reinterpret_cast<quint16 *>(rowPointers.rows[row]);
-                do {
-                    const quint16 *d = reinterpret_cast<const quint16 *>(it->oldRawData());
-                    *(dst++) = d[0];
-                    if (options.alpha) *(dst++) = d[1];
-                } while (it->nextPixel());
-            } else {
-                quint8 *dst = rowPointers.rows[row];
-                do {
-                    const quint8 *d = it->oldRawData();
-                    *(dst++) = d[0];
-                    if (options.alpha) *(dst++) = d[1];
-                } while (it->nextPixel());
-            }
-            break;
-        case PNG_COLOR_TYPE_RGB:
-        case PNG_COLOR_TYPE_RGB_ALPHA:
-            if (color_nb_bits == 16) {
-                quint16 *dst = reinterpret_cast<quint16 *>(rowPointers.rows[row]);
-                do {
-                    const quint16 *d = reinterpret_cast<const quint16 *>(it->oldRawData());
-                    *(dst++) = d[2];
-                    *(dst++) = d[1];
-                    *(dst++) = d[0];
-                    if (options.alpha) *(dst++) = d[3];
-                } while (it->nextPixel());
+    if (color_type != PNG_COLOR_TYPE_GRAY && color_type != PNG_COLOR_TYPE_GRAY_ALPHA &&
+        color_type != PNG_COLOR_TYPE_RGB && color_type != PNG_COLOR_TYPE_RGB_ALPHA &&
+        color_type != PNG_COLOR_TYPE_PALETTE) {
+
+        return ImportExportCodes::FormatColorSpaceUnsupported;
+    }
+
+    /**
+     * The pixels are read in bands of rows and each band is converted
+     * into the PNG sample layout independently
+     */
+    const PNGRowConverter rowConverter = rowToPNGConverter(color_type, color_nb_bits, options.alpha);
+    const int pixelSize = device->pixelSize();
+    const int width = imageRect.width();
+    const int bandHeight = 64;
+
+    QVector<int> bandStarts;
+    for (int row = 0; row < rowPointers.numRows; row += bandHeight) {
+        bandStarts.append(row);
+    }
+
+    QtConcurrent::blockingMap(bandStarts, [&] (int firstRow) {
+        const int numRows = qMin(bandHeight, rowPointers.numRows - firstRow);
+        QVector<quint8> band(numRows * width * pixelSize);
+
+        device->readBytes(band.data(), QRect(imageRect.x(), imageRect.y() + firstRow, width, numRows));
+
+        for (int i = 0; i < numRows; i++) {
+            const quint8 *src = band.constData() + i * width * pixelSize;
+            quint8 *dst = rowPointers.rows[firstRow + i];
+
+            if (rowConverter) {
+                rowConverter(src, dst, width);
             } else {
-                quint8 *dst = rowPointers.rows[row];
-                do {
-                    const quint8 *d = it->oldRawData();
-                    *(dst++) = d[2];
-                    *(dst++) = d[1];
-                    *(dst++) = d[0];
-                    if (options.alpha) *(dst++) = d[3];
-                } while (it->nextPixel());
-            }
-            break;
-        case PNG_COLOR_TYPE_PALETTE: {
-            quint8 *dst = rowPointers.rows[row];
-            KisPNGWriteStream writestream(dst, color_nb_bits);
-            do {
-                const quint8 *d = it->oldRawData();
-                int i;
-                for (i = 0; i < num_palette; i++) {
-                    if (palette[i].red == d[2] &&
-                            palette[i].green == d[1] &&
-                            palette[i].blue == d[0]) {
-                        break;
+                KisPNGWriteStream writestream(dst, color_nb_bits);
+                for (int x = 0; x < width; x++, src += pixelSize) {
+                    int j;
+                    for (j = 0; j < num_palette; j++) {
+                        if (palette[j].red == src[2] &&
+                                palette[j].green == src[1] &&
+                                palette[j].blue == src[0]) {
+                            break;
+                        }
                     }
+                    writestream.setNextValue(j);
                 }
-                writestream.setNextValue(i);
-            } while (it->nextPixel());
-        }
-            break;
-        default:
-            return ImportExportCodes::FormatColorSpaceUnsupported;
+            }
         }
-    }
+    });
+
+    if (!options.interlace) {
+        const int bpp = qMax(1, int(png_get_channels(png_ptr, info_ptr)) * color_nb_bits / 8);
+        const bool useFilters = color_type != PNG_COLOR_TYPE_PALETTE && color_nb_bits >= 8;
+
+        if (!writeImageDataParallel(png_ptr, rowPointers.rows, rowPointers.numRows,
+                                    png_get_rowbytes(png_ptr, info_ptr), bpp,
+                                    useFilters, options.compression)) {
 
-    png_write_image(png_ptr, rowPointers.rows);
+            png_destroy_write_struct(&png_ptr, &info_ptr);
+            return ImportExportCodes::Failure;
+        }
+    } else {
+        png_write_image(png_ptr, rowPointers.rows);
 
-    // Writing is over
-    png_write_end(png_ptr, info_ptr);
+        // Writing is over
+        png_write_end(png_ptr, info_ptr);
+    }
 
     // Free memory
     png_destroy_write_struct(&png_ptr, &info_ptr);
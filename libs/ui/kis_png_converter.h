@@ -124,15 +124,33 @@ public:
 
     /**
      * @brief saveDeviceToStore saves the given paint device to the KoStore. If the device is not 8 bits sRGB, it will be converted to 8 bits sRGB.
+     * @param compression zlib compression level of the PNG data, the file is stored in the KoStore without additional compression
      * @return true if the saving succeeds
      */
-    static bool saveDeviceToStore(const QString &filename, const QRect &imageRect, const qreal xRes, const qreal yRes, KisPaintDeviceSP dev, KoStore *store, KisMetaData::Store* metaData = 0);
+    static bool saveDeviceToStore(const QString &filename, const QRect &imageRect, const qreal xRes, const qreal yRes, KisPaintDeviceSP dev, KoStore *store, KisMetaData::Store* metaData = 0, int compression = 6);
+
+    /**
+     * @brief saveDeviceToIODevice encodes the given paint device as a PNG into \p io,
+     * the same way saveDeviceToStore() does. It doesn't touch any store, so
+     * several devices may be encoded concurrently from worker threads.
+     * @return true if the saving succeeds
+     */
+    static bool saveDeviceToIODevice(QIODevice *io, const QRect &imageRect, const qreal xRes, const qreal yRes, KisPaintDeviceSP dev, KisMetaData::Store* metaData = 0, int compression = 6);
+
+    /**
+     * @brief loadDeviceFromIODevice decodes a PNG into a standalone paint device,
+     * without creating a KisImage for it. The loading is done in batch mode,
+     * so it is safe to call from worker threads.
+     * @return the decoded device or null if the decoding failed
+     */
+    static KisPaintDeviceSP loadDeviceFromIODevice(QIODevice *iod);
 
     static bool isColorSpaceSupported(const KoColorSpace *cs);
 
 public Q_SLOTS:
     virtual void cancel();
 private:
+    KisImportExportErrorCode buildImageImpl(QIODevice* iod, KisPaintDeviceSP *standaloneDevice);
     void progress(png_structp png_ptr, png_uint_32 row_number, int pass);
 private:
     png_uint_32 m_max_row;
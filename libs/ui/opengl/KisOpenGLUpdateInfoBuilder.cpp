@@ -26,6 +26,9 @@
 #include <QReadWriteLock>
 #include <QReadLocker>
 #include <QWriteLocker>
+#include <QtConcurrent>
+
+#include <algorithm>
 
 
 struct KRITAUI_NO_EXPORT KisOpenGLUpdateInfoBuilder::Private
@@ -151,16 +154,6 @@ KisOpenGLUpdateInfoSP KisOpenGLUpdateInfoBuilder::buildUpdateInfo(const QRect &r
                                                      m_d->pool));
             // Don't update empty tiles
             if (tileInfo->valid()) {
-                tileInfo->retrieveData(projection, channelFlags, m_d->onlyOneChannelSelected, m_d->selectedChannelIndex);
-
-                if (convertColorSpace) {
-                    if (m_d->proofingTransform) {
-                        tileInfo->proofTo(m_d->conversionOptions.m_destinationColorSpace, m_d->proofingConfig->conversionFlags, m_d->proofingTransform.data());
-                    } else {
-                        tileInfo->convertTo(m_d->conversionOptions.m_destinationColorSpace, m_d->conversionOptions.m_renderingIntent, m_d->conversionOptions.m_conversionFlags);
-                    }
-                }
-
                 info->tileList.append(tileInfo);
             }
             else {
@@ -169,6 +162,32 @@ KisOpenGLUpdateInfoSP KisOpenGLUpdateInfoBuilder::buildUpdateInfo(const QRect &r
         }
     }
 
+    /**
+     * Reading, color conversion and proofing of the tiles are
+     * independent from each other, so the tiles are prepared in
+     * parallel. The buffers are allocated from the shared tile pool,
+     * which is thread-safe, and the color conversion transformations
+     * are safe to be used concurrently.
+     */
+    auto prepareTile =
+        [&] (KisTextureTileUpdateInfoSP tileInfo) {
+            tileInfo->retrieveData(projection, channelFlags, m_d->onlyOneChannelSelected, m_d->selectedChannelIndex);
+
+            if (convertColorSpace) {
+                if (m_d->proofingTransform) {
+                    tileInfo->proofTo(m_d->conversionOptions.m_destinationColorSpace, m_d->proofingConfig->conversionFlags, m_d->proofingTransform.data());
+                } else {
+                    tileInfo->convertTo(m_d->conversionOptions.m_destinationColorSpace, m_d->conversionOptions.m_renderingIntent, m_d->conversionOptions.m_conversionFlags);
+                }
+            }
+        };
+
+    if (info->tileList.size() > 1) {
+        QtConcurrent::blockingMap(info->tileList, prepareTile);
+    } else {
+        std::for_each(info->tileList.begin(), info->tileList.end(), prepareTile);
+    }
+
     info->assignDirtyImageRect(rect);
     info->assignLevelOfDetail(levelOfDetail);
     return info;
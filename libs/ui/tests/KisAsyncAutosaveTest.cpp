@@ -0,0 +1,146 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisAsyncAutosaveTest.h"
+
+#include <QSemaphore>
+#include <QTemporaryDir>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <KisDocument.h>
+#include <KisPart.h>
+#include <kis_image.h>
+#include <kis_simple_stroke_strategy.h>
+#include <sdk/tests/kistest.h>
+
+
+namespace {
+
+/**
+ * Keeps the image busy: the finishing job of the stroke
+ * waits until the semaphore is released
+ */
+class BlockingStrokeStrategy : public KisSimpleStrokeStrategy
+{
+public:
+    BlockingStrokeStrategy(QSemaphore *semaphore)
+        : KisSimpleStrokeStrategy(QLatin1String("blocking-stroke")),
+          m_semaphore(semaphore)
+    {
+        enableJob(JOB_FINISH, true, KisStrokeJobData::BARRIER, KisStrokeJobData::EXCLUSIVE);
+    }
+
+    void finishStrokeCallback() override {
+        m_semaphore->acquire();
+    }
+
+private:
+    QSemaphore *m_semaphore;
+};
+
+QStringList autosaveFiles(const QString &path)
+{
+    return QDir(path).entryList(QStringList() << "*autosave*", QDir::Files | QDir::Hidden);
+}
+
+}
+
+void KisAsyncAutosaveTest::init()
+{
+    m_dir = new QTemporaryDir();
+    QVERIFY(m_dir->isValid());
+
+    m_doc = KisPart::instance()->createDocument();
+    QVERIFY(m_doc->newImage("test", 512, 512, KoColorSpaceRegistry::instance()->rgb8(), KoColor(), KisConfig::RASTER_LAYER, 1, "", 96));
+
+    // the autosave is written next to the document only if the file is writable
+    const QString fileName = m_dir->path() + QDir::separator() + "test.kra";
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.close();
+
+    m_doc->setUrl(QUrl::fromLocalFile(fileName));
+    m_doc->setLocalFilePath(fileName);
+}
+
+void KisAsyncAutosaveTest::cleanup()
+{
+    delete m_doc;
+    m_doc = 0;
+
+    delete m_dir;
+    m_dir = 0;
+}
+
+void KisAsyncAutosaveTest::testAutosaveDuringStroke()
+{
+    KisImageSP image = m_doc->image();
+
+    QSemaphore semaphore;
+    KisStrokeId id = image->startStroke(new BlockingStrokeStrategy(&semaphore));
+    image->endStroke(id);
+
+    m_doc->setModified(true);
+
+    QVERIFY(QMetaObject::invokeMethod(m_doc, "slotAutoSave"));
+    QVERIFY(m_doc->isWaitingForAutosaveClone());
+
+    // the second request doesn't start another clone stroke
+    QVERIFY(QMetaObject::invokeMethod(m_doc, "slotAutoSave"));
+    QVERIFY(m_doc->isWaitingForAutosaveClone());
+
+    semaphore.release();
+
+    QTRY_VERIFY_WITH_TIMEOUT(!m_doc->isWaitingForAutosaveClone(), 10000);
+    QTRY_VERIFY_WITH_TIMEOUT(!m_doc->isSaving(), 10000);
+
+    image->waitForDone();
+
+    QCOMPARE(autosaveFiles(m_dir->path()).size(), 1);
+}
+
+void KisAsyncAutosaveTest::testCloneStrokeCancelled()
+{
+    KisImageSP image = m_doc->image();
+
+    QSemaphore semaphore;
+    KisStrokeId id = image->startStroke(new BlockingStrokeStrategy(&semaphore));
+    image->endStroke(id);
+
+    m_doc->setModified(true);
+
+    QVERIFY(QMetaObject::invokeMethod(m_doc, "slotAutoSave"));
+    QVERIFY(m_doc->isWaitingForAutosaveClone());
+
+    /**
+     * Both strokes have been ended, so both of them are cancelled.
+     * The clone stroke has not started yet.
+     */
+    image->requestStrokeCancellation();
+    semaphore.release();
+
+    image->waitForDone();
+    QTRY_VERIFY_WITH_TIMEOUT(!m_doc->isWaitingForAutosaveClone(), 10000);
+
+    QVERIFY(!m_doc->isSaving());
+    QVERIFY(autosaveFiles(m_dir->path()).isEmpty());
+}
+
+KISTEST_MAIN(KisAsyncAutosaveTest)
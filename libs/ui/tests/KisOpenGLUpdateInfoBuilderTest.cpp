@@ -0,0 +1,93 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "KisOpenGLUpdateInfoBuilderTest.h"
+
+#include <QTest>
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include "kis_paint_device.h"
+#include "opengl/KisOpenGLUpdateInfoBuilder.h"
+#include "kis_update_info.h"
+
+#include "opengl/kis_texture_tile_update_info.h"
+
+
+void KisOpenGLUpdateInfoBuilderTest::testParallelPreparation()
+{
+    const KoColorSpace *srcColorSpace = KoColorSpaceRegistry::instance()->rgb8();
+    const KoColorSpace *dstColorSpace = KoColorSpaceRegistry::instance()->rgb16();
+
+    const QRect bounds(0, 0, 1000, 700);
+
+    KisPaintDeviceSP dev = new KisPaintDevice(srcColorSpace);
+
+    {
+        const int pixelSize = srcColorSpace->pixelSize();
+        QVector<quint8> bytes(bounds.width() * bounds.height() * pixelSize);
+
+        for (int i = 0; i < bytes.size(); i++) {
+            bytes[i] = (i * 7 + i / 1357) % 256;
+        }
+
+        dev->writeBytes(bytes.data(), bounds);
+    }
+
+    KisTextureTileInfoPoolRegistry poolRegistry;
+    KisTextureTileInfoPoolSP pool = poolRegistry.getPool(256, 256);
+
+    KisOpenGLUpdateInfoBuilder builder;
+    builder.setTextureInfoPool(pool);
+    builder.setConversionOptions(
+        ConversionOptions(dstColorSpace,
+                          KoColorConversionTransformation::internalRenderingIntent(),
+                          KoColorConversionTransformation::internalConversionFlags()));
+    builder.setTextureBorder(8);
+    builder.setEffectiveTextureSize(QSize(256 - 16, 256 - 16));
+
+    const QRect updateRect(100, 50, 800, 600);
+
+    KisOpenGLUpdateInfoSP info = builder.buildUpdateInfo(updateRect, dev, bounds, 0, true);
+
+    const QRect artificialRect = kisGrowRect(updateRect, 8) & bounds;
+    const int numColumns = builder.xToCol(artificialRect.right()) - builder.xToCol(artificialRect.left()) + 1;
+    const int numRows = builder.yToRow(artificialRect.bottom()) - builder.yToRow(artificialRect.top()) + 1;
+
+    QCOMPARE(info->tileList.size(), numColumns * numRows);
+
+    Q_FOREACH (KisTextureTileUpdateInfoSP tile, info->tileList) {
+        const QRect tileRect = builder.calculatePhysicalTileRect(tile->tileCol(), tile->tileRow(), bounds, 0);
+
+        KisTextureTileUpdateInfo refTile(tile->tileCol(), tile->tileRow(),
+                                         tileRect, updateRect, bounds, 0, pool);
+
+        refTile.retrieveData(dev, QBitArray(), false, -1);
+        refTile.convertTo(dstColorSpace,
+                          KoColorConversionTransformation::internalRenderingIntent(),
+                          KoColorConversionTransformation::internalConversionFlags());
+
+        QCOMPARE(tile->patchColorSpace(), dstColorSpace);
+        QCOMPARE(tile->realPatchRect(), refTile.realPatchRect());
+
+        const int numBytes = tile->realPatchRect().width() * tile->realPatchRect().height() * tile->pixelSize();
+        QVERIFY(!memcmp(tile->data(), refTile.data(), numBytes));
+    }
+}
+
+QTEST_MAIN(KisOpenGLUpdateInfoBuilderTest)
@@ -0,0 +1,152 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisSavedPixelDataTrackerTest.h"
+
+#include <QTemporaryDir>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+
+#include "KisSavedPixelDataTracker.h"
+#include "kis_image.h"
+#include "kis_paint_layer.h"
+#include "kis_paint_device.h"
+#include "kis_transaction.h"
+
+namespace {
+
+struct TestImage
+{
+    TestImage() {
+        const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+        image = new KisImage(0, 256, 256, cs, "tracker test");
+
+        layer1 = new KisPaintLayer(image, "layer1", OPACITY_OPAQUE_U8);
+        layer2 = new KisPaintLayer(image, "layer2", OPACITY_OPAQUE_U8);
+        image->addNode(layer1);
+        image->addNode(layer2);
+
+        layer1->paintDevice()->fill(QRect(0, 0, 100, 100), KoColor(Qt::red, cs));
+        layer2->paintDevice()->fill(QRect(50, 50, 100, 100), KoColor(Qt::green, cs));
+    }
+
+    KisImageSP image;
+    KisPaintLayerSP layer1;
+    KisPaintLayerSP layer2;
+};
+
+QString writeFile(const QTemporaryDir &dir, const QString &name, const QByteArray &data)
+{
+    const QString fileName = dir.path() + "/" + name;
+
+    QFile file(fileName);
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+    file.close();
+
+    return QFileInfo(fileName).absoluteFilePath();
+}
+
+}
+
+void KisSavedPixelDataTrackerTest::testUnchangedLayersAreReused()
+{
+    TestImage t;
+    QTemporaryDir dir;
+    const QString fileName = writeFile(dir, "test.kra", "loaded data");
+
+    KisSavedPixelDataTracker tracker;
+    tracker.recordLoadedEntry(t.layer1->uuid(), t.layer1->paintDevice(), "test/layers/layer1");
+    tracker.recordLoadedEntry(t.layer2->uuid(), t.layer2->paintDevice(), "test/layers/layer2");
+    tracker.commit(fileName);
+
+    // only snapshots are allowed to hand out the entries
+    QVERIFY(tracker.unchangedEntryLocation(t.layer1->uuid()).isEmpty());
+
+    KisSavedPixelDataTracker snapshot = tracker.snapshotForSaving(t.image->root());
+    QCOMPARE(snapshot.sourceFileName(), fileName);
+    QCOMPARE(snapshot.unchangedEntryLocation(t.layer1->uuid()), QString("test/layers/layer1"));
+    QCOMPARE(snapshot.unchangedEntryLocation(t.layer2->uuid()), QString("test/layers/layer2"));
+}
+
+void KisSavedPixelDataTrackerTest::testChangedLayerIsNotReused()
+{
+    TestImage t;
+    QTemporaryDir dir;
+    const QString fileName = writeFile(dir, "test.kra", "loaded data");
+
+    KisSavedPixelDataTracker tracker;
+    tracker.recordLoadedEntry(t.layer1->uuid(), t.layer1->paintDevice(), "test/layers/layer1");
+    tracker.recordLoadedEntry(t.layer2->uuid(), t.layer2->paintDevice(), "test/layers/layer2");
+    tracker.commit(fileName);
+
+    {
+        KisPaintDeviceSP dev = t.layer2->paintDevice();
+        KisTransaction transaction(dev);
+        dev->fill(QRect(200, 200, 20, 20), KoColor(Qt::blue, dev->colorSpace()));
+        delete transaction.endAndTake();
+    }
+
+    KisSavedPixelDataTracker snapshot = tracker.snapshotForSaving(t.image->root());
+    QCOMPARE(snapshot.unchangedEntryLocation(t.layer1->uuid()), QString("test/layers/layer1"));
+    QVERIFY(snapshot.unchangedEntryLocation(t.layer2->uuid()).isEmpty());
+}
+
+void KisSavedPixelDataTrackerTest::testModifiedFileIsNotReused()
+{
+    TestImage t;
+    QTemporaryDir dir;
+    const QString fileName = writeFile(dir, "test.kra", "loaded data");
+
+    KisSavedPixelDataTracker tracker;
+    tracker.recordLoadedEntry(t.layer1->uuid(), t.layer1->paintDevice(), "test/layers/layer1");
+    tracker.commit(fileName);
+
+    writeFile(dir, "test.kra", "the file has been overwritten by someone else");
+
+    KisSavedPixelDataTracker snapshot = tracker.snapshotForSaving(t.image->root());
+    QVERIFY(snapshot.sourceFileName().isEmpty());
+    QVERIFY(snapshot.unchangedEntryLocation(t.layer1->uuid()).isEmpty());
+}
+
+void KisSavedPixelDataTrackerTest::testSavedEntriesAreCommitted()
+{
+    TestImage t;
+    QTemporaryDir dir;
+
+    KisSavedPixelDataTracker tracker;
+
+    // nothing has been saved yet
+    KisSavedPixelDataTracker snapshot = tracker.snapshotForSaving(t.image->root());
+    QVERIFY(snapshot.sourceFileName().isEmpty());
+
+    snapshot.recordSavedEntry(t.layer1->uuid(), "test/layers/layer3");
+    snapshot.recordSavedEntry(t.layer2->uuid(), "test/layers/layer4");
+
+    const QString fileName = writeFile(dir, "saved.kra", "saved data");
+    tracker = snapshot;
+    tracker.commit(fileName);
+
+    snapshot = tracker.snapshotForSaving(t.image->root());
+    QCOMPARE(snapshot.sourceFileName(), fileName);
+    QCOMPARE(snapshot.unchangedEntryLocation(t.layer1->uuid()), QString("test/layers/layer3"));
+    QCOMPARE(snapshot.unchangedEntryLocation(t.layer2->uuid()), QString("test/layers/layer4"));
+}
+
+QTEST_MAIN(KisSavedPixelDataTrackerTest)
@@ -0,0 +1,111 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "KisStrokePredictionTest.h"
+
+#include <QTest>
+
+#include "kis_speed_smoother.h"
+#include "kis_tool_freehand_helper.h"
+#include "KisStrokeSpeedMonitor.h"
+
+void KisStrokePredictionTest::testConstantVelocity()
+{
+    KisSpeedSmoother smoother;
+
+    // 2 px every 5 ms
+    for (int i = 0; i < 40; i++) {
+        smoother.getNextSpeed(QPointF(100 + 2 * i, 100), 5 * i);
+    }
+
+    QVERIFY(qAbs(smoother.lastVelocity().x() - 0.4) < 1e-2);
+    QVERIFY(qAbs(smoother.lastVelocity().y()) < 1e-6);
+    QCOMPARE(smoother.lastPointTime(), 195.0);
+}
+
+void KisStrokePredictionTest::testVelocityDecaysWhenStopped()
+{
+    KisSpeedSmoother smoother;
+
+    int i = 0;
+    for (; i < 40; i++) {
+        smoother.getNextSpeed(QPointF(100 + 2 * i, 100), 5 * i);
+    }
+
+    QVERIFY(smoother.lastVelocity().x() > 0.3);
+
+    // the pen stays still, but the tablet keeps sending the events
+    const QPointF stopPoint(100 + 2 * (i - 1), 100);
+    for (int j = 0; j < 150; j++, i++) {
+        smoother.getNextSpeed(stopPoint, 5 * i);
+    }
+
+    QVERIFY(qAbs(smoother.lastVelocity().x()) < 1e-2);
+}
+
+void KisStrokePredictionTest::testPredictionShrinksWithTime()
+{
+    const QPointF velocity(0.5, -0.25);
+    const qreal predictionTime = 20;
+    const qreal maxDistance = 1000;
+
+    QCOMPARE(KisToolFreehandHelper::predictStrokeOffset(velocity, predictionTime, 0, maxDistance),
+             QPointF(10, -5));
+
+    QCOMPARE(KisToolFreehandHelper::predictStrokeOffset(velocity, predictionTime, 10, maxDistance),
+             QPointF(5, -2.5));
+
+    // no events for the whole prediction interval, the overlay must disappear
+    QCOMPARE(KisToolFreehandHelper::predictStrokeOffset(velocity, predictionTime, 20, maxDistance),
+             QPointF());
+    QCOMPARE(KisToolFreehandHelper::predictStrokeOffset(velocity, predictionTime, 100, maxDistance),
+             QPointF());
+
+    // the pen doesn't move
+    QCOMPARE(KisToolFreehandHelper::predictStrokeOffset(QPointF(), predictionTime, 0, maxDistance),
+             QPointF());
+}
+
+void KisStrokePredictionTest::testPredictionIsLimited()
+{
+    const QPointF offset =
+        KisToolFreehandHelper::predictStrokeOffset(QPointF(0, 10), 20, 0, 50);
+
+    QCOMPARE(offset, QPointF(0, 50));
+}
+
+void KisStrokePredictionTest::testLatencyIgnoresPreviousStroke()
+{
+    KisStrokeSpeedMonitor monitor;
+    monitor.setHaveStrokeSpeedMeasurement(true);
+
+    // the last event of the previous stroke has never been shown
+    monitor.notifyInputStreamStarted();
+    monitor.notifyInputEvent(QPointF(10, 10));
+    monitor.notifyInputStreamEnded();
+
+    QTest::qSleep(100);
+
+    monitor.notifyInputStreamStarted();
+    monitor.notifyInputEvent(QPointF(100, 100));
+    monitor.notifyCanvasUpdated(QRect(0, 0, 200, 200));
+
+    QVERIFY(monitor.lastInputLatency() < 100.0);
+    QVERIFY(monitor.avgInputLatency() < 100.0);
+}
+
+QTEST_MAIN(KisStrokePredictionTest)
@@ -0,0 +1,81 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "KisViewportMotionPredictorTest.h"
+
+#include <QTest>
+
+#include "canvas/KisViewportMotionPredictor.h"
+
+void KisViewportMotionPredictorTest::testConstantVelocity()
+{
+    KisViewportMotionPredictor predictor;
+
+    QCOMPARE(predictor.predictedShift(0, 100), QPointF());
+
+    for (int i = 0; i <= 10; i++) {
+        predictor.addMotion(QPointF(-20, 10), i * 10);
+    }
+
+    QCOMPARE(predictor.velocity(), QPointF(-2.0, 1.0));
+    QCOMPARE(predictor.predictedShift(100, 100), QPointF(-200, 100));
+}
+
+void KisViewportMotionPredictorTest::testStop()
+{
+    KisViewportMotionPredictor predictor;
+
+    for (int i = 0; i <= 10; i++) {
+        predictor.addMotion(QPointF(20, 0), i * 10);
+    }
+
+    QVERIFY(!predictor.predictedShift(110, 100).isNull());
+
+    // the user has stopped panning
+    QCOMPARE(predictor.predictedShift(1000, 100), QPointF());
+
+    // the motion after a pause starts from scratch
+    predictor.addMotion(QPointF(0, 50), 1000);
+    QCOMPARE(predictor.predictedShift(1000, 100), QPointF());
+
+    predictor.addMotion(QPointF(0, 50), 1010);
+    QCOMPARE(predictor.predictedShift(1010, 100), QPointF(0, 500));
+
+    predictor.reset();
+    QCOMPARE(predictor.predictedShift(1010, 100), QPointF());
+}
+
+void KisViewportMotionPredictorTest::testSmoothing()
+{
+    KisViewportMotionPredictor predictor;
+
+    for (int i = 0; i <= 10; i++) {
+        predictor.addMotion(QPointF(10, 0), i * 10);
+    }
+
+    // a single jerky event doesn't reverse the prediction
+    predictor.addMotion(QPointF(-10, 0), 110);
+    QVERIFY(predictor.velocity().x() > 0);
+
+    // but a persistent change of the direction does
+    for (int i = 12; i <= 20; i++) {
+        predictor.addMotion(QPointF(-10, 0), i * 10);
+    }
+    QVERIFY(predictor.velocity().x() < 0);
+}
+
+QTEST_MAIN(KisViewportMotionPredictorTest)
@@ -19,7 +19,9 @@
 #include "freehand_stroke_test.h"
 
 #include <QTest>
+#include <QTransform>
 #include <KoCompositeOpRegistry.h>
+#include <KoColorSpaceRegistry.h>
 #include <KoColor.h>
 #include "stroke_testing_utils.h"
 #include "strokes/freehand_stroke.h"
@@ -29,6 +31,11 @@
 #include "kis_image.h"
 #include "kis_painter.h"
 #include <brushengine/kis_paint_information.h>
+#include <brushengine/kis_paintop_preset.h>
+#include <brushengine/kis_paintop_settings.h>
+#include "kis_paint_layer.h"
+#include <brushengine/kis_stroke_random_source.h>
+#include "testutil.h"
 
 #include "kistest.h"
 
@@ -187,4 +194,184 @@ void FreehandStrokeTest::testPredefinedBrushStrokeLod()
     tester.testSimpleStroke();
 }
 
+const int numMultihandSegments = 20;
+
+void multihandSegment(KisImageSP image, int numHands, qreal innerRadius,
+                      int hand, int segment,
+                      KisPaintInformation *pi1, KisPaintInformation *pi2)
+{
+    const QPointF center = QRectF(image->bounds()).center();
+    const int j = segment;
+
+    const QTransform t =
+        QTransform::fromTranslate(-center.x(), -center.y()) *
+        QTransform().rotate(360.0 * hand / numHands) *
+        QTransform::fromTranslate(center.x(), center.y());
+
+    *pi1 = KisPaintInformation(t.map(center + QPointF(innerRadius + 5 * j, 2 * j)), 0.5 + 0.02 * j);
+    *pi2 = KisPaintInformation(t.map(center + QPointF(innerRadius + 5 * (j + 1), 2 * (j + 1))), 0.5 + 0.02 * (j + 1));
+}
+
+void paintMultihandStroke(KisImageSP image, KisNodeSP layer, KisPaintOpPresetSP preset,
+                          int numHands, qreal innerRadius, bool sendAsMultihandData)
+{
+    KisResourcesSnapshotSP resources = new KisResourcesSnapshot(image, layer);
+    resources->setBrush(preset);
+    resources->setFGColorOverride(KoColor(Qt::black, image->colorSpace()));
+
+    QVector<KisFreehandStrokeInfo*> strokeInfos;
+    for (int i = 0; i < numHands; i++) {
+        strokeInfos << new KisFreehandStrokeInfo();
+    }
+
+    KisStrokeId strokeId = image->startStroke(
+        new FreehandStrokeStrategy(resources, strokeInfos, kundo2_noi18n("multihand_stroke")));
+
+    for (int j = 0; j < numMultihandSegments; j++) {
+        QVector<FreehandStrokeStrategy::Data*> hands;
+
+        for (int i = 0; i < numHands; i++) {
+            KisPaintInformation pi1, pi2;
+            multihandSegment(image, numHands, innerRadius, i, j, &pi1, &pi2);
+            hands << new FreehandStrokeStrategy::Data(i, pi1, pi2);
+        }
+
+        if (sendAsMultihandData) {
+            image->addJob(strokeId, new FreehandStrokeStrategy::MultihandData(hands));
+        } else {
+            Q_FOREACH (FreehandStrokeStrategy::Data *hand, hands) {
+                image->addJob(strokeId, hand);
+            }
+        }
+    }
+
+    image->addJob(strokeId, new KisAsyncronousStrokeUpdateHelper::UpdateData(true));
+    image->endStroke(strokeId);
+    image->waitForDone();
+}
+
+void FreehandStrokeTest::testMultihandParallelHands_data()
+{
+    QTest::addColumn<int>("numHands");
+    QTest::addColumn<qreal>("innerRadius");
+
+    // the hands are far from each other and are painted in parallel
+    QTest::newRow("separate-hands") << 6 << 100.0;
+
+    // the hands overlap near the center and are painted sequentially
+    QTest::newRow("overlapping-hands") << 8 << 0.0;
+}
+
+void FreehandStrokeTest::testMultihandParallelHands()
+{
+    QFETCH(int, numHands);
+    QFETCH(qreal, innerRadius);
+
+    KisPaintOpPresetSP preset = new KisPaintOpPreset(TestUtil::fetchDataFileLazy("Basic_tip_default.kpp"));
+    QVERIFY(preset->load());
+
+    // the hands are painted in parallel with indirect painting only
+    const int washPaintAction = 2;
+    preset->settings()->setProperty("PaintOpAction", washPaintAction);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect imageRect(0, 0, 640, 640);
+
+    KisImageSP sequentialImage = new KisImage(0, imageRect.width(), imageRect.height(), cs, "sequential");
+    KisPaintLayerSP sequentialLayer = new KisPaintLayer(sequentialImage, "layer", OPACITY_OPAQUE_U8, cs);
+    sequentialImage->addNode(sequentialLayer, sequentialImage->root());
+
+    KisImageSP parallelImage = new KisImage(0, imageRect.width(), imageRect.height(), cs, "parallel");
+    KisPaintLayerSP parallelLayer = new KisPaintLayer(parallelImage, "layer", OPACITY_OPAQUE_U8, cs);
+    parallelImage->addNode(parallelLayer, parallelImage->root());
+
+    paintMultihandStroke(sequentialImage, sequentialLayer, preset, numHands, innerRadius, false);
+    paintMultihandStroke(parallelImage, parallelLayer, preset, numHands, innerRadius, true);
+
+    QVERIFY(!sequentialLayer->paintDevice()->exactBounds().isEmpty());
+
+    QPoint errorPoint;
+    if (!TestUtil::comparePaintDevices(errorPoint, sequentialLayer->paintDevice(), parallelLayer->paintDevice())) {
+        sequentialLayer->paintDevice()->convertToQImage(0).save("multihand_sequential.png");
+        parallelLayer->paintDevice()->convertToQImage(0).save("multihand_parallel.png");
+        QFAIL(QString("The hands painted in parallel differ from the sequential ones at %1,%2")
+              .arg(errorPoint.x()).arg(errorPoint.y()).toLatin1());
+    }
+}
+
+void FreehandStrokeTest::testMultihandSequentialRandomSource()
+{
+    KisPaintOpPresetSP preset = new KisPaintOpPreset(TestUtil::fetchDataFileLazy("Basic_tip_default.kpp"));
+    QVERIFY(preset->load());
+
+    // the scattered dabs take their offsets from the random source
+    const int buildUpPaintAction = 1;
+    preset->settings()->setProperty("PaintOpAction", buildUpPaintAction);
+    preset->settings()->setProperty("PressureScatter", true);
+    preset->settings()->setProperty("ScatterValue", 2.0);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect imageRect(0, 0, 640, 640);
+    const int numHands = 4;
+    const qreal innerRadius = 50.0;
+    const uint seed = 17;
+
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "multihand");
+    KisPaintLayerSP layer = new KisPaintLayer(image, "layer", OPACITY_OPAQUE_U8, cs);
+    image->addNode(layer, image->root());
+
+    qsrand(seed);
+    paintMultihandStroke(image, layer, preset, numHands, innerRadius, false);
+
+    /**
+     * The hands painted one after another must share a single random
+     * source, in the order they are painted, as they always did
+     */
+    qsrand(seed);
+
+    KisResourcesSnapshotSP resources = new KisResourcesSnapshot(image, layer);
+    resources->setBrush(preset);
+    resources->setFGColorOverride(KoColor(Qt::black, cs));
+
+    KisStrokeRandomSource randomSource;
+    KisPaintDeviceSP referenceDevice = new KisPaintDevice(cs);
+
+    QVector<KisFreehandStrokeInfo*> strokeInfos;
+    for (int i = 0; i < numHands; i++) {
+        KisFreehandStrokeInfo *info = new KisFreehandStrokeInfo();
+        info->painter->begin(referenceDevice);
+        resources->setupPainter(info->painter);
+        strokeInfos << info;
+    }
+
+    for (int j = 0; j < numMultihandSegments; j++) {
+        for (int i = 0; i < numHands; i++) {
+            KisPaintInformation pi1, pi2;
+            multihandSegment(image, numHands, innerRadius, i, j, &pi1, &pi2);
+
+            pi1.setRandomSource(randomSource.source());
+            pi2.setRandomSource(randomSource.source());
+            pi1.setPerStrokeRandomSource(randomSource.perStrokeSource());
+            pi2.setPerStrokeRandomSource(randomSource.perStrokeSource());
+
+            strokeInfos[i]->painter->paintLine(pi1, pi2, strokeInfos[i]->dragDistance);
+        }
+    }
+
+    Q_FOREACH (KisFreehandStrokeInfo *info, strokeInfos) {
+        info->painter->end();
+        delete info;
+    }
+
+    QVERIFY(!referenceDevice->exactBounds().isEmpty());
+
+    QPoint errorPoint;
+    if (!TestUtil::comparePaintDevices(errorPoint, referenceDevice, layer->paintDevice())) {
+        referenceDevice->convertToQImage(0).save("multihand_random_reference.png");
+        layer->paintDevice()->convertToQImage(0).save("multihand_random_stroke.png");
+        QFAIL(QString("The hands painted sequentially differ from the reference at %1,%2")
+              .arg(errorPoint.x()).arg(errorPoint.y()).toLatin1());
+    }
+}
+
 KISTEST_MAIN(FreehandStrokeTest)
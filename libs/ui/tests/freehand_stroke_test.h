@@ -36,6 +36,10 @@ private Q_SLOTS:
 
     void testAutoBrushStrokeLod();
     void testPredefinedBrushStrokeLod();
+
+    void testMultihandParallelHands_data();
+    void testMultihandParallelHands();
+    void testMultihandSequentialRandomSource();
 };
 
 #endif /* __FREEHAND_STROKE_TEST_H */
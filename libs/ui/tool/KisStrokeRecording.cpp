@@ -0,0 +1,220 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisStrokeRecording.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+
+#include "kis_debug.h"
+
+namespace {
+const quint32 RECORDING_MAGIC = 0x4b535452; // "KSTR"
+const quint16 RECORDING_VERSION = 1;
+
+// eleven single-precision values and the flags byte
+const int RECORDING_EVENT_SIZE = 11 * 4 + 1;
+
+enum EventFlags {
+    CanvasMirroredH = 0x1,
+    CanvasMirroredV = 0x2
+};
+}
+
+KisStrokeRecording::KisStrokeRecording()
+{
+}
+
+KisStrokeRecording::KisStrokeRecording(qreal startAngle, const QString &presetName)
+    : m_startAngle(startAngle),
+      m_presetName(presetName)
+{
+}
+
+qreal KisStrokeRecording::startAngle() const
+{
+    return m_startAngle;
+}
+
+void KisStrokeRecording::setStartAngle(qreal value)
+{
+    m_startAngle = value;
+}
+
+QString KisStrokeRecording::presetName() const
+{
+    return m_presetName;
+}
+
+void KisStrokeRecording::setPresetName(const QString &value)
+{
+    m_presetName = value;
+}
+
+void KisStrokeRecording::addEvent(const KisPaintInformation &pi)
+{
+    m_events.append(pi);
+}
+
+const QVector<KisPaintInformation>& KisStrokeRecording::events() const
+{
+    return m_events;
+}
+
+bool KisStrokeRecording::isEmpty() const
+{
+    return m_events.isEmpty();
+}
+
+void KisStrokeRecording::clear()
+{
+    m_events.clear();
+}
+
+bool KisStrokeRecording::save(QIODevice *device) const
+{
+    QDataStream stream(device);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    stream << RECORDING_MAGIC << RECORDING_VERSION;
+    stream << m_startAngle << m_presetName;
+    stream << quint32(m_events.size());
+
+    Q_FOREACH (const KisPaintInformation &pi, m_events) {
+        const quint8 flags =
+            (pi.canvasMirroredH() ? CanvasMirroredH : 0) |
+            (pi.canvasMirroredV() ? CanvasMirroredV : 0);
+
+        stream << pi.pos().x() << pi.pos().y()
+               << pi.pressure()
+               << pi.xTilt() << pi.yTilt()
+               << pi.rotation()
+               << pi.tangentialPressure()
+               << pi.perspective()
+               << pi.currentTime()
+               << pi.drawingSpeed()
+               << pi.canvasRotation()
+               << flags;
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
+
+bool KisStrokeRecording::load(QIODevice *device)
+{
+    QDataStream stream(device);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    stream >> magic >> version;
+
+    if (magic != RECORDING_MAGIC || version != RECORDING_VERSION) {
+        warnKrita << "KisStrokeRecording: unsupported stroke recording format" << ppVar(magic) << ppVar(version);
+        return false;
+    }
+
+    quint32 numEvents = 0;
+    stream >> m_startAngle >> m_presetName >> numEvents;
+
+    m_events.clear();
+
+    /**
+     * Don't trust the event count of a broken or malicious file: reserve
+     * only as many events as the rest of the device can really hold
+     */
+    if (!device->isSequential()) {
+        const qint64 maxEvents = device->bytesAvailable() / RECORDING_EVENT_SIZE;
+        m_events.reserve(int(qMin(qint64(numEvents), maxEvents)));
+    }
+
+    for (quint32 i = 0; i < numEvents && stream.status() == QDataStream::Ok; i++) {
+        qreal x, y, pressure, xTilt, yTilt, rotation;
+        qreal tangentialPressure, perspective, time, speed, canvasRotation;
+        quint8 flags;
+
+        stream >> x >> y
+               >> pressure
+               >> xTilt >> yTilt
+               >> rotation
+               >> tangentialPressure
+               >> perspective
+               >> time
+               >> speed
+               >> canvasRotation
+               >> flags;
+
+        KisPaintInformation pi(QPointF(x, y), pressure, xTilt, yTilt, rotation,
+                               tangentialPressure, perspective, time, speed);
+        pi.setCanvasRotation(canvasRotation);
+        pi.setCanvasMirroredH(flags & CanvasMirroredH);
+        pi.setCanvasMirroredV(flags & CanvasMirroredV);
+
+        m_events.append(pi);
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        warnKrita << "KisStrokeRecording: stroke recording is truncated";
+        m_events.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool KisStrokeRecording::save(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        warnKrita << "KisStrokeRecording: failed to open" << fileName << "for writing";
+        return false;
+    }
+
+    return save(&file);
+}
+
+bool KisStrokeRecording::load(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        warnKrita << "KisStrokeRecording: failed to open" << fileName << "for reading";
+        return false;
+    }
+
+    return load(&file);
+}
+
+QString KisStrokeRecording::saveToDirectory(const QString &directory) const
+{
+    QDir dir(directory);
+    if (!dir.exists() && !dir.mkpath(".")) {
+        warnKrita << "KisStrokeRecording: failed to create directory" << directory;
+        return QString();
+    }
+
+    const QString fileName =
+        dir.absoluteFilePath(
+            QString("stroke-%1.kstroke")
+            .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss-zzz")));
+
+    return save(fileName) ? fileName : QString();
+}
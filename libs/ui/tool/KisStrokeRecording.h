@@ -0,0 +1,81 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISSTROKERECORDING_H
+#define KISSTROKERECORDING_H
+
+#include <QString>
+#include <QVector>
+
+#include "kritaui_export.h"
+#include <brushengine/kis_paint_information.h>
+
+class QIODevice;
+
+/**
+ * A stream of paint information events of a single freehand stroke, as
+ * it has been generated by KisPaintingInformationBuilder from the real
+ * tablet events.
+ *
+ * The recording is saved in a compact binary form (one single-precision
+ * record per event) and can be replayed by KisToolFreehandHelper later
+ * to measure the performance of the painting pipeline on the real input.
+ */
+class KRITAUI_EXPORT KisStrokeRecording
+{
+public:
+    KisStrokeRecording();
+    KisStrokeRecording(qreal startAngle, const QString &presetName);
+
+    qreal startAngle() const;
+    void setStartAngle(qreal value);
+
+    /**
+     * The name of the preset the stroke has been painted with. Used for
+     * information purposes only.
+     */
+    QString presetName() const;
+    void setPresetName(const QString &value);
+
+    void addEvent(const KisPaintInformation &pi);
+    const QVector<KisPaintInformation>& events() const;
+
+    bool isEmpty() const;
+    void clear();
+
+    bool save(QIODevice *device) const;
+    bool load(QIODevice *device);
+
+    bool save(const QString &fileName) const;
+    bool load(const QString &fileName);
+
+    /**
+     * Saves the recording into \p directory with a unique file name
+     * generated from the current time.
+     *
+     * @return the name of the written file or an empty string on failure
+     */
+    QString saveToDirectory(const QString &directory) const;
+
+private:
+    qreal m_startAngle = 0.0;
+    QString m_presetName;
+    QVector<KisPaintInformation> m_events;
+};
+
+#endif // KISSTROKERECORDING_H
@@ -21,6 +21,10 @@
 #include <QGlobalStatic>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QPointF>
+#include <QRect>
+#include <QVector>
 
 #include <KisRollingMeanAccumulatorWrapper.h>
 #include "kis_paintop_preset.h"
@@ -37,17 +41,27 @@ Q_GLOBAL_STATIC(KisStrokeSpeedMonitor, s_instance)
 struct KisStrokeSpeedMonitor::Private
 {
     static const int averageWindow = 10;
+    static const int latencyAverageWindow = 100;
+    static const int maxPendingInputEvents = 256;
 
     Private()
         : avgCursorSpeed(averageWindow),
           avgRenderingSpeed(averageWindow),
-          avgFps(averageWindow)
+          avgFps(averageWindow),
+          avgInputLatency(latencyAverageWindow)
     {
+        latencyTimer.start();
     }
 
+    struct InputEvent {
+        QPointF pos;
+        qint64 time;
+    };
+
     KisRollingMeanAccumulatorWrapper avgCursorSpeed;
     KisRollingMeanAccumulatorWrapper avgRenderingSpeed;
     KisRollingMeanAccumulatorWrapper avgFps;
+    KisRollingMeanAccumulatorWrapper avgInputLatency;
 
     qreal cachedAvgCursorSpeed = 0;
     qreal cachedAvgRenderingSpeed = 0;
@@ -58,6 +72,11 @@ struct KisStrokeSpeedMonitor::Private
     qreal lastFps = 0;
     bool lastStrokeSaturated = false;
 
+    QElapsedTimer latencyTimer;
+    QVector<InputEvent> pendingInputEvents;
+    qreal lastInputLatency = 0;
+    qreal cachedAvgInputLatency = 0;
+
     QByteArray lastPresetMd5;
     QString lastPresetName;
     qreal lastPresetSize = 0;
@@ -101,6 +120,7 @@ void KisStrokeSpeedMonitor::resetAccumulatedValues()
     m_d->avgCursorSpeed.reset(m_d->averageWindow);
     m_d->avgRenderingSpeed.reset(m_d->averageWindow);
     m_d->avgFps.reset(m_d->averageWindow);
+    m_d->avgInputLatency.reset(m_d->latencyAverageWindow);
 }
 
 void KisStrokeSpeedMonitor::slotConfigChanged()
@@ -164,6 +184,69 @@ void KisStrokeSpeedMonitor::notifyStrokeFinished(qreal cursorSpeed, qreal render
             .arg(m_d->cachedAvgFps, 5);
 }
 
+void KisStrokeSpeedMonitor::notifyInputEvent(const QPointF &imagePos)
+{
+    if (!m_d->haveStrokeSpeedMeasurement) return;
+
+    QMutexLocker locker(&m_d->mutex);
+
+    /**
+     * If the canvas doesn't show the stroke (e.g. it is painted outside
+     * the visible area), just drop the oldest events
+     */
+    if (m_d->pendingInputEvents.size() >= m_d->maxPendingInputEvents) {
+        m_d->pendingInputEvents.remove(0, m_d->pendingInputEvents.size() / 2);
+    }
+
+    m_d->pendingInputEvents.append({imagePos, m_d->latencyTimer.nsecsElapsed()});
+}
+
+void KisStrokeSpeedMonitor::notifyInputStreamStarted()
+{
+    QMutexLocker locker(&m_d->mutex);
+    m_d->pendingInputEvents.clear();
+}
+
+void KisStrokeSpeedMonitor::notifyInputStreamEnded()
+{
+    QMutexLocker locker(&m_d->mutex);
+    m_d->pendingInputEvents.clear();
+}
+
+void KisStrokeSpeedMonitor::notifyCanvasUpdated(const QRect &imageRect)
+{
+    if (!m_d->haveStrokeSpeedMeasurement) return;
+
+    QMutexLocker locker(&m_d->mutex);
+
+    if (m_d->pendingInputEvents.isEmpty()) return;
+
+    /**
+     * The events are painted in order, so when the canvas shows the
+     * position of some event, all the previous events are shown as well
+     */
+    int lastShownEvent = -1;
+    for (int i = m_d->pendingInputEvents.size() - 1; i >= 0; i--) {
+        if (imageRect.contains(m_d->pendingInputEvents[i].pos.toPoint())) {
+            lastShownEvent = i;
+            break;
+        }
+    }
+
+    if (lastShownEvent < 0) return;
+
+    const qint64 now = m_d->latencyTimer.nsecsElapsed();
+
+    for (int i = 0; i <= lastShownEvent; i++) {
+        const qreal latency = (now - m_d->pendingInputEvents[i].time) / 1000000.0;
+        m_d->avgInputLatency(latency);
+        m_d->lastInputLatency = latency;
+    }
+
+    m_d->cachedAvgInputLatency = m_d->avgInputLatency.rollingMean();
+    m_d->pendingInputEvents.remove(0, lastShownEvent + 1);
+}
+
 QString KisStrokeSpeedMonitor::lastPresetName() const
 {
     return m_d->lastPresetName;
@@ -208,3 +291,13 @@ qreal KisStrokeSpeedMonitor::avgFps() const
 {
     return m_d->cachedAvgFps;
 }
+
+qreal KisStrokeSpeedMonitor::lastInputLatency() const
+{
+    return m_d->lastInputLatency;
+}
+
+qreal KisStrokeSpeedMonitor::avgInputLatency() const
+{
+    return m_d->cachedAvgInputLatency;
+}
@@ -21,6 +21,9 @@
 
 #include <QObject>
 
+class QPointF;
+class QRect;
+
 #include "kis_types.h"
 #include "kritaui_export.h"
 
@@ -41,6 +44,9 @@ class KRITAUI_EXPORT KisStrokeSpeedMonitor : public QObject
     Q_PROPERTY(qreal avgRenderingSpeed READ avgRenderingSpeed NOTIFY sigStatsUpdated)
     Q_PROPERTY(qreal avgFps READ avgFps NOTIFY sigStatsUpdated)
 
+    Q_PROPERTY(qreal lastInputLatency READ lastInputLatency NOTIFY sigStatsUpdated)
+    Q_PROPERTY(qreal avgInputLatency READ avgInputLatency NOTIFY sigStatsUpdated)
+
 public:
     KisStrokeSpeedMonitor();
     ~KisStrokeSpeedMonitor();
@@ -51,6 +57,27 @@ public:
 
     void notifyStrokeFinished(qreal cursorSpeed, qreal renderingSpeed, qreal fps, KisPaintOpPresetSP preset);
 
+    /**
+     * Input-to-photon latency measurement: the freehand helper reports
+     * the position of every tablet event it gets, and the canvas reports
+     * the image rects it has uploaded and requested to repaint. The
+     * latency of an event is the time between these two moments for the
+     * first canvas update covering the event's position.
+     *
+     * Please note that the time spent by the windowing system and the
+     * display itself is not included.
+     */
+    void notifyInputEvent(const QPointF &imagePos);
+    void notifyCanvasUpdated(const QRect &imageRect);
+
+    /**
+     * The events of a finished stroke that have never been shown on the
+     * canvas must not be matched against the updates of the next one,
+     * so the freehand helper drops them when a stroke starts and ends
+     */
+    void notifyInputStreamStarted();
+    void notifyInputStreamEnded();
+
 
     QString lastPresetName() const;
     qreal lastPresetSize() const;
@@ -64,6 +91,12 @@ public:
     qreal avgRenderingSpeed() const;
     qreal avgFps() const;
 
+    /**
+     * Input-to-photon latency in milliseconds, see notifyInputEvent()
+     */
+    qreal lastInputLatency() const;
+    qreal avgInputLatency() const;
+
 
 Q_SIGNALS:
     void sigStatsUpdated();
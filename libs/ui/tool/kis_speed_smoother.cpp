@@ -46,13 +46,14 @@ struct KisSpeedSmoother::Private
         {
         }
 
-        DistancePoint(qreal _distance, qreal _time)
-            : distance(_distance), time(_time)
+        DistancePoint(qreal _distance, qreal _time, const QPointF &_point)
+            : distance(_distance), time(_time), point(_point)
         {
         }
 
         qreal distance;
         qreal time;
+        QPointF point;
     };
 
     typedef boost::circular_buffer<DistancePoint> DistanceBuffer;
@@ -61,6 +62,8 @@ struct KisSpeedSmoother::Private
     QPointF lastPoint;
     QElapsedTimer timer;
     qreal lastSpeed;
+    QPointF lastVelocity;
+    qreal lastPointTime = 0;
 };
 
 
@@ -74,17 +77,23 @@ KisSpeedSmoother::~KisSpeedSmoother()
 }
 
 qreal KisSpeedSmoother::getNextSpeed(const QPointF &pt)
+{
+    return getNextSpeed(pt, currentTime());
+}
+
+qreal KisSpeedSmoother::getNextSpeed(const QPointF &pt, qreal time)
 {
     if (m_d->lastPoint.isNull()) {
         m_d->lastPoint = pt;
+        m_d->lastPointTime = time;
         return 0.0;
     }
 
-    qreal time = qreal(m_d->timer.nsecsElapsed()) / 1000000;
     qreal dist = kisDistance(pt, m_d->lastPoint);
     m_d->lastPoint = pt;
+    m_d->lastPointTime = time;
 
-    m_d->distances.push_back(Private::DistancePoint(dist, time));
+    m_d->distances.push_back(Private::DistancePoint(dist, time, pt));
 
     Private::DistanceBuffer::const_reverse_iterator it = m_d->distances.rbegin();
     Private::DistanceBuffer::const_reverse_iterator end = m_d->distances.rend();
@@ -93,6 +102,7 @@ qreal KisSpeedSmoother::getNextSpeed(const QPointF &pt)
 
     qreal totalDistance = 0;
     qreal startTime = currentTime;
+    QPointF startPoint = pt;
 
     for (; it != end; ++it) {
         if (currentTime - it->time > MAX_TIME_DIFF) {
@@ -101,6 +111,7 @@ qreal KisSpeedSmoother::getNextSpeed(const QPointF &pt)
 
         totalDistance += it->distance;
         startTime = it->time;
+        startPoint = it->point;
 
         if (totalDistance > MAX_TRACKING_DISTANCE) {
             break;
@@ -109,12 +120,37 @@ qreal KisSpeedSmoother::getNextSpeed(const QPointF &pt)
 
     qreal totalTime = currentTime - startTime;
 
+    const qreal alpha = 0.2;
+
     if (totalTime > 0 && totalDistance > MIN_TRACKING_DISTANCE) {
         qreal speed = totalDistance / totalTime;
-
-        const qreal alpha = 0.2;
         m_d->lastSpeed = alpha * speed + (1 - alpha) * m_d->lastSpeed;
     }
 
+    /**
+     * The velocity is updated even when the cursor barely moves, so
+     * that it decays when the pen stops instead of pointing to the
+     * direction of the last movement forever
+     */
+    if (totalTime > 0) {
+        const QPointF velocity = (pt - startPoint) / totalTime;
+        m_d->lastVelocity = alpha * velocity + (1 - alpha) * m_d->lastVelocity;
+    }
+
     return m_d->lastSpeed;
 }
+
+QPointF KisSpeedSmoother::lastVelocity() const
+{
+    return m_d->lastVelocity;
+}
+
+qreal KisSpeedSmoother::lastPointTime() const
+{
+    return m_d->lastPointTime;
+}
+
+qreal KisSpeedSmoother::currentTime() const
+{
+    return qreal(m_d->timer.nsecsElapsed()) / 1000000;
+}
@@ -20,11 +20,12 @@
 #define __KIS_SPEED_SMOOTHER_H
 
 #include <QScopedPointer>
+#include <QPointF>
 
-class QPointF;
+#include "kritaui_export.h"
 
 
-class KisSpeedSmoother
+class KRITAUI_EXPORT KisSpeedSmoother
 {
 public:
     KisSpeedSmoother();
@@ -32,6 +33,30 @@ public:
 
     qreal getNextSpeed(const QPointF &pt);
 
+    /**
+     * Same as getNextSpeed(pt), but with an explicit \p time of the
+     * point (in ms), as returned by currentTime()
+     */
+    qreal getNextSpeed(const QPointF &pt, qreal time);
+
+    /**
+     * The smoothed velocity vector of the cursor, in units of the points
+     * passed to getNextSpeed() per millisecond. It is tracked over the same
+     * window as the speed itself, so the direction is stable enough to
+     * extrapolate the stroke a few milliseconds ahead.
+     */
+    QPointF lastVelocity() const;
+
+    /**
+     * The time (in ms) of the last point passed to getNextSpeed()
+     */
+    qreal lastPointTime() const;
+
+    /**
+     * The time (in ms) elapsed since the smoother has been created
+     */
+    qreal currentTime() const;
+
 private:
     struct Private;
     const QScopedPointer<Private> m_d;
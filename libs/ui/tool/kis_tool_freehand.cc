@@ -54,6 +54,7 @@
 #include "kis_config.h"
 #include "canvas/kis_canvas2.h"
 #include "kis_cursor.h"
+#include "kis_display_color_converter.h"
 #include <KisViewManager.h>
 #include <kis_painting_assistants_decoration.h>
 #include "kis_painting_information_builder.h"
@@ -79,6 +80,10 @@ KisToolFreehand::KisToolFreehand(KoCanvasBase * canvas, const QCursor & cursor,
     m_helper = new KisToolFreehandHelper(m_infoBuilder, transactionText);
 
     connect(m_helper, SIGNAL(requestExplicitUpdateOutline()), SLOT(explicitUpdateOutline()));
+
+    m_predictionUpdateTimer.setSingleShot(true);
+    m_predictionUpdateTimer.setInterval(16);
+    connect(&m_predictionUpdateTimer, SIGNAL(timeout()), SLOT(updatePredictedStroke()));
 }
 
 KisToolFreehand::~KisToolFreehand()
@@ -178,11 +183,13 @@ void KisToolFreehand::initStroke(KoPointerEvent *event)
 void KisToolFreehand::doStroke(KoPointerEvent *event)
 {
     m_helper->paintEvent(event);
+    updatePredictedStroke();
 }
 
 void KisToolFreehand::endStroke()
 {
     m_helper->endPaint();
+    updatePredictedStroke();
     bool paintOpIgnoredEvent = currentPaintOpPreset()->settings()->mouseReleaseEvent();
     Q_UNUSED(paintOpIgnoredEvent);
 }
@@ -441,6 +448,52 @@ void KisToolFreehand::explicitUpdateOutline()
     requestUpdateOutline(m_outlineDocPoint, 0);
 }
 
+void KisToolFreehand::updatePredictedStroke()
+{
+    const QPainterPath newOutline = m_helper->predictedStrokeOutline();
+
+    if (newOutline.isEmpty()) {
+        m_predictionUpdateTimer.stop();
+    } else {
+        m_predictionUpdateTimer.start();
+    }
+
+    if (m_predictedStrokeOutline.isEmpty() && newOutline.isEmpty()) return;
+
+    QRectF updateRect =
+        m_predictedStrokeOutline.boundingRect() | newOutline.boundingRect();
+
+    m_predictedStrokeOutline = newOutline;
+
+    updateRect = image()->pixelToDocument(updateRect.adjusted(-1, -1, 1, 1));
+    canvas()->updateCanvas(updateRect);
+}
+
+void KisToolFreehand::paint(QPainter &gc, const KoViewConverter &converter)
+{
+    if (!m_predictedStrokeOutline.isEmpty()) {
+        KisCanvas2 *kisCanvas = dynamic_cast<KisCanvas2*>(canvas());
+        KIS_SAFE_ASSERT_RECOVER_NOOP(kisCanvas);
+
+        if (kisCanvas) {
+            /**
+             * The prediction is painted with the semi-transparent paint
+             * color, it is replaced by the real dabs on the next event
+             */
+            QColor color = kisCanvas->displayColorConverter()->toQColor(
+                canvas()->resourceManager()->foregroundColor());
+            color.setAlphaF(0.5 * color.alphaF());
+
+            gc.save();
+            gc.setRenderHint(QPainter::Antialiasing);
+            gc.fillPath(pixelToView(m_predictedStrokeOutline), color);
+            gc.restore();
+        }
+    }
+
+    KisToolPaint::paint(gc, converter);
+}
+
 QPainterPath KisToolFreehand::getOutlinePath(const QPointF &documentPos,
                                              const KoPointerEvent *event,
                                              KisPaintOpSettings::OutlineMode outlineMode)
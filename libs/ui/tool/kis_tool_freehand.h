@@ -19,6 +19,9 @@
 #ifndef KIS_TOOL_FREEHAND_H_
 #define KIS_TOOL_FREEHAND_H_
 
+#include <QPainterPath>
+#include <QTimer>
+
 #include <brushengine/kis_paint_information.h>
 #include <brushengine/kis_paintop_settings.h>
 #include <kis_distance_information.h>
@@ -48,6 +51,8 @@ public:
     int flags() const override;
     void mouseMoveEvent(KoPointerEvent *event) override;
 
+    void paint(QPainter &gc, const KoViewConverter &converter) override;
+
 public Q_SLOTS:
     void activate(ToolActivation toolActivation, const QSet<KoShape*> &shapes) override;
     void deactivate() override;
@@ -90,6 +95,12 @@ protected Q_SLOTS:
     void setOnlyOneAssistantSnap(bool assistant);
     void slotDoResizeBrush(qreal newSize);
 
+    /**
+     * Fetches the predicted part of the stroke from the helper and
+     * requests the canvas to repaint the overlay
+     */
+    void updatePredictedStroke();
+
 private:
     friend class KisToolFreehandPaintingInformationBuilder;
 
@@ -124,6 +135,14 @@ private:
 
     bool m_paintopBasedPickingInAction;
     KisSignalCompressorWithParam<qreal> m_brushResizeCompressor;
+
+    QPainterPath m_predictedStrokeOutline;
+
+    /**
+     * The prediction shrinks with time when no new events arrive, so the
+     * overlay is updated periodically until it disappears
+     */
+    QTimer m_predictionUpdateTimer;
 };
 
 
@@ -20,6 +20,10 @@
 
 #include <QTimer>
 #include <QQueue>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QtConcurrent>
+#include <QPainterPathStroker>
 
 #include <klocalizedstring.h>
 
@@ -27,6 +31,7 @@
 #include <KoCanvasResourceProvider.h>
 
 #include "kis_algebra_2d.h"
+#include "kis_assert.h"
 #include "kis_distance_information.h"
 #include "kis_painting_information_builder.h"
 #include "kis_image.h"
@@ -45,6 +50,9 @@
 #include "strokes/freehand_stroke.h"
 #include "strokes/KisFreehandStrokeInfo.h"
 #include "KisAsyncronousStrokeUpdateHelper.h"
+#include "KisStrokeRecording.h"
+#include "KisStrokeSpeedMonitor.h"
+#include "kis_speed_smoother.h"
 
 #include <math.h>
 
@@ -63,6 +71,10 @@ const qreal SPACING_UPDATE_INTERVAL = 50.0;
 // used when airbrushing.
 const qreal TIMING_UPDATE_INTERVAL = 50.0;
 
+// The maximum length of the predicted part of the stroke, relative to the size of the brush.
+// Fast flicks are very hard to predict, so we limit the overlay not to overshoot too much.
+const qreal MAX_PREDICTION_DISTANCE_FACTOR = 2.0;
+
 struct KisToolFreehandHelper::Private
 {
     KisPaintingInformationBuilder *infoBuilder;
@@ -111,9 +123,36 @@ struct KisToolFreehandHelper::Private
     KisStabilizedEventsSampler stabilizedSampler;
     KisStabilizerDelayedPaintHelper stabilizerDelayedPaintHelper;
 
+    // Primitives of the hands, collected between beginHandsBatch() and endHandsBatch()
+    bool isBatchingHands = false;
+    QVector<FreehandStrokeStrategy::Data*> handsBatch;
+
+    // Paint information stream of the current stroke, non-null only when
+    // stroke recording is enabled in the config
+    QScopedPointer<KisStrokeRecording> recording;
+    QString recordingDirectory;
+
+    // Stroke prediction data, the smoother is non-null only when the
+    // prediction is enabled in the config
+    QScopedPointer<KisSpeedSmoother> predictionSmoother;
+    int predictionTime = 0;
+    KisPaintInformation lastInputInfo;
+
     qreal effectiveSmoothnessDistance() const;
+    void addPaintJob(FreehandStrokeStrategy::Data *data);
 };
 
+void KisToolFreehandHelper::Private::addPaintJob(FreehandStrokeStrategy::Data *data)
+{
+    hasPaintAtLeastOnce = true;
+
+    if (isBatchingHands) {
+        handsBatch.append(data);
+    } else {
+        strokesFacade->addJob(strokeId, data);
+    }
+}
+
 
 KisToolFreehandHelper::KisToolFreehandHelper(KisPaintingInformationBuilder *infoBuilder,
                                              const KUndo2MagicString &transactionText,
@@ -287,6 +326,27 @@ void KisToolFreehandHelper::initPaintImpl(qreal startAngle,
         m_d->resources->setCurrentNode(overrideNode);
     }
 
+    m_d->recordingDirectory = KisConfig(true).strokeRecordingDirectory();
+    m_d->recording.reset();
+
+    if (!m_d->recordingDirectory.isEmpty()) {
+        KisPaintOpPresetSP preset = m_d->resources->currentPaintOpPreset();
+        m_d->recording.reset(new KisStrokeRecording(startAngle, preset ? preset->name() : QString()));
+        m_d->recording->addEvent(pi);
+    }
+
+    m_d->predictionTime = KisConfig(true).strokePredictionTime();
+    m_d->predictionSmoother.reset();
+    m_d->lastInputInfo = pi;
+
+    if (m_d->predictionTime > 0) {
+        m_d->predictionSmoother.reset(new KisSpeedSmoother());
+        m_d->predictionSmoother->getNextSpeed(pi.pos());
+    }
+
+    KisStrokeSpeedMonitor::instance()->notifyInputStreamStarted();
+    KisStrokeSpeedMonitor::instance()->notifyInputEvent(pi.pos());
+
     const bool airbrushing = m_d->resources->needsAirbrushing();
     const bool useSpacingUpdates = m_d->resources->needsSpacingUpdates();
 
@@ -432,7 +492,23 @@ void KisToolFreehandHelper::paintEvent(KoPointerEvent *event)
     KisPaintInformation info =
             m_d->infoBuilder->continueStroke(event,
                                              elapsedStrokeTime());
+
+    continuePaintImpl(info);
+}
+
+void KisToolFreehandHelper::continuePaintImpl(KisPaintInformation info)
+{
+    if (m_d->recording) {
+        m_d->recording->addEvent(info);
+    }
+
+    if (m_d->predictionSmoother) {
+        m_d->predictionSmoother->getNextSpeed(info.pos());
+    }
+    m_d->lastInputInfo = info;
+
     KisUpdateTimeMonitor::instance()->reportMouseMove(info.pos());
+    KisStrokeSpeedMonitor::instance()->notifyInputEvent(info.pos());
 
     paint(info);
 }
@@ -631,6 +707,23 @@ void KisToolFreehandHelper::endPaint()
 
     m_d->strokesFacade->endStroke(m_d->strokeId);
     m_d->strokeId.clear();
+
+    KisStrokeSpeedMonitor::instance()->notifyInputStreamEnded();
+
+    if (m_d->recording) {
+        /**
+         * Writing a long recording may take a while, so don't keep the
+         * GUI thread busy with it
+         */
+        QSharedPointer<KisStrokeRecording> recording(m_d->recording.take());
+        const QString directory = m_d->recordingDirectory;
+
+        QtConcurrent::run([recording, directory] () {
+            recording->saveToDirectory(directory);
+        });
+    }
+
+    m_d->predictionSmoother.reset();
 }
 
 void KisToolFreehandHelper::cancelPaint()
@@ -661,6 +754,85 @@ void KisToolFreehandHelper::cancelPaint()
     m_d->strokesFacade->cancelStroke(m_d->strokeId);
     m_d->strokeId.clear();
 
+    KisStrokeSpeedMonitor::instance()->notifyInputStreamEnded();
+
+    m_d->recording.reset();
+    m_d->predictionSmoother.reset();
+
+}
+
+QPointF KisToolFreehandHelper::predictStrokeOffset(const QPointF &velocity,
+                                                   qreal predictionTime,
+                                                   qreal timeSinceLastEvent,
+                                                   qreal maxDistance)
+{
+    /**
+     * The events that have already arrived are painted for real, so we
+     * predict only the rest of the prediction interval. When the events
+     * stop coming, the prediction shrinks and disappears completely.
+     */
+    const qreal timeAhead = predictionTime - qBound(0.0, timeSinceLastEvent, predictionTime);
+
+    QPointF offset = velocity * timeAhead;
+    const qreal distance = KisAlgebra2D::norm(offset);
+
+    if (distance < 1.0) return QPointF();
+
+    if (distance > maxDistance) {
+        offset *= maxDistance / distance;
+    }
+
+    return offset;
+}
+
+QPainterPath KisToolFreehandHelper::predictedStrokeOutline() const
+{
+    if (!m_d->predictionSmoother || !m_d->strokeId) return QPainterPath();
+
+    KisPaintOpPresetSP preset = m_d->resources->currentPaintOpPreset();
+    if (!preset) return QPainterPath();
+
+    /**
+     * The outline of the dab is fetched with all the sensors applied, so
+     * the overlay follows the size curves of the preset
+     */
+    KisPaintInformation info = m_d->lastInputInfo;
+    KisDistanceInformation distanceInfo(info.pos(), 0.0);
+    KisPaintInformation::DistanceInformationRegistrar registrar =
+        info.registerDistanceInformation(&distanceInfo);
+
+    info.setRandomSource(m_d->fakeDabRandomSource);
+    info.setPerStrokeRandomSource(m_d->fakeStrokeRandomSource);
+
+    KisPaintOpSettings::OutlineMode mode;
+    mode.isVisible = true;
+    mode.forceCircle = true;
+
+    const QRectF dabRect = preset->settings()->brushOutline(info, mode).boundingRect();
+    const qreal dabSize = qMax(1.0, qMax(dabRect.width(), dabRect.height()));
+
+    const qreal timeSinceLastEvent =
+        m_d->predictionSmoother->currentTime() - m_d->predictionSmoother->lastPointTime();
+
+    const QPointF offset =
+        predictStrokeOffset(m_d->predictionSmoother->lastVelocity(),
+                            m_d->predictionTime,
+                            timeSinceLastEvent,
+                            MAX_PREDICTION_DISTANCE_FACTOR * dabSize);
+
+    if (offset.isNull()) return QPainterPath();
+
+    const QPointF startPos = m_d->lastInputInfo.pos();
+
+    QPainterPath path;
+    path.moveTo(startPos);
+    path.lineTo(startPos + offset);
+
+    QPainterPathStroker stroker;
+    stroker.setWidth(dabSize);
+    stroker.setCapStyle(Qt::RoundCap);
+
+    return stroker.createStroke(path);
 }
 
 int KisToolFreehandHelper::elapsedStrokeTime() const
@@ -885,20 +1057,14 @@ int KisToolFreehandHelper::computeAirbrushTimerInterval() const
 void KisToolFreehandHelper::paintAt(int strokeInfoId,
                                     const KisPaintInformation &pi)
 {
-    m_d->hasPaintAtLeastOnce = true;
-    m_d->strokesFacade->addJob(m_d->strokeId,
-                               new FreehandStrokeStrategy::Data(strokeInfoId, pi));
-
+    m_d->addPaintJob(new FreehandStrokeStrategy::Data(strokeInfoId, pi));
 }
 
 void KisToolFreehandHelper::paintLine(int strokeInfoId,
                                       const KisPaintInformation &pi1,
                                       const KisPaintInformation &pi2)
 {
-    m_d->hasPaintAtLeastOnce = true;
-    m_d->strokesFacade->addJob(m_d->strokeId,
-                               new FreehandStrokeStrategy::Data(strokeInfoId, pi1, pi2));
-
+    m_d->addPaintJob(new FreehandStrokeStrategy::Data(strokeInfoId, pi1, pi2));
 }
 
 void KisToolFreehandHelper::paintBezierCurve(int strokeInfoId,
@@ -931,11 +1097,29 @@ void KisToolFreehandHelper::paintBezierCurve(int strokeInfoId,
     paintLine(tpi1, tpi2);
 #endif
 
-    m_d->hasPaintAtLeastOnce = true;
-    m_d->strokesFacade->addJob(m_d->strokeId,
-                               new FreehandStrokeStrategy::Data(strokeInfoId,
-                                                                pi1, control1, control2, pi2));
+    m_d->addPaintJob(new FreehandStrokeStrategy::Data(strokeInfoId,
+                                                      pi1, control1, control2, pi2));
+}
+
+void KisToolFreehandHelper::beginHandsBatch()
+{
+    KIS_SAFE_ASSERT_RECOVER_NOOP(!m_d->isBatchingHands);
+    KIS_SAFE_ASSERT_RECOVER_NOOP(m_d->handsBatch.isEmpty());
+
+    m_d->isBatchingHands = true;
+}
 
+void KisToolFreehandHelper::endHandsBatch()
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(m_d->isBatchingHands);
+
+    m_d->isBatchingHands = false;
+
+    if (m_d->handsBatch.isEmpty()) return;
+
+    m_d->strokesFacade->addJob(m_d->strokeId,
+                               new FreehandStrokeStrategy::MultihandData(m_d->handsBatch));
+    m_d->handsBatch.clear();
 }
 
 void KisToolFreehandHelper::createPainters(QVector<KisFreehandStrokeInfo*> &strokeInfos,
@@ -84,6 +84,35 @@ public:
                                 const KisPaintOpSettingsSP globalSettings,
                                 KisPaintOpSettings::OutlineMode mode) const;
 
+    /**
+     * Returns the area the stroke is expected to cover during the next
+     * strokePredictionTime() milliseconds, in image pixel coordinates.
+     *
+     * The prediction is extrapolated from the velocity of the tablet
+     * events and is supposed to be painted as a temporary overlay by the
+     * tool. It is recalculated on every new event, so the overlay is
+     * replaced by the real dabs as soon as they are painted. Returns an
+     * empty path if the prediction is disabled in the config or there
+     * is not enough data for it.
+     *
+     * The multi-hand helper returns the prediction for all the hands.
+     */
+    virtual QPainterPath predictedStrokeOutline() const;
+
+    /**
+     * Extrapolates the stroke from the smoothed \p velocity of the
+     * cursor (in pixels per ms) for the part of \p predictionTime that
+     * hasn't passed since the last event yet.
+     *
+     * @return the offset of the predicted end of the stroke from the
+     * position of the last event, not longer than \p maxDistance, or a
+     * null point if the stroke is not expected to move
+     */
+    static QPointF predictStrokeOffset(const QPointF &velocity,
+                                       qreal predictionTime,
+                                       qreal timeSinceLastEvent,
+                                       qreal maxDistance);
+
 Q_SIGNALS:
     /**
      * The signal is emitted when the outline should be updated
@@ -106,6 +135,13 @@ protected:
                        KisNodeSP overrideNode = 0,
                        KisDefaultBoundsBaseSP bounds = 0);
 
+    /**
+     * Paints the next event of the stroke started with initPaintImpl().
+     * Used by paintEvent() and by the stroke replaying code, which feeds
+     * the helper with recorded paint information (see KisStrokeRecording)
+     */
+    void continuePaintImpl(KisPaintInformation info);
+
 protected:
 
     virtual void createPainters(QVector<KisFreehandStrokeInfo*> &strokeInfos,
@@ -125,6 +161,14 @@ protected:
                           const QPointF &control2,
                           const KisPaintInformation &pi2);
 
+    /**
+     * All the primitives painted by the lo-level methods between
+     * beginHandsBatch() and endHandsBatch() are sent to the stroke as a
+     * single job, which lets the stroke render the hands in parallel
+     */
+    void beginHandsBatch();
+    void endHandsBatch();
+
     // hi-level methods for painting primitives
 
     virtual void paintAt(const KisPaintInformation &pi);
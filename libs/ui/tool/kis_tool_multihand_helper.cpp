@@ -46,6 +46,21 @@ void KisToolMultihandHelper::setupTransformations(const QVector<QTransform> &tra
     d->transformations = transformations;
 }
 
+QPainterPath KisToolMultihandHelper::predictedStrokeOutline() const
+{
+    const QPainterPath outline = KisToolFreehandHelper::predictedStrokeOutline();
+    if (outline.isEmpty()) return outline;
+
+    QPainterPath result;
+    result.setFillRule(Qt::WindingFill);
+
+    Q_FOREACH (const QTransform &transform, d->transformations) {
+        result.addPath(transform.map(outline));
+    }
+
+    return result;
+}
+
 void KisToolMultihandHelper::createPainters(QVector<KisFreehandStrokeInfo*> &strokeInfos,
                                             const KisDistanceInformation &startDist)
 {
@@ -83,6 +98,8 @@ void adjustPointInformationRotation(KisPaintInformation &pi, const QTransform &t
 
 void KisToolMultihandHelper::paintAt(const KisPaintInformation &pi)
 {
+    beginHandsBatch();
+
     for (int i = 0; i < d->transformations.size(); i++) {
         const QTransform &transform = d->transformations[i];
         KisPaintInformation __pi = pi;
@@ -90,11 +107,15 @@ void KisToolMultihandHelper::paintAt(const KisPaintInformation &pi)
         adjustPointInformationRotation(__pi, transform);
         paintAt(i, __pi);
     }
+
+    endHandsBatch();
 }
 
 void KisToolMultihandHelper::paintLine(const KisPaintInformation &pi1,
                                        const KisPaintInformation &pi2)
 {
+    beginHandsBatch();
+
     for (int i = 0; i < d->transformations.size(); i++) {
         const QTransform &transform = d->transformations[i];
 
@@ -108,6 +129,8 @@ void KisToolMultihandHelper::paintLine(const KisPaintInformation &pi1,
 
         paintLine(i, __pi1, __pi2);
     }
+
+    endHandsBatch();
 }
 
 void KisToolMultihandHelper::paintBezierCurve(const KisPaintInformation &pi1,
@@ -115,6 +138,8 @@ void KisToolMultihandHelper::paintBezierCurve(const KisPaintInformation &pi1,
                                               const QPointF &control2,
                                               const KisPaintInformation &pi2)
 {
+    beginHandsBatch();
+
     for (int i = 0; i < d->transformations.size(); i++) {
         const QTransform &transform = d->transformations[i];
 
@@ -131,4 +156,6 @@ void KisToolMultihandHelper::paintBezierCurve(const KisPaintInformation &pi1,
 
         paintBezierCurve(i, __pi1, __control1, __control2, __pi2);
     }
+
+    endHandsBatch();
 }
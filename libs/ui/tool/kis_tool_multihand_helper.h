@@ -33,6 +33,8 @@ public:
 
     void setupTransformations(const QVector<QTransform> &transformations);
 
+    QPainterPath predictedStrokeOutline() const override;
+
 protected:
     void createPainters(QVector<KisFreehandStrokeInfo*> &strokeInfos,
                         const KisDistanceInformation &startDist) override;
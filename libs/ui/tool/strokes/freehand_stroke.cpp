@@ -19,6 +19,8 @@
 #include "freehand_stroke.h"
 
 #include <QElapsedTimer>
+#include <QSharedPointer>
+#include <QPolygonF>
 
 #include "kis_canvas_resource_provider.h"
 #include <brushengine/kis_paintop_preset.h>
@@ -47,6 +49,10 @@ struct FreehandStrokeStrategy::Private
         : resources(_resources),
           needsAsynchronousUpdates(_resources->presetNeedsAsynchronousUpdates())
     {
+        if (resources->currentPaintOpPreset()) {
+            brushSize = resources->currentPaintOpPreset()->settings()->paintOpSize();
+        }
+
         if (needsAsynchronousUpdates) {
             timeSinceLastUpdate.start();
         }
@@ -54,8 +60,10 @@ struct FreehandStrokeStrategy::Private
 
     Private(const Private &rhs)
         : randomSource(rhs.randomSource),
+          handRandomSources(rhs.handRandomSources),
           resources(rhs.resources),
-          needsAsynchronousUpdates(rhs.needsAsynchronousUpdates)
+          needsAsynchronousUpdates(rhs.needsAsynchronousUpdates),
+          brushSize(rhs.brushSize)
     {
         if (needsAsynchronousUpdates) {
             timeSinceLastUpdate.start();
@@ -63,6 +71,22 @@ struct FreehandStrokeStrategy::Private
     }
 
     KisStrokeRandomSource randomSource;
+
+    /**
+     * The hands painted sequentially share \p randomSource, exactly as
+     * they always did. The hands painted in parallel cannot share it,
+     * so there the first hand keeps \p randomSource and every other
+     * hand takes its own source from this list. That is, with random
+     * brush options the hands other than the first one may get
+     * different random values when they are painted in parallel.
+     */
+    QVector<KisStrokeRandomSource> handRandomSources;
+
+    const KisStrokeRandomSource& parallelHandRandomSource(int strokeInfoId) const {
+        return strokeInfoId > 0 && strokeInfoId < handRandomSources.size() ?
+            handRandomSources[strokeInfoId] : randomSource;
+    }
+
     KisResourcesSnapshotSP resources;
 
     KisStrokeEfficiencyMeasurer efficiencyMeasurer;
@@ -72,8 +96,74 @@ struct FreehandStrokeStrategy::Private
 
     const bool needsAsynchronousUpdates = false;
     std::mutex updateEntryMutex;
+
+    QVector<QRect> mergedHandsDirtyRects;
+    std::mutex mergedHandsDirtyRectsMutex;
+
+    /**
+     * The hands are painted concurrently only when the areas they may
+     * touch don't overlap. The areas are predicted from the positions
+     * of the primitives grown by the brush size and by the largest
+     * distance the dabs of the stroke have ever reached from them.
+     */
+    qreal brushSize = 0.0;
+    qreal maxDabReach = -1.0;
+    bool parallelHandsDisabled = false;
+
+    void addMergedHandsDirtyRects(const QVector<QRect> &rects) {
+        std::lock_guard<std::mutex> l(mergedHandsDirtyRectsMutex);
+        mergedHandsDirtyRects.append(rects);
+    }
 };
 
+namespace {
+
+bool primitiveBounds(const FreehandStrokeStrategy::Data *d, QRectF *bounds)
+{
+    QPolygonF points;
+
+    switch (d->type) {
+    case FreehandStrokeStrategy::Data::POINT:
+        points << d->pi1.pos();
+        break;
+    case FreehandStrokeStrategy::Data::LINE:
+        points << d->pi1.pos() << d->pi2.pos();
+        break;
+    case FreehandStrokeStrategy::Data::CURVE:
+        // a bezier curve always lies inside the hull of its control points
+        points << d->pi1.pos() << d->control1 << d->control2 << d->pi2.pos();
+        break;
+    default:
+        return false;
+    }
+
+    *bounds = points.boundingRect();
+    return true;
+}
+
+bool rectsIntersect(const QVector<QRect> &rects1, const QVector<QRect> &rects2)
+{
+    Q_FOREACH (const QRect &rc1, rects1) {
+        Q_FOREACH (const QRect &rc2, rects2) {
+            if (rc1.intersects(rc2)) return true;
+        }
+    }
+    return false;
+}
+
+bool handsIntersect(const QVector<QVector<QRect>> &handRects)
+{
+    for (int i = 0; i < handRects.size(); i++) {
+        for (int j = i + 1; j < handRects.size(); j++) {
+            if (rectsIntersect(handRects[i], handRects[j])) return true;
+        }
+    }
+    return false;
+}
+
+}
+
+
 FreehandStrokeStrategy::FreehandStrokeStrategy(KisResourcesSnapshotSP resources,
                                                KisFreehandStrokeInfo *strokeInfo,
                                                const KUndo2MagicString &name)
@@ -91,6 +181,7 @@ FreehandStrokeStrategy::FreehandStrokeStrategy(KisResourcesSnapshotSP resources,
                                     resources, strokeInfos),
       m_d(new Private(resources))
 {
+    m_d->handRandomSources.resize(strokeInfos.size());
     init();
 }
 
@@ -99,6 +190,10 @@ FreehandStrokeStrategy::FreehandStrokeStrategy(const FreehandStrokeStrategy &rhs
       m_d(new Private(*rhs.m_d))
 {
     m_d->randomSource.setLevelOfDetail(levelOfDetail);
+
+    for (auto it = m_d->handRandomSources.begin(); it != m_d->handRandomSources.end(); ++it) {
+        it->setLevelOfDetail(levelOfDetail);
+    }
 }
 
 FreehandStrokeStrategy::~FreehandStrokeStrategy()
@@ -116,6 +211,13 @@ void FreehandStrokeStrategy::init()
     setSupportsWrapAroundMode(true);
     setSupportsMaskingBrush(true);
     setSupportsIndirectPainting(true);
+
+    /**
+     * Asynchronous paintops render their dabs in the update jobs, which
+     * know nothing about merging the hands, so paint them sequentially.
+     */
+    setSupportsParallelHands(!m_d->needsAsynchronousUpdates);
+
     enableJob(KisSimpleStrokeStrategy::JOB_DOSTROKE);
 
     if (m_d->needsAsynchronousUpdates) {
@@ -152,70 +254,10 @@ void FreehandStrokeStrategy::doStrokeCallback(KisStrokeJobData *data)
         tryDoUpdate(d->forceUpdate);
 
     } else if (Data *d = dynamic_cast<Data*>(data)) {
-        KisMaskedFreehandStrokePainter *maskedPainter = this->maskedPainter(d->strokeInfoId);
-
-        KisUpdateTimeMonitor::instance()->reportPaintOpPreset(maskedPainter->preset());
-        KisRandomSourceSP rnd = m_d->randomSource.source();
-        KisPerStrokeRandomSourceSP strokeRnd = m_d->randomSource.perStrokeSource();
-
-        switch(d->type) {
-        case Data::POINT:
-            d->pi1.setRandomSource(rnd);
-            d->pi1.setPerStrokeRandomSource(strokeRnd);
-            maskedPainter->paintAt(d->pi1);
-            m_d->efficiencyMeasurer.addSample(d->pi1.pos());
-            break;
-        case Data::LINE:
-            d->pi1.setRandomSource(rnd);
-            d->pi2.setRandomSource(rnd);
-            d->pi1.setPerStrokeRandomSource(strokeRnd);
-            d->pi2.setPerStrokeRandomSource(strokeRnd);
-            maskedPainter->paintLine(d->pi1, d->pi2);
-            m_d->efficiencyMeasurer.addSample(d->pi2.pos());
-            break;
-        case Data::CURVE:
-            d->pi1.setRandomSource(rnd);
-            d->pi2.setRandomSource(rnd);
-            d->pi1.setPerStrokeRandomSource(strokeRnd);
-            d->pi2.setPerStrokeRandomSource(strokeRnd);
-            maskedPainter->paintBezierCurve(d->pi1,
-                                         d->control1,
-                                         d->control2,
-                                         d->pi2);
-            m_d->efficiencyMeasurer.addSample(d->pi2.pos());
-            break;
-        case Data::POLYLINE:
-            maskedPainter->paintPolyline(d->points, 0, d->points.size());
-            m_d->efficiencyMeasurer.addSamples(d->points);
-            break;
-        case Data::POLYGON:
-            maskedPainter->paintPolygon(d->points);
-            m_d->efficiencyMeasurer.addSamples(d->points);
-            break;
-        case Data::RECT:
-            maskedPainter->paintRect(d->rect);
-            m_d->efficiencyMeasurer.addSample(d->rect.topLeft());
-            m_d->efficiencyMeasurer.addSample(d->rect.topRight());
-            m_d->efficiencyMeasurer.addSample(d->rect.bottomRight());
-            m_d->efficiencyMeasurer.addSample(d->rect.bottomLeft());
-            break;
-        case Data::ELLIPSE:
-            maskedPainter->paintEllipse(d->rect);
-            // TODO: add speed measures
-            break;
-        case Data::PAINTER_PATH:
-            maskedPainter->paintPainterPath(d->path);
-            // TODO: add speed measures
-            break;
-        case Data::QPAINTER_PATH:
-            maskedPainter->drawPainterPath(d->path, d->pen);
-            break;
-        case Data::QPAINTER_PATH_FILL:
-            maskedPainter->drawAndFillPainterPath(d->path, d->pen, d->customColor);
-            break;
-        };
-
+        paintSingleHand(d, true);
         tryDoUpdate();
+    } else if (MultihandData *d = dynamic_cast<MultihandData*>(data)) {
+        paintMultipleHands(d);
     } else {
         KisPainterBasedStrokeStrategy::doStrokeCallback(data);
 
@@ -228,6 +270,208 @@ void FreehandStrokeStrategy::doStrokeCallback(KisStrokeJobData *data)
     }
 }
 
+void FreehandStrokeStrategy::paintHand(Data *d,
+                                       KisRandomSourceSP rnd,
+                                       KisPerStrokeRandomSourceSP strokeRnd,
+                                       bool measureEfficiency)
+{
+    KisMaskedFreehandStrokePainter *maskedPainter = this->maskedPainter(d->strokeInfoId);
+
+    KisUpdateTimeMonitor::instance()->reportPaintOpPreset(maskedPainter->preset());
+
+    switch(d->type) {
+    case Data::POINT:
+        d->pi1.setRandomSource(rnd);
+        d->pi1.setPerStrokeRandomSource(strokeRnd);
+        maskedPainter->paintAt(d->pi1);
+        if (measureEfficiency) m_d->efficiencyMeasurer.addSample(d->pi1.pos());
+        break;
+    case Data::LINE:
+        d->pi1.setRandomSource(rnd);
+        d->pi2.setRandomSource(rnd);
+        d->pi1.setPerStrokeRandomSource(strokeRnd);
+        d->pi2.setPerStrokeRandomSource(strokeRnd);
+        maskedPainter->paintLine(d->pi1, d->pi2);
+        if (measureEfficiency) m_d->efficiencyMeasurer.addSample(d->pi2.pos());
+        break;
+    case Data::CURVE:
+        d->pi1.setRandomSource(rnd);
+        d->pi2.setRandomSource(rnd);
+        d->pi1.setPerStrokeRandomSource(strokeRnd);
+        d->pi2.setPerStrokeRandomSource(strokeRnd);
+        maskedPainter->paintBezierCurve(d->pi1,
+                                        d->control1,
+                                        d->control2,
+                                        d->pi2);
+        if (measureEfficiency) m_d->efficiencyMeasurer.addSample(d->pi2.pos());
+        break;
+    case Data::POLYLINE:
+        maskedPainter->paintPolyline(d->points, 0, d->points.size());
+        if (measureEfficiency) m_d->efficiencyMeasurer.addSamples(d->points);
+        break;
+    case Data::POLYGON:
+        maskedPainter->paintPolygon(d->points);
+        if (measureEfficiency) m_d->efficiencyMeasurer.addSamples(d->points);
+        break;
+    case Data::RECT:
+        maskedPainter->paintRect(d->rect);
+        if (measureEfficiency) {
+            m_d->efficiencyMeasurer.addSample(d->rect.topLeft());
+            m_d->efficiencyMeasurer.addSample(d->rect.topRight());
+            m_d->efficiencyMeasurer.addSample(d->rect.bottomRight());
+            m_d->efficiencyMeasurer.addSample(d->rect.bottomLeft());
+        }
+        break;
+    case Data::ELLIPSE:
+        maskedPainter->paintEllipse(d->rect);
+        // TODO: add speed measures
+        break;
+    case Data::PAINTER_PATH:
+        maskedPainter->paintPainterPath(d->path);
+        // TODO: add speed measures
+        break;
+    case Data::QPAINTER_PATH:
+        maskedPainter->drawPainterPath(d->path, d->pen);
+        break;
+    case Data::QPAINTER_PATH_FILL:
+        maskedPainter->drawAndFillPainterPath(d->path, d->pen, d->customColor);
+        break;
+    };
+}
+
+void FreehandStrokeStrategy::paintSingleHand(Data *d, bool measureEfficiency)
+{
+    const KisStrokeRandomSource &randomSource = m_d->randomSource;
+
+    if (!needsHandDevicesMerging()) {
+        paintHand(d, randomSource.source(), randomSource.perStrokeSource(), measureEfficiency);
+        return;
+    }
+
+    prepareHandDevice(d->strokeInfoId);
+    paintHand(d, randomSource.source(), randomSource.perStrokeSource(), measureEfficiency);
+
+    const QVector<QRect> rects = maskedPainter(d->strokeInfoId)->takeDirtyRegion();
+    updateMaxDabReach(d, rects);
+    mergeHandDevice(d->strokeInfoId, rects);
+    m_d->addMergedHandsDirtyRects(rects);
+}
+
+bool FreehandStrokeStrategy::predictHandRect(const Data *d, QRect *rect) const
+{
+    QRectF bounds;
+    if (m_d->maxDabReach < 0 || !primitiveBounds(d, &bounds)) return false;
+
+    /**
+     * The size of the dabs may grow along the stroke, e.g. with pressure,
+     * so keep a generous safety margin around the reach seen so far
+     */
+    const qreal margin = qMax(2.0 * m_d->maxDabReach, m_d->brushSize) + 2.0;
+    *rect = bounds.adjusted(-margin, -margin, margin, margin).toAlignedRect();
+    return true;
+}
+
+void FreehandStrokeStrategy::updateMaxDabReach(const Data *d, const QVector<QRect> &rects)
+{
+    QRectF bounds;
+    if (!primitiveBounds(d, &bounds)) return;
+
+    m_d->maxDabReach = qMax(m_d->maxDabReach, 0.0);
+
+    Q_FOREACH (const QRect &rc, rects) {
+        const QRectF rcF(rc);
+        m_d->maxDabReach = qMax(m_d->maxDabReach,
+                                qMax(qMax(bounds.left() - rcF.left(), rcF.right() - bounds.right()),
+                                     qMax(bounds.top() - rcF.top(), rcF.bottom() - bounds.bottom())));
+    }
+}
+
+bool FreehandStrokeStrategy::canPaintHandsInParallel(const MultihandData *d) const
+{
+    if (!needsHandDevicesMerging() || m_d->parallelHandsDisabled) return false;
+
+    // the wrapped dabs may appear anywhere on the image
+    if (targetDevice()->defaultBounds()->wrapAroundMode()) return false;
+
+    QVector<QVector<QRect>> predictedRects;
+
+    Q_FOREACH (const Data *hand, d->hands) {
+        QRect rc;
+        if (!predictHandRect(hand, &rc)) return false;
+        predictedRects.append(QVector<QRect>() << rc);
+    }
+
+    return !handsIntersect(predictedRects);
+}
+
+void FreehandStrokeStrategy::paintMultipleHands(MultihandData *d)
+{
+    if (!canPaintHandsInParallel(d)) {
+        for (int i = 0; i < d->hands.size(); i++) {
+            paintSingleHand(d->hands[i], i == 0);
+        }
+        tryDoUpdate();
+        return;
+    }
+
+    QVector<KisRunnableStrokeJobData*> jobs;
+    QVector<QSharedPointer<Data>> hands;
+
+    /**
+     * The job data is destroyed right after this callback returns, so
+     * the runnable jobs take the ownership over the hands
+     */
+    for (int i = 0; i < d->hands.size(); i++) {
+        QSharedPointer<Data> hand(d->hands[i]);
+        const KisStrokeRandomSource &randomSource = m_d->parallelHandRandomSource(hand->strokeInfoId);
+        KisRandomSourceSP rnd = randomSource.source();
+        KisPerStrokeRandomSourceSP strokeRnd = randomSource.perStrokeSource();
+        const bool measureEfficiency = i == 0;
+
+        jobs.append(new KisRunnableStrokeJobData(
+            [this, hand, rnd, strokeRnd, measureEfficiency] () {
+                this->prepareHandDevice(hand->strokeInfoId);
+                this->paintHand(hand.data(), rnd, strokeRnd, measureEfficiency);
+            },
+            KisStrokeJobData::CONCURRENT));
+
+        hands.append(hand);
+    }
+    d->hands.clear();
+
+    /**
+     * The hands are merged in a single sequential job in the same order
+     * as they would be painted sequentially. When the prediction of
+     * the painted areas failed and the hands touched the same pixels,
+     * the later hand overwrites the earlier one in the shared area, and
+     * the rest of the stroke is painted sequentially.
+     */
+    jobs.append(new KisRunnableStrokeJobData(
+        [this, hands] () {
+            QVector<QVector<QRect>> handRects;
+
+            Q_FOREACH (QSharedPointer<Data> hand, hands) {
+                handRects.append(this->maskedPainter(hand->strokeInfoId)->takeDirtyRegion());
+            }
+
+            if (handsIntersect(handRects)) {
+                dbgKrita << "FreehandStrokeStrategy: the hands painted in parallel overlapped, falling back to sequential painting";
+                m_d->parallelHandsDisabled = true;
+            }
+
+            for (int i = 0; i < hands.size(); i++) {
+                this->updateMaxDabReach(hands[i].data(), handRects[i]);
+                this->mergeHandDevice(hands[i]->strokeInfoId, handRects[i]);
+                m_d->addMergedHandsDirtyRects(handRects[i]);
+            }
+
+            this->tryDoUpdate();
+        },
+        KisStrokeJobData::SEQUENTIAL));
+
+    runnableJobsInterface()->addRunnableJobs(jobs);
+}
+
 void FreehandStrokeStrategy::tryDoUpdate(bool forceEnd)
 {
     // we should enter this function only once!
@@ -285,9 +529,22 @@ void FreehandStrokeStrategy::issueSetDirtySignals()
 {
     QVector<QRect> dirtyRects;
 
-    for (int i = 0; i < numMaskedPainters(); i++) {
-        KisMaskedFreehandStrokePainter *maskedPainter = this->maskedPainter(i);
-        dirtyRects.append(maskedPainter->takeDirtyRegion());
+    /**
+     * When the hands paint on their own devices, their dirty regions
+     * are taken by the merging job only. Otherwise the pixels that
+     * are not merged yet would be reported as updated.
+     */
+    if (!needsHandDevicesMerging()) {
+        for (int i = 0; i < numMaskedPainters(); i++) {
+            KisMaskedFreehandStrokePainter *maskedPainter = this->maskedPainter(i);
+            dirtyRects.append(maskedPainter->takeDirtyRegion());
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> l(m_d->mergedHandsDirtyRectsMutex);
+        dirtyRects.append(m_d->mergedHandsDirtyRects);
+        m_d->mergedHandsDirtyRects.clear();
     }
 
     if (needsMaskingUpdates()) {
@@ -176,6 +176,42 @@ public:
         KoColor customColor;
     };
 
+    /**
+     * A set of primitives painted by all the hands of a multi-hand
+     * stroke at once. When the stroke supports parallel hands and the
+     * hands cannot touch the same pixels, every primitive is rendered in
+     * a separate concurrent job and the results are merged into the
+     * target device in the order of the hands. Otherwise the hands are
+     * painted one by one, exactly as if they were sent as separate jobs.
+     */
+    class MultihandData : public KisStrokeJobData {
+    public:
+        MultihandData(const QVector<Data*> &_hands)
+            : KisStrokeJobData(KisStrokeJobData::UNIQUELY_CONCURRENT),
+              hands(_hands)
+        {}
+
+        ~MultihandData() override {
+            qDeleteAll(hands);
+        }
+
+        KisStrokeJobData* createLodClone(int levelOfDetail) override {
+            return new MultihandData(*this, levelOfDetail);
+        }
+
+    private:
+        MultihandData(const MultihandData &rhs, int levelOfDetail)
+            : KisStrokeJobData(rhs)
+        {
+            Q_FOREACH (Data *hand, rhs.hands) {
+                hands.append(static_cast<Data*>(hand->createLodClone(levelOfDetail)));
+            }
+        }
+
+    public:
+        QVector<Data*> hands;
+    };
+
 public:
     FreehandStrokeStrategy(KisResourcesSnapshotSP resources,
                            KisFreehandStrokeInfo *strokeInfo,
@@ -203,6 +239,15 @@ protected:
 private:
     void init();
 
+    void paintHand(Data *d, KisRandomSourceSP rnd, KisPerStrokeRandomSourceSP strokeRnd,
+                   bool measureEfficiency);
+    void paintSingleHand(Data *d, bool measureEfficiency);
+    void paintMultipleHands(MultihandData *d);
+
+    bool predictHandRect(const Data *d, QRect *rect) const;
+    void updateMaxDabReach(const Data *d, const QVector<QRect> &rects);
+    bool canPaintHandsInParallel(const MultihandData *d) const;
+
     void tryDoUpdate(bool forceEnd = false);
     void issueSetDirtySignals();
 
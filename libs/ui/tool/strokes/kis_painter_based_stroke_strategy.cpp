@@ -46,7 +46,8 @@ KisPainterBasedStrokeStrategy::KisPainterBasedStrokeStrategy(const QLatin1String
       m_transaction(0),
       m_useMergeID(useMergeID),
       m_supportsMaskingBrush(false),
-      m_supportsIndirectPainting(false)
+      m_supportsIndirectPainting(false),
+      m_supportsParallelHands(false)
 {
     init();
 }
@@ -61,7 +62,8 @@ KisPainterBasedStrokeStrategy::KisPainterBasedStrokeStrategy(const QLatin1String
       m_transaction(0),
       m_useMergeID(useMergeID),
       m_supportsMaskingBrush(false),
-      m_supportsIndirectPainting(false)
+      m_supportsIndirectPainting(false),
+      m_supportsParallelHands(false)
 {
     init();
 }
@@ -86,7 +88,8 @@ KisPainterBasedStrokeStrategy::KisPainterBasedStrokeStrategy(const KisPainterBas
       m_transaction(rhs.m_transaction),
       m_useMergeID(rhs.m_useMergeID),
       m_supportsMaskingBrush(rhs.m_supportsMaskingBrush),
-      m_supportsIndirectPainting(rhs.m_supportsIndirectPainting)
+      m_supportsIndirectPainting(rhs.m_supportsIndirectPainting),
+      m_supportsParallelHands(rhs.m_supportsParallelHands)
 {
     Q_FOREACH (KisFreehandStrokeInfo *info, rhs.m_strokeInfos) {
         m_strokeInfos.append(new KisFreehandStrokeInfo(info, levelOfDetail));
@@ -97,6 +100,7 @@ KisPainterBasedStrokeStrategy::KisPainterBasedStrokeStrategy(const KisPainterBas
         !rhs.m_transaction &&
         !rhs.m_targetDevice &&
         !rhs.m_activeSelection &&
+        rhs.m_handDevices.isEmpty() &&
         "After the stroke has been started, no copying must happen");
 }
 
@@ -141,6 +145,42 @@ QVector<KisRunnableStrokeJobData *> KisPainterBasedStrokeStrategy::doMaskingBrus
     return jobs;
 }
 
+bool KisPainterBasedStrokeStrategy::needsHandDevicesMerging() const
+{
+    return !m_handDevices.isEmpty();
+}
+
+void KisPainterBasedStrokeStrategy::prepareHandDevice(int strokeInfoId)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(strokeInfoId >= 0 && strokeInfoId < m_handDevices.size());
+
+    KisPaintDeviceSP handDevice = m_handDevices[strokeInfoId];
+    QVector<QRect> &staleRects = m_handStaleRects[strokeInfoId];
+
+    Q_FOREACH (const QRect &rc, staleRects) {
+        KisPainter::copyAreaOptimized(rc.topLeft(), m_targetDevice, handDevice, rc);
+    }
+
+    staleRects.clear();
+}
+
+void KisPainterBasedStrokeStrategy::mergeHandDevice(int strokeInfoId, const QVector<QRect> &rects)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(strokeInfoId >= 0 && strokeInfoId < m_handDevices.size());
+
+    KisPaintDeviceSP handDevice = m_handDevices[strokeInfoId];
+
+    Q_FOREACH (const QRect &rc, rects) {
+        KisPainter::copyAreaOptimized(rc.topLeft(), handDevice, m_targetDevice, rc);
+    }
+
+    for (int i = 0; i < m_handStaleRects.size(); i++) {
+        if (i != strokeInfoId) {
+            m_handStaleRects[i].append(rects);
+        }
+    }
+}
+
 void KisPainterBasedStrokeStrategy::setSupportsMaskingBrush(bool value)
 {
     m_supportsMaskingBrush = value;
@@ -161,16 +201,47 @@ bool KisPainterBasedStrokeStrategy::supportsIndirectPainting() const
     return m_supportsIndirectPainting;
 }
 
+void KisPainterBasedStrokeStrategy::setSupportsParallelHands(bool value)
+{
+    m_supportsParallelHands = value;
+}
+
+bool KisPainterBasedStrokeStrategy::supportsParallelHands() const
+{
+    return m_supportsParallelHands;
+}
+
 void KisPainterBasedStrokeStrategy::initPainters(KisPaintDeviceSP targetDevice,
                                                  KisPaintDeviceSP maskingDevice,
                                                  KisSelectionSP selection,
                                                  bool hasIndirectPainting,
                                                  const QString &indirectPaintingCompositeOp)
 {
-    Q_FOREACH (KisFreehandStrokeInfo *info, m_strokeInfos) {
-        KisPainter *painter = info->painter;
+    /**
+     * Every hand of a multi-hand stroke paints on its own copy of the
+     * target device, so the hands never write into the same tiles
+     * concurrently. The pixels painted by a hand are copied back into
+     * the target with mergeHandDevice(), and the other copies catch up
+     * with them in prepareHandDevice() before the next painting.
+     */
+    const bool useHandDevices =
+        supportsParallelHands() &&
+        hasIndirectPainting &&
+        !maskingDevice &&
+        m_strokeInfos.size() > 1;
+
+    if (useHandDevices) {
+        for (int i = 0; i < m_strokeInfos.size(); i++) {
+            m_handDevices.append(new KisPaintDevice(*targetDevice));
+        }
+        m_handStaleRects.resize(m_strokeInfos.size());
+    }
+
+    for (int i = 0; i < m_strokeInfos.size(); i++) {
+        KisPainter *painter = m_strokeInfos[i]->painter;
+        KisPaintDeviceSP paintingDevice = useHandDevices ? m_handDevices[i] : targetDevice;
 
-        painter->begin(targetDevice, !hasIndirectPainting ? selection : 0);
+        painter->begin(paintingDevice, !hasIndirectPainting ? selection : 0);
         painter->setRunnableStrokeJobsInterface(runnableJobsInterface());
         m_resources->setupPainter(painter);
 
@@ -223,6 +294,9 @@ void KisPainterBasedStrokeStrategy::deletePainters()
     }
 
     m_maskedPainters.clear();
+
+    m_handDevices.clear();
+    m_handStaleRects.clear();
 }
 
 void KisPainterBasedStrokeStrategy::initStrokeCallback()
@@ -88,6 +88,33 @@ protected:
      */
     QVector<KisRunnableStrokeJobData*> doMaskingBrushUpdates(const QVector<QRect> &rects);
 
+    /**
+     * Return true if every stroke info (hand) of the stroke paints into
+     * its own copy of the target device instead of the shared target
+     * device. In such a case the descendant must call prepareHandDevice()
+     * before painting with the hand and mergeHandDevice() after that,
+     * before issuing the setDirty() call on the layer.
+     *
+     * \see setSupportsParallelHands()
+     */
+    bool needsHandDevicesMerging() const;
+
+    /**
+     * Bring the copy of the target device owned by the hand \p strokeInfoId
+     * up to date with the areas merged by the other hands. The hands
+     * can be prepared concurrently, but not while any hand is merged.
+     */
+    void prepareHandDevice(int strokeInfoId);
+
+    /**
+     * Copy \p rects of the device of the hand \p strokeInfoId into the
+     * shared target device. Painting with a hand on its prepared device
+     * and merging it gives exactly the same pixels as painting directly on
+     * the target, as long as the hands painted concurrently don't touch
+     * the same pixels. Must be called sequentially.
+     */
+    void mergeHandDevice(int strokeInfoId, const QVector<QRect> &rects);
+
 protected:
 
     /**
@@ -105,6 +132,16 @@ protected:
     void setSupportsIndirectPainting(bool value);
     bool supportsIndirectPainting() const;
 
+    /**
+     * The descendants may declare if the hands of a multi-hand stroke are
+     * allowed to paint into separate copies of the target device, so that
+     * they could be rendered in parallel. The mode is activated only when the stroke has more than
+     * one hand, uses indirect painting and has no masking brush. Default
+     * value: false
+     */
+    void setSupportsParallelHands(bool value);
+    bool supportsParallelHands() const;
+
 protected:
     KisPainterBasedStrokeStrategy(const KisPainterBasedStrokeStrategy &rhs, int levelOfDetail);
 
@@ -129,12 +166,16 @@ private:
 
     QScopedPointer<KisMaskingBrushRenderer> m_maskingBrushRenderer;
 
+    QVector<KisPaintDeviceSP> m_handDevices;
+    QVector<QVector<QRect>> m_handStaleRects;
+
     KisPaintDeviceSP m_targetDevice;
     KisSelectionSP m_activeSelection;
     bool m_useMergeID;
 
     bool m_supportsMaskingBrush;
     bool m_supportsIndirectPainting;
+    bool m_supportsParallelHands;
 };
 
 #endif /* __KIS_PAINTER_BASED_STROKE_STRATEGY_H */
@@ -25,6 +25,7 @@
 #include <klocalizedstring.h>
 
 #include "LcmsColorSpace.h"
+#include "LcmsMatrixShaperTransformationFactory.h"
 
 // -- KoLcmsColorConversionTransformation --
 
@@ -150,6 +151,7 @@ private:
 };
 
 struct IccColorSpaceEngine::Private {
+    LcmsMatrixShaperTransformationFactory matrixShaperFactory;
 };
 
 IccColorSpaceEngine::IccColorSpaceEngine() : KoColorSpaceEngine("icc", i18n("ICC Engine")), d(new Private)
@@ -230,6 +232,17 @@ KoColorConversionTransformation *IccColorSpaceEngine::createColorTransformation(
     Q_ASSERT(srcColorSpace);
     Q_ASSERT(dstColorSpace);
 
+    /**
+     * Conversions between matrix-shaper RGB and Gray profiles are
+     * done without lcms
+     */
+    KoColorConversionTransformation *fastTransformation =
+        d->matrixShaperFactory.createColorTransformation(srcColorSpace, dstColorSpace,
+                                                         renderingIntent, conversionFlags);
+    if (fastTransformation) {
+        return fastTransformation;
+    }
+
     return new KoLcmsColorConversionTransformation(
                 srcColorSpace, computeColorSpaceType(srcColorSpace),
                 dynamic_cast<const IccColorProfile *>(srcColorSpace->profile())->asLcms(), dstColorSpace, computeColorSpaceType(dstColorSpace),
@@ -24,8 +24,10 @@
 
 #include <colorprofiles/LcmsColorProfileContainer.h>
 #include <KoColorSpaceAbstract.h>
+#include <QAtomicPointer>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QVector>
 
 #include "kis_assert.h"
 
@@ -156,18 +158,41 @@ class LcmsColorSpace : public KoColorSpaceAbstract<_CSTraits>, public KoLcmsInfo
         cmsHTRANSFORM cmsAlphaTransform;
     };
 
+    /**
+     * Transformations to and from a custom RGB profile passed to
+     * fromQColor()/toQColor()
+     */
+    struct ProfileTransforms {
+        cmsHPROFILE profile;
+        cmsHTRANSFORM toRGB;
+        cmsHTRANSFORM fromRGB;
+    };
+
+    typedef QVector<ProfileTransforms> ProfileTransformsList;
+
     struct Private {
-        mutable quint8 *qcolordata; // A small buffer for conversion from and to qcolor.
         KoLcmsDefaultTransformations *defaultTransformations;
 
-        mutable cmsHPROFILE   lastRGBProfile;  // Last used profile to transform to/from RGB
-        mutable cmsHTRANSFORM lastToRGB;       // Last used transform to transform to RGB
-        mutable cmsHTRANSFORM lastFromRGB;     // Last used transform to transform from RGB
+        /**
+         * The published list is never modified, a new copy is published
+         * instead, so the list can be read without locking. lcms transforms
+         * themselves are safe to use from multiple threads. Replaced copies
+         * are kept till the destruction of the color space, because other
+         * threads may still be reading them.
+         */
+        QAtomicPointer<ProfileTransformsList> profileTransforms;
+        QVector<ProfileTransformsList*> retiredProfileTransforms;
+        QMutex profileTransformsMutex;
+
         LcmsColorProfileContainer *profile;
         KoColorProfile *colorProfile;
-        QMutex mutex;
     };
 
+    /**
+     * The size of the stack buffers used by the batch QColor conversions
+     */
+    static const int qcolorBatchSize = 256;
+
 protected:
 
     LcmsColorSpace(const QString &id,
@@ -184,27 +209,32 @@ protected:
         d->profile = asLcmsProfile(p);
         Q_ASSERT(d->profile);
         d->colorProfile = p;
-        d->qcolordata = 0;
-        d->lastRGBProfile = 0;
-        d->lastToRGB = 0;
-        d->lastFromRGB = 0;
         d->defaultTransformations = 0;
     }
 
     ~LcmsColorSpace() override
     {
+        ProfileTransformsList *transforms = d->profileTransforms.load();
+        if (transforms) {
+            Q_FOREACH (const ProfileTransforms &t, *transforms) {
+                if (t.toRGB) {
+                    cmsDeleteTransform(t.toRGB);
+                }
+                if (t.fromRGB) {
+                    cmsDeleteTransform(t.fromRGB);
+                }
+            }
+            delete transforms;
+        }
+        qDeleteAll(d->retiredProfileTransforms);
+
         delete d->colorProfile;
-        delete[] d->qcolordata;
         delete d->defaultTransformations;
         delete d;
     }
 
     void init()
     {
-        // Default pixel buffer for QColor conversion
-        d->qcolordata = new quint8[3];
-        Q_CHECK_PTR(d->qcolordata);
-
         KIS_ASSERT(d->profile);
 
         if (KoLcmsDefaultTransformations::s_RGBProfile == 0) {
@@ -252,55 +282,65 @@ public:
 
     void fromQColor(const QColor &color, quint8 *dst, const KoColorProfile *koprofile = 0) const override
     {
-        QMutexLocker locker(&d->mutex);
-        d->qcolordata[2] = color.red();
-        d->qcolordata[1] = color.green();
-        d->qcolordata[0] = color.blue();
+        fromQColors(&color, dst, 1, koprofile);
+    }
 
-        LcmsColorProfileContainer *profile = asLcmsProfile(koprofile);
-        if (profile == 0) {
-            // Default sRGB
-            KIS_ASSERT(d->defaultTransformations && d->defaultTransformations->fromRGB);
+    void toQColor(const quint8 *src, QColor *c, const KoColorProfile *koprofile = 0) const override
+    {
+        toQColors(src, c, 1, koprofile);
+    }
 
-            cmsDoTransform(d->defaultTransformations->fromRGB, d->qcolordata, dst, 1);
-        } else {
-            if (d->lastFromRGB == 0 || (d->lastFromRGB != 0 && d->lastRGBProfile != profile->lcmsProfile())) {
-                d->lastFromRGB = cmsCreateTransform(profile->lcmsProfile(),
-                                                    TYPE_BGR_8,
-                                                    d->profile->lcmsProfile(),
-                                                    this->colorSpaceType(),
-                                                    KoColorConversionTransformation::internalRenderingIntent(),
-                                                    KoColorConversionTransformation::internalConversionFlags());
-                d->lastRGBProfile = profile->lcmsProfile();
+    void fromQColors(const QColor *colors, quint8 *dst, int numColors, const KoColorProfile *koprofile = 0) const override
+    {
+        cmsHTRANSFORM transform = fromRGBTransform(koprofile);
+        KIS_ASSERT(transform);
+
+        quint8 rgb[3 * qcolorBatchSize];
+        const int pixelSize = this->pixelSize();
+
+        while (numColors > 0) {
+            const int batchSize = qMin(numColors, qcolorBatchSize);
 
+            for (int i = 0; i < batchSize; i++) {
+                rgb[3 * i + 2] = colors[i].red();
+                rgb[3 * i + 1] = colors[i].green();
+                rgb[3 * i + 0] = colors[i].blue();
             }
-            KIS_ASSERT(d->lastFromRGB);
-            cmsDoTransform(d->lastFromRGB, d->qcolordata, dst, 1);
-        }
 
-        this->setOpacity(dst, (quint8)(color.alpha()), 1);
+            cmsDoTransform(transform, rgb, dst, batchSize);
+
+            for (int i = 0; i < batchSize; i++) {
+                this->setOpacity(dst + i * pixelSize, (quint8)(colors[i].alpha()), 1);
+            }
+
+            colors += batchSize;
+            dst += batchSize * pixelSize;
+            numColors -= batchSize;
+        }
     }
 
-    void toQColor(const quint8 *src, QColor *c, const KoColorProfile *koprofile = 0) const override
+    void toQColors(const quint8 *src, QColor *colors, int numColors, const KoColorProfile *koprofile = 0) const override
     {
-        QMutexLocker locker(&d->mutex);
-        LcmsColorProfileContainer *profile = asLcmsProfile(koprofile);
-        if (profile == 0) {
-            // Default sRGB transform
-            Q_ASSERT(d->defaultTransformations && d->defaultTransformations->toRGB);
-            cmsDoTransform(d->defaultTransformations->toRGB, const_cast <quint8 *>(src), d->qcolordata, 1);
-        } else {
-            if (d->lastToRGB == 0 || (d->lastToRGB != 0 && d->lastRGBProfile != profile->lcmsProfile())) {
-                d->lastToRGB = cmsCreateTransform(d->profile->lcmsProfile(), this->colorSpaceType(),
-                                                  profile->lcmsProfile(), TYPE_BGR_8,
-                                                  KoColorConversionTransformation::internalRenderingIntent(),
-                                                  KoColorConversionTransformation::internalConversionFlags());
-                d->lastRGBProfile = profile->lcmsProfile();
+        cmsHTRANSFORM transform = toRGBTransform(koprofile);
+        KIS_ASSERT(transform);
+
+        quint8 rgb[3 * qcolorBatchSize];
+        const int pixelSize = this->pixelSize();
+
+        while (numColors > 0) {
+            const int batchSize = qMin(numColors, qcolorBatchSize);
+
+            cmsDoTransform(transform, const_cast<quint8 *>(src), rgb, batchSize);
+
+            for (int i = 0; i < batchSize; i++) {
+                colors[i].setRgb(rgb[3 * i + 2], rgb[3 * i + 1], rgb[3 * i + 0]);
+                colors[i].setAlpha(this->opacityU8(src + i * pixelSize));
             }
-            cmsDoTransform(d->lastToRGB, const_cast <quint8 *>(src), d->qcolordata, 1);
+
+            colors += batchSize;
+            src += batchSize * pixelSize;
+            numColors -= batchSize;
         }
-        c->setRgb(d->qcolordata[2], d->qcolordata[1], d->qcolordata[0]);
-        c->setAlpha(this->opacityU8(src));
     }
 
     KoColorTransformation *createBrightnessContrastAdjustment(const quint16 *transferValues) const override
@@ -452,6 +492,85 @@ private:
         return iccp->asLcms();
     }
 
+    cmsHTRANSFORM fromRGBTransform(const KoColorProfile *koprofile) const
+    {
+        LcmsColorProfileContainer *profile = asLcmsProfile(koprofile);
+        if (profile == 0) {
+            // Default sRGB
+            KIS_ASSERT(d->defaultTransformations);
+            return d->defaultTransformations->fromRGB;
+        }
+
+        return profileTransforms(profile->lcmsProfile())->fromRGB;
+    }
+
+    cmsHTRANSFORM toRGBTransform(const KoColorProfile *koprofile) const
+    {
+        LcmsColorProfileContainer *profile = asLcmsProfile(koprofile);
+        if (profile == 0) {
+            // Default sRGB
+            KIS_ASSERT(d->defaultTransformations);
+            return d->defaultTransformations->toRGB;
+        }
+
+        return profileTransforms(profile->lcmsProfile())->toRGB;
+    }
+
+    static const ProfileTransforms* findProfileTransforms(const ProfileTransformsList *list, cmsHPROFILE profile)
+    {
+        if (list) {
+            for (auto it = list->constBegin(); it != list->constEnd(); ++it) {
+                if (it->profile == profile) {
+                    return &(*it);
+                }
+            }
+        }
+        return 0;
+    }
+
+    const ProfileTransforms* profileTransforms(cmsHPROFILE profile) const
+    {
+        const ProfileTransforms *transforms =
+            findProfileTransforms(d->profileTransforms.loadAcquire(), profile);
+
+        if (transforms) return transforms;
+
+        QMutexLocker locker(&d->profileTransformsMutex);
+
+        ProfileTransformsList *oldList = d->profileTransforms.loadAcquire();
+
+        // some other thread might have created the transforms already
+        transforms = findProfileTransforms(oldList, profile);
+        if (transforms) return transforms;
+
+        ProfileTransforms newTransforms;
+        newTransforms.profile = profile;
+        newTransforms.fromRGB = cmsCreateTransform(profile,
+                                                   TYPE_BGR_8,
+                                                   d->profile->lcmsProfile(),
+                                                   this->colorSpaceType(),
+                                                   KoColorConversionTransformation::internalRenderingIntent(),
+                                                   KoColorConversionTransformation::internalConversionFlags());
+        newTransforms.toRGB = cmsCreateTransform(d->profile->lcmsProfile(),
+                                                 this->colorSpaceType(),
+                                                 profile,
+                                                 TYPE_BGR_8,
+                                                 KoColorConversionTransformation::internalRenderingIntent(),
+                                                 KoColorConversionTransformation::internalConversionFlags());
+
+        ProfileTransformsList *newList =
+            oldList ? new ProfileTransformsList(*oldList) : new ProfileTransformsList();
+        newList->append(newTransforms);
+        transforms = &newList->at(newList->size() - 1);
+
+        if (oldList) {
+            d->retiredProfileTransforms.append(oldList);
+        }
+        d->profileTransforms.storeRelease(newList);
+
+        return transforms;
+    }
+
     Private *const d;
 };
 
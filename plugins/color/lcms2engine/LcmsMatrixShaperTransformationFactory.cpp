@@ -0,0 +1,684 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "LcmsMatrixShaperTransformationFactory.h"
+
+#include <cmath>
+#include <limits>
+
+#include <lcms2.h>
+
+#include <QScopedPointer>
+#include <QVector>
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceMaths.h>
+#include <KoColorModelStandardIds.h>
+#include <KoBgrColorSpaceTraits.h>
+#include <KoRgbColorSpaceTraits.h>
+#include <KoGrayColorSpaceTraits.h>
+
+#include "colorprofiles/IccColorProfile.h"
+#include "colorprofiles/LcmsColorProfileContainer.h"
+
+#include "kis_assert.h"
+
+namespace {
+
+/**
+ * The number of pixels converted in one pass. The planar buffers
+ * for a block should fit into L1 cache.
+ */
+const int pixelBlockSize = 256;
+
+/**
+ * Tables used for interpolation of the curves for 16-bit and float
+ * pixels and for encoding of linear values. 8-bit pixels use a table
+ * of 256 entries directly.
+ *
+ * A full table for 16-bit pixels would take 256 KiB per channel, which
+ * is too much for the transformations cached per thread, so they are
+ * interpolated as well.
+ */
+const int linearizationTableSize = 4096;
+const int encodingTableSize = 4096;
+
+/**
+ * If the source and destination profiles have the same primaries,
+ * the combined matrix is skipped
+ */
+const qreal identityMatrixThreshold = 1e-6;
+
+/**
+ * If the tone curves of both profiles map zero to zero, the black
+ * point compensation is a no-op
+ */
+const float zeroBlackThreshold = 1e-5;
+
+/**
+ * A tone curve of a profile and its lookup table. The table keeps
+ * either the linearized values, or the encoded ones, depending on the
+ * side of the conversion the curve is used for.
+ *
+ * A null curve is an identity one.
+ */
+struct ShaperCurve
+{
+    ShaperCurve() {}
+
+    ~ShaperCurve() {
+        if (curve) {
+            cmsFreeToneCurve(curve);
+        }
+    }
+
+    /**
+     * Samples the curve in \p tableSize uniformly distributed points of
+     * [0, 1] range. 8-bit sources use the table directly, 16-bit and
+     * float sources interpolate it.
+     */
+    void initLinearization(const cmsToneCurve *srcCurve, int tableSize) {
+        isLinear = !srcCurve || cmsIsToneCurveLinear(srcCurve);
+        curve = srcCurve ? cmsDupToneCurve(srcCurve) : 0;
+
+        table.resize(tableSize);
+        for (int i = 0; i < tableSize; i++) {
+            const float value = float(i) / (tableSize - 1);
+            table[i] = isLinear ? value : cmsEvalToneCurveFloat(curve, value);
+        }
+    }
+
+    /**
+     * Samples the reversed curve. The table is uniform in sqrt(x) domain,
+     * which gives much better precision for dark values, where gamma
+     * curves are the steepest.
+     */
+    bool initEncoding(const cmsToneCurve *dstCurve) {
+        isLinear = !dstCurve || cmsIsToneCurveLinear(dstCurve);
+        if (isLinear) return true;
+
+        curve = cmsReverseToneCurve(dstCurve);
+        if (!curve) return false;
+
+        table.resize(encodingTableSize);
+        for (int i = 0; i < encodingTableSize; i++) {
+            const float t = float(i) / (encodingTableSize - 1);
+            table[i] = cmsEvalToneCurveFloat(curve, t * t);
+        }
+
+        return true;
+    }
+
+    inline float interpolate(float pos) const {
+        const int index = qMin(int(pos), table.size() - 2);
+        const float fraction = pos - index;
+        return table[index] + fraction * (table[index + 1] - table[index]);
+    }
+
+    bool isLinear = true;
+    cmsToneCurve *curve = 0;
+    QVector<float> table;
+
+private:
+    Q_DISABLE_COPY(ShaperCurve)
+};
+
+inline float linearizeValue(const ShaperCurve &curve, quint8 value) {
+    return curve.table[value];
+}
+
+inline float linearizeValue(const ShaperCurve &curve, quint16 value) {
+    return curve.interpolate(value * (float(linearizationTableSize - 1) / 0xffff));
+}
+
+inline float linearizeValue(const ShaperCurve &curve, float value) {
+    if (curve.isLinear) return value;
+
+    if (value >= 0.0f && value <= 1.0f) {
+        return curve.interpolate(value * (linearizationTableSize - 1));
+    }
+
+    return cmsEvalToneCurveFloat(curve.curve, value);
+}
+
+template <typename channels_type>
+inline float encodeValue(const ShaperCurve &curve, float value) {
+    /**
+     * Integer color spaces cannot keep out-of-range values
+     */
+    if (std::numeric_limits<channels_type>::is_integer) {
+        value = qBound(0.0f, value, 1.0f);
+    }
+
+    if (curve.isLinear) return value;
+
+    if (value >= 0.0f && value <= 1.0f) {
+        return curve.interpolate(std::sqrt(value) * (encodingTableSize - 1));
+    }
+
+    return cmsEvalToneCurveFloat(curve.curve, value);
+}
+
+bool invertMatrix(const qreal m[3][3], qreal inv[3][3])
+{
+    const qreal det =
+        m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+        m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+        m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+
+    if (qFuzzyIsNull(det)) return false;
+
+    inv[0][0] = (m[1][1] * m[2][2] - m[1][2] * m[2][1]) / det;
+    inv[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) / det;
+    inv[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) / det;
+    inv[1][0] = (m[1][2] * m[2][0] - m[1][0] * m[2][2]) / det;
+    inv[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) / det;
+    inv[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) / det;
+    inv[2][0] = (m[1][0] * m[2][1] - m[1][1] * m[2][0]) / det;
+    inv[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) / det;
+    inv[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) / det;
+
+    return true;
+}
+
+/**
+ * The part of the profile needed for the conversion
+ */
+struct ProfileInfo
+{
+    bool isGray = false;
+    const cmsToneCurve *curves[3] = {0, 0, 0};
+
+    /// columns are the colorants of the profile (PCS is D50)
+    qreal toXYZ[3][3];
+
+    bool hasZeroBlack() const {
+        for (int i = 0; i < (isGray ? 1 : 3); i++) {
+            if (cmsEvalToneCurveFloat(curves[i], 0.0f) > zeroBlackThreshold) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+bool fetchProfileInfo(const KoColorSpace *cs,
+                      KoColorConversionTransformation::Intent renderingIntent,
+                      KoColorConversionTransformation::ConversionFlags conversionFlags,
+                      int direction,
+                      ProfileInfo *info)
+{
+    /**
+     * Gamut checks and soft proofing need a proper lcms pipeline
+     */
+    if (conversionFlags.testFlag(KoColorConversionTransformation::GamutCheck) ||
+        conversionFlags.testFlag(KoColorConversionTransformation::SoftProofing)) {
+
+        return false;
+    }
+
+    const IccColorProfile *iccProfile = dynamic_cast<const IccColorProfile*>(cs->profile());
+    if (!iccProfile || !iccProfile->asLcms()) return false;
+
+    cmsHPROFILE profile = iccProfile->asLcms()->lcmsProfile();
+    if (!profile || !cmsIsMatrixShaper(profile)) return false;
+
+    /**
+     * If the profile has a LUT for the requested intent, lcms will
+     * prefer it over the matrix-shaper
+     */
+    if (cmsIsCLUT(profile, renderingIntent, direction)) return false;
+
+    const cmsColorSpaceSignature signature = cmsGetColorSpace(profile);
+
+    if (cs->colorModelId() == RGBAColorModelID && signature == cmsSigRgbData) {
+        const cmsCIEXYZ *colorants[3] = {
+            static_cast<const cmsCIEXYZ*>(cmsReadTag(profile, cmsSigRedColorantTag)),
+            static_cast<const cmsCIEXYZ*>(cmsReadTag(profile, cmsSigGreenColorantTag)),
+            static_cast<const cmsCIEXYZ*>(cmsReadTag(profile, cmsSigBlueColorantTag))
+        };
+
+        info->curves[0] = static_cast<const cmsToneCurve*>(cmsReadTag(profile, cmsSigRedTRCTag));
+        info->curves[1] = static_cast<const cmsToneCurve*>(cmsReadTag(profile, cmsSigGreenTRCTag));
+        info->curves[2] = static_cast<const cmsToneCurve*>(cmsReadTag(profile, cmsSigBlueTRCTag));
+
+        for (int i = 0; i < 3; i++) {
+            if (!colorants[i] || !info->curves[i]) return false;
+
+            info->toXYZ[0][i] = colorants[i]->X;
+            info->toXYZ[1][i] = colorants[i]->Y;
+            info->toXYZ[2][i] = colorants[i]->Z;
+        }
+
+        info->isGray = false;
+
+    } else if (cs->colorModelId() == GrayAColorModelID && signature == cmsSigGrayData) {
+        info->curves[0] = static_cast<const cmsToneCurve*>(cmsReadTag(profile, cmsSigGrayTRCTag));
+        if (!info->curves[0]) return false;
+
+        info->isGray = true;
+
+    } else {
+        return false;
+    }
+
+    /**
+     * Black point compensation is a no-op only when the profile maps
+     * zero to zero
+     */
+    if (conversionFlags.testFlag(KoColorConversionTransformation::BlackpointCompensation) &&
+        !info->hasZeroBlack()) {
+
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Unless NoWhiteOnWhiteFixup flag is set, lcms guarantees that white of
+ * an integer color space is mapped into white. Our transformation doesn't
+ * have any special handling for that, so we just check it.
+ */
+bool mapsWhiteOnWhite(const KoColorConversionTransformation *transformation)
+{
+    const KoColorSpace *srcCs = transformation->srcColorSpace();
+    const KoColorSpace *dstCs = transformation->dstColorSpace();
+
+    QVector<quint8> srcPixel(srcCs->pixelSize());
+    QVector<quint8> dstPixel(dstCs->pixelSize());
+    QVector<quint8> dstWhite(dstCs->pixelSize());
+
+    srcCs->fromNormalisedChannelsValue(srcPixel.data(), QVector<float>(srcCs->channelCount(), 1.0f));
+    dstCs->fromNormalisedChannelsValue(dstWhite.data(), QVector<float>(dstCs->channelCount(), 1.0f));
+
+    transformation->transform(srcPixel.constData(), dstPixel.data(), 1);
+
+    return dstPixel == dstWhite;
+}
+
+}
+
+class LcmsMatrixShaperTransformation : public KoColorConversionTransformation
+{
+public:
+    enum MatrixMode {
+        NoMatrix,
+        RgbToRgb,
+        GrayToRgb,
+        RgbToGray
+    };
+
+    typedef void (*UnpackFunc)(const LcmsMatrixShaperTransformation *transformation,
+                               const quint8 *src, int numPixels, float **channels);
+
+    typedef void (*PackFunc)(const LcmsMatrixShaperTransformation *transformation,
+                             float **channels, int numPixels, quint8 *dst);
+
+public:
+    LcmsMatrixShaperTransformation(const KoColorSpace *srcCs,
+                                   const KoColorSpace *dstCs,
+                                   Intent renderingIntent,
+                                   ConversionFlags conversionFlags)
+        : KoColorConversionTransformation(srcCs, dstCs, renderingIntent, conversionFlags),
+          m_srcPixelSize(srcCs->pixelSize()),
+          m_dstPixelSize(dstCs->pixelSize())
+    {
+    }
+
+    void transform(const quint8 *src, quint8 *dst, qint32 numPixels) const override {
+        float buffer[4][pixelBlockSize];
+        float *channels[4] = {buffer[0], buffer[1], buffer[2], buffer[3]};
+
+        while (numPixels > 0) {
+            const int blockSize = qMin(numPixels, pixelBlockSize);
+
+            m_unpack(this, src, blockSize, channels);
+            applyMatrix(channels, blockSize);
+            m_pack(this, channels, blockSize, dst);
+
+            src += blockSize * m_srcPixelSize;
+            dst += blockSize * m_dstPixelSize;
+            numPixels -= blockSize;
+        }
+    }
+
+    template <class Traits>
+    static void unpackRgb(const LcmsMatrixShaperTransformation *t,
+                          const quint8 *src, int numPixels, float **channels)
+    {
+        typedef typename Traits::channels_type channels_type;
+        const channels_type *pixel = reinterpret_cast<const channels_type*>(src);
+
+        float *r = channels[0];
+        float *g = channels[1];
+        float *b = channels[2];
+        float *a = channels[3];
+
+        for (int i = 0; i < numPixels; i++) {
+            r[i] = linearizeValue(t->m_srcCurves[0], pixel[Traits::red_pos]);
+            g[i] = linearizeValue(t->m_srcCurves[1], pixel[Traits::green_pos]);
+            b[i] = linearizeValue(t->m_srcCurves[2], pixel[Traits::blue_pos]);
+            a[i] = KoColorSpaceMaths<channels_type, float>::scaleToA(pixel[Traits::alpha_pos]);
+            pixel += Traits::channels_nb;
+        }
+    }
+
+    template <class Traits>
+    static void unpackGray(const LcmsMatrixShaperTransformation *t,
+                           const quint8 *src, int numPixels, float **channels)
+    {
+        typedef typename Traits::channels_type channels_type;
+        const channels_type *pixel = reinterpret_cast<const channels_type*>(src);
+
+        float *y = channels[0];
+        float *a = channels[3];
+
+        for (int i = 0; i < numPixels; i++) {
+            y[i] = linearizeValue(t->m_srcCurves[0], pixel[Traits::gray_pos]);
+            a[i] = KoColorSpaceMaths<channels_type, float>::scaleToA(pixel[Traits::alpha_pos]);
+            pixel += Traits::channels_nb;
+        }
+    }
+
+    template <class Traits>
+    static void packRgb(const LcmsMatrixShaperTransformation *t,
+                        float **channels, int numPixels, quint8 *dst)
+    {
+        typedef typename Traits::channels_type channels_type;
+        channels_type *pixel = reinterpret_cast<channels_type*>(dst);
+
+        const float *r = channels[0];
+        const float *g = channels[1];
+        const float *b = channels[2];
+        const float *a = channels[3];
+
+        for (int i = 0; i < numPixels; i++) {
+            pixel[Traits::red_pos] = KoColorSpaceMaths<float, channels_type>::scaleToA(encodeValue<channels_type>(t->m_dstCurves[0], r[i]));
+            pixel[Traits::green_pos] = KoColorSpaceMaths<float, channels_type>::scaleToA(encodeValue<channels_type>(t->m_dstCurves[1], g[i]));
+            pixel[Traits::blue_pos] = KoColorSpaceMaths<float, channels_type>::scaleToA(encodeValue<channels_type>(t->m_dstCurves[2], b[i]));
+            pixel[Traits::alpha_pos] = KoColorSpaceMaths<float, channels_type>::scaleToA(a[i]);
+            pixel += Traits::channels_nb;
+        }
+    }
+
+    template <class Traits>
+    static void packGray(const LcmsMatrixShaperTransformation *t,
+                         float **channels, int numPixels, quint8 *dst)
+    {
+        typedef typename Traits::channels_type channels_type;
+        channels_type *pixel = reinterpret_cast<channels_type*>(dst);
+
+        const float *y = channels[0];
+        const float *a = channels[3];
+
+        for (int i = 0; i < numPixels; i++) {
+            pixel[Traits::gray_pos] = KoColorSpaceMaths<float, channels_type>::scaleToA(encodeValue<channels_type>(t->m_dstCurves[0], y[i]));
+            pixel[Traits::alpha_pos] = KoColorSpaceMaths<float, channels_type>::scaleToA(a[i]);
+            pixel += Traits::channels_nb;
+        }
+    }
+
+private:
+    void applyMatrix(float **channels, int numPixels) const {
+        float *c0 = channels[0];
+        float *c1 = channels[1];
+        float *c2 = channels[2];
+
+        const float (&m)[3][3] = m_matrix;
+
+        switch (m_matrixMode) {
+        case NoMatrix:
+            break;
+        case RgbToRgb:
+            for (int i = 0; i < numPixels; i++) {
+                const float r = c0[i];
+                const float g = c1[i];
+                const float b = c2[i];
+
+                c0[i] = m[0][0] * r + m[0][1] * g + m[0][2] * b;
+                c1[i] = m[1][0] * r + m[1][1] * g + m[1][2] * b;
+                c2[i] = m[2][0] * r + m[2][1] * g + m[2][2] * b;
+            }
+            break;
+        case GrayToRgb:
+            for (int i = 0; i < numPixels; i++) {
+                const float y = c0[i];
+
+                c0[i] = m[0][0] * y;
+                c1[i] = m[1][0] * y;
+                c2[i] = m[2][0] * y;
+            }
+            break;
+        case RgbToGray:
+            for (int i = 0; i < numPixels; i++) {
+                c0[i] = m[0][0] * c0[i] + m[0][1] * c1[i] + m[0][2] * c2[i];
+            }
+            break;
+        }
+    }
+
+private:
+    friend class LcmsMatrixShaperTransformationFactory;
+
+    const int m_srcPixelSize;
+    const int m_dstPixelSize;
+
+    UnpackFunc m_unpack = 0;
+    PackFunc m_pack = 0;
+
+    ShaperCurve m_srcCurves[3];
+    ShaperCurve m_dstCurves[3];
+
+    MatrixMode m_matrixMode = NoMatrix;
+    float m_matrix[3][3];
+};
+
+namespace {
+
+typedef LcmsMatrixShaperTransformation::UnpackFunc UnpackFunc;
+typedef LcmsMatrixShaperTransformation::PackFunc PackFunc;
+
+/**
+ * RGB integer color spaces are stored in BGR order, float ones in RGB
+ */
+UnpackFunc selectUnpackFunc(const KoColorSpace *cs, bool isGray)
+{
+    const KoID depth = cs->colorDepthId();
+
+    if (depth == Integer8BitsColorDepthID) {
+        return isGray ?
+            &LcmsMatrixShaperTransformation::unpackGray<KoGrayU8Traits> :
+            &LcmsMatrixShaperTransformation::unpackRgb<KoBgrU8Traits>;
+    } else if (depth == Integer16BitsColorDepthID) {
+        return isGray ?
+            &LcmsMatrixShaperTransformation::unpackGray<KoGrayU16Traits> :
+            &LcmsMatrixShaperTransformation::unpackRgb<KoBgrU16Traits>;
+    } else if (depth == Float32BitsColorDepthID) {
+        return isGray ?
+            &LcmsMatrixShaperTransformation::unpackGray<KoGrayF32Traits> :
+            &LcmsMatrixShaperTransformation::unpackRgb<KoRgbF32Traits>;
+    }
+
+    return 0;
+}
+
+PackFunc selectPackFunc(const KoColorSpace *cs, bool isGray)
+{
+    const KoID depth = cs->colorDepthId();
+
+    if (depth == Integer8BitsColorDepthID) {
+        return isGray ?
+            &LcmsMatrixShaperTransformation::packGray<KoGrayU8Traits> :
+            &LcmsMatrixShaperTransformation::packRgb<KoBgrU8Traits>;
+    } else if (depth == Integer16BitsColorDepthID) {
+        return isGray ?
+            &LcmsMatrixShaperTransformation::packGray<KoGrayU16Traits> :
+            &LcmsMatrixShaperTransformation::packRgb<KoBgrU16Traits>;
+    } else if (depth == Float32BitsColorDepthID) {
+        return isGray ?
+            &LcmsMatrixShaperTransformation::packGray<KoGrayF32Traits> :
+            &LcmsMatrixShaperTransformation::packRgb<KoRgbF32Traits>;
+    }
+
+    return 0;
+}
+
+int linearizationTableSizeForDepth(const KoColorSpace *cs)
+{
+    const KoID depth = cs->colorDepthId();
+
+    return depth == Integer8BitsColorDepthID ? 256 :
+           linearizationTableSize;
+}
+
+}
+
+KoColorConversionTransformation* LcmsMatrixShaperTransformationFactory::createColorTransformation(const KoColorSpace* srcColorSpace,
+                                                                                                 const KoColorSpace* dstColorSpace,
+                                                                                                 KoColorConversionTransformation::Intent renderingIntent,
+                                                                                                 KoColorConversionTransformation::ConversionFlags conversionFlags) const
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(srcColorSpace && dstColorSpace, 0);
+
+    if (renderingIntent == KoColorConversionTransformation::IntentAbsoluteColorimetric ||
+        conversionFlags.testFlag(KoColorConversionTransformation::NoOptimization)) {
+
+        return 0;
+    }
+
+    /**
+     * The interpolated tables keep the result within one level only for
+     * 8-bit destinations. 16-bit and float ones may differ from lcms by up
+     * to 16 levels (or 2e-4), so they get the fast path only when the
+     * caller explicitly prefers speed over precision.
+     */
+    if (dstColorSpace->colorDepthId() != Integer8BitsColorDepthID &&
+        !conversionFlags.testFlag(KoColorConversionTransformation::LowQuality)) {
+
+        return 0;
+    }
+
+    ProfileInfo srcInfo;
+    ProfileInfo dstInfo;
+
+    if (!fetchProfileInfo(srcColorSpace, renderingIntent, conversionFlags, LCMS_USED_AS_INPUT, &srcInfo) ||
+        !fetchProfileInfo(dstColorSpace, renderingIntent, conversionFlags, LCMS_USED_AS_OUTPUT, &dstInfo)) {
+
+        return 0;
+    }
+
+    const UnpackFunc unpack = selectUnpackFunc(srcColorSpace, srcInfo.isGray);
+    const PackFunc pack = selectPackFunc(dstColorSpace, dstInfo.isGray);
+
+    if (!unpack || !pack) return 0;
+
+    QScopedPointer<LcmsMatrixShaperTransformation> transformation(
+        new LcmsMatrixShaperTransformation(srcColorSpace, dstColorSpace,
+                                           renderingIntent, conversionFlags));
+
+    transformation->m_unpack = unpack;
+    transformation->m_pack = pack;
+
+    /**
+     * When only the depth of the color space changes, skip the curves
+     * and the matrix to keep the values exact
+     */
+    const bool sameProfile = *srcColorSpace->profile() == *dstColorSpace->profile();
+    const int numSrcCurves = srcInfo.isGray ? 1 : 3;
+    const int numDstCurves = dstInfo.isGray ? 1 : 3;
+    const int srcTableSize = linearizationTableSizeForDepth(srcColorSpace);
+
+    for (int i = 0; i < numSrcCurves; i++) {
+        transformation->m_srcCurves[i].initLinearization(sameProfile ? 0 : srcInfo.curves[i], srcTableSize);
+    }
+
+    for (int i = 0; i < numDstCurves; i++) {
+        if (!transformation->m_dstCurves[i].initEncoding(sameProfile ? 0 : dstInfo.curves[i])) {
+            return 0;
+        }
+    }
+
+    qreal matrix[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+    LcmsMatrixShaperTransformation::MatrixMode mode = LcmsMatrixShaperTransformation::NoMatrix;
+
+    if (!srcInfo.isGray && !dstInfo.isGray) {
+        qreal fromXYZ[3][3];
+        if (!invertMatrix(dstInfo.toXYZ, fromXYZ)) return 0;
+
+        bool isIdentity = true;
+
+        for (int row = 0; row < 3; row++) {
+            for (int col = 0; col < 3; col++) {
+                for (int k = 0; k < 3; k++) {
+                    matrix[row][col] += fromXYZ[row][k] * srcInfo.toXYZ[k][col];
+                }
+                isIdentity &= qAbs(matrix[row][col] - (row == col ? 1.0 : 0.0)) < identityMatrixThreshold;
+            }
+        }
+
+        mode = sameProfile || isIdentity ?
+            LcmsMatrixShaperTransformation::NoMatrix :
+            LcmsMatrixShaperTransformation::RgbToRgb;
+
+    } else if (srcInfo.isGray && !dstInfo.isGray) {
+        /**
+         * lcms maps gray into XYZ as D50 white scaled by the gray value
+         */
+        qreal fromXYZ[3][3];
+        if (!invertMatrix(dstInfo.toXYZ, fromXYZ)) return 0;
+
+        const cmsCIEXYZ *d50 = cmsD50_XYZ();
+        const qreal white[3] = {d50->X, d50->Y, d50->Z};
+
+        for (int row = 0; row < 3; row++) {
+            for (int k = 0; k < 3; k++) {
+                matrix[row][0] += fromXYZ[row][k] * white[k];
+            }
+        }
+
+        mode = LcmsMatrixShaperTransformation::GrayToRgb;
+
+    } else if (!srcInfo.isGray && dstInfo.isGray) {
+        /**
+         * ... and takes only Y component of XYZ when converting into gray
+         */
+        for (int col = 0; col < 3; col++) {
+            matrix[0][col] = srcInfo.toXYZ[1][col];
+        }
+
+        mode = LcmsMatrixShaperTransformation::RgbToGray;
+    }
+
+    transformation->m_matrixMode = mode;
+
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 3; col++) {
+            transformation->m_matrix[row][col] = matrix[row][col];
+        }
+    }
+
+    if (!conversionFlags.testFlag(KoColorConversionTransformation::NoWhiteOnWhiteFixup) &&
+        dstColorSpace->colorDepthId() != Float32BitsColorDepthID &&
+        !mapsWhiteOnWhite(transformation.data())) {
+
+        return 0;
+    }
+
+    return transformation.take();
+}
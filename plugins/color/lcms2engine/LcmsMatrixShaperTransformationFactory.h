@@ -0,0 +1,71 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef LCMSMATRIXSHAPERTRANSFORMATIONFACTORY_H
+#define LCMSMATRIXSHAPERTRANSFORMATIONFACTORY_H
+
+#include <KoColorConversionTransformationAbstractFactory.h>
+
+/**
+ * Creates fast conversions between RGB and Gray color spaces whose
+ * profiles are matrix-shapers, that is, consist of three (or one) tone
+ * curves and a matrix to XYZ. That covers sRGB, linear sRGB, Rec. 709,
+ * Adobe RGB and most of the "working space" profiles.
+ *
+ * The conversion is done without lcms in three passes over a block of
+ * pixels stored in planar float buffers: linearization through lookup
+ * tables, the matrix multiplication and the encoding through lookup
+ * tables. The loops are simple enough to be vectorized by the compiler.
+ *
+ * For the relative colorimetric (and, hence, perceptual and saturation)
+ * intent the result matches the unoptimized lcms transformation within
+ * one level for 8-bit, 16 levels for 16-bit and 2e-4 for float color
+ * spaces (see TestLcmsMatrixShaperTransformation::testCompareWithLcms).
+ * That is why 16-bit and float destinations are converted only when
+ * LowQuality flag is set.
+ *
+ * The factory is used by IccColorSpaceEngine, which is the factory
+ * registered in the conversion graph for all ICC color spaces. The links
+ * of the graph are bound to the profile names, so a factory covering any
+ * pair of matrix-shaper profiles cannot be registered there directly.
+ */
+class LcmsMatrixShaperTransformationFactory : public KoColorConversionTransformationAbstractFactory
+{
+public:
+    /**
+     * Creates a transformation between \p srcColorSpace and \p dstColorSpace
+     * or returns null if any of the color spaces is not supported. In such
+     * a case the caller should fall back to a usual lcms transformation.
+     *
+     * Supported are 8-bit, 16-bit and 32-bit float RGBA and GrayA color
+     * spaces with matrix-shaper profiles. The destination should be 8-bit
+     * unless LowQuality flag is set. NoOptimization flag, absolute
+     * colorimetric intent, gamut checks and soft proofing are not
+     * supported, neither is black
+     * point compensation for profiles with non-zero black. If white is
+     * not mapped exactly into white, the white-on-white fixup of lcms is
+     * needed and null is returned as well.
+     */
+    KoColorConversionTransformation* createColorTransformation(const KoColorSpace* srcColorSpace,
+                                                               const KoColorSpace* dstColorSpace,
+                                                               KoColorConversionTransformation::Intent renderingIntent,
+                                                               KoColorConversionTransformation::ConversionFlags conversionFlags) const override;
+};
+
+#endif // LCMSMATRIXSHAPERTRANSFORMATIONFACTORY_H
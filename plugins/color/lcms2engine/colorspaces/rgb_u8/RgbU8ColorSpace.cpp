@@ -29,13 +29,16 @@
 #include <KoColorConversions.h>
 #include "compositeops/KoCompositeOps.h"
 #include "compositeops/RgbCompositeOps.h"
+#include "compositeops/KoOptimizedCompositeOpFactory.h"
+#include <KoMixColorsOp.h>
 #include <kis_dom_utils.h>
 
 #define downscale(quantum)  (quantum) //((unsigned char) ((quantum)/257UL))
 #define upscale(value)  (value) // ((quint8) (257UL*(value)))
 
 RgbU8ColorSpace::RgbU8ColorSpace(const QString &name, KoColorProfile *p) :
-    LcmsColorSpace<KoBgrU8Traits>(colorSpaceId(), name, TYPE_BGRA_8, cmsSigRgbData, p)
+    LcmsColorSpace<KoBgrU8Traits>(colorSpaceId(), name, TYPE_BGRA_8, cmsSigRgbData, p),
+    m_optimizedMixColorsOp(KoOptimizedCompositeOpFactory::createMixColorsOp32(this))
 {
     addChannel(new KoChannelInfo(i18n("Blue"), 0, 2, KoChannelInfo::COLOR, KoChannelInfo::UINT8, 1, QColor(0, 0, 255)));
     addChannel(new KoChannelInfo(i18n("Green"), 1, 1, KoChannelInfo::COLOR, KoChannelInfo::UINT8, 1, QColor(0, 255, 0)));
@@ -56,6 +59,11 @@ KoColorSpace *RgbU8ColorSpace::clone() const
     return new RgbU8ColorSpace(name(), profile()->clone());
 }
 
+KoMixColorsOp* RgbU8ColorSpace::mixColorsOp() const
+{
+    return m_optimizedMixColorsOp.data();
+}
+
 void RgbU8ColorSpace::colorToXML(const quint8 *pixel, QDomDocument &doc, QDomElement &colorElt) const
 {
     const KoBgrU8Traits::Pixel *p = reinterpret_cast<const KoBgrU8Traits::Pixel *>(pixel);
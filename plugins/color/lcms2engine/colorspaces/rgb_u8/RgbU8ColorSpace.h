@@ -18,6 +18,7 @@
 #ifndef KO_STRATEGY_COLORSPACE_RGB_H_
 #define KO_STRATEGY_COLORSPACE_RGB_H_
 
+#include <QScopedPointer>
 #include <klocalizedstring.h>
 #include <LcmsColorSpace.h>
 #include "KoColorModelStandardIds.h"
@@ -48,6 +49,8 @@ public:
 
     virtual KoColorSpace *clone() const;
 
+    KoMixColorsOp* mixColorsOp() const override;
+
     void colorToXML(const quint8 *pixel, QDomDocument &doc, QDomElement &colorElt) const override;
 
     void colorFromXML(quint8 *pixel, const QDomElement &elt) const override;
@@ -63,6 +66,9 @@ public:
     {
         return QString("RGBA");
     }
+
+private:
+    QScopedPointer<KoMixColorsOp> m_optimizedMixColorsOp;
 };
 
 class RgbU8ColorSpaceFactory : public LcmsColorSpaceFactory
@@ -0,0 +1,161 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "TestLcmsColorSpace.h"
+
+#include <QTest>
+#include "sdk/tests/kistest.h"
+
+#include <lcms2.h>
+
+#include "KoColorSpace.h"
+#include "KoColorSpaceRegistry.h"
+#include "KoColorModelStandardIds.h"
+
+#include "IccColorProfile.h"
+#include "LcmsColorProfileContainer.h"
+
+namespace {
+
+cmsHPROFILE lcmsProfile(const KoColorProfile *profile)
+{
+    const IccColorProfile *iccProfile = dynamic_cast<const IccColorProfile*>(profile);
+    return iccProfile && iccProfile->asLcms() ? iccProfile->asLcms()->lcmsProfile() : 0;
+}
+
+/**
+ * The per-pixel transformations the color spaces used before the batch
+ * conversion was introduced
+ */
+struct ReferenceTransformations
+{
+    ReferenceTransformations(const KoColorSpace *cs, cmsUInt32Number pixelType, const KoColorProfile *rgbProfile)
+    {
+        cmsHPROFILE srgbProfile = 0;
+        cmsHPROFILE qcolorProfile = lcmsProfile(rgbProfile);
+
+        if (!qcolorProfile) {
+            srgbProfile = cmsCreate_sRGBProfile();
+            qcolorProfile = srgbProfile;
+        }
+
+        fromRGB = cmsCreateTransform(qcolorProfile, TYPE_BGR_8,
+                                     lcmsProfile(cs->profile()), pixelType,
+                                     KoColorConversionTransformation::internalRenderingIntent(),
+                                     KoColorConversionTransformation::internalConversionFlags());
+
+        toRGB = cmsCreateTransform(lcmsProfile(cs->profile()), pixelType,
+                                   qcolorProfile, TYPE_BGR_8,
+                                   KoColorConversionTransformation::internalRenderingIntent(),
+                                   KoColorConversionTransformation::internalConversionFlags());
+
+        if (srgbProfile) {
+            cmsCloseProfile(srgbProfile);
+        }
+    }
+
+    ~ReferenceTransformations() {
+        if (fromRGB) cmsDeleteTransform(fromRGB);
+        if (toRGB) cmsDeleteTransform(toRGB);
+    }
+
+    cmsHTRANSFORM fromRGB = 0;
+    cmsHTRANSFORM toRGB = 0;
+};
+
+}
+
+void TestLcmsColorSpace::testQColorBatchConversion_data()
+{
+    QTest::addColumn<QString>("colorModel");
+    QTest::addColumn<QString>("colorDepth");
+    QTest::addColumn<quint32>("pixelType");
+    QTest::addColumn<QString>("rgbProfileName");
+
+    QTest::newRow("rgb8") << RGBAColorModelID.id() << Integer8BitsColorDepthID.id() << quint32(TYPE_BGRA_8) << QString();
+    QTest::newRow("rgb16") << RGBAColorModelID.id() << Integer16BitsColorDepthID.id() << quint32(TYPE_BGRA_16) << QString();
+    QTest::newRow("lab16") << LABAColorModelID.id() << Integer16BitsColorDepthID.id() << quint32(TYPE_LabA_16) << QString();
+    QTest::newRow("rgb8-custom") << RGBAColorModelID.id() << Integer8BitsColorDepthID.id() << quint32(TYPE_BGRA_8) << QString("sRGB-elle-V2-g10.icc");
+    QTest::newRow("lab16-custom") << LABAColorModelID.id() << Integer16BitsColorDepthID.id() << quint32(TYPE_LabA_16) << QString("Rec2020-elle-V4-g10.icc");
+}
+
+void TestLcmsColorSpace::testQColorBatchConversion()
+{
+    QFETCH(QString, colorModel);
+    QFETCH(QString, colorDepth);
+    QFETCH(quint32, pixelType);
+    QFETCH(QString, rgbProfileName);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(colorModel, colorDepth);
+    QVERIFY(cs);
+
+    const KoColorProfile *rgbProfile = 0;
+
+    if (!rgbProfileName.isEmpty()) {
+        rgbProfile = KoColorSpaceRegistry::instance()->profileByName(rgbProfileName);
+        if (!rgbProfile) {
+            QSKIP("the custom RGB profile is not available");
+        }
+    }
+
+    ReferenceTransformations reference(cs, pixelType, rgbProfile);
+    QVERIFY(reference.fromRGB);
+    QVERIFY(reference.toRGB);
+
+    // more colors than fit into a single batch
+    QVector<QColor> colors;
+    for (int i = 0; i < 1000; i++) {
+        colors << QColor((i * 7) % 256, (i * 13) % 256, (i * 29) % 256, i % 256);
+    }
+
+    const int pixelSize = cs->pixelSize();
+
+    QVector<quint8> batchPixels(colors.size() * pixelSize);
+    cs->fromQColors(colors.constData(), batchPixels.data(), colors.size(), rgbProfile);
+
+    QVector<QColor> batchColors(colors.size());
+    cs->toQColors(batchPixels.constData(), batchColors.data(), batchColors.size(), rgbProfile);
+
+    for (int i = 0; i < colors.size(); i++) {
+        const quint8 *batchPixel = batchPixels.constData() + i * pixelSize;
+
+        QVector<quint8> expectedPixel(pixelSize, 0);
+        const quint8 bgr[3] = {quint8(colors[i].blue()), quint8(colors[i].green()), quint8(colors[i].red())};
+        cmsDoTransform(reference.fromRGB, bgr, expectedPixel.data(), 1);
+        cs->setOpacity(expectedPixel.data(), quint8(colors[i].alpha()), 1);
+
+        QVERIFY2(!memcmp(expectedPixel.constData(), batchPixel, pixelSize),
+                 qPrintable(QString("fromQColors() differs for color %1").arg(i)));
+
+        quint8 expectedBgr[3] = {0, 0, 0};
+        cmsDoTransform(reference.toRGB, batchPixel, expectedBgr, 1);
+        const QColor expectedColor(expectedBgr[2], expectedBgr[1], expectedBgr[0], cs->opacityU8(batchPixel));
+
+        QCOMPARE(batchColors[i], expectedColor);
+
+        // the single-color versions should give the same result
+        QVector<quint8> singlePixel(pixelSize);
+        cs->fromQColor(colors[i], singlePixel.data(), rgbProfile);
+        QVERIFY(!memcmp(expectedPixel.constData(), singlePixel.constData(), pixelSize));
+
+        QColor singleColor;
+        cs->toQColor(batchPixel, &singleColor, rgbProfile);
+        QCOMPARE(singleColor, expectedColor);
+    }
+}
+
+KISTEST_MAIN(TestLcmsColorSpace)
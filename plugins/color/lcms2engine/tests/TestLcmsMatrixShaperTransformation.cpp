@@ -0,0 +1,393 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "TestLcmsMatrixShaperTransformation.h"
+
+#include <QTest>
+#include "sdk/tests/kistest.h"
+
+#include <cmath>
+
+#include <lcms2.h>
+
+#include "KoColorProfile.h"
+#include "KoColorSpaceRegistry.h"
+#include "KoColorModelStandardIds.h"
+
+#include "IccColorProfile.h"
+#include "LcmsColorProfileContainer.h"
+
+namespace {
+
+const KoColorSpace* colorSpace(const KoID &model, const KoID &depth, const QString &profileName)
+{
+    const KoColorProfile *profile = KoColorSpaceRegistry::instance()->profileByName(profileName);
+    if (!profile) return 0;
+
+    return KoColorSpaceRegistry::instance()->colorSpace(model.id(), depth.id(), profile);
+}
+
+/**
+ * The matrix-shaper transformation is used for 16-bit and float
+ * destinations only when LowQuality flag is set
+ */
+const KoColorConversionTransformation::ConversionFlags fastPathFlags =
+    KoColorConversionTransformation::internalConversionFlags() |
+    KoColorConversionTransformation::LowQuality;
+
+void convert(const KoColorSpace *srcCS, const quint8 *src, const KoColorSpace *dstCS, quint8 *dst, int numPixels,
+             KoColorConversionTransformation::ConversionFlags conversionFlags = fastPathFlags)
+{
+    srcCS->convertPixelsTo(src, dst, dstCS, numPixels,
+                           KoColorConversionTransformation::internalRenderingIntent(),
+                           conversionFlags);
+}
+
+float srgbToLinear(float value)
+{
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+cmsUInt32Number lcmsPixelType(const KoColorSpace *cs)
+{
+    const bool isGray = cs->colorModelId() == GrayAColorModelID;
+    const KoID depth = cs->colorDepthId();
+
+    if (depth == Integer8BitsColorDepthID) {
+        return isGray ? TYPE_GRAYA_8 : TYPE_BGRA_8;
+    } else if (depth == Integer16BitsColorDepthID) {
+        return isGray ? TYPE_GRAYA_16 : TYPE_BGRA_16;
+    }
+
+    return isGray ? TYPE_GRAYA_FLT : TYPE_RGBA_FLT;
+}
+
+cmsHPROFILE lcmsProfile(const KoColorSpace *cs)
+{
+    const IccColorProfile *profile = dynamic_cast<const IccColorProfile*>(cs->profile());
+    return profile && profile->asLcms() ? profile->asLcms()->lcmsProfile() : 0;
+}
+
+/**
+ * Deterministic pseudo-random channel values in [0, 1] range, including
+ * the exact black and white
+ */
+void fillRandomPixels(const KoColorSpace *cs, quint8 *pixels, int numPixels)
+{
+    const int numChannels = cs->channelCount();
+    QVector<float> values(numChannels);
+
+    quint32 seed = 12345;
+
+    for (int i = 0; i < numPixels; i++) {
+        for (int ch = 0; ch < numChannels; ch++) {
+            seed = seed * 1664525 + 1013904223;
+
+            values[ch] =
+                i == 0 ? 0.0f :
+                i == 1 ? 1.0f :
+                float(seed >> 8) / float(0xffffff);
+        }
+
+        cs->fromNormalisedChannelsValue(pixels + i * cs->pixelSize(), values);
+    }
+}
+
+}
+
+void TestLcmsMatrixShaperTransformation::testSrgbToLinear()
+{
+    const KoColorSpace *srcCS = colorSpace(RGBAColorModelID, Integer8BitsColorDepthID, "sRGB-elle-V2-srgbtrc.icc");
+    const KoColorSpace *dstCS = colorSpace(RGBAColorModelID, Float32BitsColorDepthID, "sRGB-elle-V2-g10.icc");
+
+    if (!srcCS || !dstCS) {
+        QSKIP("sRGB profiles are not available");
+    }
+
+    QVector<quint8> src(256 * 4);
+    QVector<float> dst(256 * 4);
+
+    for (int i = 0; i < 256; i++) {
+        src[i * 4 + 0] = i;
+        src[i * 4 + 1] = i;
+        src[i * 4 + 2] = i;
+        src[i * 4 + 3] = 255 - i;
+    }
+
+    convert(srcCS, src.constData(), dstCS, reinterpret_cast<quint8*>(dst.data()), 256);
+
+    for (int i = 0; i < 256; i++) {
+        const float expected = srgbToLinear(i / 255.0f);
+
+        for (int ch = 0; ch < 3; ch++) {
+            QVERIFY2(qAbs(dst[i * 4 + ch] - expected) < 1e-3,
+                     qPrintable(QString("value %1, channel %2: %3 != %4").arg(i).arg(ch).arg(dst[i * 4 + ch]).arg(expected)));
+        }
+
+        QVERIFY(qAbs(dst[i * 4 + 3] - (255 - i) / 255.0f) < 1e-6);
+    }
+}
+
+void TestLcmsMatrixShaperTransformation::testRoundTrip()
+{
+    const KoColorSpace *srcCS = colorSpace(RGBAColorModelID, Integer8BitsColorDepthID, "sRGB-elle-V2-srgbtrc.icc");
+    const KoColorSpace *dstCS = colorSpace(RGBAColorModelID, Float32BitsColorDepthID, "Rec2020-elle-V4-g10.icc");
+
+    if (!srcCS || !dstCS) {
+        QSKIP("sRGB or Rec2020 profiles are not available");
+    }
+
+    const int numPixels = 256 * 3;
+
+    QVector<quint8> src(numPixels * 4);
+    QVector<float> tmp(numPixels * 4);
+    QVector<quint8> result(numPixels * 4);
+
+    // every value in every channel with the other channels set to something else
+    for (int i = 0; i < numPixels; i++) {
+        const int value = i % 256;
+        const int channel = i / 256;
+
+        for (int ch = 0; ch < 3; ch++) {
+            src[i * 4 + ch] = ch == channel ? value : (value * 7 + ch * 31) % 256;
+        }
+        src[i * 4 + 3] = value;
+    }
+
+    convert(srcCS, src.constData(), dstCS, reinterpret_cast<quint8*>(tmp.data()), numPixels);
+    convert(dstCS, reinterpret_cast<const quint8*>(tmp.constData()), srcCS, result.data(), numPixels);
+
+    for (int i = 0; i < numPixels * 4; i++) {
+        QCOMPARE(int(result[i]), int(src[i]));
+    }
+}
+
+void TestLcmsMatrixShaperTransformation::testDepthScaling()
+{
+    const KoColorSpace *srcCS = colorSpace(RGBAColorModelID, Integer8BitsColorDepthID, "sRGB-elle-V2-srgbtrc.icc");
+    const KoColorSpace *dstCS = colorSpace(RGBAColorModelID, Integer16BitsColorDepthID, "sRGB-elle-V2-srgbtrc.icc");
+
+    if (!srcCS || !dstCS) {
+        QSKIP("sRGB profile is not available");
+    }
+
+    QVector<quint8> src(256 * 4);
+    QVector<quint16> dst(256 * 4);
+
+    for (int i = 0; i < 256 * 4; i++) {
+        src[i] = i / 4;
+    }
+
+    convert(srcCS, src.constData(), dstCS, reinterpret_cast<quint8*>(dst.data()), 256);
+
+    // only the depth changes, so the values should be scaled exactly
+    for (int i = 0; i < 256 * 4; i++) {
+        QCOMPARE(int(dst[i]), int(src[i]) * 257);
+    }
+}
+
+void TestLcmsMatrixShaperTransformation::testGrayRoundTrip()
+{
+    const KoColorSpace *grayCS = colorSpace(GrayAColorModelID, Integer8BitsColorDepthID, "Gray-D50-elle-V2-srgbtrc.icc");
+    const KoColorSpace *rgbCS = colorSpace(RGBAColorModelID, Integer16BitsColorDepthID, "sRGB-elle-V2-srgbtrc.icc");
+
+    if (!grayCS || !rgbCS) {
+        QSKIP("gray or sRGB profiles are not available");
+    }
+
+    QVector<quint8> src(256 * 2);
+    QVector<quint16> tmp(256 * 4);
+    QVector<quint8> result(256 * 2);
+
+    for (int i = 0; i < 256; i++) {
+        src[i * 2 + 0] = i;
+        src[i * 2 + 1] = 255;
+    }
+
+    convert(grayCS, src.constData(), rgbCS, reinterpret_cast<quint8*>(tmp.data()), 256);
+
+    // gray is neutral in any RGB space with D50-adapted colorants
+    for (int i = 0; i < 256; i++) {
+        QVERIFY(qAbs(int(tmp[i * 4 + 0]) - int(tmp[i * 4 + 1])) <= 2);
+        QVERIFY(qAbs(int(tmp[i * 4 + 2]) - int(tmp[i * 4 + 1])) <= 2);
+    }
+
+    convert(rgbCS, reinterpret_cast<const quint8*>(tmp.constData()), grayCS, result.data(), 256);
+
+    for (int i = 0; i < 256 * 2; i++) {
+        QCOMPARE(int(result[i]), int(src[i]));
+    }
+}
+
+void TestLcmsMatrixShaperTransformation::testCompareWithLcms_data()
+{
+    QTest::addColumn<QString>("srcModel");
+    QTest::addColumn<QString>("srcDepth");
+    QTest::addColumn<QString>("srcProfile");
+    QTest::addColumn<QString>("dstModel");
+    QTest::addColumn<QString>("dstDepth");
+    QTest::addColumn<QString>("dstProfile");
+
+    const QString rgb = RGBAColorModelID.id();
+    const QString gray = GrayAColorModelID.id();
+    const QString u8 = Integer8BitsColorDepthID.id();
+    const QString u16 = Integer16BitsColorDepthID.id();
+    const QString f32 = Float32BitsColorDepthID.id();
+
+    QTest::newRow("srgb-u8-clay-u8")
+        << rgb << u8 << "sRGB-elle-V2-srgbtrc.icc"
+        << rgb << u8 << "ClayRGB-elle-V2-g22.icc";
+
+    QTest::newRow("srgb-u16-rec2020linear-u16")
+        << rgb << u16 << "sRGB-elle-V2-srgbtrc.icc"
+        << rgb << u16 << "Rec2020-elle-V4-g10.icc";
+
+    QTest::newRow("wide-u16-srgb-u8")
+        << rgb << u16 << "WideRGB-elle-V2-g22.icc"
+        << rgb << u8 << "sRGB-elle-V2-srgbtrc.icc";
+
+    QTest::newRow("wide-f32-srgb-u16")
+        << rgb << f32 << "WideRGB-elle-V2-g22.icc"
+        << rgb << u16 << "sRGB-elle-V2-srgbtrc.icc";
+
+    QTest::newRow("srgblinear-f32-acescg-f32")
+        << rgb << f32 << "sRGB-elle-V2-g10.icc"
+        << rgb << f32 << "ACEScg-elle-V4-g10.icc";
+
+    QTest::newRow("srgb-u8-srgb-f32")
+        << rgb << u8 << "sRGB-elle-V2-srgbtrc.icc"
+        << rgb << f32 << "sRGB-elle-V2-g10.icc";
+
+    QTest::newRow("gray-u8-srgb-u16")
+        << gray << u8 << "Gray-D50-elle-V2-srgbtrc.icc"
+        << rgb << u16 << "sRGB-elle-V2-srgbtrc.icc";
+
+    QTest::newRow("srgb-u16-gray-u16")
+        << rgb << u16 << "sRGB-elle-V2-srgbtrc.icc"
+        << gray << u16 << "Gray-D50-elle-V2-srgbtrc.icc";
+
+    QTest::newRow("clay-f32-gray-f32")
+        << rgb << f32 << "ClayRGB-elle-V2-g22.icc"
+        << gray << f32 << "Gray-D50-elle-V2-srgbtrc.icc";
+}
+
+void TestLcmsMatrixShaperTransformation::testCompareWithLcms()
+{
+    QFETCH(QString, srcModel);
+    QFETCH(QString, srcDepth);
+    QFETCH(QString, srcProfile);
+    QFETCH(QString, dstModel);
+    QFETCH(QString, dstDepth);
+    QFETCH(QString, dstProfile);
+
+    const KoColorSpace *srcCS = colorSpace(KoID(srcModel), KoID(srcDepth), srcProfile);
+    const KoColorSpace *dstCS = colorSpace(KoID(dstModel), KoID(dstDepth), dstProfile);
+
+    if (!srcCS || !dstCS) {
+        QSKIP("the profiles are not available");
+    }
+
+    /**
+     * The reference is a plain lcms transformation with the optimizations
+     * disabled, so that it is evaluated in floating point
+     */
+    const KoColorConversionTransformation::ConversionFlags flags =
+        KoColorConversionTransformation::internalConversionFlags() |
+        KoColorConversionTransformation::NoOptimization |
+        KoColorConversionTransformation::CopyAlpha;
+
+    cmsHTRANSFORM reference =
+        cmsCreateTransform(lcmsProfile(srcCS), lcmsPixelType(srcCS),
+                           lcmsProfile(dstCS), lcmsPixelType(dstCS),
+                           KoColorConversionTransformation::internalRenderingIntent(),
+                           flags);
+    QVERIFY(reference);
+
+    const int numPixels = 4096;
+
+    QVector<quint8> src(numPixels * srcCS->pixelSize());
+    QVector<quint8> result(numPixels * dstCS->pixelSize());
+    QVector<quint8> expected(numPixels * dstCS->pixelSize());
+
+    fillRandomPixels(srcCS, src.data(), numPixels);
+
+    convert(srcCS, src.constData(), dstCS, result.data(), numPixels);
+    cmsDoTransform(reference, src.constData(), expected.data(), numPixels);
+    cmsDeleteTransform(reference);
+
+    const KoID depth = dstCS->colorDepthId();
+    const float tolerance =
+        depth == Integer8BitsColorDepthID ? 1.0f / 255 :
+        depth == Integer16BitsColorDepthID ? 16.0f / 65535 :
+        2e-4f;
+
+    QVector<float> resultValues(dstCS->channelCount());
+    QVector<float> expectedValues(dstCS->channelCount());
+
+    for (int i = 0; i < numPixels; i++) {
+        dstCS->normalisedChannelsValue(result.constData() + i * dstCS->pixelSize(), resultValues);
+        dstCS->normalisedChannelsValue(expected.constData() + i * dstCS->pixelSize(), expectedValues);
+
+        for (int ch = 0; ch < resultValues.size(); ch++) {
+            // a little epsilon for the roundings in normalisedChannelsValue()
+            QVERIFY2(qAbs(resultValues[ch] - expectedValues[ch]) <= tolerance * 1.001f,
+                     qPrintable(QString("pixel %1, channel %2: %3 != %4")
+                                .arg(i).arg(ch).arg(resultValues[ch]).arg(expectedValues[ch])));
+        }
+    }
+}
+
+void TestLcmsMatrixShaperTransformation::testHighPrecisionUsesLcms()
+{
+    const KoColorSpace *srcCS = colorSpace(RGBAColorModelID, Integer16BitsColorDepthID, "sRGB-elle-V2-srgbtrc.icc");
+    const KoColorSpace *dstCS = colorSpace(RGBAColorModelID, Integer16BitsColorDepthID, "ClayRGB-elle-V2-g22.icc");
+
+    if (!srcCS || !dstCS) {
+        QSKIP("sRGB or Clay profiles are not available");
+    }
+
+    /**
+     * Without LowQuality flag a 16-bit destination should be converted
+     * by exactly the same lcms transformation as before
+     */
+    const KoColorConversionTransformation::ConversionFlags flags =
+        KoColorConversionTransformation::internalConversionFlags();
+
+    cmsHTRANSFORM reference =
+        cmsCreateTransform(lcmsProfile(srcCS), lcmsPixelType(srcCS),
+                           lcmsProfile(dstCS), lcmsPixelType(dstCS),
+                           KoColorConversionTransformation::internalRenderingIntent(),
+                           flags | KoColorConversionTransformation::CopyAlpha);
+    QVERIFY(reference);
+
+    const int numPixels = 4096;
+
+    QVector<quint8> src(numPixels * srcCS->pixelSize());
+    QVector<quint8> result(numPixels * dstCS->pixelSize());
+    QVector<quint8> expected(numPixels * dstCS->pixelSize());
+
+    fillRandomPixels(srcCS, src.data(), numPixels);
+
+    convert(srcCS, src.constData(), dstCS, result.data(), numPixels, flags);
+    cmsDoTransform(reference, src.constData(), expected.data(), numPixels);
+    cmsDeleteTransform(reference);
+
+    QVERIFY(result == expected);
+}
+
+KISTEST_MAIN(TestLcmsMatrixShaperTransformation)
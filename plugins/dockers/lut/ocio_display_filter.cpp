@@ -25,6 +25,8 @@
 #include <fstream>
 #include <sstream>
 
+#include <QtConcurrent>
+
 #include <kis_config.h>
 
 #include <opengl/kis_opengl.h>
@@ -44,6 +46,7 @@ OcioDisplayFilter::OcioDisplayFilter(KisExposureGammaCorrectionInterface *interf
     , m_interface(interface)
     , m_lut3dTexID(0)
     , m_shaderDirty(true)
+    , m_cpuLutEdgeSize(64)
 {
 }
 
@@ -59,12 +62,60 @@ KisExposureGammaCorrectionInterface* OcioDisplayFilter::correctionInterface() co
 void OcioDisplayFilter::filter(quint8 *pixels, quint32 numPixels)
 {
     // processes that data _in_ place
-    if (m_processor) {
+    if (!m_processor) return;
+
+    /**
+     * Baking the LUT costs as much as processing a few hundred thousand
+     * pixels, so small requests (e.g. single colors converted by
+     * KisDisplayColorConverter on the GUI thread) go to the processor
+     * directly and never trigger the baking.
+     */
+    const quint32 minLutPixels = 64 * 64;
+
+    OcioLut3DSP lut = numPixels >= minLutPixels ? cpuLut() : OcioLut3DSP();
+
+    if (!lut) {
         OCIO::PackedImageDesc img(reinterpret_cast<float*>(pixels), numPixels, 1, 4);
         m_processor->apply(img);
+        return;
+    }
+
+    float *floatPixels = reinterpret_cast<float*>(pixels);
+
+    const quint32 chunkSize = 64 * 256;
+
+    if (numPixels > chunkSize) {
+        QVector<quint32> chunks;
+        for (quint32 i = 0; i < numPixels; i += chunkSize) {
+            chunks.append(i);
+        }
+
+        QtConcurrent::blockingMap(chunks,
+            [&] (quint32 firstPixel) {
+                lut->apply(floatPixels + 4 * firstPixel, qMin(chunkSize, numPixels - firstPixel));
+            });
+    } else {
+        lut->apply(floatPixels, numPixels);
     }
 }
 
+OcioLut3DSP OcioDisplayFilter::cpuLut()
+{
+    /**
+     * The alpha swizzle moves alpha into the color channels, which
+     * cannot be represented by a 3D LUT
+     */
+    if (swizzle == A || m_processor->isNoOp()) return OcioLut3DSP();
+
+    QMutexLocker l(&m_cpuLutMutex);
+
+    if (!m_cpuLut) {
+        m_cpuLut = OcioLut3D::fromCache(m_processor, m_cpuLutEdgeSize);
+    }
+
+    return m_cpuLut;
+}
+
 void OcioDisplayFilter::approximateInverseTransformation(quint8 *pixels, quint32 numPixels)
 {
     // processes that data _in_ place
@@ -253,6 +304,14 @@ void OcioDisplayFilter::updateProcessor()
 
     m_processor = config->getProcessor(transform);
 
+    {
+        KisConfig cfg(true);
+
+        QMutexLocker l(&m_cpuLutMutex);
+        m_cpuLut.clear();
+        m_cpuLutEdgeSize = cfg.ocioLutEdgeSize();
+    }
+
     m_forwardApproximationProcessor = config->getProcessor(approximateTransform, OCIO::TRANSFORM_DIR_FORWARD);
 
     try {
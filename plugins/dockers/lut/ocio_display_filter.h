@@ -22,7 +22,9 @@
 #include <OpenColorIO/OpenColorIO.h>
 #include <OpenColorIO/OpenColorTransforms.h>
 #include <QVector>
+#include <QMutex>
 #include "kis_exposure_gamma_correction_interface.h"
+#include "ocio_lut3d.h"
 
 namespace OCIO = OCIO_NAMESPACE;
 
@@ -73,6 +75,10 @@ public:
     float whitePoint;
     bool forceInternalColorManagement;
 
+private:
+
+    OcioLut3DSP cpuLut();
+
 private:
 
     OCIO::ConstProcessorRcPtr m_processor;
@@ -90,6 +96,14 @@ private:
     QString m_shadercacheid;
 
     bool m_shaderDirty;
+
+    /**
+     * The baked processor used by filter(), created lazily on the
+     * first request
+     */
+    OcioLut3DSP m_cpuLut;
+    int m_cpuLutEdgeSize;
+    QMutex m_cpuLutMutex;
 };
 
 #endif // OCIO_DISPLAY_FILTER_H
@@ -0,0 +1,259 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "ocio_lut3d.h"
+
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <cmath>
+#include <cstring>
+
+#include <kis_assert.h>
+
+namespace {
+const float minStop = -10.0f;
+const float maxStop = 8.0f;
+const float minStopValue = 1.0f / 1024.0f; // 2^minStop
+const float shaperScale = 1.0f / (maxStop - minStop);
+
+const int alphaLutSize = 4096;
+const int maxCachedLuts = 8;
+
+QMutex s_cacheMutex;
+QCache<QString, OcioLut3DSP> s_cache(maxCachedLuts);
+
+/**
+ * NaN fails all the comparisons, so it is mapped to zero by the
+ * first one. Otherwise it would be used as an index into the LUT.
+ */
+inline float clampUnit(float value) {
+    return !(value > 0.0f) ? 0.0f : (value > 1.0f ? 1.0f : value);
+}
+
+/**
+ * The biggest value covered by the shaper, fromShaper(1.0)
+ */
+const float maxShaperValue = std::exp2(maxStop) - minStopValue;
+
+/**
+ * Negative, HDR values above the shaper range and non-finite values
+ * cannot be represented by the LUT. NaN fails all the comparisons,
+ * so it is out of range as well.
+ */
+inline bool isInLutRange(const float *pixel) {
+    return pixel[0] >= 0.0f && pixel[0] <= maxShaperValue &&
+           pixel[1] >= 0.0f && pixel[1] <= maxShaperValue &&
+           pixel[2] >= 0.0f && pixel[2] <= maxShaperValue &&
+           pixel[3] >= 0.0f && pixel[3] <= 1.0f;
+}
+}
+
+OcioLut3D::OcioLut3D(OCIO::ConstProcessorRcPtr processor, int edgeSize)
+    : m_edgeSize(qMax(2, edgeSize)),
+      m_processor(processor)
+{
+    const int numEntries = m_edgeSize * m_edgeSize * m_edgeSize;
+    const float step = 1.0f / (m_edgeSize - 1);
+
+    QVector<float> samples(4 * numEntries);
+    float *ptr = samples.data();
+
+    for (int b = 0; b < m_edgeSize; b++) {
+        for (int g = 0; g < m_edgeSize; g++) {
+            for (int r = 0; r < m_edgeSize; r++) {
+                ptr[0] = fromShaper(r * step);
+                ptr[1] = fromShaper(g * step);
+                ptr[2] = fromShaper(b * step);
+                ptr[3] = 1.0f;
+                ptr += 4;
+            }
+        }
+    }
+
+    OCIO::PackedImageDesc img(samples.data(), numEntries, 1, 4);
+    processor->apply(img);
+
+    m_lut.resize(3 * numEntries);
+    for (int i = 0; i < numEntries; i++) {
+        m_lut[3 * i + 0] = samples[4 * i + 0];
+        m_lut[3 * i + 1] = samples[4 * i + 1];
+        m_lut[3 * i + 2] = samples[4 * i + 2];
+    }
+
+    QVector<float> alphaSamples(4 * alphaLutSize, 0.0f);
+    for (int i = 0; i < alphaLutSize; i++) {
+        alphaSamples[4 * i + 3] = float(i) / (alphaLutSize - 1);
+    }
+
+    OCIO::PackedImageDesc alphaImg(alphaSamples.data(), alphaLutSize, 1, 4);
+    processor->apply(alphaImg);
+
+    m_alphaLut.resize(alphaLutSize);
+    for (int i = 0; i < alphaLutSize; i++) {
+        m_alphaLut[i] = alphaSamples[4 * i + 3];
+    }
+}
+
+OcioLut3DSP OcioLut3D::fromCache(OCIO::ConstProcessorRcPtr processor, int edgeSize)
+{
+    const QString key =
+        QString("%1:%2").arg(QString::fromLatin1(processor->getCpuCacheID())).arg(edgeSize);
+
+    {
+        QMutexLocker l(&s_cacheMutex);
+        OcioLut3DSP *cachedLut = s_cache.object(key);
+        if (cachedLut) {
+            return *cachedLut;
+        }
+    }
+
+    /**
+     * Bake the LUT without holding the lock. If two threads bake the
+     * same LUT simultaneously, one of the copies is just dropped.
+     */
+    OcioLut3DSP lut(new OcioLut3D(processor, edgeSize));
+
+    QMutexLocker l(&s_cacheMutex);
+    s_cache.insert(key, new OcioLut3DSP(lut));
+
+    return lut;
+}
+
+int OcioLut3D::edgeSize() const
+{
+    return m_edgeSize;
+}
+
+inline float OcioLut3D::toShaper(float value)
+{
+    // NaN and negative values are mapped to zero
+    value = !(value > 0.0f) ? 0.0f : value;
+    return clampUnit((std::log2(value + minStopValue) - minStop) * shaperScale);
+}
+
+inline float OcioLut3D::fromShaper(float value)
+{
+    return std::exp2(value / shaperScale + minStop) - minStopValue;
+}
+
+void OcioLut3D::apply(float *pixels, quint32 numPixels) const
+{
+    const int edge = m_edgeSize;
+    const int strideG = 3 * edge;
+    const int strideB = 3 * edge * edge;
+    const float scale = edge - 1;
+    const float *lut = m_lut.constData();
+    const float *alphaLut = m_alphaLut.constData();
+
+    QVector<quint32> outOfRangePixels;
+    float *firstPixel = pixels;
+
+    for (quint32 i = 0; i < numPixels; i++, pixels += 4) {
+        if (!isInLutRange(pixels)) {
+            outOfRangePixels.append(i);
+            continue;
+        }
+
+        const float fr = toShaper(pixels[0]) * scale;
+        const float fg = toShaper(pixels[1]) * scale;
+        const float fb = toShaper(pixels[2]) * scale;
+
+        const int ir = qMin(int(fr), edge - 2);
+        const int ig = qMin(int(fg), edge - 2);
+        const int ib = qMin(int(fb), edge - 2);
+
+        const float dr = fr - ir;
+        const float dg = fg - ig;
+        const float db = fb - ib;
+
+        const float *c000 = lut + 3 * ir + strideG * ig + strideB * ib;
+        const float *c111 = c000 + 3 + strideG + strideB;
+
+        /**
+         * Tetrahedral interpolation: the cube is split into six
+         * tetrahedra, and the one containing the point is selected
+         * by the order of the fractional parts.
+         */
+        const float *c1;
+        const float *c2;
+        float w0, w1, w2;
+
+        if (dr >= dg) {
+            if (dg >= db) {
+                c1 = c000 + 3;
+                c2 = c000 + 3 + strideG;
+                w0 = dr; w1 = dg; w2 = db;
+            } else if (dr >= db) {
+                c1 = c000 + 3;
+                c2 = c000 + 3 + strideB;
+                w0 = dr; w1 = db; w2 = dg;
+            } else {
+                c1 = c000 + strideB;
+                c2 = c000 + 3 + strideB;
+                w0 = db; w1 = dr; w2 = dg;
+            }
+        } else {
+            if (db >= dg) {
+                c1 = c000 + strideB;
+                c2 = c000 + strideG + strideB;
+                w0 = db; w1 = dg; w2 = dr;
+            } else if (db >= dr) {
+                c1 = c000 + strideG;
+                c2 = c000 + strideG + strideB;
+                w0 = dg; w1 = db; w2 = dr;
+            } else {
+                c1 = c000 + strideG;
+                c2 = c000 + 3 + strideG;
+                w0 = dg; w1 = dr; w2 = db;
+            }
+        }
+
+        for (int ch = 0; ch < 3; ch++) {
+            pixels[ch] = c000[ch] +
+                w0 * (c1[ch] - c000[ch]) +
+                w1 * (c2[ch] - c1[ch]) +
+                w2 * (c111[ch] - c2[ch]);
+        }
+
+        const float fa = clampUnit(pixels[3]) * (alphaLutSize - 1);
+        const int ia = qMin(int(fa), alphaLutSize - 2);
+        const float da = fa - ia;
+        pixels[3] = alphaLut[ia] + da * (alphaLut[ia + 1] - alphaLut[ia]);
+    }
+
+    if (!outOfRangePixels.isEmpty()) {
+        applyProcessor(firstPixel, outOfRangePixels);
+    }
+}
+
+void OcioLut3D::applyProcessor(float *pixels, const QVector<quint32> &indexes) const
+{
+    QVector<float> buffer(4 * indexes.size());
+
+    for (int i = 0; i < indexes.size(); i++) {
+        memcpy(buffer.data() + 4 * i, pixels + 4 * indexes[i], 4 * sizeof(float));
+    }
+
+    OCIO::PackedImageDesc img(buffer.data(), indexes.size(), 1, 4);
+    m_processor->apply(img);
+
+    for (int i = 0; i < indexes.size(); i++) {
+        memcpy(pixels + 4 * indexes[i], buffer.constData() + 4 * i, 4 * sizeof(float));
+    }
+}
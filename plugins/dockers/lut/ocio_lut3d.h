@@ -0,0 +1,82 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef OCIO_LUT3D_H
+#define OCIO_LUT3D_H
+
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+#include <OpenColorIO/OpenColorIO.h>
+
+namespace OCIO = OCIO_NAMESPACE;
+
+class OcioLut3D;
+typedef QSharedPointer<const OcioLut3D> OcioLut3DSP;
+
+/**
+ * A CPU approximation of an OCIO processor. The processor is baked
+ * into a 3D LUT that is sampled with tetrahedral interpolation,
+ * which is much faster than running the processor on every pixel.
+ *
+ * The LUT is indexed in a logarithmic "shaper" space, so that it can
+ * cover HDR values (up to 2^maxStop) without losing the precision in
+ * the shadows. Pixels with values outside of [0, 2^maxStop] (or alpha
+ * outside of [0, 1]) cannot be represented by the LUT and are passed
+ * to the processor itself.
+ *
+ * The alpha channel is baked into a separate 1D LUT, therefore the
+ * processor must not mix alpha into the color channels or vice versa
+ * (e.g. the "A" channel swizzle of the LUT docker).
+ */
+class OcioLut3D
+{
+public:
+    OcioLut3D(OCIO::ConstProcessorRcPtr processor, int edgeSize);
+
+    /**
+     * Returns a baked LUT for \p processor. The LUTs are shared between
+     * all the filters, so switching back and forth between the
+     * exposure/gamma values or configs doesn't rebake the LUT.
+     */
+    static OcioLut3DSP fromCache(OCIO::ConstProcessorRcPtr processor, int edgeSize);
+
+    /**
+     * Applies the LUT to \p numPixels RGBA float pixels in place.
+     * The method is reentrant, so the pixels can be split into chunks
+     * processed in parallel. The pixels out of the LUT range go through
+     * the (const) processor, which is thread-safe as well.
+     */
+    void apply(float *pixels, quint32 numPixels) const;
+
+    int edgeSize() const;
+
+private:
+    static float toShaper(float value);
+    static float fromShaper(float value);
+
+    void applyProcessor(float *pixels, const QVector<quint32> &indexes) const;
+
+private:
+    int m_edgeSize;
+    OCIO::ConstProcessorRcPtr m_processor;
+    QVector<float> m_lut;
+    QVector<float> m_alphaLut;
+};
+
+#endif // OCIO_LUT3D_H
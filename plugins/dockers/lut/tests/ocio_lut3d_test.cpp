@@ -0,0 +1,199 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "ocio_lut3d_test.h"
+
+#include <QTest>
+
+#include <cmath>
+#include <limits>
+
+#include <kis_debug.h>
+#include <ocio_lut3d.h>
+
+namespace {
+
+OCIO::ConstProcessorRcPtr createProcessor(float exposure, float gamma)
+{
+    OCIO::ConstConfigRcPtr config = OCIO::Config::CreateRaw();
+
+    OCIO::GroupTransformRcPtr group = OCIO::GroupTransform::Create();
+
+    {
+        // a mild saturation change to check channel crosstalk
+        const float gain = std::pow(2.0f, exposure);
+        const float m44[] = { 0.80f * gain, 0.15f * gain, 0.05f * gain, 0.0f,
+                              0.10f * gain, 0.80f * gain, 0.10f * gain, 0.0f,
+                              0.05f * gain, 0.15f * gain, 0.80f * gain, 0.0f,
+                              0.0f,         0.0f,         0.0f,         1.0f };
+        const float offset4[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+        OCIO::MatrixTransformRcPtr mtx = OCIO::MatrixTransform::Create();
+        mtx->setValue(m44, offset4);
+        group->push_back(mtx);
+    }
+
+    {
+        const float exponent = 1.0f / gamma;
+        const float exponent4f[] = { exponent, exponent, exponent, 1.0f };
+
+        OCIO::ExponentTransformRcPtr expTransform = OCIO::ExponentTransform::Create();
+        expTransform->setValue(exponent4f);
+        group->push_back(expTransform);
+    }
+
+    return config->getProcessor(group);
+}
+
+}
+
+void OcioLut3DTest::testMatchesProcessor()
+{
+    OCIO::ConstProcessorRcPtr processor = createProcessor(1.0f, 2.2f);
+    OcioLut3D lut(processor, 64);
+
+    const int numPixels = 4096;
+    QVector<float> pixels(4 * numPixels);
+
+    qsrand(1);
+    for (int i = 0; i < numPixels; i++) {
+        for (int ch = 0; ch < 3; ch++) {
+            // scene-linear values from 0.01 to 16.0
+            pixels[4 * i + ch] = std::pow(10.0f, -2.0f + 3.2f * float(qrand()) / RAND_MAX);
+        }
+        pixels[4 * i + 3] = float(qrand()) / RAND_MAX;
+    }
+
+    QVector<float> refPixels = pixels;
+    OCIO::PackedImageDesc img(refPixels.data(), numPixels, 1, 4);
+    processor->apply(img);
+
+    lut.apply(pixels.data(), numPixels);
+
+    for (int i = 0; i < 4 * numPixels; i++) {
+        const float error = qAbs(pixels[i] - refPixels[i]) / qMax(refPixels[i], 0.01f);
+        if (error > 0.005f) {
+            qDebug() << ppVar(i) << ppVar(pixels[i]) << ppVar(refPixels[i]);
+            QFAIL("The baked LUT differs from the processor");
+        }
+    }
+}
+
+void OcioLut3DTest::testCache()
+{
+    OCIO::ConstProcessorRcPtr processor1 = createProcessor(0.0f, 1.0f);
+    OCIO::ConstProcessorRcPtr processor2 = createProcessor(2.0f, 1.0f);
+
+    OcioLut3DSP lut1 = OcioLut3D::fromCache(processor1, 16);
+    OcioLut3DSP lut2 = OcioLut3D::fromCache(processor2, 16);
+
+    QVERIFY(lut1 != lut2);
+    QCOMPARE(OcioLut3D::fromCache(processor1, 16), lut1);
+    QCOMPARE(OcioLut3D::fromCache(processor2, 16), lut2);
+    QVERIFY(OcioLut3D::fromCache(processor1, 32) != lut1);
+}
+
+void OcioLut3DTest::testOutOfRangeValues()
+{
+    OCIO::ConstProcessorRcPtr processor = createProcessor(1.0f, 2.2f);
+    OcioLut3D lut(processor, 32);
+
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float inf = std::numeric_limits<float>::infinity();
+    const float huge = 1e30f;
+
+    /**
+     * The pixels the LUT cannot represent should be processed by the
+     * processor itself, so that negative and HDR values are not clipped
+     */
+    const float pixels[][4] = {
+        { nan,  nan,  nan,  nan},
+        { inf,  inf,  inf,  inf},
+        { huge, huge, huge, 1.0f},
+        {-inf,  nan,  inf, -inf},
+        { 0.0f, 0.0f, huge, 0.0f},
+        { nan,  0.5f, -1.0f, 0.5f},
+        { 300.0f, 0.5f, 0.25f, 1.0f},
+        { -0.01f, 0.5f, 0.25f, 1.0f},
+        { 0.5f, 0.5f, 0.25f, 1.5f}
+    };
+
+    const int numPixels = sizeof(pixels) / sizeof(pixels[0]);
+
+    QVector<float> result(4 * numPixels);
+    memcpy(result.data(), pixels, sizeof(pixels));
+
+    QVector<float> refPixels = result;
+    OCIO::PackedImageDesc img(refPixels.data(), numPixels, 1, 4);
+    processor->apply(img);
+
+    lut.apply(result.data(), numPixels);
+
+    for (int i = 0; i < 4 * numPixels; i++) {
+        const bool bothNaN = std::isnan(result[i]) && std::isnan(refPixels[i]);
+
+        if (!bothNaN && result[i] != refPixels[i]) {
+            qDebug() << ppVar(i) << ppVar(result[i]) << ppVar(refPixels[i]);
+            QFAIL("The out-of-range pixel differs from the processor");
+        }
+    }
+}
+
+void OcioLut3DTest::testMixedRangeValues()
+{
+    OCIO::ConstProcessorRcPtr processor = createProcessor(1.0f, 2.2f);
+    OcioLut3D lut(processor, 64);
+
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+
+    /**
+     * Out-of-range pixels between the normal ones should not shift
+     * or change the results of the latter
+     */
+    const float pixels[][4] = {
+        { 0.1f, 0.2f, 0.3f, 1.0f},
+        { nan,  0.2f, 0.3f, 1.0f},
+        { 1.5f, 0.7f, 0.05f, 0.5f},
+        { 1000.0f, 0.2f, 0.3f, 1.0f},
+        { 4.0f, 8.0f, 16.0f, 0.25f}
+    };
+
+    const int numPixels = sizeof(pixels) / sizeof(pixels[0]);
+
+    QVector<float> result(4 * numPixels);
+    memcpy(result.data(), pixels, sizeof(pixels));
+
+    QVector<float> refPixels = result;
+    OCIO::PackedImageDesc img(refPixels.data(), numPixels, 1, 4);
+    processor->apply(img);
+
+    lut.apply(result.data(), numPixels);
+
+    for (int i = 0; i < numPixels; i += 2) {
+        for (int ch = 0; ch < 4; ch++) {
+            const int idx = 4 * i + ch;
+            const float error = qAbs(result[idx] - refPixels[idx]) / qMax(refPixels[idx], 0.01f);
+            QVERIFY2(error <= 0.005f, qPrintable(QString("pixel %1, channel %2: %3 != %4")
+                                                 .arg(i).arg(ch).arg(result[idx]).arg(refPixels[idx])));
+        }
+    }
+
+    QCOMPARE(result[4 * 3 + 0], refPixels[4 * 3 + 0]);
+    QVERIFY(std::isnan(result[4 * 1 + 0]) == std::isnan(refPixels[4 * 1 + 0]));
+}
+
+QTEST_GUILESS_MAIN(OcioLut3DTest)
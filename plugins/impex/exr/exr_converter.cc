@@ -28,12 +28,16 @@
 #include <ImfOutputFile.h>
 
 #include <ImfStringAttribute.h>
+#include <ImfTileDescription.h>
 #include "exr_extra_tags.h"
 
 #include <QApplication>
 #include <QMessageBox>
 #include <QDomDocument>
 #include <QThread>
+#include <QtConcurrent>
+
+#include <stdexcept>
 
 #include <QFileInfo>
 
@@ -372,60 +376,147 @@ void multiplyAlpha(Pixel *pixel)
     }
 }
 
+/**
+ * Number of rows OpenEXR decompresses at once: a row of tiles for tiled
+ * files and one line buffer for scanline files. Reading chunks aligned
+ * to it avoids decompressing the same block twice.
+ */
+int exrBlockHeight(const Imf::Header &header)
+{
+    if (header.hasTileDescription()) {
+        return header.tileDescription().ySize;
+    }
+
+    switch (header.compression()) {
+    case Imf::ZIP_COMPRESSION:
+    case Imf::PXR24_COMPRESSION:
+        return 16;
+    case Imf::PIZ_COMPRESSION:
+    case Imf::B44_COMPRESSION:
+    case Imf::B44A_COMPRESSION:
+    case Imf::DWAA_COMPRESSION:
+        return 32;
+    case Imf::DWAB_COMPRESSION:
+        return 256;
+    default:
+        return 1;
+    }
+}
+
+/**
+ * Reads rows [ystart, ystart + height) of the file in chunks of a few
+ * blocks, so that only two chunks are kept in memory instead of the
+ * whole layer. While \p convertChunk writes one chunk into the paint
+ * device, the next one is decoded on a worker thread.
+ *
+ * \p createFrameBuffer gets a pointer to the pixel at (0, 0) of the
+ * image, as Imf::Slice expects it, and returns the frame buffer
+ * describing the chunk. \p convertChunk gets the first pixel of the
+ * chunk and the rect it covers.
+ */
+template <typename Pixel, typename FrameBufferFactory, typename ChunkConverter>
+void readPixelsInChunks(Imf::InputFile &file, int width, int xstart, int ystart, int height,
+                        FrameBufferFactory createFrameBuffer, ChunkConverter convertChunk)
+{
+    const int blockHeight = exrBlockHeight(file.header());
+    const int chunkHeight = qMin(height, blockHeight * qMax(1, 64 / blockHeight));
+    const int yend = ystart + height;
+
+    QVector<Pixel> buffers[2] = {
+        QVector<Pixel>(width * chunkHeight),
+        QVector<Pixel>(width * chunkHeight)
+    };
+
+    // Imf::InputFile is used only by one thread at a time
+    auto readChunk = [&] (int index, int y) -> std::string {
+        try {
+            file.setFrameBuffer(createFrameBuffer(buffers[index].data() - xstart - y * width));
+            file.readPixels(y, qMin(y + chunkHeight, yend) - 1);
+        } catch (std::exception &e) {
+            return e.what();
+        }
+        return std::string();
+    };
+
+    int current = 0;
+    QFuture<std::string> pendingRead =
+        QtConcurrent::run([&readChunk, ystart] () { return readChunk(0, ystart); });
+
+    for (int y = ystart; y < yend; y += chunkHeight) {
+        const std::string error = pendingRead.result();
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+
+        const int nextY = y + chunkHeight;
+        if (nextY < yend) {
+            const int next = 1 - current;
+            pendingRead = QtConcurrent::run([&readChunk, next, nextY] () { return readChunk(next, nextY); });
+        }
+
+        convertChunk(buffers[current].data(), QRect(xstart, y, width, qMin(chunkHeight, yend - y)));
+        current = 1 - current;
+    }
+}
+
 template<typename _T_>
 void EXRConverter::Private::decodeData4(Imf::InputFile& file, ExrPaintLayerInfo& info, KisPaintLayerSP layer, int width, int xstart, int ystart, int height, Imf::PixelType ptype)
 {
     typedef Rgba<_T_> Rgba;
 
-    QVector<Rgba> pixels(width * height);
-
-    bool hasAlpha = info.channelMap.contains("A");
-
-    Imf::FrameBuffer frameBuffer;
-    Rgba* frameBufferData = (pixels.data()) - xstart - ystart * width;
-    frameBuffer.insert(info.channelMap["R"].toLatin1().constData(),
-            Imf::Slice(ptype, (char *) &frameBufferData->r,
-                       sizeof(Rgba) * 1,
-                       sizeof(Rgba) * width));
-    frameBuffer.insert(info.channelMap["G"].toLatin1().constData(),
-            Imf::Slice(ptype, (char *) &frameBufferData->g,
-                       sizeof(Rgba) * 1,
-                       sizeof(Rgba) * width));
-    frameBuffer.insert(info.channelMap["B"].toLatin1().constData(),
-            Imf::Slice(ptype, (char *) &frameBufferData->b,
-                       sizeof(Rgba) * 1,
-                       sizeof(Rgba) * width));
-    if (hasAlpha) {
-        frameBuffer.insert(info.channelMap["A"].toLatin1().constData(),
-                Imf::Slice(ptype, (char *) &frameBufferData->a,
-                           sizeof(Rgba) * 1,
-                           sizeof(Rgba) * width));
-    }
+    const bool hasAlpha = info.channelMap.contains("A");
 
-    file.setFrameBuffer(frameBuffer);
-    file.readPixels(ystart, height + ystart - 1);
-    Rgba *rgba = pixels.data();
+    const QByteArray redChannel = info.channelMap["R"].toLatin1();
+    const QByteArray greenChannel = info.channelMap["G"].toLatin1();
+    const QByteArray blueChannel = info.channelMap["B"].toLatin1();
+    const QByteArray alphaChannel = info.channelMap.value("A").toLatin1();
 
-    QRect paintRegion(xstart, ystart, width, height);
-    KisSequentialIterator it(layer->paintDevice(), paintRegion);
-    while (it.nextPixel()) {
+    auto createFrameBuffer = [&] (Rgba *frameBufferData) -> Imf::FrameBuffer {
+        Imf::FrameBuffer frameBuffer;
+        frameBuffer.insert(redChannel.constData(),
+                Imf::Slice(ptype, (char *) &frameBufferData->r,
+                           sizeof(Rgba) * 1,
+                           sizeof(Rgba) * width));
+        frameBuffer.insert(greenChannel.constData(),
+                Imf::Slice(ptype, (char *) &frameBufferData->g,
+                           sizeof(Rgba) * 1,
+                           sizeof(Rgba) * width));
+        frameBuffer.insert(blueChannel.constData(),
+                Imf::Slice(ptype, (char *) &frameBufferData->b,
+                           sizeof(Rgba) * 1,
+                           sizeof(Rgba) * width));
         if (hasAlpha) {
-            unmultiplyAlpha<RgbPixelWrapper<_T_> >(rgba);
+            frameBuffer.insert(alphaChannel.constData(),
+                    Imf::Slice(ptype, (char *) &frameBufferData->a,
+                               sizeof(Rgba) * 1,
+                               sizeof(Rgba) * width));
         }
+        return frameBuffer;
+    };
+
+    auto convertChunk = [&] (Rgba *rgba, const QRect &paintRegion) {
+        KisSequentialIterator it(layer->paintDevice(), paintRegion);
+        while (it.nextPixel()) {
+            if (hasAlpha) {
+                unmultiplyAlpha<RgbPixelWrapper<_T_> >(rgba);
+            }
 
-        typename KoRgbTraits<_T_>::Pixel* dst = reinterpret_cast<typename KoRgbTraits<_T_>::Pixel*>(it.rawData());
+            typename KoRgbTraits<_T_>::Pixel* dst = reinterpret_cast<typename KoRgbTraits<_T_>::Pixel*>(it.rawData());
 
-        dst->red = rgba->r;
-        dst->green = rgba->g;
-        dst->blue = rgba->b;
-        if (hasAlpha) {
-            dst->alpha = rgba->a;
-        } else {
-            dst->alpha = 1.0;
+            dst->red = rgba->r;
+            dst->green = rgba->g;
+            dst->blue = rgba->b;
+            if (hasAlpha) {
+                dst->alpha = rgba->a;
+            } else {
+                dst->alpha = 1.0;
+            }
+
+            ++rgba;
         }
+    };
 
-        ++rgba;
-    }
+    readPixelsInChunks<Rgba>(file, width, xstart, ystart, height, createFrameBuffer, convertChunk);
 }
 
 template<typename _T_>
@@ -437,49 +528,48 @@ void EXRConverter::Private::decodeData1(Imf::InputFile& file, ExrPaintLayerInfo&
     KIS_ASSERT_RECOVER_RETURN(
                 layer->paintDevice()->colorSpace()->colorModelId() == GrayAColorModelID);
 
-    QVector<pixel_type> pixels(width * height);
-
     Q_ASSERT(info.channelMap.contains("G"));
     dbgFile << "G -> " << info.channelMap["G"];
 
-    bool hasAlpha = info.channelMap.contains("A");
+    const bool hasAlpha = info.channelMap.contains("A");
     dbgFile << "Has Alpha:" << hasAlpha;
 
+    const QByteArray grayChannel = info.channelMap["G"].toLatin1();
+    const QByteArray alphaChannel = info.channelMap.value("A").toLatin1();
 
-    Imf::FrameBuffer frameBuffer;
-    pixel_type* frameBufferData = (pixels.data()) - xstart - ystart * width;
-    frameBuffer.insert(info.channelMap["G"].toLatin1().constData(),
-            Imf::Slice(ptype, (char *) &frameBufferData->gray,
-                       sizeof(pixel_type) * 1,
-                       sizeof(pixel_type) * width));
-
-    if (hasAlpha) {
-        frameBuffer.insert(info.channelMap["A"].toLatin1().constData(),
-                Imf::Slice(ptype, (char *) &frameBufferData->alpha,
+    auto createFrameBuffer = [&] (pixel_type *frameBufferData) -> Imf::FrameBuffer {
+        Imf::FrameBuffer frameBuffer;
+        frameBuffer.insert(grayChannel.constData(),
+                Imf::Slice(ptype, (char *) &frameBufferData->gray,
                            sizeof(pixel_type) * 1,
                            sizeof(pixel_type) * width));
-    }
-
-    file.setFrameBuffer(frameBuffer);
-    file.readPixels(ystart, height + ystart - 1);
-
-    pixel_type *srcPtr = pixels.data();
-
-    QRect paintRegion(xstart, ystart, width, height);
-    KisSequentialIterator it(layer->paintDevice(), paintRegion);
-    do {
 
         if (hasAlpha) {
-            unmultiplyAlpha<GrayPixelWrapper<_T_> >(srcPtr);
+            frameBuffer.insert(alphaChannel.constData(),
+                    Imf::Slice(ptype, (char *) &frameBufferData->alpha,
+                               sizeof(pixel_type) * 1,
+                               sizeof(pixel_type) * width));
         }
+        return frameBuffer;
+    };
+
+    auto convertChunk = [&] (pixel_type *srcPtr, const QRect &paintRegion) {
+        KisSequentialIterator it(layer->paintDevice(), paintRegion);
+        while (it.nextPixel()) {
+            if (hasAlpha) {
+                unmultiplyAlpha<GrayPixelWrapper<_T_> >(srcPtr);
+            }
 
-        pixel_type* dstPtr = reinterpret_cast<pixel_type*>(it.rawData());
+            pixel_type* dstPtr = reinterpret_cast<pixel_type*>(it.rawData());
 
-        dstPtr->gray = srcPtr->gray;
-        dstPtr->alpha = hasAlpha ? srcPtr->alpha : channel_type(1.0);
+            dstPtr->gray = srcPtr->gray;
+            dstPtr->alpha = hasAlpha ? srcPtr->alpha : channel_type(1.0);
+
+            ++srcPtr;
+        }
+    };
 
-        ++srcPtr;
-    } while (it.nextPixel());
+    readPixelsInChunks<pixel_type>(file, width, xstart, ystart, height, createFrameBuffer, convertChunk);
 }
 
 bool recCheckGroup(const ExrGroupLayerInfo& group, QStringList list, int idx1, int idx2)
@@ -24,6 +24,10 @@
 #include  <sdk/tests/kistest.h>
 
 #include <half.h>
+#include <ImfRgbaFile.h>
+#include <ImfTiledRgbaFile.h>
+#include <KoColorSpaceTraits.h>
+#include <kis_sequential_iterator.h>
 #include <KisMimeDatabase.h>
 #include "filestest.h"
 
@@ -105,6 +109,81 @@ void KisExrTest::testRoundTrip()
 
 }
 
+void KisExrTest::testChunkedImport_data()
+{
+    QTest::addColumn<bool>("tiled");
+    QTest::addColumn<int>("compression");
+
+    QTest::newRow("scanline-none") << false << int(Imf::NO_COMPRESSION);
+    QTest::newRow("scanline-zip") << false << int(Imf::ZIP_COMPRESSION);
+    QTest::newRow("scanline-piz") << false << int(Imf::PIZ_COMPRESSION);
+    QTest::newRow("tiled-zip") << true << int(Imf::ZIP_COMPRESSION);
+}
+
+void KisExrTest::testChunkedImport()
+{
+    QFETCH(bool, tiled);
+    QFETCH(int, compression);
+
+    // the data window is offset and its height is not a multiple of the chunk size
+    const Imath::Box2i displayWindow(Imath::V2i(0, 0), Imath::V2i(319, 549));
+    const Imath::Box2i dataWindow(Imath::V2i(7, 13), Imath::V2i(306, 529));
+    const int width = dataWindow.max.x - dataWindow.min.x + 1;
+    const int height = dataWindow.max.y - dataWindow.min.y + 1;
+
+    QVector<Imf::Rgba> pixels(width * height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            pixels[y * width + x] = Imf::Rgba(half(float(x) / width), half(float(y) / height), half(0.5f), half(1.0f));
+        }
+    }
+
+    QTemporaryFile file(QDir::tempPath() + QLatin1String("/krita_XXXXXX") + QLatin1String(".exr"));
+    QVERIFY(file.open());
+    file.close();
+
+    const QByteArray fileName = QFile::encodeName(file.fileName());
+    Imf::Header header(displayWindow, dataWindow, 1, Imath::V2f(0, 0), 1,
+                       Imf::INCREASING_Y, Imf::Compression(compression));
+    const Imf::Rgba *base = pixels.constData() - dataWindow.min.x - dataWindow.min.y * width;
+
+    if (tiled) {
+        Imf::TiledRgbaOutputFile out(fileName.constData(), header, Imf::WRITE_RGBA, 64, 64, Imf::ONE_LEVEL);
+        out.setFrameBuffer(base, 1, width);
+        out.writeTiles(0, out.numXTiles() - 1, 0, out.numYTiles() - 1);
+    } else {
+        Imf::RgbaOutputFile out(fileName.constData(), header, Imf::WRITE_RGBA);
+        out.setFrameBuffer(base, 1, width);
+        out.writePixels(height);
+    }
+
+    KisDocument *doc = KisPart::instance()->createDocument();
+    doc->setFileBatchMode(true);
+    QVERIFY(doc->importDocument(QUrl::fromLocalFile(file.fileName())));
+    QVERIFY(doc->image());
+
+    KisPaintDeviceSP dev = doc->image()->root()->firstChild()->paintDevice();
+    const QRect rc(dataWindow.min.x, dataWindow.min.y, width, height);
+    QCOMPARE(dev->exactBounds(), rc);
+
+    typedef KoRgbTraits<half>::Pixel Pixel;
+
+    const Imf::Rgba *src = pixels.constData();
+    KisSequentialConstIterator it(dev, rc);
+    while (it.nextPixel()) {
+        const Pixel *dst = reinterpret_cast<const Pixel*>(it.rawDataConst());
+
+        if (dst->red != src->r || dst->green != src->g ||
+            dst->blue != src->b || dst->alpha != src->a) {
+
+            QFAIL(QString("Pixel mismatch at %1, %2").arg(it.x()).arg(it.y()).toLatin1());
+        }
+        ++src;
+    }
+
+    delete doc;
+}
+
 KISTEST_MAIN(KisExrTest)
 
 
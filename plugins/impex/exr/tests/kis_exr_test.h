@@ -30,6 +30,8 @@ private Q_SLOTS:
     void testExportToReadonly();
     void testImportIncorrectFormat();
     void testRoundTrip();
+    void testChunkedImport_data();
+    void testChunkedImport();
 };
 
 #endif
@@ -0,0 +1,296 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisGifAnimationWriter.h"
+
+#include <QDebug>
+#include <QFuture>
+#include <QImage>
+#include <QIODevice>
+#include <QQueue>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <gif_lib.h>
+#include <string.h>
+
+#include <kis_assert.h>
+
+#include "KisGifPaletteQuantizer.h"
+
+namespace {
+
+struct EncodedFrame
+{
+    QRect rect;
+    QImage indexes;
+    int delay = 0;
+};
+
+int writeToDevice(GifFileType *gif, const GifByteType *data, int size)
+{
+    QIODevice *device = reinterpret_cast<QIODevice*>(gif->UserData);
+    return device->write(reinterpret_cast<const char*>(data), size);
+}
+
+QRect changedRect(const QImage &previous, const QImage &image)
+{
+    const int width = image.width();
+    const int rowBytes = width * sizeof(QRgb);
+
+    int top = -1;
+    int bottom = -1;
+    int left = width;
+    int right = -1;
+
+    for (int y = 0; y < image.height(); y++) {
+        const QRgb *prev = reinterpret_cast<const QRgb*>(previous.constScanLine(y));
+        const QRgb *curr = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+
+        if (!memcmp(prev, curr, rowBytes)) continue;
+
+        if (top < 0) top = y;
+        bottom = y;
+
+        int x = 0;
+        while (x < left && prev[x] == curr[x]) x++;
+        left = qMin(left, x);
+
+        x = width - 1;
+        while (x > right && prev[x] == curr[x]) x--;
+        right = qMax(right, x);
+    }
+
+    return top < 0 ? QRect() : QRect(left, top, right - left + 1, bottom - top + 1);
+}
+
+EncodedFrame encodeFrame(const QImage &image, const QImage &previous, int delay, bool dither)
+{
+    EncodedFrame frame;
+    frame.delay = delay;
+    frame.rect = previous.isNull() ? image.rect() : changedRect(previous, image);
+
+    if (!frame.rect.isEmpty()) {
+        frame.indexes = KisGifPaletteQuantizer::quantize(image, frame.rect, 256, dither);
+    }
+
+    return frame;
+}
+
+}
+
+struct KisGifAnimationWriter::Private
+{
+    GifFileType *gif = 0;
+    QSize size;
+    bool useFrameDelta = true;
+    bool dither = true;
+    bool failed = false;
+
+    QImage previousImage;
+    QQueue<QFuture<EncodedFrame>> pendingFrames;
+    int maxPendingFrames = 1;
+
+    EncodedFrame heldFrame;
+    bool hasHeldFrame = false;
+
+    void pushFrame(const EncodedFrame &frame);
+    void writeFrame(const EncodedFrame &frame);
+    void writeLoopExtension();
+};
+
+KisGifAnimationWriter::KisGifAnimationWriter(QIODevice *device, const QSize &size, bool useFrameDelta, bool dither)
+    : m_d(new Private)
+{
+    m_d->size = size;
+    m_d->useFrameDelta = useFrameDelta;
+    m_d->dither = dither;
+    m_d->maxPendingFrames = qMax(1, QThread::idealThreadCount());
+
+    int error = 0;
+    m_d->gif = EGifOpen(device, writeToDevice, &error);
+    if (!m_d->gif) {
+        qWarning("EGifOpen returned error %d", error);
+        m_d->failed = true;
+        return;
+    }
+
+    EGifSetGifVersion(m_d->gif, true);
+
+    // every frame has its own local palette, so no global one is written
+    if (EGifPutScreenDesc(m_d->gif, size.width(), size.height(), 8, 0, 0) == GIF_ERROR) {
+        qWarning("EGifPutScreenDesc returned error %d", m_d->gif->Error);
+        m_d->failed = true;
+        return;
+    }
+
+    m_d->writeLoopExtension();
+}
+
+KisGifAnimationWriter::~KisGifAnimationWriter()
+{
+    Q_FOREACH (QFuture<EncodedFrame> future, m_d->pendingFrames) {
+        future.waitForFinished();
+    }
+
+    if (m_d->gif) {
+        int error = 0;
+        EGifCloseFile(m_d->gif, &error);
+    }
+}
+
+bool KisGifAnimationWriter::addFrame(const QImage &srcImage, int delay)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(srcImage.size() == m_d->size, false);
+
+    if (m_d->failed) return false;
+
+    const QImage image =
+        srcImage.format() == QImage::Format_ARGB32 ?
+        srcImage : srcImage.convertToFormat(QImage::Format_ARGB32);
+
+    const QImage previous = m_d->useFrameDelta ? m_d->previousImage : QImage();
+    m_d->previousImage = image;
+
+    const bool dither = m_d->dither;
+
+    m_d->pendingFrames.enqueue(
+        QtConcurrent::run([image, previous, delay, dither] () {
+            return encodeFrame(image, previous, delay, dither);
+        }));
+
+    while (m_d->pendingFrames.size() > m_d->maxPendingFrames) {
+        m_d->pushFrame(m_d->pendingFrames.dequeue().result());
+    }
+
+    return !m_d->failed;
+}
+
+bool KisGifAnimationWriter::finish()
+{
+    while (!m_d->pendingFrames.isEmpty()) {
+        m_d->pushFrame(m_d->pendingFrames.dequeue().result());
+    }
+
+    if (m_d->hasHeldFrame) {
+        m_d->writeFrame(m_d->heldFrame);
+        m_d->hasHeldFrame = false;
+    }
+
+    if (m_d->gif) {
+        int error = 0;
+        if (EGifCloseFile(m_d->gif, &error) == GIF_ERROR) {
+            qWarning("EGifCloseFile returned error %d", error);
+            m_d->failed = true;
+        }
+        m_d->gif = 0;
+    }
+
+    m_d->previousImage = QImage();
+
+    return !m_d->failed;
+}
+
+void KisGifAnimationWriter::Private::pushFrame(const EncodedFrame &frame)
+{
+    /**
+     * The last frame is held back until the next one arrives, so that
+     * the delay of the following identical frames could be added to it.
+     */
+    if (frame.rect.isEmpty() && hasHeldFrame) {
+        heldFrame.delay += frame.delay;
+        return;
+    }
+
+    if (hasHeldFrame) {
+        writeFrame(heldFrame);
+    }
+
+    heldFrame = frame;
+    hasHeldFrame = true;
+}
+
+void KisGifAnimationWriter::Private::writeFrame(const EncodedFrame &frame)
+{
+    if (failed || frame.rect.isEmpty()) return;
+
+    GraphicsControlBlock gcb;
+    gcb.DisposalMode = DISPOSE_DO_NOT;
+    gcb.UserInputFlag = false;
+    gcb.DelayTime = qBound(0, frame.delay, 0xffff);
+    gcb.TransparentColor = NO_TRANSPARENT_COLOR;
+
+    GifByteType extension[4];
+    const size_t extensionLength = EGifGCBToExtension(&gcb, extension);
+
+    if (EGifPutExtension(gif, GRAPHICS_EXT_FUNC_CODE, extensionLength, extension) == GIF_ERROR) {
+        qWarning("EGifPutExtension returned error %d", gif->Error);
+        failed = true;
+        return;
+    }
+
+    const QVector<QRgb> palette = frame.indexes.colorTable();
+
+    // the size of a GIF color map must be a power of 2
+    const int colorCount = 1 << GifBitSize(qMax(2, palette.size()));
+    QVector<GifColorType> colors(colorCount);
+
+    for (int i = 0; i < palette.size(); i++) {
+        colors[i].Red = qRed(palette[i]);
+        colors[i].Green = qGreen(palette[i]);
+        colors[i].Blue = qBlue(palette[i]);
+    }
+
+    ColorMapObject *colorMap = GifMakeMapObject(colorCount, colors.data());
+    KIS_SAFE_ASSERT_RECOVER(colorMap) {
+        failed = true;
+        return;
+    }
+
+    if (EGifPutImageDesc(gif, frame.rect.x(), frame.rect.y(), frame.rect.width(), frame.rect.height(), false, colorMap) == GIF_ERROR) {
+        qWarning("EGifPutImageDesc returned error %d", gif->Error);
+        failed = true;
+    }
+
+    for (int y = 0; !failed && y < frame.rect.height(); y++) {
+        GifPixelType *line = const_cast<GifPixelType*>(frame.indexes.constScanLine(y));
+
+        if (EGifPutLine(gif, line, frame.rect.width()) == GIF_ERROR) {
+            qWarning("EGifPutLine returned error %d", gif->Error);
+            failed = true;
+        }
+    }
+
+    GifFreeMapObject(colorMap);
+}
+
+void KisGifAnimationWriter::Private::writeLoopExtension()
+{
+    // the Netscape application extension makes the animation loop forever
+    const GifByteType applicationId[] = "NETSCAPE2.0";
+    const GifByteType loopCount[] = { 1, 0, 0 };
+
+    if (EGifPutExtensionLeader(gif, APPLICATION_EXT_FUNC_CODE) == GIF_ERROR ||
+        EGifPutExtensionBlock(gif, 11, applicationId) == GIF_ERROR ||
+        EGifPutExtensionBlock(gif, 3, loopCount) == GIF_ERROR ||
+        EGifPutExtensionTrailer(gif) == GIF_ERROR) {
+
+        qWarning("Writing the loop extension returned error %d", gif->Error);
+        failed = true;
+    }
+}
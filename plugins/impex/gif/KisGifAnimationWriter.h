@@ -0,0 +1,67 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef KISGIFANIMATIONWRITER_H
+#define KISGIFANIMATIONWRITER_H
+
+#include <QScopedPointer>
+
+class QIODevice;
+class QImage;
+class QSize;
+
+/**
+ * Writes an animated GIF frame by frame. The frames are quantized
+ * concurrently, each into its own local palette, while the encoded
+ * frames are written into the device strictly in order as soon as they
+ * are ready, so only a few frames are kept in memory at a time.
+ *
+ * When frame delta encoding is enabled, only the rectangle that changed
+ * since the previous frame is stored, and frames identical to the
+ * previous one are merged into it by extending its delay.
+ *
+ * When dithering is enabled, the quantization error of every frame is
+ * diffused with KisGifPaletteQuantizer.
+ *
+ * The alpha channel of the frames is ignored.
+ */
+class KisGifAnimationWriter
+{
+public:
+    KisGifAnimationWriter(QIODevice *device, const QSize &size, bool useFrameDelta, bool dither = true);
+    ~KisGifAnimationWriter();
+
+    /**
+     * Queues a frame for writing
+     * @param image the frame, it must have the size passed to the constructor
+     * @param delay frame delay in hundredths of a second
+     * @return false if writing of any of the previous frames failed
+     */
+    bool addFrame(const QImage &image, int delay);
+
+    /**
+     * Writes all the pending frames and the end of the file
+     * @return true if the whole animation has been written successfully
+     */
+    bool finish();
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISGIFANIMATIONWRITER_H
@@ -0,0 +1,385 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisGifPaletteQuantizer.h"
+
+#include <QHash>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <limits>
+
+#include <kis_assert.h>
+
+namespace {
+
+const int binBits = 5;
+const int numBins = 1 << (3 * binBits);
+
+inline int binIndex(QRgb color)
+{
+    return ((qRed(color) >> (8 - binBits)) << (2 * binBits)) |
+           ((qGreen(color) >> (8 - binBits)) << binBits) |
+            (qBlue(color) >> (8 - binBits));
+}
+
+struct Histogram
+{
+    Histogram()
+        : count(numBins, 0),
+          red(numBins, 0),
+          green(numBins, 0),
+          blue(numBins, 0)
+    {
+    }
+
+    void add(const Histogram &rhs) {
+        for (int i = 0; i < numBins; i++) {
+            count[i] += rhs.count[i];
+            red[i] += rhs.red[i];
+            green[i] += rhs.green[i];
+            blue[i] += rhs.blue[i];
+        }
+    }
+
+    QVector<quint64> count;
+    QVector<quint64> red;
+    QVector<quint64> green;
+    QVector<quint64> blue;
+};
+
+/**
+ * A leaf of the color octree. A leaf at \p depth covers all the
+ * colors whose top \p depth bits of every channel are encoded in
+ * \p key.
+ */
+struct Leaf
+{
+    int depth = binBits;
+    int key = 0;
+    quint64 count = 0;
+    quint64 red = 0;
+    quint64 green = 0;
+    quint64 blue = 0;
+
+    void add(const Leaf &rhs) {
+        count += rhs.count;
+        red += rhs.red;
+        green += rhs.green;
+        blue += rhs.blue;
+    }
+
+    int parentKey() const {
+        const int mask = (1 << depth) - 1;
+        const int r = key >> (2 * depth);
+        const int g = (key >> depth) & mask;
+        const int b = key & mask;
+        const int parentDepth = depth - 1;
+
+        return ((r >> 1) << (2 * parentDepth)) | ((g >> 1) << parentDepth) | (b >> 1);
+    }
+
+    QRgb color() const {
+        return qRgb(red / count, green / count, blue / count);
+    }
+};
+
+inline int binCenter(int bin, int shift)
+{
+    return (((bin >> shift) & ((1 << binBits) - 1)) << (8 - binBits)) | (1 << (7 - binBits));
+}
+
+inline int nearestColor(const QRgb *palette, int paletteSize, int r, int g, int b)
+{
+    int bestIndex = 0;
+    int bestDistance = std::numeric_limits<int>::max();
+
+    for (int index = 0; index < paletteSize; index++) {
+        const QRgb c = palette[index];
+        const int dr = qRed(c) - r;
+        const int dg = qGreen(c) - g;
+        const int db = qBlue(c) - b;
+        const int distance = dr * dr + dg * dg + db * db;
+
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            bestIndex = index;
+        }
+    }
+
+    return bestIndex;
+}
+
+/**
+ * Maps a row with Floyd-Steinberg error diffusion. The errors are kept
+ * in 1/16 units, \p currErrors holds the errors diffused into this row
+ * and \p nextErrors receives the errors for the next one. Both arrays
+ * have a padding element on each side.
+ */
+void ditherRow(const QRgb *src, uchar *dst, int width,
+               const quint8 *lookup, const QRgb *palette,
+               int *currErrors, int *nextErrors)
+{
+    std::fill(nextErrors, nextErrors + 3 * (width + 2), 0);
+
+    for (int x = 0; x < width; x++) {
+        int *curr = currErrors + 3 * (x + 1);
+        int *next = nextErrors + 3 * (x + 1);
+
+        const int r = qBound(0, qRed(src[x]) + curr[0] / 16, 255);
+        const int g = qBound(0, qGreen(src[x]) + curr[1] / 16, 255);
+        const int b = qBound(0, qBlue(src[x]) + curr[2] / 16, 255);
+
+        const int index = lookup[binIndex(qRgb(r, g, b))];
+        dst[x] = index;
+
+        const int error[3] = {
+            r - qRed(palette[index]),
+            g - qGreen(palette[index]),
+            b - qBlue(palette[index])
+        };
+
+        for (int ch = 0; ch < 3; ch++) {
+            curr[3 + ch] += error[ch] * 7;
+            next[-3 + ch] += error[ch] * 3;
+            next[ch] += error[ch] * 5;
+            next[3 + ch] += error[ch];
+        }
+    }
+}
+
+QVector<int> splitIntoChunks(int size)
+{
+    const int numChunks = qBound(1, QThread::idealThreadCount(), size);
+
+    QVector<int> chunks;
+    for (int i = 0; i < numChunks; i++) {
+        chunks.append(i);
+    }
+    return chunks;
+}
+
+Histogram collectHistogram(const QImage &image, const QRect &rect)
+{
+    const QVector<int> chunks = splitIntoChunks(rect.height());
+    const int rowsPerChunk = (rect.height() + chunks.size() - 1) / chunks.size();
+
+    QVector<Histogram> partial(chunks.size());
+    Histogram *partialData = partial.data();
+
+    QtConcurrent::blockingMap(chunks, [&] (int chunk) {
+        quint64 *count = partialData[chunk].count.data();
+        quint64 *red = partialData[chunk].red.data();
+        quint64 *green = partialData[chunk].green.data();
+        quint64 *blue = partialData[chunk].blue.data();
+
+        const int firstRow = rect.y() + chunk * rowsPerChunk;
+        const int lastRow = qMin(firstRow + rowsPerChunk, rect.y() + rect.height());
+
+        for (int y = firstRow; y < lastRow; y++) {
+            const QRgb *src = reinterpret_cast<const QRgb*>(image.constScanLine(y)) + rect.x();
+
+            for (int x = 0; x < rect.width(); x++) {
+                const QRgb color = src[x];
+                const int bin = binIndex(color);
+
+                count[bin]++;
+                red[bin] += qRed(color);
+                green[bin] += qGreen(color);
+                blue[bin] += qBlue(color);
+            }
+        }
+    });
+
+    for (int i = 1; i < partial.size(); i++) {
+        partial[0].add(partial[i]);
+    }
+
+    return partial[0];
+}
+
+/**
+ * Merges the leaves of the octree bottom-up, the least populated
+ * nodes first, until no more than \p maxColors leaves are left
+ */
+QVector<Leaf> reduceOctree(QVector<Leaf> leaves, int maxColors)
+{
+    for (int depth = binBits; depth > 0 && leaves.size() > maxColors; depth--) {
+        QHash<int, Leaf> parents;
+        QHash<int, QVector<Leaf>> children;
+
+        Q_FOREACH (const Leaf &leaf, leaves) {
+            const int key = leaf.parentKey();
+
+            Leaf &parent = parents[key];
+            parent.depth = depth - 1;
+            parent.key = key;
+            parent.add(leaf);
+
+            children[key].append(leaf);
+        }
+
+        QVector<Leaf> sortedParents = parents.values().toVector();
+        std::sort(sortedParents.begin(), sortedParents.end(),
+                  [] (const Leaf &lhs, const Leaf &rhs) {
+                      return lhs.count < rhs.count;
+                  });
+
+        int numLeaves = leaves.size();
+        QVector<Leaf> reducedLeaves;
+
+        Q_FOREACH (const Leaf &parent, sortedParents) {
+            const QVector<Leaf> &nodeChildren = children[parent.key];
+
+            if (numLeaves > maxColors) {
+                reducedLeaves.append(parent);
+                numLeaves -= nodeChildren.size() - 1;
+            } else {
+                reducedLeaves += nodeChildren;
+            }
+        }
+
+        leaves = reducedLeaves;
+    }
+
+    return leaves;
+}
+
+}
+
+namespace KisGifPaletteQuantizer
+{
+
+QImage quantize(const QImage &srcImage, const QRect &srcRect, int maxColors, bool dither)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(maxColors > 0 && maxColors <= 256, QImage());
+
+    const QRect rect = srcRect & srcImage.rect();
+    if (rect.isEmpty()) return QImage();
+
+    QImage image = srcImage;
+    if (image.format() != QImage::Format_RGB32 &&
+        image.format() != QImage::Format_ARGB32 &&
+        image.format() != QImage::Format_ARGB32_Premultiplied) {
+
+        image = image.convertToFormat(QImage::Format_ARGB32);
+    }
+
+    const Histogram histogram = collectHistogram(image, rect);
+
+    QVector<Leaf> leaves;
+    QVector<int> usedBins;
+
+    for (int bin = 0; bin < numBins; bin++) {
+        if (!histogram.count[bin]) continue;
+
+        Leaf leaf;
+        leaf.key = bin;
+        leaf.count = histogram.count[bin];
+        leaf.red = histogram.red[bin];
+        leaf.green = histogram.green[bin];
+        leaf.blue = histogram.blue[bin];
+
+        leaves.append(leaf);
+        usedBins.append(bin);
+    }
+
+    leaves = reduceOctree(leaves, maxColors);
+
+    QVector<QRgb> palette;
+    Q_FOREACH (const Leaf &leaf, leaves) {
+        palette.append(leaf.color());
+    }
+
+    /**
+     * Every used bin is mapped to the closest palette color rather than
+     * to its octree leaf, which avoids the visible seams of the octree
+     * subdivision. The diffused error may push a pixel into any bin, so
+     * with dithering the unused bins are mapped as well, by their centers.
+     */
+    QVector<quint8> lookup(numBins, 0);
+    quint8 *lookupData = lookup.data();
+    const QRgb *paletteColors = palette.constData();
+    const int paletteSize = palette.size();
+
+    {
+        const int numLookupBins = dither ? numBins : usedBins.size();
+        const QVector<int> chunks = splitIntoChunks(numLookupBins);
+        const int binsPerChunk = (numLookupBins + chunks.size() - 1) / chunks.size();
+
+        QtConcurrent::blockingMap(chunks, [&] (int chunk) {
+            const int first = chunk * binsPerChunk;
+            const int last = qMin(first + binsPerChunk, numLookupBins);
+
+            for (int i = first; i < last; i++) {
+                const int bin = dither ? i : usedBins[i];
+                const quint64 count = histogram.count[bin];
+
+                const int r = count ? int(histogram.red[bin] / count) : binCenter(bin, 2 * binBits);
+                const int g = count ? int(histogram.green[bin] / count) : binCenter(bin, binBits);
+                const int b = count ? int(histogram.blue[bin] / count) : binCenter(bin, 0);
+
+                lookupData[bin] = nearestColor(paletteColors, paletteSize, r, g, b);
+            }
+        });
+    }
+
+    QImage result(rect.size(), QImage::Format_Indexed8);
+    result.setColorTable(palette);
+
+    uchar *resultData = result.bits();
+    const int resultBytesPerLine = result.bytesPerLine();
+
+    {
+        const QVector<int> chunks = splitIntoChunks(rect.height());
+        const int rowsPerChunk = (rect.height() + chunks.size() - 1) / chunks.size();
+
+        QtConcurrent::blockingMap(chunks, [&] (int chunk) {
+            const int firstRow = chunk * rowsPerChunk;
+            const int lastRow = qMin(firstRow + rowsPerChunk, rect.height());
+
+            QVector<int> currErrors;
+            QVector<int> nextErrors;
+
+            if (dither) {
+                currErrors.fill(0, 3 * (rect.width() + 2));
+                nextErrors.fill(0, 3 * (rect.width() + 2));
+            }
+
+            for (int y = firstRow; y < lastRow; y++) {
+                const QRgb *src = reinterpret_cast<const QRgb*>(image.constScanLine(rect.y() + y)) + rect.x();
+                uchar *dst = resultData + y * resultBytesPerLine;
+
+                if (dither) {
+                    ditherRow(src, dst, rect.width(), lookupData, paletteColors,
+                              currErrors.data(), nextErrors.data());
+                    std::swap(currErrors, nextErrors);
+                } else {
+                    for (int x = 0; x < rect.width(); x++) {
+                        dst[x] = lookupData[binIndex(src[x])];
+                    }
+                }
+            }
+        });
+    }
+
+    return result;
+}
+
+}
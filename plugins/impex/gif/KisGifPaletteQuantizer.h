@@ -0,0 +1,49 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef KISGIFPALETTEQUANTIZER_H
+#define KISGIFPALETTEQUANTIZER_H
+
+#include <QImage>
+#include <QRect>
+
+/**
+ * A fast palette quantizer for GIF encoding. The color histogram is
+ * collected over 15-bit color bins, reduced to a palette with an
+ * octree and the pixels are mapped through a per-bin lookup table,
+ * optionally with Floyd-Steinberg error diffusion. The histogram and
+ * the mapping are computed in parallel.
+ *
+ * The alpha channel is ignored.
+ */
+namespace KisGifPaletteQuantizer
+{
+
+/**
+ * Converts \p rect of \p image into an indexed image with at most
+ * \p maxColors colors. The palette is stored in the color table of
+ * the returned image.
+ *
+ * When \p dither is true, the quantization error is diffused to the
+ * neighbouring pixels. The rows are processed in parallel bands, and
+ * the error is not carried over from one band to the next one.
+ */
+QImage quantize(const QImage &image, const QRect &rect, int maxColors = 256, bool dither = true);
+
+}
+
+#endif // KISGIFPALETTEQUANTIZER_H
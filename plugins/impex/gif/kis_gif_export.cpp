@@ -32,8 +32,12 @@
 #include <KisDocument.h>
 #include <kis_image.h>
 #include <kis_paint_layer.h>
+#include <kis_image_animation_interface.h>
+#include <kis_properties_configuration.h>
+#include <kis_time_range.h>
 
 #include "qgiflibhandler.h"
+#include "KisGifAnimationWriter.h"
 
 K_PLUGIN_FACTORY_WITH_JSON(KisGIFExportFactory, "krita_gif_export.json", registerPlugin<KisGIFExport>();)
 
@@ -47,13 +51,25 @@ KisGIFExport::~KisGIFExport()
 
 KisImportExportErrorCode KisGIFExport::convert(KisDocument *document, QIODevice *io,  KisPropertiesConfigurationSP configuration)
 {
-    Q_UNUSED(configuration);
-    QRect rc = document->savingImage()->bounds();
-    QImage image = document->savingImage()->projection()->convertToQImage(0, 0, 0, rc.width(), rc.height(), KoColorConversionTransformation::internalRenderingIntent(), KoColorConversionTransformation::internalConversionFlags());
+    KisImageSP image = document->savingImage();
+
+    if (!configuration) {
+        configuration = defaultConfiguration();
+    }
+
+    const bool dither = configuration->getBool("dither", true);
+
+    if (image->animationInterface()->hasAnimation() && configuration->getBool("animated", true)) {
+        return convertAnimation(image, io, configuration->getBool("frameDelta", true), dither);
+    }
+
+    QRect rc = image->bounds();
+    QImage qimage = image->projection()->convertToQImage(0, 0, 0, rc.width(), rc.height(), KoColorConversionTransformation::internalRenderingIntent(), KoColorConversionTransformation::internalConversionFlags());
 
     QGIFLibHandler handler;
     handler.setDevice(io);
-    bool result = handler.write(image);
+    handler.setDithering(dither);
+    bool result = handler.write(qimage);
     if (!result) {
        KIS_ASSERT_RECOVER_RETURN_VALUE(true, ImportExportCodes::InternalError);
        return ImportExportCodes::InternalError;
@@ -61,8 +77,71 @@ KisImportExportErrorCode KisGIFExport::convert(KisDocument *document, QIODevice
     return ImportExportCodes::OK;
 }
 
+KisImportExportErrorCode KisGIFExport::convertAnimation(KisImageSP image, QIODevice *io, bool useFrameDelta, bool dither)
+{
+    KisImageAnimationInterface *animation = image->animationInterface();
+
+    const QRect bounds = image->bounds();
+    const KisTimeRange range = animation->fullClipRange();
+    const int framerate = qMax(1, animation->framerate());
+
+    KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(range.isValid() && !range.isInfinite(), ImportExportCodes::InternalError);
+
+    /**
+     * The frames are regenerated one by one in this thread, while the
+     * writer quantizes the already rendered ones in the background and
+     * writes them out in order.
+     */
+    KisGifAnimationWriter writer(io, bounds.size(), useFrameDelta, dither);
+    bool success = true;
+    int writtenTime = 0;
+
+    for (int frame = range.start(); success && frame <= range.end(); frame++) {
+        animation->switchCurrentTimeAsync(frame);
+        image->waitForDone();
+
+        const QImage frameImage =
+            image->projection()->convertToQImage(0, bounds.x(), bounds.y(), bounds.width(), bounds.height(),
+                                                 KoColorConversionTransformation::internalRenderingIntent(),
+                                                 KoColorConversionTransformation::internalConversionFlags());
+
+        /**
+         * The delays are in hundredths of a second, so the rounding error is
+         * distributed over the frames. Most viewers replace delays shorter
+         * than 2 with a much slower default, so such frames are stretched
+         * and the following ones catch up with the timeline when possible.
+         */
+        const int index = frame - range.start();
+        const int delay = qMax(2, qRound(100.0 * (index + 1) / framerate) - writtenTime);
+        writtenTime += delay;
+
+        success = writer.addFrame(frameImage, delay);
+
+        setProgress(100 * (index + 1) / range.duration());
+    }
+
+    success &= writer.finish();
+
+    return success ? ImportExportCodes::OK : ImportExportCodes::ErrorWhileWriting;
+}
+
+KisPropertiesConfigurationSP KisGIFExport::defaultConfiguration(const QByteArray &, const QByteArray &) const
+{
+    KisPropertiesConfigurationSP cfg = new KisPropertiesConfiguration();
+    cfg->setProperty("animated", true);
+    cfg->setProperty("frameDelta", true);
+    cfg->setProperty("dither", true);
+    return cfg;
+}
+
+KisConfigWidget *KisGIFExport::createConfigurationWidget(QWidget *parent, const QByteArray &/*from*/, const QByteArray &/*to*/) const
+{
+    return new KisWdgOptionsGif(parent);
+}
+
 void KisGIFExport::initializeCapabilities()
 {
+    addCapability(KisExportCheckRegistry::instance()->get("AnimationCheck")->create(KisExportCheckBase::SUPPORTED));
 
     QList<QPair<KoID, KoID> > supportedColorModels;
     supportedColorModels << QPair<KoID, KoID>()
@@ -72,5 +151,22 @@ void KisGIFExport::initializeCapabilities()
 
 
 
+void KisWdgOptionsGif::setConfiguration(const KisPropertiesConfigurationSP cfg)
+{
+    chkAnimated->setChecked(cfg->getBool("animated", true));
+    chkFrameDelta->setChecked(cfg->getBool("frameDelta", true));
+    chkFrameDelta->setEnabled(chkAnimated->isChecked());
+    chkDither->setChecked(cfg->getBool("dither", true));
+}
+
+KisPropertiesConfigurationSP KisWdgOptionsGif::configuration() const
+{
+    KisPropertiesConfigurationSP cfg = new KisPropertiesConfiguration();
+    cfg->setProperty("animated", chkAnimated->isChecked());
+    cfg->setProperty("frameDelta", chkFrameDelta->isChecked());
+    cfg->setProperty("dither", chkDither->isChecked());
+    return cfg;
+}
+
 #include "kis_gif_export.moc"
 
@@ -23,6 +23,24 @@
 #include <QVariant>
 
 #include <KisImportExportFilter.h>
+#include <kis_config_widget.h>
+#include "ui_kis_wdg_options_gif.h"
+
+class KisWdgOptionsGif : public KisConfigWidget, public Ui::WdgOptionsGif
+{
+    Q_OBJECT
+
+public:
+    KisWdgOptionsGif(QWidget *parent)
+        : KisConfigWidget(parent)
+    {
+        setupUi(this);
+        connect(chkAnimated, SIGNAL(toggled(bool)), chkFrameDelta, SLOT(setEnabled(bool)));
+    }
+
+    void setConfiguration(const KisPropertiesConfigurationSP  cfg) override;
+    KisPropertiesConfigurationSP configuration() const override;
+};
 
 class KisGIFExport : public KisImportExportFilter
 {
@@ -32,7 +50,12 @@ public:
     ~KisGIFExport() override;
 public:
     KisImportExportErrorCode convert(KisDocument *document, QIODevice *io,  KisPropertiesConfigurationSP configuration = 0) override;
+    KisPropertiesConfigurationSP defaultConfiguration(const QByteArray& from = "", const QByteArray& to = "") const override;
+    KisConfigWidget *createConfigurationWidget(QWidget *parent, const QByteArray& from = "", const QByteArray& to = "") const override;
     void initializeCapabilities() override;
+
+private:
+    KisImportExportErrorCode convertAnimation(KisImageSP image, QIODevice *io, bool useFrameDelta, bool dither);
 };
 
 #endif
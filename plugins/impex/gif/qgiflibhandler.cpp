@@ -23,6 +23,8 @@
 #include <string.h>		// memset
 #include <QPainter>
 
+#include "KisGifPaletteQuantizer.h"
+
 extern int _GifError;
 
 static const int InterlacedOffset[] = { 0, 4, 2, 1 };	/* The way Interlaced image should */
@@ -232,12 +234,16 @@ bool QGIFLibHandler::canRead(QIODevice *device)
     return false;
 }
 
+void QGIFLibHandler::setDithering(bool value)
+{
+    m_dithering = value;
+}
+
 bool QGIFLibHandler::write ( const QImage & image )
 {
     QImage toWrite(image);
-    /// @todo how to specify dithering method
     if (toWrite.colorCount() == 0 || toWrite.colorCount() > 256)
-        toWrite = image.convertToFormat(QImage::Format_Indexed8);
+        toWrite = KisGifPaletteQuantizer::quantize(image, image.rect(), 256, m_dithering);
 
     QVector<QRgb> colorTable = toWrite.colorTable();
     ColorMapObject cmap;
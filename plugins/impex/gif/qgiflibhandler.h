@@ -35,8 +35,15 @@ public:
     void setOption ( ImageOption option, const QVariant & value );
     QVariant option( ImageOption option ) const;
 
+    /**
+     * Enables error diffusion when the written image has to be
+     * quantized, it is enabled by default
+     */
+    void setDithering(bool value);
+
 private:
     QString m_description;
+    bool m_dithering = true;
 };
 
 #endif // QGIFLIBHANDLER_H
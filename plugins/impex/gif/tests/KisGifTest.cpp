@@ -20,10 +20,30 @@
 
 
 #include <QTest>
+#include <QBuffer>
+#include <QFile>
 #include <QCoreApplication>
 
+#include <gif_lib.h>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+#include <KisDocument.h>
+#include <KisPart.h>
+#include <kis_image.h>
+#include <kis_paint_layer.h>
+#include <kis_keyframe_channel.h>
+#include <kis_image_animation_interface.h>
+#include <kis_properties_configuration.h>
+#include <kis_surrogate_undo_store.h>
+#include <kis_time_range.h>
+#include <kundo2command.h>
+
 #include "filestest.h"
 
+#include "../KisGifPaletteQuantizer.h"
+#include "../KisGifAnimationWriter.h"
+
 #ifndef FILES_DATA_DIR
 #error "FILES_DATA_DIR not set. A directory with the data used for testing the importing of files in krita"
 #endif
@@ -51,6 +71,259 @@ void KisGifTest::testImportIncorrectFormat()
 }
 
 
+void KisGifTest::testQuantizeFewColors()
+{
+    QImage image(64, 32, QImage::Format_ARGB32);
+    image.fill(qRgb(10, 200, 30));
+    image.setPixel(5, 5, qRgb(255, 0, 0));
+    image.setPixel(40, 20, qRgb(0, 0, 255));
+
+    const QImage result = KisGifPaletteQuantizer::quantize(image, image.rect());
+
+    QCOMPARE(result.format(), QImage::Format_Indexed8);
+    QCOMPARE(result.size(), image.size());
+    QCOMPARE(result.colorCount(), 3);
+
+    for (int y = 0; y < image.height(); y++) {
+        for (int x = 0; x < image.width(); x++) {
+            QCOMPARE(result.pixel(x, y), image.pixel(x, y));
+        }
+    }
+}
+
+void KisGifTest::testQuantizeManyColors()
+{
+    QImage image(256, 256, QImage::Format_ARGB32);
+    for (int y = 0; y < image.height(); y++) {
+        for (int x = 0; x < image.width(); x++) {
+            image.setPixel(x, y, qRgb(x, y, (x + y) / 2));
+        }
+    }
+
+    const QRect rect(16, 32, 200, 100);
+    const QImage result = KisGifPaletteQuantizer::quantize(image, rect);
+
+    QCOMPARE(result.size(), rect.size());
+    QVERIFY(result.colorCount() <= 256);
+    QVERIFY(result.colorCount() > 128);
+
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            const QRgb src = image.pixel(rect.x() + x, rect.y() + y);
+            const QRgb dst = result.pixel(x, y);
+
+            QVERIFY(qAbs(qRed(src) - qRed(dst)) < 32);
+            QVERIFY(qAbs(qGreen(src) - qGreen(dst)) < 32);
+            QVERIFY(qAbs(qBlue(src) - qBlue(dst)) < 32);
+        }
+    }
+}
+
+void KisGifTest::testQuantizeDither()
+{
+    QImage image(256, 64, QImage::Format_ARGB32);
+    for (int y = 0; y < image.height(); y++) {
+        for (int x = 0; x < image.width(); x++) {
+            image.setPixel(x, y, qRgb(x, x, x));
+        }
+    }
+
+    const QImage plain = KisGifPaletteQuantizer::quantize(image, image.rect(), 4, false);
+    const QImage dithered = KisGifPaletteQuantizer::quantize(image, image.rect(), 4, true);
+
+    QCOMPARE(plain.colorTable(), dithered.colorTable());
+
+    /**
+     * Error diffusion keeps the average color of an area close to the
+     * original one, while the plain mapping produces flat bands
+     */
+    auto blockError = [&image] (const QImage &result) {
+        int maxError = 0;
+
+        // the blocks at the ends of the ramp lie outside the range of the palette
+        for (int bx = 64; bx < 192; bx += 16) {
+            int srcSum = 0;
+            int dstSum = 0;
+
+            for (int y = 16; y < 48; y++) {
+                for (int x = bx; x < bx + 16; x++) {
+                    srcSum += qGray(image.pixel(x, y));
+                    dstSum += qGray(result.pixel(x, y));
+                }
+            }
+
+            maxError = qMax(maxError, qAbs(srcSum - dstSum) / (16 * 32));
+        }
+
+        return maxError;
+    };
+
+    QVERIFY(blockError(dithered) < 8);
+    QVERIFY(blockError(dithered) < blockError(plain));
+}
+
+namespace {
+int readFromDevice(GifFileType *gif, GifByteType *data, int size)
+{
+    QIODevice *device = reinterpret_cast<QIODevice*>(gif->UserData);
+    return device->read(reinterpret_cast<char*>(data), size);
+}
+}
+
+void KisGifTest::testAnimationFrameDelta()
+{
+    const QSize size(100, 80);
+
+    QImage frame1(size, QImage::Format_ARGB32);
+    frame1.fill(qRgb(255, 255, 255));
+
+    QImage frame2 = frame1;
+    for (int y = 10; y < 30; y++) {
+        for (int x = 20; x < 60; x++) {
+            frame2.setPixel(x, y, qRgb(255, 0, 0));
+        }
+    }
+
+    QByteArray data;
+
+    {
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+
+        KisGifAnimationWriter writer(&buffer, size, true);
+        QVERIFY(writer.addFrame(frame1, 4));
+        QVERIFY(writer.addFrame(frame1, 4));
+        QVERIFY(writer.addFrame(frame2, 4));
+        QVERIFY(writer.finish());
+    }
+
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+
+    int error = 0;
+    GifFileType *gif = DGifOpen(&buffer, readFromDevice, &error);
+    QVERIFY(gif);
+    QCOMPARE(DGifSlurp(gif), GIF_OK);
+
+    QCOMPARE(gif->SWidth, size.width());
+    QCOMPARE(gif->SHeight, size.height());
+
+    // the second frame is identical to the first one, so it is merged into it
+    QCOMPARE(gif->ImageCount, 2);
+
+    GraphicsControlBlock gcb;
+    QCOMPARE(DGifSavedExtensionToGCB(gif, 0, &gcb), GIF_OK);
+    QCOMPARE(gcb.DelayTime, 8);
+
+    const GifImageDesc &desc = gif->SavedImages[1].ImageDesc;
+    QCOMPARE(QRect(desc.Left, desc.Top, desc.Width, desc.Height), QRect(20, 10, 40, 20));
+
+    DGifCloseFile(gif, &error);
+}
+
+void KisGifTest::testExportAnimation_data()
+{
+    QTest::addColumn<bool>("frameDelta");
+    QTest::addColumn<int>("framerate");
+    QTest::addColumn<QVector<int>>("delays");
+    QTest::addColumn<QVector<QRect>>("rects");
+
+    const QRect bounds(0, 0, 64, 48);
+    const QRect changed(10, 10, 20, 15);
+
+    /**
+     * 30 fps gives delays of 3.33 hundredths of a second, the rounding
+     * error is distributed: 3, 4, 3, 3. With frame delta, identical
+     * frames are merged into the previous ones. At 60 fps the delays
+     * would go below 2 hundredths of a second, so they are clamped.
+     */
+    QTest::newRow("full") << false << 30
+                          << (QVector<int>() << 3 << 4 << 3 << 3)
+                          << (QVector<QRect>() << bounds << bounds << bounds << bounds);
+
+    QTest::newRow("delta") << true << 30
+                           << (QVector<int>() << 7 << 6)
+                           << (QVector<QRect>() << bounds << changed);
+
+    QTest::newRow("clamped") << false << 60
+                             << (QVector<int>() << 2 << 2 << 2 << 2)
+                             << (QVector<QRect>() << bounds << bounds << bounds << bounds);
+}
+
+void KisGifTest::testExportAnimation()
+{
+    QFETCH(bool, frameDelta);
+    QFETCH(int, framerate);
+    QFETCH(QVector<int>, delays);
+    QFETCH(QVector<QRect>, rects);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+    doc->setFileBatchMode(true);
+
+    KisImageSP image = new KisImage(new KisSurrogateUndoStore(), 64, 48, cs, "gif animation");
+    KisPaintLayerSP layer = new KisPaintLayer(image, "layer", OPACITY_OPAQUE_U8);
+    image->addNode(layer);
+    doc->setCurrentImage(image);
+
+    layer->paintDevice()->fill(image->bounds(), KoColor(Qt::red, cs));
+
+    KUndo2Command parentCommand;
+
+    layer->enableAnimation();
+    KisKeyframeChannel *channel = layer->getKeyframeChannel(KisKeyframeChannel::Content.id(), true);
+    QVERIFY(channel);
+
+    channel->addKeyframe(2, &parentCommand);
+    image->animationInterface()->switchCurrentTimeAsync(2);
+    image->waitForDone();
+    layer->paintDevice()->fill(image->bounds(), KoColor(Qt::red, cs));
+    layer->paintDevice()->fill(QRect(10, 10, 20, 15), KoColor(Qt::blue, cs));
+
+    image->animationInterface()->setFullClipRange(KisTimeRange::fromTime(0, 3));
+    image->animationInterface()->setFramerate(framerate);
+
+    KisPropertiesConfigurationSP cfg = new KisPropertiesConfiguration();
+    cfg->setProperty("animated", true);
+    cfg->setProperty("frameDelta", frameDelta);
+    cfg->setProperty("dither", true);
+
+    const QString fileName = QString("gif_animation_%1.gif").arg(QTest::currentDataTag());
+    QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile(fileName), GifMimetype.toLatin1(), cfg));
+
+    int error = 0;
+    GifFileType *gif = DGifOpenFileName(QFile::encodeName(fileName).constData(), &error);
+    QVERIFY(gif);
+    QCOMPARE(DGifSlurp(gif), GIF_OK);
+
+    QCOMPARE(gif->ImageCount, delays.size());
+
+    for (int i = 0; i < gif->ImageCount; i++) {
+        GraphicsControlBlock gcb;
+        QCOMPARE(DGifSavedExtensionToGCB(gif, i, &gcb), GIF_OK);
+        QCOMPARE(int(gcb.DelayTime), delays[i]);
+
+        const GifImageDesc &desc = gif->SavedImages[i].ImageDesc;
+        QCOMPARE(QRect(desc.Left, desc.Top, desc.Width, desc.Height), rects[i]);
+    }
+
+    /**
+     * The frames are uniform, so the dithering doesn't change them. The
+     * first frame is red, the last one has the blue rect at (10, 10).
+     */
+    auto pixelColor = [gif] (int imageIndex, int x, int y) {
+        const SavedImage &saved = gif->SavedImages[imageIndex];
+        const int index = saved.RasterBits[(y - saved.ImageDesc.Top) * saved.ImageDesc.Width + (x - saved.ImageDesc.Left)];
+        const GifColorType &c = saved.ImageDesc.ColorMap->Colors[index];
+        return qRgb(c.Red, c.Green, c.Blue);
+    };
+
+    QCOMPARE(pixelColor(0, 40, 40), qRgb(255, 0, 0));
+    QCOMPARE(pixelColor(gif->ImageCount - 1, 15, 15), qRgb(0, 0, 255));
+
+    DGifCloseFile(gif, &error);
+}
 
 KISTEST_MAIN(KisGifTest)
 
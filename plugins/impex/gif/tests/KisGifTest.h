@@ -29,6 +29,13 @@ private Q_SLOTS:
     void testImportFromWriteonly();
     void testExportToReadonly();
     void testImportIncorrectFormat();
+
+    void testQuantizeFewColors();
+    void testQuantizeManyColors();
+    void testQuantizeDither();
+    void testAnimationFrameDelta();
+    void testExportAnimation_data();
+    void testExportAnimation();
 };
 
 #endif // _KIS_BRUSH_TEST_H_
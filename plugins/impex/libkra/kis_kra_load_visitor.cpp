@@ -68,6 +68,7 @@
 #include "kis_raster_keyframe_channel.h"
 #include "kis_paint_device_frames_interface.h"
 #include "kis_filter_registry.h"
+#include "KisSavedPixelDataTracker.h"
 
 
 using namespace KRA;
@@ -109,6 +110,7 @@ KisKraLoadVisitor::KisKraLoadVisitor(KisImageSP image,
     , m_keyframeFilenames(keyframeFilenames)
     , m_name(name)
     , m_shapeController(shapeController)
+    , m_savedPixelData(0)
 {
     m_store->pushDirectory();
 
@@ -136,6 +138,11 @@ void KisKraLoadVisitor::setExternalUri(const QString &uri)
     m_uri = uri;
 }
 
+void KisKraLoadVisitor::setSavedPixelDataTracker(KisSavedPixelDataTracker *tracker)
+{
+    m_savedPixelData = tracker;
+}
+
 bool KisKraLoadVisitor::visit(KisExternalLayer * layer)
 {
     bool result = false;
@@ -200,6 +207,9 @@ bool KisKraLoadVisitor::visit(KisPaintLayer *layer)
     if (!loadProfile(layer->paintDevice(), getLocation(layer, DOT_ICC))) {
         return false;
     }
+    if (m_savedPixelData) {
+        m_savedPixelData->recordLoadedEntry(layer->uuid(), layer->paintDevice(), getLocation(layer));
+    }
     if (!loadMetaData(layer)) {
         return false;
     }
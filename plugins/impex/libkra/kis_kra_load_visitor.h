@@ -34,6 +34,7 @@ class KoStore;
 class KoShapeControllerBase;
 class KoColorProfile;
 class KisNodeFilterInterface;
+class KisSavedPixelDataTracker;
 
 class KRITALIBKRA_EXPORT KisKraLoadVisitor : public KisNodeVisitor
 {
@@ -51,6 +52,12 @@ public:
 public:
     void setExternalUri(const QString &uri);
 
+    /**
+     * Records the locations the pixel data of the paint layers
+     * is loaded from in \p tracker
+     */
+    void setSavedPixelDataTracker(KisSavedPixelDataTracker *tracker);
+
     bool visit(KisNode*) override {
         return true;
     }
@@ -107,6 +114,7 @@ private:
     QStringList m_warningMessages;
     KoShapeControllerBase *m_shapeController;
     QMap<QByteArray, const KoColorProfile *> m_profileCache;
+    KisSavedPixelDataTracker *m_savedPixelData;
 };
 
 #endif // KIS_KRA_LOAD_VISITOR_H_
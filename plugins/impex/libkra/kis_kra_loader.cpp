@@ -441,6 +441,8 @@ void KisKraLoader::loadBinaryData(KoStore * store, KisImageSP image, const QStri
         visitor.setExternalUri(uri);
     }
 
+    visitor.setSavedPixelDataTracker(m_d->document->savedPixelDataTracker());
+
     image->rootLayer()->accept(visitor);
     if (!visitor.errorMessages().isEmpty()) {
         m_d->errorMessages.append(visitor.errorMessages());
@@ -56,6 +56,7 @@
 
 #include "kis_config.h"
 #include "kis_store_paintdevice_writer.h"
+#include "KisSavedPixelDataTracker.h"
 #include "flake/kis_shape_selection.h"
 
 #include "kis_raster_keyframe_channel.h"
@@ -76,6 +77,8 @@ KisKraSaveVisitor::KisKraSaveVisitor(KoStore *store, const QString & name, QMap<
     , m_name(name)
     , m_nodeFileNames(nodeFileNames)
     , m_writer(new KisStorePaintDeviceWriter(store))
+    , m_savedPixelData(0)
+    , m_previousStore(0)
 {
 }
 
@@ -90,6 +93,12 @@ void KisKraSaveVisitor::setExternalUri(const QString &uri)
     m_uri = uri;
 }
 
+void KisKraSaveVisitor::setSavedPixelDataTracker(KisSavedPixelDataTracker *tracker, KoStore *previousStore)
+{
+    m_savedPixelData = tracker;
+    m_previousStore = previousStore;
+}
+
 bool KisKraSaveVisitor::visit(KisExternalLayer * layer)
 {
     bool result = false;
@@ -130,7 +139,7 @@ bool KisKraSaveVisitor::visit(KisExternalLayer * layer)
 
 bool KisKraSaveVisitor::visit(KisPaintLayer *layer)
 {
-    if (!savePaintDevice(layer->paintDevice(), getLocation(layer))) {
+    if (!savePaintLayerDevice(layer, getLocation(layer))) {
         m_errorMessages << i18n("Failed to save the pixel data for layer %1.", layer->name());
         return false;
     }
@@ -378,6 +387,80 @@ bool KisKraSaveVisitor::savePaintDevice(KisPaintDeviceSP device,
 }
 
 
+bool KisKraSaveVisitor::savePaintLayerDevice(KisPaintLayer *layer, const QString &location)
+{
+    const QString previousLocation =
+        m_savedPixelData && m_previousStore ?
+        m_savedPixelData->unchangedEntryLocation(layer->uuid()) : QString();
+
+    bool copied = false;
+    bool result = false;
+
+    if (!previousLocation.isEmpty()) {
+        result = copyUnchangedPaintDevice(layer->paintDevice(), previousLocation, location, &copied);
+    }
+
+    if (!copied) {
+        result = savePaintDevice(layer->paintDevice(), location);
+    }
+
+    if (result && m_savedPixelData) {
+        m_savedPixelData->recordSavedEntry(layer->uuid(), location);
+    }
+
+    return result;
+}
+
+bool KisKraSaveVisitor::copyUnchangedPaintDevice(KisPaintDeviceSP device, const QString &previousLocation, const QString &location, bool *copied)
+{
+    KisConfig cfg(true);
+    const bool compressionEnabled = m_store->isCompressionEnabled();
+    m_store->setCompressionEnabled(cfg.compressKra());
+
+    /**
+     * The compressed data is copied between the archives as it is, so
+     * the tiles are neither decoded nor deflated again. If the entry
+     * cannot be copied this way, e.g. because the compression setting
+     * has changed since the previous save, its contents are read and
+     * written in the usual way, which still skips the encoding of the
+     * tiles.
+     */
+    bool result = m_store->copyRawFile(m_previousStore, previousLocation, location);
+
+    if (result) {
+        *copied = true;
+    } else if (m_previousStore->open(previousLocation)) {
+        /**
+         * Uncompressed entries are handed out straight from the mapped
+         * file, so the data is not even copied into memory here.
+         */
+        QByteArray data = m_previousStore->mappedData();
+        if (data.isNull()) {
+            data = m_previousStore->read(m_previousStore->size());
+        }
+
+        if (data.size() == m_previousStore->size()) {
+            *copied = true;
+
+            if (m_store->open(location)) {
+                result = m_store->write(data) == data.size();
+                result &= m_store->close();
+            }
+        }
+
+        m_previousStore->close();
+    }
+
+    if (result && m_store->open(location + ".defaultpixel")) {
+        m_store->write((char*)device->defaultPixel().data(), device->colorSpace()->pixelSize());
+        m_store->close();
+    }
+
+    m_store->setCompressionEnabled(compressionEnabled);
+
+    return result;
+}
+
 template<class DevicePolicy>
 bool KisKraSaveVisitor::savePaintDeviceFrame(KisPaintDeviceSP device, QString location, DevicePolicy policy)
 {
@@ -29,6 +29,7 @@
 #include "kritalibkra_export.h"
 
 class KisPaintDeviceWriter;
+class KisSavedPixelDataTracker;
 class KoStore;
 
 class KRITALIBKRA_EXPORT KisKraSaveVisitor : public KisNodeVisitor
@@ -41,6 +42,14 @@ public:
 public:
     void setExternalUri(const QString &uri);
 
+    /**
+     * Lets the visitor copy the pixel data of the paint layers that have
+     * not changed since the last save from \p previousStore, instead of
+     * encoding it again. The entries written for the paint layers are
+     * recorded in \p tracker.
+     */
+    void setSavedPixelDataTracker(KisSavedPixelDataTracker *tracker, KoStore *previousStore);
+
     bool visit(KisNode*) override {
         return true;
     }
@@ -73,6 +82,8 @@ public:
 private:
 
     bool savePaintDevice(KisPaintDeviceSP device, QString location);
+    bool savePaintLayerDevice(KisPaintLayer *layer, const QString &location);
+    bool copyUnchangedPaintDevice(KisPaintDeviceSP device, const QString &previousLocation, const QString &location, bool *copied);
 
     template<class DevicePolicy>
     bool savePaintDeviceFrame(KisPaintDeviceSP device, QString location, DevicePolicy policy);
@@ -93,6 +104,8 @@ private:
     QMap<const KisNode*, QString> m_nodeFileNames;
     KisPaintDeviceWriter *m_writer;
     QStringList m_errorMessages;
+    KisSavedPixelDataTracker *m_savedPixelData;
+    KoStore *m_previousStore;
 };
 
 #endif // KIS_KRA_SAVE_VISITOR_H_
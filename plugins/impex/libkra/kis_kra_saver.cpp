@@ -52,9 +52,11 @@
 #include <kis_painting_assistants_decoration.h>
 #include <kis_psd_layer_style_resource.h>
 #include "kis_png_converter.h"
+#include "kis_config.h"
 #include "kis_keyframe_channel.h"
 #include <kis_time_range.h>
 #include "KisDocument.h"
+#include "KisSavedPixelDataTracker.h"
 #include <string>
 #include "kis_dom_utils.h"
 #include "kis_grid_config.h"
@@ -247,6 +249,20 @@ bool KisKraSaver::saveBinaryData(KoStore* store, KisImageSP image, const QString
     if (external)
         visitor.setExternalUri(uri);
 
+    // copy the layers that have not changed since the last save from the previous file
+    KisSavedPixelDataTracker *savedPixelData = m_d->doc->savedPixelDataTracker();
+    QScopedPointer<KoStore> previousStore;
+
+    const QString previousFileName = savedPixelData->sourceFileName();
+    if (!previousFileName.isEmpty()) {
+        previousStore.reset(KoStore::createStore(previousFileName, KoStore::Read, "", KoStore::Zip));
+        if (previousStore && previousStore->bad()) {
+            previousStore.reset();
+        }
+    }
+
+    visitor.setSavedPixelDataTracker(savedPixelData, previousStore.data());
+
     image->rootLayer()->accept(visitor);
 
     m_d->errorMessages.append(visitor.errorMessages());
@@ -331,9 +347,16 @@ bool KisKraSaver::saveBinaryData(KoStore* store, KisImageSP image, const QString
         }
     }
 
-    if (!autosave) {
+    KisConfig cfg(true);
+    if (!autosave || cfg.autoSaveMergedImage()) {
+        /**
+         * Autosaving should disturb the user as little as possible, so
+         * the merged image is written with the fastest compression level
+         */
+        const int compression = autosave ? 1 : 6;
+
         KisPaintDeviceSP dev = image->projection();
-        KisPNGConverter::saveDeviceToStore("mergedimage.png", image->bounds(), image->xRes(), image->yRes(), dev, store);
+        KisPNGConverter::saveDeviceToStore("mergedimage.png", image->bounds(), image->xRes(), image->yRes(), dev, store, 0, compression);
     }
 
     saveAssistants(store, uri,external);
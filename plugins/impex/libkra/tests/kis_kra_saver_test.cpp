@@ -48,6 +48,7 @@
 #include "kis_keyframe_channel.h"
 #include "kis_image_animation_interface.h"
 #include "kis_layer_properties_icons.h"
+#include "KisSavedPixelDataTracker.h"
 
 #include "kis_transform_mask_params_interface.h"
 
@@ -549,4 +550,55 @@ void KisKraSaverTest::testExportToReadonly()
     TestUtil::testExportToReadonly(QString(FILES_DATA_DIR), KraMimetype);
 }
 
+void KisKraSaverTest::testRoundTripUnchangedLayers()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+
+    KisImageSP image = new KisImage(0, 300, 200, cs, "unchanged layers");
+    doc->setCurrentImage(image);
+
+    KisPaintLayerSP layer1 = new KisPaintLayer(image, "layer1", OPACITY_OPAQUE_U8);
+    KisPaintLayerSP layer2 = new KisPaintLayer(image, "layer2", OPACITY_OPAQUE_U8);
+
+    layer1->paintDevice()->fill(QRect(10, 10, 200, 100), KoColor(Qt::red, cs));
+    layer2->paintDevice()->fill(QRect(50, 60, 100, 120), KoColor(Qt::blue, cs));
+
+    image->addNode(layer1, image->root());
+    image->addNode(layer2, image->root());
+    image->initialRefreshGraph();
+
+    QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile("roundtrip_unchanged_layers_1.kra"), doc->mimeType()));
+
+    // the fill creates a new tile, so the change is registered
+    layer2->paintDevice()->fill(QRect(250, 10, 20, 20), KoColor(Qt::green, cs));
+
+    {
+        const KisSavedPixelDataTracker snapshot =
+            doc->savedPixelDataTracker()->snapshotForSaving(image->root());
+
+        QVERIFY(!snapshot.sourceFileName().isEmpty());
+        QVERIFY(!snapshot.unchangedEntryLocation(layer1->uuid()).isEmpty());
+        QVERIFY(snapshot.unchangedEntryLocation(layer2->uuid()).isEmpty());
+    }
+
+    QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile("roundtrip_unchanged_layers_2.kra"), doc->mimeType()));
+
+    QScopedPointer<KisDocument> doc2(KisPart::instance()->createDocument());
+    QVERIFY(doc2->loadNativeFormat("roundtrip_unchanged_layers_2.kra"));
+
+    KisNodeSP newLayer1 = TestUtil::findNode(doc2->image()->root(), "layer1");
+    KisNodeSP newLayer2 = TestUtil::findNode(doc2->image()->root(), "layer2");
+    QVERIFY(newLayer1);
+    QVERIFY(newLayer2);
+
+    QPoint pt;
+    QVERIFY(TestUtil::comparePaintDevices(pt, layer1->paintDevice(), newLayer1->paintDevice()));
+    QVERIFY(TestUtil::comparePaintDevices(pt, layer2->paintDevice(), newLayer2->paintDevice()));
+
+    QCOMPARE(newLayer1->paintDevice()->exactBounds(), layer1->paintDevice()->exactBounds());
+    QCOMPARE(newLayer2->paintDevice()->exactBounds(), layer2->paintDevice()->exactBounds());
+}
+
 KISTEST_MAIN(KisKraSaverTest)
@@ -18,7 +18,10 @@
 
 #include "kis_open_raster_load_context.h"
 
+#include <QBuffer>
 #include <QDomDocument>
+#include <QThread>
+#include <QtConcurrent>
 
 #include <KoStore.h>
 #include <KoStoreDevice.h>
@@ -32,20 +35,67 @@ KisOpenRasterLoadContext::KisOpenRasterLoadContext(KoStore* _store)
 {
 }
 
-KisImageSP KisOpenRasterLoadContext::loadDeviceData(const QString & filename)
+void KisOpenRasterLoadContext::preloadDeviceData(const QStringList &fileNames)
 {
+    /**
+     * The store is not thread-safe, so the compressed data is read
+     * sequentially and only the decoding is done in parallel. The files
+     * are processed in batches to limit the amount of compressed data
+     * held in memory at once.
+     */
+    const int batchSize = 2 * qMax(1, QThread::idealThreadCount());
+
+    for (int batchStart = 0; batchStart < fileNames.size(); batchStart += batchSize) {
+        const int batchEnd = qMin(batchStart + batchSize, fileNames.size());
+
+        QVector<QPair<QString, QByteArray>> batch;
+
+        for (int i = batchStart; i < batchEnd; i++) {
+            const QString &fileName = fileNames[i];
+            if (m_preloadedDevices.contains(fileName) || !m_store->open(fileName)) continue;
+
+            batch.append(qMakePair(fileName, m_store->read(m_store->size())));
+            m_store->close();
+        }
+
+        QVector<KisPaintDeviceSP> devices =
+            QtConcurrent::blockingMapped<QVector<KisPaintDeviceSP>>(batch,
+                [] (const QPair<QString, QByteArray> &file) {
+                    QByteArray data = file.second;
+                    QBuffer buffer(&data);
+                    if (!buffer.open(QIODevice::ReadOnly)) {
+                        return KisPaintDeviceSP();
+                    }
+                    return KisPNGConverter::loadDeviceFromIODevice(&buffer);
+                });
+
+        for (int i = 0; i < batch.size(); i++) {
+            if (devices[i]) {
+                m_preloadedDevices.insert(batch[i].first, devices[i]);
+            } else {
+                dbgFile << "Could not decode:" << batch[i].first;
+            }
+        }
+    }
+}
+
+KisPaintDeviceSP KisOpenRasterLoadContext::loadDeviceData(const QString & filename)
+{
+    if (m_preloadedDevices.contains(filename)) {
+        return m_preloadedDevices.take(filename);
+    }
+
     if (m_store->open(filename)) {
         KoStoreDevice io(m_store);
         if (!io.open(QIODevice::ReadOnly)) {
             dbgFile << "Could not open for reading:" << filename;
             return 0;
         }
-        KisPNGConverter pngConv(0);
-        pngConv.buildImage(&io);
+        KisPaintDeviceSP device = KisPNGConverter::loadDeviceFromIODevice(&io);
         io.close();
         m_store->close();
 
-        return pngConv.image();
+        return device;
 
     }
     return 0;
@@ -23,6 +23,8 @@ class QString;
 class QDomDocument;
 class KoStore;
 
+#include <QHash>
+
 #include <KoStoreDevice.h>
 #include <kis_image.h>
 #include <kis_paint_device.h>
@@ -33,10 +35,19 @@ class KisOpenRasterLoadContext
 {
 public:
     KisOpenRasterLoadContext(KoStore *store);
-    KisImageSP loadDeviceData(const QString &fileName);
+
+    /**
+     * Reads the given layer files from the store and decodes them
+     * concurrently. The decoded devices are then returned by
+     * loadDeviceData() without touching the store again.
+     */
+    void preloadDeviceData(const QStringList &fileNames);
+
+    KisPaintDeviceSP loadDeviceData(const QString &fileName);
     QDomDocument loadStack();
 private:
     KoStore *m_store;
+    QHash<QString, KisPaintDeviceSP> m_preloadedDevices;
 };
 
 
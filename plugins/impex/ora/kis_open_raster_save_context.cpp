@@ -18,7 +18,10 @@
 
 #include "kis_open_raster_save_context.h"
 
+#include <QBuffer>
 #include <QDomDocument>
+#include <QThread>
+#include <QtConcurrent>
 
 #include <KoStore.h>
 #include <KoStoreDevice.h>
@@ -32,30 +35,135 @@
 
 #include "kis_png_converter.h"
 
+namespace {
+struct PendingDeviceData {
+    QString fileName;
+    KisPaintDeviceSP device;
+    KisMetaData::Store *metaData = 0;
+    QRect imageRect;
+    qreal xRes = 1.0;
+    qreal yRes = 1.0;
+
+    QByteArray pngData;
+    bool encoded = false;
+};
+}
+
+struct KisOpenRasterSaveContext::Private
+{
+    int id = 0;
+    KoStore *store = 0;
+    QVector<PendingDeviceData> pendingData;
+};
+
 KisOpenRasterSaveContext::KisOpenRasterSaveContext(KoStore* store)
-    : m_id(0)
-    , m_store(store)
+    : m_d(new Private)
+{
+    m_d->store = store;
+}
+
+KisOpenRasterSaveContext::~KisOpenRasterSaveContext()
 {
 }
 
 QString KisOpenRasterSaveContext::saveDeviceData(KisPaintDeviceSP dev, KisMetaData::Store* metaData, const QRect &imageRect, const qreal xRes, const qreal yRes)
 {
-    QString filename = QString("data/layer%1.png").arg(m_id++);
-    if (KisPNGConverter::saveDeviceToStore(filename, imageRect, xRes, yRes, dev, m_store, metaData)) {
-        return filename;
-    }
-    return "";
+    PendingDeviceData data;
+    data.fileName = QString("data/layer%1.png").arg(m_d->id++);
+    data.device = dev;
+    data.metaData = metaData;
+    data.imageRect = imageRect;
+    data.xRes = xRes;
+    data.yRes = yRes;
+
+    m_d->pendingData.append(data);
+
+    return data.fileName;
 }
 
+bool KisOpenRasterSaveContext::savePendingDeviceData()
+{
+    /**
+     * The layers are encoded into PNG concurrently, while the store,
+     * which is not thread-safe, is written from this thread only and in
+     * the order the layers were queued in. The layers are processed in
+     * batches to limit the amount of encoded data held in memory.
+     */
+    const int batchSize = 2 * qMax(1, QThread::idealThreadCount());
+
+    bool result = true;
+
+    for (int batchStart = 0; batchStart < m_d->pendingData.size(); batchStart += batchSize) {
+        const int batchEnd = qMin(batchStart + batchSize, m_d->pendingData.size());
 
-void KisOpenRasterSaveContext::saveStack(const QDomDocument& doc)
+        QVector<PendingDeviceData*> batch;
+        for (int i = batchStart; i < batchEnd; i++) {
+            batch.append(&m_d->pendingData[i]);
+        }
+
+        QtConcurrent::blockingMap(batch, [] (PendingDeviceData *data) {
+            QBuffer buffer(&data->pngData);
+            buffer.open(QIODevice::WriteOnly);
+            data->encoded = KisPNGConverter::saveDeviceToIODevice(&buffer, data->imageRect, data->xRes, data->yRes, data->device, data->metaData);
+        });
+
+        Q_FOREACH (PendingDeviceData *data, batch) {
+            if (!data->encoded) {
+                dbgFile << "Saving PNG failed:" << data->fileName;
+                result = false;
+                continue;
+            }
+
+            // the PNG data is already deflated
+            const bool compressionEnabled = m_d->store->isCompressionEnabled();
+            m_d->store->setCompressionEnabled(false);
+            const bool storeOpened = m_d->store->open(data->fileName);
+            m_d->store->setCompressionEnabled(compressionEnabled);
+
+            if (storeOpened) {
+                if (m_d->store->write(data->pngData) != data->pngData.size()) {
+                    dbgFile << "Writing of data file failed :" << data->fileName;
+                    result = false;
+                }
+                if (!m_d->store->close()) {
+                    result = false;
+                }
+            } else {
+                dbgFile << "Opening of data file failed :" << data->fileName;
+                result = false;
+            }
+
+            data->pngData.clear();
+            data->device = 0;
+        }
+    }
+
+    m_d->pendingData.clear();
+
+    return result;
+}
+
+bool KisOpenRasterSaveContext::saveStack(const QDomDocument& doc)
 {
-    if (m_store->open("stack.xml")) {
-        KoStoreDevice io(m_store);
-        io.write(doc.toByteArray());
+    bool result = savePendingDeviceData();
+
+    if (m_d->store->open("stack.xml")) {
+        const QByteArray data = doc.toByteArray();
+
+        KoStoreDevice io(m_d->store);
+        if (io.write(data) != data.size()) {
+            dbgFile << "Writing of the stack.xml file failed";
+            result = false;
+        }
         io.close();
-        m_store->close();
+
+        if (!m_d->store->close()) {
+            result = false;
+        }
     } else {
         dbgFile << "Opening of the stack.xml file failed :";
+        result = false;
     }
+
+    return result;
 }
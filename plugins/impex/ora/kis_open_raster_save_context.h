@@ -19,6 +19,8 @@
 #ifndef _KIS_OPEN_RASTER_SAVE_CONTEXT_H_
 #define _KIS_OPEN_RASTER_SAVE_CONTEXT_H_
 
+#include <QScopedPointer>
+
 #include <kis_types.h>
 
 class QDomDocument;
@@ -30,12 +32,29 @@ class KisOpenRasterSaveContext
 {
 public:
     KisOpenRasterSaveContext(KoStore *store);
+    ~KisOpenRasterSaveContext();
+
+    /**
+     * Assigns a file name to the layer data and queues the device for
+     * saving. The PNG is not written before the stack is saved.
+     */
     QString saveDeviceData(KisPaintDeviceSP dev, KisMetaData::Store *metaData, const QRect &imageRect, qreal xRes, qreal yRes);
-    void saveStack(const QDomDocument& doc);
+
+    /**
+     * Encodes all the queued layers and writes them into the store,
+     * followed by stack.xml
+     *
+     * @return false if any of the layers or the stack could not be
+     * encoded or written
+     */
+    bool saveStack(const QDomDocument& doc);
+
 private:
-    int m_id;
-    KoStore *m_store;
+    bool savePendingDeviceData();
 
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
 };
 
 
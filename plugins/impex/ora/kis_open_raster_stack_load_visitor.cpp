@@ -41,6 +41,19 @@
 
 #include "kis_open_raster_load_context.h"
 
+namespace {
+void collectLayerFileNames(const QDomElement &elem, QStringList *fileNames)
+{
+    for (QDomElement child = elem.firstChildElement(); !child.isNull(); child = child.nextSiblingElement()) {
+        if (child.nodeName() == "stack") {
+            collectLayerFileNames(child, fileNames);
+        } else if (child.nodeName() == "layer" && !child.attribute("src").isNull()) {
+            fileNames->append(child.attribute("src"));
+        }
+    }
+}
+}
+
 struct KisOpenRasterStackLoadVisitor::Private {
     KisImageSP image;
     vKisNodeSP activeNodes;
@@ -107,6 +120,11 @@ void KisOpenRasterStackLoadVisitor::loadImage()
             for (QDomNode node2 = node.firstChild(); !node2.isNull(); node2 = node2.nextSibling()) {
                 if (node2.isElement() && node2.nodeName() == "stack") { // it's the root layer !
                     QDomElement subelem2 = node2.toElement();
+
+                    QStringList fileNames;
+                    collectLayerFileNames(subelem2, &fileNames);
+                    d->loadContext->preloadDeviceData(fileNames);
+
                     loadGroupLayer(subelem2, d->image->rootLayer());
                     break;
                 }
@@ -216,12 +234,10 @@ void KisOpenRasterStackLoadVisitor::loadGroupLayer(const QDomElement& elem, KisG
                 QString filename = subelem.attribute("src");
                 if (!filename.isNull()) {
                     const qreal opacity = KisDomUtils::toDouble(subelem.attribute("opacity", "1.0"));
-                    KisImageSP pngImage = d->loadContext->loadDeviceData(filename);
-                    if (pngImage) {
+                    KisPaintDeviceSP device = d->loadContext->loadDeviceData(filename);
+                    if (device) {
                         // If ORA doesn't have resolution info, load the default value(75 ppi) else fetch from stack.xml
                         d->image->setResolution(d->xRes, d->yRes);
-                        // now get the device
-                        KisPaintDeviceSP device = pngImage->projection();
 
                         KisPaintLayerSP layer = new KisPaintLayer(groupLayer->image() , "", opacity * 255, device);
                         d->image->addNode(layer, groupLayer, 0);
@@ -135,7 +135,12 @@ bool KisOpenRasterStackSaveVisitor::visit(KisGroupLayer *layer)
         imageElt.appendChild(elt);
         d->layerStack.insertBefore(imageElt, QDomNode());
         d->currentElement = QDomElement();
-        d->saveContext->saveStack(d->layerStack);
+
+        /**
+         * The layers are only queued while visiting, so the failures
+         * of the whole stack are reported by the root group
+         */
+        return d->saveContext->saveStack(d->layerStack);
     }
 
     return true;
@@ -86,7 +86,10 @@ KisImportExportErrorCode OraConverter::buildFile(QIODevice *io, KisImageSP image
     KisOpenRasterSaveContext osc(store);
     KisOpenRasterStackSaveVisitor orssv(&osc, activeNodes);
 
-    image->rootLayer()->accept(orssv);
+    if (!image->rootLayer()->accept(orssv)) {
+        delete store;
+        return ImportExportCodes::ErrorWhileWriting;
+    }
 
     if (store->open("Thumbnails/thumbnail.png")) {
         QSize previewSize = image->bounds().size();
@@ -103,7 +106,12 @@ KisImportExportErrorCode OraConverter::buildFile(QIODevice *io, KisImageSP image
     }
 
     KisPaintDeviceSP dev = image->projection();
-    KisPNGConverter::saveDeviceToStore("mergedimage.png", image->bounds(), image->xRes(), image->yRes(), dev, store);
+    if (!KisPNGConverter::saveDeviceToStore("mergedimage.png", image->bounds(), image->xRes(), image->yRes(), dev, store) ||
+        !store->finalize()) {
+
+        delete store;
+        return ImportExportCodes::ErrorWhileWriting;
+    }
 
     delete store;
     return ImportExportCodes::OK;
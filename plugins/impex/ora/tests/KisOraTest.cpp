@@ -22,6 +22,16 @@
 #include <QTest>
 #include <QCoreApplication>
 
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+#include <KisDocument.h>
+#include <KisPart.h>
+#include <kis_image.h>
+#include <kis_group_layer.h>
+#include <kis_paint_layer.h>
+#include <kis_layer_utils.h>
+#include <kis_surrogate_undo_store.h>
+
 #include "filestest.h"
 
 #ifndef FILES_DATA_DIR
@@ -51,6 +61,76 @@ void KisOraTest::testImportIncorrectFormat()
 }
 
 
+void KisOraTest::testRoundTrip()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+    doc->setFileBatchMode(true);
+
+    KisImageSP image = new KisImage(new KisSurrogateUndoStore(), 200, 150, cs, "ora round trip");
+    doc->setCurrentImage(image);
+
+    /**
+     * The layers are encoded in parallel and written in the queued
+     * order, so the stack has several layers on different levels
+     */
+    KisPaintLayerSP bottom = new KisPaintLayer(image, "bottom", OPACITY_OPAQUE_U8);
+    KisGroupLayerSP group = new KisGroupLayer(image, "group", OPACITY_OPAQUE_U8);
+    KisPaintLayerSP inner = new KisPaintLayer(image, "inner", OPACITY_OPAQUE_U8);
+    KisGroupLayerSP nested = new KisGroupLayer(image, "nested", OPACITY_OPAQUE_U8);
+    KisPaintLayerSP deep = new KisPaintLayer(image, "deep", OPACITY_OPAQUE_U8);
+    KisPaintLayerSP top = new KisPaintLayer(image, "top", OPACITY_OPAQUE_U8);
+
+    image->addNode(bottom, image->root());
+    image->addNode(group, image->root());
+    image->addNode(inner, group);
+    image->addNode(nested, group);
+    image->addNode(deep, nested);
+    image->addNode(top, image->root());
+
+    bottom->paintDevice()->fill(image->bounds(), KoColor(QColor(200, 30, 10), cs));
+    bottom->paintDevice()->fill(QRect(20, 10, 30, 40), KoColor(QColor(0, 0, 255), cs));
+    inner->paintDevice()->fill(QRect(0, 50, 120, 60), KoColor(QColor(10, 220, 40, 128), cs));
+    deep->paintDevice()->fill(QRect(70, 0, 50, 150), KoColor(QColor(250, 250, 0, 200), cs));
+    deep->paintDevice()->fill(QRect(100, 100, 100, 50), KoColor(QColor(30, 60, 90, 17), cs));
+    top->paintDevice()->fill(QRect(150, 20, 50, 50), KoColor(QColor(255, 255, 255), cs));
+
+    image->initialRefreshGraph();
+
+    const QString fileName("ora_roundtrip.ora");
+    QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile(fileName), OraMimetype.toLatin1()));
+
+    QScopedPointer<KisDocument> loadedDoc(KisPart::instance()->createDocument());
+    loadedDoc->setFileBatchMode(true);
+    QVERIFY(loadedDoc->importDocument(QUrl::fromLocalFile(fileName)));
+
+    KisImageSP loadedImage = loadedDoc->image();
+    QVERIFY(loadedImage);
+    QCOMPARE(loadedImage->bounds(), image->bounds());
+
+    QMap<QString, KisNodeSP> loadedNodes;
+    KisLayerUtils::recursiveApplyNodes(loadedImage->root(),
+        [&loadedNodes] (KisNodeSP node) {
+            loadedNodes.insert(node->name(), node);
+        });
+
+    QVERIFY(loadedNodes.contains("deep"));
+    QCOMPARE(loadedNodes["deep"]->parent()->name(), QString("nested"));
+    QCOMPARE(loadedNodes["nested"]->parent()->name(), QString("group"));
+    QCOMPARE(loadedNodes["inner"]->parent()->name(), QString("group"));
+
+    Q_FOREACH (KisPaintLayerSP layer, QList<KisPaintLayerSP>() << bottom << inner << deep << top) {
+        KisNodeSP loadedLayer = loadedNodes.value(layer->name());
+        QVERIFY(loadedLayer);
+        QVERIFY(loadedLayer->paintDevice());
+
+        const QImage expected = layer->paintDevice()->convertToQImage(0, image->bounds());
+        const QImage loaded = loadedLayer->paintDevice()->convertToQImage(0, image->bounds());
+
+        QVERIFY2(loaded == expected, qPrintable(layer->name()));
+    }
+}
 
 KISTEST_MAIN(KisOraTest)
 
@@ -24,6 +24,12 @@
 
 #include "filestest.h"
 
+#include <QBuffer>
+#include <KoColorSpaceRegistry.h>
+#include <KoColor.h>
+#include "kis_paint_device.h"
+#include "kis_png_converter.h"
+
 #include  <sdk/tests/kistest.h>
 
 #ifndef FILES_DATA_DIR
@@ -175,5 +181,163 @@ void KisPngTest::testSaveHDR()
                     KoColorSpaceRegistry::instance()->p2020PQProfile()));
 }
 
+void KisPngTest::testParallelEncoding_data()
+{
+    QTest::addColumn<bool>("use16Bit");
+    QTest::addColumn<bool>("indexed");
+    QTest::addColumn<int>("compression");
+
+    QTest::newRow("rgba8-fast") << false << false << 1;
+    QTest::newRow("rgba8-default") << false << false << 6;
+    QTest::newRow("rgba8-store") << false << false << 0;
+    QTest::newRow("rgba16") << true << false << 6;
+    QTest::newRow("indexed") << false << true << 9;
+}
+
+void KisPngTest::testParallelEncoding()
+{
+    QFETCH(bool, use16Bit);
+    QFETCH(bool, indexed);
+    QFETCH(int, compression);
+
+    const KoColorSpace *cs = use16Bit ?
+        KoColorSpaceRegistry::instance()->rgb16() :
+        KoColorSpaceRegistry::instance()->rgb8();
+
+    // big enough to be split into many deflate chunks
+    const QRect rc(0, 0, 1531, 713);
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->fill(rc, KoColor(Qt::white, cs));
+
+    for (int i = 0; i < 12; i++) {
+        const QColor color = indexed ? QColor(Qt::GlobalColor(Qt::red + i % 6)) :
+            QColor::fromHsv(i * 30, 200, 255, 50 + i * 17);
+        dev->fill(QRect(i * 97, i * 41, 300, 200), KoColor(color, cs));
+    }
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+
+    KisPNGOptions options;
+    options.compression = compression;
+    options.alpha = !indexed;
+    options.tryToSaveAsIndexed = indexed;
+    options.interlace = false;
+
+    KisPNGConverter converter(0);
+    vKisAnnotationSP_it annotIt = 0;
+    KisImportExportErrorCode result = converter.buildFile(&buffer, rc, 72.0, 72.0, dev, annotIt, annotIt, options, 0);
+    QVERIFY(result.isOk());
+    buffer.close();
+
+    QImage loaded;
+    QVERIFY(loaded.loadFromData(buffer.data(), "PNG"));
+    QCOMPARE(loaded.size(), rc.size());
+
+    KisPaintDeviceSP reference = new KisPaintDevice(*dev);
+    reference->convertTo(KoColorSpaceRegistry::instance()->rgb8());
+    const QImage expected = reference->convertToQImage(0, rc.x(), rc.y(), rc.width(), rc.height());
+
+    QCOMPARE(loaded.convertToFormat(QImage::Format_ARGB32),
+             expected.convertToFormat(QImage::Format_ARGB32));
+}
+
+void KisPngTest::testRoundTrip_data()
+{
+    QTest::addColumn<QString>("colorModelId");
+    QTest::addColumn<QString>("colorDepthId");
+    QTest::addColumn<bool>("alpha");
+    QTest::addColumn<bool>("indexed");
+
+    const QString rgb = RGBAColorModelID.id();
+    const QString gray = GrayAColorModelID.id();
+    const QString u8 = Integer8BitsColorDepthID.id();
+    const QString u16 = Integer16BitsColorDepthID.id();
+
+    QTest::newRow("rgb8") << rgb << u8 << false << false;
+    QTest::newRow("rgba8") << rgb << u8 << true << false;
+    QTest::newRow("rgb16") << rgb << u16 << false << false;
+    QTest::newRow("rgba16") << rgb << u16 << true << false;
+    QTest::newRow("gray8") << gray << u8 << false << false;
+    QTest::newRow("graya8") << gray << u8 << true << false;
+    QTest::newRow("gray16") << gray << u16 << false << false;
+    QTest::newRow("graya16") << gray << u16 << true << false;
+    QTest::newRow("indexed") << rgb << u8 << false << true;
+}
+
+void KisPngTest::testRoundTrip()
+{
+    QFETCH(QString, colorModelId);
+    QFETCH(QString, colorDepthId);
+    QFETCH(bool, alpha);
+    QFETCH(bool, indexed);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(colorModelId, colorDepthId, 0);
+    QVERIFY(cs);
+
+    // spans several bands of rows
+    const QRect rc(0, 0, 97, 211);
+    const int pixelSize = cs->pixelSize();
+    const int channelSize = pixelSize / cs->channelCount();
+    const int alphaPos = int(cs->alphaPos());
+
+    /**
+     * Every channel gets its own pattern with distinct high and low bytes,
+     * so a wrong channel order or byte order changes the pixels. The
+     * indexed image uses only a few colors to fit into a palette.
+     */
+    QVector<quint8> pixels(rc.width() * rc.height() * pixelSize);
+
+    for (int y = 0; y < rc.height(); y++) {
+        for (int x = 0; x < rc.width(); x++) {
+            quint8 *pixel = pixels.data() + (y * rc.width() + x) * pixelSize;
+
+            for (int c = 0; c < int(cs->channelCount()); c++) {
+                const bool opaque = c == alphaPos && !alpha;
+                const quint16 value =
+                    indexed ? quint16(((x / 10 + y / 20 + c) % 6) * 51) :
+                    quint16(x * 677 + y * 131 + c * 12345);
+
+                if (channelSize == 2) {
+                    reinterpret_cast<quint16*>(pixel)[c] = opaque ? 0xffff : value;
+                } else {
+                    pixel[c] = opaque ? 0xff : quint8(value ^ (value >> 8));
+                }
+            }
+        }
+    }
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->writeBytes(pixels.constData(), rc);
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+
+    KisPNGOptions options;
+    options.alpha = alpha;
+    options.tryToSaveAsIndexed = indexed;
+    options.interlace = false;
+    options.saveSRGBProfile = true;
+
+    KisPNGConverter converter(0);
+    vKisAnnotationSP_it annotIt = 0;
+    QVERIFY(converter.buildFile(&buffer, rc, 72.0, 72.0, dev, annotIt, annotIt, options, 0).isOk());
+    buffer.close();
+
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    KisPaintDeviceSP loaded = KisPNGConverter::loadDeviceFromIODevice(&buffer);
+    QVERIFY(loaded);
+
+    QCOMPARE(loaded->colorSpace()->colorModelId().id(), colorModelId);
+    QCOMPARE(loaded->colorSpace()->colorDepthId().id(), colorDepthId);
+    QCOMPARE(loaded->colorSpace()->profile()->name(), cs->profile()->name());
+
+    QVector<quint8> loadedPixels(pixels.size());
+    loaded->readBytes(loadedPixels.data(), rc);
+
+    QVERIFY(loadedPixels == pixels);
+}
+
 KISTEST_MAIN(KisPngTest)
 
@@ -28,6 +28,10 @@ private Q_SLOTS:
     void testFiles();
     void testWriteonly();
     void testSaveHDR();
+    void testParallelEncoding_data();
+    void testParallelEncoding();
+    void testRoundTrip_data();
+    void testRoundTrip();
 };
 
 #endif
@@ -391,40 +391,6 @@ psd_status psd_unzip_with_prediction(psd_uchar *src_buf, psd_int src_len,
 /* End of third party block                                           */
 /**********************************************************************/
 
-QMap<quint16, QByteArray> fetchChannelsBytes(QIODevice *io, QVector<ChannelInfo*> channelInfoRecords,
-                                            int row, int width, int channelSize, bool processMasks)
-{
-    const int uncompressedLength = width * channelSize;
-
-    QMap<quint16, QByteArray> channelBytes;
-
-    Q_FOREACH (ChannelInfo *channelInfo, channelInfoRecords) {
-        // user supplied masks are ignored here
-        if (!processMasks && channelInfo->channelId < -1) continue;
-
-        io->seek(channelInfo->channelDataStart + channelInfo->channelOffset);
-
-        if (channelInfo->compressionType == Compression::Uncompressed) {
-            channelBytes[channelInfo->channelId] = io->read(uncompressedLength);
-            channelInfo->channelOffset += uncompressedLength;
-        }
-        else if (channelInfo->compressionType == Compression::RLE) {
-            int rleLength = channelInfo->rleRowLengths[row];
-            QByteArray compressedBytes = io->read(rleLength);
-            QByteArray uncompressedBytes = Compression::uncompress(uncompressedLength, compressedBytes, channelInfo->compressionType);
-            channelBytes.insert(channelInfo->channelId, uncompressedBytes);
-            channelInfo->channelOffset += rleLength;
-        }
-        else {
-            QString error = QString("Unsupported Compression mode: %1").arg(channelInfo->compressionType);
-            dbgFile << "ERROR: fetchChannelsBytes:" << error;
-            throw KisAslReaderUtils::ASLParseException(error);
-        }
-    }
-
-    return channelBytes;
-}
-
 typedef boost::function<void(int, const QMap<quint16, QByteArray>&, int, quint8*)> PixelFunc;
 
 void readCommon(KisPaintDeviceSP dev,
@@ -442,13 +408,13 @@ void readCommon(KisPaintDeviceSP dev,
         return;
     }
 
+    QMap<quint16, QByteArray> channelBytes;
+
     if (infoRecords.first()->compressionType == Compression::ZIP ||
         infoRecords.first()->compressionType == Compression::ZIPWithPrediction) {
 
         const int numPixels = channelSize * layerRect.width() * layerRect.height();
 
-        QMap<quint16, QByteArray> channelBytes;
-
         Q_FOREACH (ChannelInfo *info, infoRecords) {
             io->seek(info->channelDataStart);
             QByteArray compressedBytes = io->read(info->channelDataLength);
@@ -477,29 +443,61 @@ void readCommon(KisPaintDeviceSP dev,
             channelBytes.insert(info->channelId, uncompressedBytes);
         }
 
-        KisSequentialIterator it(dev, layerRect);
-        int col = 0;
-        while (it.nextPixel()) {
-            pixelFunc(channelSize, channelBytes, col, it.rawData());
-            col++;
-        }
-
     } else {
-        KisHLineIteratorSP it = dev->createHLineIteratorNG(layerRect.left(), layerRect.top(), layerRect.width());
-        for (int i = 0 ; i < layerRect.height(); i++) {
-            QMap<quint16, QByteArray> channelBytes;
+        const int rowSize = channelSize * layerRect.width();
+        const int numRows = layerRect.height();
+
+        Q_FOREACH (ChannelInfo *channelInfo, infoRecords) {
+            // user supplied masks are ignored here
+            if (!processMasks && channelInfo->channelId < -1) continue;
+
+            io->seek(channelInfo->channelDataStart + channelInfo->channelOffset);
 
-            channelBytes = fetchChannelsBytes(io, infoRecords,
-                                              i, layerRect.width(),
-                                              channelSize, processMasks);
+            QByteArray uncompressedBytes;
 
-            for (qint64 col = 0; col < layerRect.width(); col++){
-                pixelFunc(channelSize, channelBytes, col, it->rawData());
-                it->nextPixel();
+            if (channelInfo->compressionType == Compression::Uncompressed) {
+                uncompressedBytes = io->read(rowSize * numRows);
+                channelInfo->channelOffset += uncompressedBytes.size();
             }
-            it->nextRow();
+            else if (channelInfo->compressionType == Compression::RLE) {
+                if (channelInfo->rleRowLengths.size() < numRows) {
+                    throw KisAslReaderUtils::ASLParseException("RLE row lengths table is too short");
+                }
+
+                const QVector<quint32> rowLengths = channelInfo->rleRowLengths.mid(0, numRows);
+
+                qint64 rleLength = 0;
+                Q_FOREACH (quint32 length, rowLengths) {
+                    rleLength += length;
+                }
+
+                // the whole channel is read at once, its rows are unpacked concurrently
+                QByteArray compressedBytes = io->read(rleLength);
+                uncompressedBytes = Compression::uncompressRowsRLE(compressedBytes, rowLengths, rowSize);
+                channelInfo->channelOffset += rleLength;
+            }
+            else {
+                QString error = QString("Unsupported Compression mode: %1").arg(channelInfo->compressionType);
+                dbgFile << "ERROR: readCommon:" << error;
+                throw KisAslReaderUtils::ASLParseException(error);
+            }
+
+            if (uncompressedBytes.size() != rowSize * numRows) {
+                QString error = QString("Failed to read channel data: id = %1, compression = %2").arg(channelInfo->channelId).arg(channelInfo->compressionType);
+                dbgFile << "ERROR:" << error;
+                throw KisAslReaderUtils::ASLParseException(error);
+            }
+
+            channelBytes.insert(channelInfo->channelId, uncompressedBytes);
         }
     }
+
+    KisSequentialIterator it(dev, layerRect);
+    int col = 0;
+    while (it.nextPixel()) {
+        pixelFunc(channelSize, channelBytes, col, it.rawData());
+        col++;
+    }
 }
 
 void readChannels(QIODevice *io,
@@ -557,8 +555,11 @@ void writeChannelDataRLE(QIODevice *io, const quint8 *plane, const int channelSi
 
     const bool externalRleBlock = rleBlockOffset >= 0;
 
-    // the start of RLE sizes block
-    const qint64 channelRLESizePos = externalRleBlock ? rleBlockOffset : io->pos();
+    // the rows are packed concurrently, so the lengths block can be
+    // written before the data instead of being patched row by row
+    const quint32 stride = channelSize * rc.width();
+    const QVector<QByteArray> compressedRows =
+        Compression::compressRowsRLE(reinterpret_cast<const char*>(plane), stride, rc.height());
 
     {
         QScopedPointer<KisOffsetKeeper> rleOffsetKeeper;
@@ -568,22 +569,15 @@ void writeChannelDataRLE(QIODevice *io, const quint8 *plane, const int channelSi
             io->seek(rleBlockOffset);
         }
 
-        // write zero's for the channel lengths block
-        for(int i = 0; i < rc.height(); ++i) {
+        // write the channel lengths block
+        Q_FOREACH (const QByteArray &compressed, compressedRows) {
             // XXX: choose size for PSB!
-            const quint16 fakeRLEBLockSize = 0;
-            SAFE_WRITE_EX(io, fakeRLEBLockSize);
+            const quint16 rleBlockSize = compressed.size();
+            SAFE_WRITE_EX(io, rleBlockSize);
         }
     }
 
-    quint32 stride = channelSize * rc.width();
-    for (qint32 row = 0; row < rc.height(); ++row) {
-
-        QByteArray uncompressed = QByteArray::fromRawData((const char*)plane + row * stride, stride);
-        QByteArray compressed = Compression::compress(uncompressed, Compression::RLE);
-
-        KisAslWriterUtils::OffsetStreamPusher<quint16> rleExternalTag(io, 0, channelRLESizePos + row * sizeof(quint16));
-
+    Q_FOREACH (const QByteArray &compressed, compressedRows) {
         if (io->write(compressed) != compressed.size()) {
             throw KisAslWriterUtils::ASLWriteException("Failed to write image data");
         }
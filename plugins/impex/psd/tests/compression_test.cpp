@@ -53,6 +53,41 @@ void CompressionTest::testCompressionRLE()
 }
 
 
+void CompressionTest::testCompressionRowsRLE()
+{
+    const int rowSize = 1531;
+    const int numRows = 517;
+
+    // mix runs and literals, so that both kinds of PackBits packets are used
+    QByteArray plane(rowSize * numRows, 0);
+    for (int row = 0; row < numRows; ++row) {
+        for (int col = 0; col < rowSize; ++col) {
+            plane[row * rowSize + col] = (col / (row % 7 + 1)) % 3 ? char(rand()) : char(row);
+        }
+    }
+
+    const QVector<QByteArray> rows = Compression::compressRowsRLE(plane.constData(), rowSize, numRows);
+    QCOMPARE(rows.size(), numRows);
+
+    QByteArray packed;
+    QVector<quint32> rowLengths;
+
+    for (int row = 0; row < numRows; ++row) {
+        const QByteArray uncompressedRow = plane.mid(row * rowSize, rowSize);
+        QCOMPARE(rows[row], Compression::compress(uncompressedRow, Compression::RLE));
+
+        packed.append(rows[row]);
+        rowLengths.append(rows[row].size());
+    }
+
+    QCOMPARE(Compression::uncompressRowsRLE(packed, rowLengths, rowSize), plane);
+
+    // truncated data must not be read past its end
+    packed.chop(1);
+    QVERIFY(Compression::uncompressRowsRLE(packed, rowLengths, rowSize).isEmpty());
+}
+
+
 void CompressionTest::testCompressionZIP()
 {
     QByteArray ba("Twee eeee aaaaa asdasda47892347981    wwwwwwwwwwwwWWWWWWWWWW");
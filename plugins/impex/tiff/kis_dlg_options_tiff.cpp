@@ -58,6 +58,7 @@ void KisTIFFOptionsWidget::setConfiguration(const KisPropertiesConfigurationSP c
     compressionLevelDeflate->setValue(cfg->getInt("deflate", 6));
     compressionLevelPixarLog->setValue(cfg->getInt("pixarlog", 6));
     chkSaveProfile->setChecked(cfg->getBool("saveProfile", true));
+    chkTiled->setChecked(cfg->getBool("tiled", false));
 
     if (cfg->getInt("type", -1) == KoChannelInfo::FLOAT16 || cfg->getInt("type", -1) == KoChannelInfo::FLOAT32) {
         kComboBoxPredictor->removeItem(1);
@@ -84,6 +85,7 @@ KisPropertiesConfigurationSP KisTIFFOptionsWidget::configuration() const
     cfg->setProperty("deflate", compressionLevelDeflate->value());
     cfg->setProperty("pixarlog", compressionLevelPixarLog->value());
     cfg->setProperty("saveProfile", chkSaveProfile->isChecked());
+    cfg->setProperty("tiled", chkTiled->isChecked());
 
     return cfg;
 }
@@ -45,6 +45,7 @@
 #include "kis_tiff_ycbcr_reader.h"
 #include "kis_buffer_stream.h"
 #include "kis_tiff_writer_visitor.h"
+#include "kis_tiff_parallel_io.h"
 
 #include <KisImportExportAdditionalChecks.h>
 
@@ -220,6 +221,7 @@ KisPropertiesConfigurationSP KisTIFFOptions::toProperties() const
     cfg->setProperty("deflate", deflateCompress);
     cfg->setProperty("pixarlog", pixarLogCompress);
     cfg->setProperty("saveProfile", saveProfile);
+    cfg->setProperty("tiled", tiled);
 
     return cfg;
 }
@@ -248,6 +250,7 @@ void KisTIFFOptions::fromProperties(KisPropertiesConfigurationSP cfg)
     deflateCompress = cfg->getInt("deflate", 6);
     pixarLogCompress = cfg->getInt("pixarlog", 6);
     saveProfile = cfg->getBool("saveProfile", true);
+    tiled = cfg->getBool("tiled", false);
 }
 
 
@@ -283,7 +286,7 @@ KisImportExportErrorCode KisTIFFConverter::decode(const QString &filename)
     }
     do {
         dbgFile << "Read new sub-image";
-        KisImportExportErrorCode result = readTIFFDirectory(image);
+        KisImportExportErrorCode result = readTIFFDirectory(image, filename);
         if (!result.isOk()) {
             return result;
         }
@@ -293,7 +296,7 @@ KisImportExportErrorCode KisTIFFConverter::decode(const QString &filename)
     return ImportExportCodes::OK;
 }
 
-KisImportExportErrorCode KisTIFFConverter::readTIFFDirectory(TIFF* image)
+KisImportExportErrorCode KisTIFFConverter::readTIFFDirectory(TIFF* image, const QString &filename)
 {
     // Read information about the tiff
     uint32 width, height;
@@ -609,6 +612,10 @@ KisImportExportErrorCode KisTIFFConverter::readTIFFDirectory(TIFF* image)
         return ImportExportCodes::FileFormatIncorrect;
     }
 
+    // decompress the chunks on worker threads, the pixels are still
+    // written into the layer sequentially by tiffReader
+    KisTIFFChunkDecoder decoder(image, filename);
+
     if (TIFFIsTiled(image)) {
         dbgFile << "tiled image";
         uint32 tileWidth, tileHeight;
@@ -644,11 +651,11 @@ KisImportExportErrorCode KisTIFFConverter::readTIFFDirectory(TIFF* image)
             for (x = 0; x < width; x += tileWidth) {
                 dbgFile << "Reading tile x =" << x << " y =" << y;
                 if (planarconfig == PLANARCONFIG_CONTIG) {
-                    TIFFReadTile(image, buf, x, y, 0, (tsample_t) - 1);
+                    decoder.readChunk(TIFFComputeTile(image, x, y, 0, 0), buf);
                 }
                 else {
                     for (uint i = 0; i < nbchannels; i++) {
-                        TIFFReadTile(image, ps_buf[i], x, y, 0, i);
+                        decoder.readChunk(TIFFComputeTile(image, x, y, 0, i), ps_buf[i]);
                     }
                 }
                 uint32 realTileWidth = (x + tileWidth) < width ? tileWidth : width - x;
@@ -698,11 +705,11 @@ KisImportExportErrorCode KisTIFFConverter::readTIFFDirectory(TIFF* image)
         dbgFile << " NbOfStrips =" << TIFFNumberOfStrips(image) << " rowsPerStrip =" << rowsPerStrip << " stripsize =" << stripsize;
         for (uint32 strip = 0; y < height; strip++) {
             if (planarconfig == PLANARCONFIG_CONTIG) {
-                TIFFReadEncodedStrip(image, TIFFComputeStrip(image, y, 0) , buf, (tsize_t) - 1);
+                decoder.readChunk(TIFFComputeStrip(image, y, 0), buf);
             }
             else {
                 for (uint i = 0; i < nbchannels; i++) {
-                    TIFFReadEncodedStrip(image, TIFFComputeStrip(image, y, i), ps_buf[i], (tsize_t) - 1);
+                    decoder.readChunk(TIFFComputeStrip(image, y, i), ps_buf[i]);
                 }
             }
             for (uint32 yinstrip = 0 ; yinstrip < rowsPerStrip && y < height ;) {
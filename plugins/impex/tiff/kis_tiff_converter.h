@@ -40,6 +40,7 @@ struct KisTIFFOptions {
     quint16 deflateCompress = 6;
     quint16 pixarLogCompress = 6;
     bool saveProfile = true;
+    bool tiled = false;
 
     KisPropertiesConfigurationSP toProperties() const;
     void fromProperties(KisPropertiesConfigurationSP cfg);
@@ -61,7 +62,7 @@ public Q_SLOTS:
     virtual void cancel();
 private:
     KisImportExportErrorCode decode(const QString &filename);
-    KisImportExportErrorCode readTIFFDirectory(TIFF* image);
+    KisImportExportErrorCode readTIFFDirectory(TIFF* image, const QString &filename);
 private:
     KisImageSP m_image;
     KisDocument *m_doc;
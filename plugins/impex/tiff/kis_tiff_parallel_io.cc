@@ -0,0 +1,296 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_tiff_parallel_io.h"
+
+#include <string.h>
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <kis_debug.h>
+
+namespace
+{
+
+/**
+ * In-memory file used as the backend of the scratch handles that
+ * compress the chunks.
+ */
+struct MemoryFile
+{
+    QByteArray data;
+    qint64 pos = 0;
+};
+
+tsize_t memoryFileRead(thandle_t handle, tdata_t buffer, tsize_t size)
+{
+    MemoryFile *file = reinterpret_cast<MemoryFile*>(handle);
+    const qint64 available = qMax(qint64(0), file->data.size() - file->pos);
+    const qint64 bytes = qMin(qint64(size), available);
+    memcpy(buffer, file->data.constData() + file->pos, bytes);
+    file->pos += bytes;
+    return bytes;
+}
+
+tsize_t memoryFileWrite(thandle_t handle, tdata_t buffer, tsize_t size)
+{
+    MemoryFile *file = reinterpret_cast<MemoryFile*>(handle);
+    if (file->pos + size > file->data.size()) {
+        file->data.resize(file->pos + size);
+    }
+    memcpy(file->data.data() + file->pos, buffer, size);
+    file->pos += size;
+    return size;
+}
+
+toff_t memoryFileSeek(thandle_t handle, toff_t offset, int whence)
+{
+    MemoryFile *file = reinterpret_cast<MemoryFile*>(handle);
+    switch (whence) {
+    case SEEK_SET:
+        file->pos = offset;
+        break;
+    case SEEK_CUR:
+        file->pos += offset;
+        break;
+    case SEEK_END:
+        file->pos = file->data.size() + offset;
+        break;
+    }
+    return file->pos;
+}
+
+int memoryFileClose(thandle_t)
+{
+    return 0;
+}
+
+toff_t memoryFileSize(thandle_t handle)
+{
+    return reinterpret_cast<MemoryFile*>(handle)->data.size();
+}
+
+int memoryFileMap(thandle_t, tdata_t*, toff_t*)
+{
+    return 0;
+}
+
+void memoryFileUnmap(thandle_t, tdata_t, toff_t)
+{
+}
+
+}
+
+struct KisTIFFChunkDecoder::Private
+{
+    TIFF *image = 0;
+    QString filename;
+    tdir_t directory = 0;
+    bool tiled = false;
+    uint32 numChunks = 0;
+    tsize_t chunkSize = 0;
+    int batchSize = 1;
+
+    QMutex handlesLock;
+    QVector<TIFF*> freeHandles;
+
+    QHash<uint32, QByteArray> decodedChunks;
+
+    TIFF* acquireHandle();
+    void releaseHandle(TIFF *handle);
+    tsize_t decode(TIFF *handle, uint32 chunk, tdata_t buffer);
+    void decodeBatch(uint32 firstChunk);
+};
+
+TIFF* KisTIFFChunkDecoder::Private::acquireHandle()
+{
+    {
+        QMutexLocker l(&handlesLock);
+        if (!freeHandles.isEmpty()) {
+            return freeHandles.takeLast();
+        }
+    }
+
+    TIFF *handle = TIFFOpen(QFile::encodeName(filename), "r");
+    if (handle && !TIFFSetDirectory(handle, directory)) {
+        TIFFClose(handle);
+        handle = 0;
+    }
+    return handle;
+}
+
+void KisTIFFChunkDecoder::Private::releaseHandle(TIFF *handle)
+{
+    QMutexLocker l(&handlesLock);
+    freeHandles.append(handle);
+}
+
+tsize_t KisTIFFChunkDecoder::Private::decode(TIFF *handle, uint32 chunk, tdata_t buffer)
+{
+    return tiled ?
+        TIFFReadEncodedTile(handle, chunk, buffer, chunkSize) :
+        TIFFReadEncodedStrip(handle, chunk, buffer, (tsize_t) - 1);
+}
+
+void KisTIFFChunkDecoder::Private::decodeBatch(uint32 firstChunk)
+{
+    const uint32 count = qMin(uint32(batchSize), numChunks - firstChunk);
+
+    QVector<int> indexes(count);
+    QVector<QByteArray> results(count);
+    for (uint32 i = 0; i < count; i++) {
+        indexes[i] = i;
+    }
+
+    QtConcurrent::blockingMap(indexes,
+        [this, firstChunk, &results] (int &i) {
+            TIFF *handle = acquireHandle();
+            if (!handle) return;
+
+            QByteArray data(chunkSize, 0);
+            if (decode(handle, firstChunk + i, data.data()) >= 0) {
+                results[i] = data;
+            }
+            releaseHandle(handle);
+        });
+
+    for (uint32 i = 0; i < count; i++) {
+        if (!results[i].isEmpty()) {
+            decodedChunks.insert(firstChunk + i, results[i]);
+        }
+    }
+}
+
+KisTIFFChunkDecoder::KisTIFFChunkDecoder(TIFF *image, const QString &filename)
+    : m_d(new Private)
+{
+    m_d->image = image;
+    m_d->filename = filename;
+    m_d->directory = TIFFCurrentDirectory(image);
+    m_d->tiled = TIFFIsTiled(image);
+    m_d->numChunks = m_d->tiled ? TIFFNumberOfTiles(image) : TIFFNumberOfStrips(image);
+    m_d->chunkSize = m_d->tiled ? TIFFTileSize(image) : TIFFStripSize(image);
+    m_d->batchSize = 4 * qMax(1, QThread::idealThreadCount());
+}
+
+KisTIFFChunkDecoder::~KisTIFFChunkDecoder()
+{
+    Q_FOREACH (TIFF *handle, m_d->freeHandles) {
+        TIFFClose(handle);
+    }
+}
+
+void KisTIFFChunkDecoder::readChunk(uint32 chunk, tdata_t buffer)
+{
+    if (!m_d->decodedChunks.contains(chunk) &&
+        chunk < m_d->numChunks &&
+        QThread::idealThreadCount() > 1) {
+
+        m_d->decodeBatch(chunk);
+    }
+
+    QHash<uint32, QByteArray>::iterator it = m_d->decodedChunks.find(chunk);
+    if (it != m_d->decodedChunks.end()) {
+        memcpy(buffer, it->constData(), it->size());
+        m_d->decodedChunks.erase(it);
+    } else {
+        m_d->decode(m_d->image, chunk, buffer);
+    }
+}
+
+bool KisTIFFParallelIO::canEncodeIndependently(uint16 compression)
+{
+    switch (compression) {
+    case COMPRESSION_NONE:
+    case COMPRESSION_LZW:
+    case COMPRESSION_DEFLATE:
+    case COMPRESSION_ADOBE_DEFLATE:
+    case COMPRESSION_PACKBITS:
+        return true;
+    default:
+        // JPEG keeps its quantization and Huffman tables in the
+        // directory, so its chunks can only be compressed by the
+        // handle that writes that directory
+        return false;
+    }
+}
+
+QByteArray KisTIFFParallelIO::encodeChunk(const KisTIFFChunkFormat &format, uint32 rows, QByteArray pixels)
+{
+    MemoryFile file;
+
+    TIFF *scratch = TIFFClientOpen("chunk", "w", reinterpret_cast<thandle_t>(&file),
+                                   memoryFileRead, memoryFileWrite,
+                                   memoryFileSeek, memoryFileClose,
+                                   memoryFileSize,
+                                   memoryFileMap, memoryFileUnmap);
+    if (!scratch) {
+        return QByteArray();
+    }
+
+    TIFFSetField(scratch, TIFFTAG_IMAGEWIDTH, format.chunkWidth);
+    TIFFSetField(scratch, TIFFTAG_IMAGELENGTH, format.tiled ? format.chunkHeight : rows);
+    TIFFSetField(scratch, TIFFTAG_BITSPERSAMPLE, format.bitsPerSample);
+    TIFFSetField(scratch, TIFFTAG_SAMPLESPERPIXEL, format.samplesPerPixel);
+    TIFFSetField(scratch, TIFFTAG_EXTRASAMPLES, format.extraSamples.size(), format.extraSamples.constData());
+    TIFFSetField(scratch, TIFFTAG_PHOTOMETRIC, format.photometric);
+    TIFFSetField(scratch, TIFFTAG_SAMPLEFORMAT, format.sampleFormat);
+    TIFFSetField(scratch, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+    TIFFSetField(scratch, TIFFTAG_COMPRESSION, format.compression);
+    if (format.compression == COMPRESSION_DEFLATE || format.compression == COMPRESSION_ADOBE_DEFLATE) {
+        TIFFSetField(scratch, TIFFTAG_ZIPQUALITY, format.zipQuality);
+    }
+    TIFFSetField(scratch, TIFFTAG_PREDICTOR, format.predictor);
+
+    if (format.tiled) {
+        TIFFSetField(scratch, TIFFTAG_TILEWIDTH, format.chunkWidth);
+        TIFFSetField(scratch, TIFFTAG_TILELENGTH, format.chunkHeight);
+    } else {
+        TIFFSetField(scratch, TIFFTAG_ROWSPERSTRIP, format.chunkHeight);
+    }
+
+    // the predictors difference the rows in place, so work on our own copy
+    tdata_t data = pixels.data();
+
+    const tsize_t written = format.tiled ?
+        TIFFWriteEncodedTile(scratch, 0, data, pixels.size()) :
+        TIFFWriteEncodedStrip(scratch, 0, data, pixels.size());
+
+    QByteArray result;
+
+    toff_t *offsets = 0;
+    toff_t *byteCounts = 0;
+
+    if (written >= 0 &&
+        TIFFGetField(scratch, format.tiled ? TIFFTAG_TILEOFFSETS : TIFFTAG_STRIPOFFSETS, &offsets) &&
+        TIFFGetField(scratch, format.tiled ? TIFFTAG_TILEBYTECOUNTS : TIFFTAG_STRIPBYTECOUNTS, &byteCounts)) {
+
+        KIS_SAFE_ASSERT_RECOVER_NOOP(qint64(offsets[0] + byteCounts[0]) <= file.data.size());
+        result = file.data.mid(offsets[0], byteCounts[0]);
+    }
+
+    // drop the handle without writing a directory into the scratch file
+    TIFFCleanup(scratch);
+
+    return result;
+}
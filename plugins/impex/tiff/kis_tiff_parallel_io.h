@@ -0,0 +1,99 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _KIS_TIFF_PARALLEL_IO_H_
+#define _KIS_TIFF_PARALLEL_IO_H_
+
+#include <tiffio.h>
+
+#include <QByteArray>
+#include <QScopedPointer>
+#include <QString>
+#include <QVector>
+
+/**
+ * Decodes the strips or tiles of the current directory of a TIFF file
+ * ahead of the sequential reader.
+ *
+ * libtiff handles cannot be shared between threads, so every worker opens
+ * its own read-only handle on the same file and seeks it to the same
+ * directory. The decoded chunks are kept until the reader asks for them.
+ * If a worker handle cannot be opened, the chunk is decoded through the
+ * main handle instead.
+ */
+class KisTIFFChunkDecoder
+{
+public:
+    KisTIFFChunkDecoder(TIFF *image, const QString &filename);
+    ~KisTIFFChunkDecoder();
+
+    /**
+     * Copies the decoded strip or tile \p chunk into \p buffer, which must
+     * be at least TIFFStripSize() or TIFFTileSize() bytes long. When the
+     * chunk has not been decoded yet, it is decoded together with the
+     * chunks following it.
+     */
+    void readChunk(uint32 chunk, tdata_t buffer);
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+/**
+ * The tags needed to compress a strip or a tile in the same way the
+ * target file would do it.
+ */
+struct KisTIFFChunkFormat
+{
+    bool tiled = false;
+    uint32 chunkWidth = 0;
+    uint32 chunkHeight = 0;
+    uint16 bitsPerSample = 8;
+    uint16 samplesPerPixel = 1;
+    uint16 sampleFormat = SAMPLEFORMAT_UINT;
+    uint16 photometric = PHOTOMETRIC_MINISBLACK;
+    uint16 compression = COMPRESSION_NONE;
+    uint16 predictor = PREDICTOR_NONE;
+    int zipQuality = 6;
+    QVector<uint16> extraSamples;
+};
+
+namespace KisTIFFParallelIO
+{
+
+/**
+ * @return true if a chunk compressed with \p compression does not depend
+ * on any state shared by the whole file (e.g. JPEG tables), so that it
+ * can be compressed on its own and appended with TIFFWriteRawStrip() or
+ * TIFFWriteRawTile().
+ */
+bool canEncodeIndependently(uint16 compression);
+
+/**
+ * Compresses \p rows rows of \p pixels as a single strip or tile of
+ * \p format. The encoding is done through a scratch TIFF handle writing
+ * to memory, so the function is safe to call from several threads.
+ *
+ * @return the compressed bytes or an empty array on failure
+ */
+QByteArray encodeChunk(const KisTIFFChunkFormat &format, uint32 rows, QByteArray pixels);
+
+}
+
+#endif
@@ -19,6 +19,9 @@
 
 #include "kis_tiff_writer_visitor.h"
 
+#include <QThread>
+#include <QtConcurrent>
+
 #include <KoColorProfile.h>
 #include <KoColorSpace.h>
 #include <KoID.h>
@@ -29,8 +32,20 @@
 #include <half.h>
 #endif
 
+#include "kis_tiff_parallel_io.h"
+
 namespace
 {
+    const uint32 tileSize = 256;
+    const uint32 rowsPerStrip = 8;
+
+    struct Chunk {
+        QRect rect;
+        QByteArray pixels;
+        QByteArray encoded;
+        bool valid = true;
+    };
+
     bool isBitDepthFloat(QString depth) {
         return depth.contains("F");
     }
@@ -221,8 +236,15 @@ bool KisTIFFWriterVisitor::saveLayerProjection(KisLayer *layer)
 
     // Use contiguous configuration
     TIFFSetField(image(), TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
-    // Use 8 rows per strip
-    TIFFSetField(image(), TIFFTAG_ROWSPERSTRIP, 8);
+
+    const bool tiled = m_options->tiled;
+    if (tiled) {
+        TIFFSetField(image(), TIFFTAG_TILEWIDTH, tileSize);
+        TIFFSetField(image(), TIFFTAG_TILELENGTH, tileSize);
+    } else {
+        // Use 8 rows per strip
+        TIFFSetField(image(), TIFFTAG_ROWSPERSTRIP, rowsPerStrip);
+    }
 
     // Save profile
     if (m_options->saveProfile) {
@@ -232,45 +254,122 @@ bool KisTIFFWriterVisitor::saveLayerProjection(KisLayer *layer)
             TIFFSetField(image(), TIFFTAG_ICCPROFILE, ba.size(), ba.constData());
         }
     }
-    tsize_t stripsize = TIFFStripSize(image());
-    tdata_t buff = _TIFFmalloc(stripsize);
-    qint32 height = layer->image()->height();
-    qint32 width = layer->image()->width();
-    bool r = true;
-    for (int y = 0; y < height; y++) {
-        KisHLineConstIteratorSP it = pd->createHLineConstIteratorNG(0, y, width);
-        switch (color_type) {
-        case PHOTOMETRIC_MINISBLACK: {
-                quint8 poses[] = { 0, 1 };
-                r = copyDataToStrips(it, buff, depth, sample_format, 1, poses);
-            }
-            break;
-        case PHOTOMETRIC_RGB: {
-                quint8 poses[4];
-                if (sample_format == SAMPLEFORMAT_IEEEFP) {
-                    poses[2] = 2; poses[1] = 1; poses[0] = 0; poses[3] = 3;
-                } else {
-                    poses[0] = 2; poses[1] = 1; poses[2] = 0; poses[3] = 3;
+
+    quint8 poses[5];
+    uint8 nbcolorsamples;
+    switch (color_type) {
+    case PHOTOMETRIC_MINISBLACK:
+        poses[0] = 0; poses[1] = 1;
+        nbcolorsamples = 1;
+        break;
+    case PHOTOMETRIC_RGB:
+        if (sample_format == SAMPLEFORMAT_IEEEFP) {
+            poses[2] = 2; poses[1] = 1; poses[0] = 0; poses[3] = 3;
+        } else {
+            poses[0] = 2; poses[1] = 1; poses[2] = 0; poses[3] = 3;
+        }
+        nbcolorsamples = 3;
+        break;
+    case PHOTOMETRIC_SEPARATED:
+        poses[0] = 0; poses[1] = 1; poses[2] = 2; poses[3] = 3; poses[4] = 4;
+        nbcolorsamples = 4;
+        break;
+    case PHOTOMETRIC_ICCLAB:
+        poses[0] = 0; poses[1] = 1; poses[2] = 2; poses[3] = 3;
+        nbcolorsamples = 3;
+        break;
+    default:
+        return false;
+    }
+
+    const qint32 height = layer->image()->height();
+    const qint32 width = layer->image()->width();
+    const QRect imageRect(0, 0, width, height);
+
+    KisTIFFChunkFormat format;
+    format.tiled = tiled;
+    format.chunkWidth = tiled ? tileSize : width;
+    format.chunkHeight = tiled ? tileSize : rowsPerStrip;
+    format.bitsPerSample = depth;
+    format.samplesPerPixel = m_options->alpha ? pd->channelCount() : pd->channelCount() - 1;
+    format.sampleFormat = sample_format;
+    format.photometric = color_type;
+    format.compression = m_options->compressionType;
+    format.predictor = m_options->predictor;
+    format.zipQuality = m_options->deflateCompress;
+    if (m_options->alpha) {
+        format.extraSamples << EXTRASAMPLE_UNASSALPHA;
+    }
+
+    /**
+     * The chunks are filled from the paint device and, when the codec
+     * allows it, compressed on the worker threads in batches. The
+     * compressed chunks are then appended to the file in order, so the
+     * layout of the file is the same as if libtiff compressed them itself.
+     */
+    const bool encodeInParallel = KisTIFFParallelIO::canEncodeIndependently(m_options->compressionType);
+
+    const uint32 numChunks = tiled ? TIFFNumberOfTiles(image()) : TIFFNumberOfStrips(image());
+    const uint32 tilesAcross = (width + tileSize - 1) / tileSize;
+    const tsize_t rowSize = tiled ? TIFFTileRowSize(image()) : TIFFScanlineSize(image());
+    const uint32 batchSize = 4 * qMax(1, QThread::idealThreadCount());
+
+    for (uint32 firstChunk = 0; firstChunk < numChunks; firstChunk += batchSize) {
+        const uint32 count = qMin(batchSize, numChunks - firstChunk);
+
+        QVector<Chunk> chunks(count);
+        QVector<int> indexes(count);
+        for (uint32 i = 0; i < count; i++) {
+            const uint32 chunk = firstChunk + i;
+
+            chunks[i].rect = tiled ?
+                QRect((chunk % tilesAcross) * tileSize, (chunk / tilesAcross) * tileSize, tileSize, tileSize) :
+                QRect(0, chunk * rowsPerStrip, width, rowsPerStrip);
+            indexes[i] = i;
+        }
+
+        QtConcurrent::blockingMap(indexes,
+            [&] (int &i) {
+                Chunk &c = chunks[i];
+
+                // edge tiles keep their full size and are padded with zeroes
+                const QRect rc = c.rect & imageRect;
+                const int rows = tiled ? c.rect.height() : rc.height();
+                c.pixels = QByteArray(rows * rowSize, 0);
+
+                for (int y = 0; y < rc.height(); y++) {
+                    KisHLineConstIteratorSP it = pd->createHLineConstIteratorNG(rc.x(), rc.y() + y, rc.width());
+                    if (!copyDataToStrips(it, c.pixels.data() + y * rowSize, depth, sample_format, nbcolorsamples, poses)) {
+                        c.valid = false;
+                        return;
+                    }
                 }
-                r = copyDataToStrips(it, buff, depth, sample_format, 3, poses);
-            }
-            break;
-        case PHOTOMETRIC_SEPARATED: {
-                quint8 poses[] = { 0, 1, 2, 3, 4 };
-                r = copyDataToStrips(it, buff, depth, sample_format, 4, poses);
-            }
-            break;
-        case PHOTOMETRIC_ICCLAB: {
-                quint8 poses[] = { 0, 1, 2, 3 };
-                r = copyDataToStrips(it, buff, depth, sample_format, 3, poses);
+
+                if (encodeInParallel) {
+                    c.encoded = KisTIFFParallelIO::encodeChunk(format, rows, c.pixels);
+                }
+            });
+
+        for (uint32 i = 0; i < count; i++) {
+            const uint32 chunk = firstChunk + i;
+            Chunk &c = chunks[i];
+
+            if (!c.valid) return false;
+
+            tsize_t result;
+            if (!c.encoded.isEmpty()) {
+                result = tiled ?
+                    TIFFWriteRawTile(image(), chunk, c.encoded.data(), c.encoded.size()) :
+                    TIFFWriteRawStrip(image(), chunk, c.encoded.data(), c.encoded.size());
+            } else {
+                result = tiled ?
+                    TIFFWriteEncodedTile(image(), chunk, c.pixels.data(), c.pixels.size()) :
+                    TIFFWriteEncodedStrip(image(), chunk, c.pixels.data(), c.pixels.size());
             }
-            break;
-            return false;
+
+            if (result < 0) return false;
         }
-        if (!r) return false;
-        TIFFWriteScanline(image(), buff, y, (tsample_t) - 1);
     }
-    _TIFFfree(buff);
     TIFFWriteDirectory(image());
     return true;
 }
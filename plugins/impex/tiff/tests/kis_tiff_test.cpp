@@ -26,6 +26,8 @@
 
 #include <KoColorModelStandardIds.h>
 #include <KoColor.h>
+#include <kis_paint_layer.h>
+#include <kis_properties_configuration.h>
 
 #include "kisexiv2/kis_exiv2.h"
 #include  <sdk/tests/kistest.h>
@@ -118,6 +120,80 @@ void KisTiffTest::testRoundTripRGBF16()
 #endif
 }
 
+void KisTiffTest::testRoundTripChunks_data()
+{
+    QTest::addColumn<bool>("tiled");
+    QTest::addColumn<int>("compression");
+    QTest::addColumn<int>("predictor");
+
+    // the compression is the index in the export dialog
+    QTest::newRow("strips-none") << false << 0 << 0;
+    QTest::newRow("strips-deflate") << false << 2 << 1;
+    QTest::newRow("strips-lzw") << false << 3 << 0;
+    QTest::newRow("tiles-none") << true << 0 << 0;
+    QTest::newRow("tiles-deflate") << true << 2 << 1;
+    QTest::newRow("tiles-lzw") << true << 3 << 1;
+    QTest::newRow("tiles-pixarlog") << true << 4 << 0;
+}
+
+void KisTiffTest::testRoundTripChunks()
+{
+    QFETCH(bool, tiled);
+    QFETCH(int, compression);
+    QFETCH(int, predictor);
+
+    // not a multiple of the tile size, so that the edge tiles are padded
+    const QRect testRect(0, 0, 1031, 613);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisImageSP image = new KisImage(0, testRect.width(), testRect.height(), cs, "test");
+    KisPaintLayerSP layer = new KisPaintLayer(image, "paint1", OPACITY_OPAQUE_U8);
+    image->addNode(layer, image->root());
+
+    layer->paintDevice()->fill(testRect, KoColor(Qt::white, cs));
+    for (int i = 0; i < 10; i++) {
+        layer->paintDevice()->fill(QRect(i * 101, i * 59, 250, 170),
+                                   KoColor(QColor::fromHsv(i * 36, 200, 255, 40 + i * 20), cs));
+    }
+    image->initialRefreshGraph();
+
+    KisDocument *doc0 = qobject_cast<KisDocument*>(KisPart::instance()->createDocument());
+    doc0->setCurrentImage(image);
+    doc0->setFileBatchMode(true);
+
+    KisPropertiesConfigurationSP cfg = new KisPropertiesConfiguration();
+    cfg->setProperty("compressiontype", compression);
+    cfg->setProperty("predictor", predictor);
+    cfg->setProperty("alpha", true);
+    cfg->setProperty("flatten", true);
+    cfg->setProperty("saveProfile", true);
+    cfg->setProperty("tiled", tiled);
+
+    QTemporaryFile tmpFile(QDir::tempPath() + QLatin1String("/krita_XXXXXX") + QLatin1String(".tiff"));
+    QVERIFY(tmpFile.open());
+    tmpFile.close();
+
+    QVERIFY(doc0->exportDocumentSync(QUrl::fromLocalFile(tmpFile.fileName()), TiffMimetype.toLatin1(), cfg));
+
+    KisDocument *doc1 = qobject_cast<KisDocument*>(KisPart::instance()->createDocument());
+    KisImportExportManager manager(doc1);
+    doc1->setFileBatchMode(true);
+
+    KisImportExportErrorCode status = manager.importDocument(tmpFile.fileName(), QString());
+    QVERIFY(status.isOk());
+    QVERIFY(doc1->image());
+    doc1->image()->waitForDone();
+
+    const QImage ref0 = doc0->image()->projection()->convertToQImage(0, testRect);
+    const QImage ref1 = doc1->image()->projection()->convertToQImage(0, testRect);
+
+    QCOMPARE(ref1, ref0);
+
+    delete doc1;
+    delete doc0;
+}
+
 void KisTiffTest::testSaveTiffColorSpace(QString colorModel, QString colorDepth, QString colorProfile)
 {
     const KoColorSpace *space = KoColorSpaceRegistry::instance()->colorSpace(colorModel, colorDepth, colorProfile);
@@ -27,6 +27,8 @@ class KisTiffTest : public QObject
 private Q_SLOTS:
     void testFiles();
     void testRoundTripRGBF16();
+    void testRoundTripChunks_data();
+    void testRoundTripChunks();
 
     void testSaveTiffColorSpace(QString colorModel, QString colorDepth, QString colorProfile);
     void testSaveTiffRgbaColorSpace();
@@ -23,12 +23,15 @@
 
 #include <KoColor.h>
 #include <KoColorSpace.h>
+#include <KoMixColorsOp.h>
 
 #include <QRect>
+#include <QtMath>
 
 #include <kis_types.h>
 #include <kis_iterator_ng.h>
 #include <kis_cross_device_color_picker.h>
+#include <KisDisplacementGrid.h>
 
 #include <cmath>
 #include <ctime>
@@ -36,12 +39,68 @@
 
 const qreal degToRad = M_PI / 180.0;
 
+/**
+ * Big dabs calculate the deformation only in the nodes of a coarse
+ * grid and interpolate it for the rest of the pixels
+ */
+const int deformGridStep = 4;
+const int deformGridMinArea = 64 * 64;
+
+/**
+ * The gathered source rect may not be much bigger than the dab itself,
+ * otherwise reading it would cost more than picking the pixels one by one
+ */
+const int deformGatherMaxAreaRatio = 4;
+
+/**
+ * Samples the source pixels read into \p data with the same bilinear
+ * weights KisRandomSubAccessor uses. Returns false if the sample needs
+ * pixels outside \p rect.
+ */
+inline bool sampleGatheredPixel(const quint8 *data, const QRect &rect, int pixelSize,
+                                const KoMixColorsOp *mixOp,
+                                qreal x, qreal y, quint8 *dst)
+{
+    const int x0 = qFloor(x);
+    const int y0 = qFloor(y);
+
+    if (x0 < rect.left() || x0 + 1 > rect.right() ||
+        y0 < rect.top() || y0 + 1 > rect.bottom()) {
+
+        return false;
+    }
+
+    const qreal hsub = x - x0;
+    const qreal vsub = y - y0;
+
+    const int rowStride = rect.width() * pixelSize;
+    const quint8 *topLeft = data + (y0 - rect.top()) * rowStride + (x0 - rect.left()) * pixelSize;
+
+    const quint8 *pixels[4] = {
+        topLeft,
+        topLeft + pixelSize,
+        topLeft + rowStride,
+        topLeft + rowStride + pixelSize
+    };
+
+    const qint16 weights[4] = {
+        qint16(qRound((1.0 - hsub) * (1.0 - vsub) * 255)),
+        qint16(qRound((1.0 - vsub) * hsub * 255)),
+        qint16(qRound(vsub * (1.0 - hsub) * 255)),
+        qint16(qRound(hsub * vsub * 255))
+    };
+
+    mixOp->mixColors(pixels, weights, 4, dst);
+    return true;
+}
+
 
 DeformBrush::DeformBrush()
 {
     m_firstPaint = false;
     m_counter = 1;
     m_deformAction = 0;
+    m_useDisplacementGrid = true;
 }
 
 DeformBrush::~DeformBrush()
@@ -190,13 +249,90 @@ KisFixedPaintDeviceSP DeformBrush::paintMask(KisFixedPaintDeviceSP dab,
     QTransform reverseRotationMatrix;
     reverseRotationMatrix.rotateRadians(rotation);
 
+    const DeformModes mode = DeformModes(m_properties->deform_action - 1);
+
     // if can't paint, stop
-    if (!setupAction(DeformModes(m_properties->deform_action - 1),
-                     pos, forwardRotationMatrix))
+    if (!setupAction(mode, pos, forwardRotationMatrix))
     {
         return 0;
     }
 
+    /**
+     * All the actions except the color one are smooth, so we can
+     * sample them on a grid
+     */
+    const bool useDisplacementGrid =
+        m_useDisplacementGrid &&
+        mode != DEFORM_COLOR &&
+        dstWidth * dstHeight >= deformGridMinArea;
+
+    /**
+     * The actions are not smooth on the border of the ellipse (e.g.
+     * the scale action has a kink there), and the nodes lying outside
+     * the ellipse are never used by the exact path. So the pixels whose
+     * grid cell may touch the border are calculated exactly. The
+     * elliptic radius of the nodes of a cell differs from the one of
+     * its pixels by at most gridEdgeMargin. Please take into account
+     * that norme() returns the squared radius.
+     */
+    const qreal gridEdgeMargin = deformGridStep * M_SQRT2 * qMax(majorAxis, minorAxis);
+    const qreal gridMaxDistance = pow2(qMax(0.0, 1.0 - gridEdgeMargin));
+
+    KisDisplacementGrid displacementGrid;
+    QVector<float> rowOffsetsX;
+    QVector<float> rowOffsetsY;
+
+    if (useDisplacementGrid) {
+        displacementGrid = KisDisplacementGrid(QRect(0, 0, dstWidth, dstHeight), deformGridStep);
+        displacementGrid.fill(
+            [&] (const QPointF &pt) {
+                qreal maskX = pt.x() - centerX;
+                qreal maskY = pt.y() - centerY;
+                forwardRotationMatrix.map(maskX, maskY, &maskX, &maskY);
+                const qreal distance = norme(maskX * majorAxis, maskY * minorAxis);
+
+                m_deformAction->transform(&maskX, &maskY, distance);
+                reverseRotationMatrix.map(maskX, maskY, &maskX, &maskY);
+
+                return QPointF(maskX, maskY);
+            });
+
+        rowOffsetsX.resize(dstWidth);
+        rowOffsetsY.resize(dstWidth);
+    }
+
+    /**
+     * When the displacement is sampled on a grid, the bounds of the
+     * deformed positions are known in advance, so the source pixels are
+     * read once per dab tile-by-tile instead of moving a random accessor
+     * for every pixel of the dab. The pixels falling outside the gathered
+     * rect (the ones calculated exactly) are still picked one by one.
+     */
+    QRect sourceRect;
+    QVector<quint8> sourceData;
+    const KoMixColorsOp *sourceMixOp = layer->colorSpace()->mixColorsOp();
+    const int sourcePixelSize = layer->pixelSize();
+
+    if (useDisplacementGrid && *layer->colorSpace() == *dab->colorSpace()) {
+        sourceRect = displacementGrid.valueBounds()
+            .translated(pos).toAlignedRect().adjusted(-1, -1, 2, 2);
+
+        if (sourceRect.width() * sourceRect.height() <=
+            deformGatherMaxAreaRatio * dstWidth * dstHeight) {
+
+            sourceData.resize(sourceRect.width() * sourceRect.height() * sourcePixelSize);
+
+            if (m_properties->deform_use_old_data) {
+                KisPaintDeviceSP oldData = new KisPaintDevice(layer->colorSpace());
+                oldData->prepareClone(layer);
+                oldData->fastBitBltRoughOldData(layer, sourceRect);
+                oldData->readBytes(sourceData.data(), sourceRect);
+            } else {
+                layer->readBytes(sourceData.data(), sourceRect);
+            }
+        }
+    }
+
     mask->setRect(dab->bounds());
     mask->lazyGrowBufferWithoutInitialization();
     quint8* maskPointer = mask->data();
@@ -206,6 +342,10 @@ KisFixedPaintDeviceSP DeformBrush::paintMask(KisFixedPaintDeviceSP dab,
     int dabPixelSize = dab->colorSpace()->pixelSize();
 
     for (int y = 0; y <  dstHeight; y++) {
+        if (useDisplacementGrid) {
+            displacementGrid.interpolateRow(0, y, dstWidth, rowOffsetsX.data(), rowOffsetsY.data());
+        }
+
         for (int x = 0; x < dstWidth; x++) {
             qreal maskX = x - centerX;
             qreal maskY = y - centerY;
@@ -232,8 +372,13 @@ KisFixedPaintDeviceSP DeformBrush::paintMask(KisFixedPaintDeviceSP dab,
                 }
             }
 
-            m_deformAction->transform(&maskX, &maskY, distance);
-            reverseRotationMatrix.map(maskX, maskY, &maskX, &maskY);
+            if (useDisplacementGrid && distance < gridMaxDistance) {
+                maskX = rowOffsetsX[x];
+                maskY = rowOffsetsY[x];
+            } else {
+                m_deformAction->transform(&maskX, &maskY, distance);
+                reverseRotationMatrix.map(maskX, maskY, &maskX, &maskY);
+            }
 
             maskX += pos.x();
             maskY += pos.y();
@@ -243,11 +388,16 @@ KisFixedPaintDeviceSP DeformBrush::paintMask(KisFixedPaintDeviceSP dab,
                 maskY = qRound(maskY);
             }
 
-            if (m_properties->deform_use_old_data) {
-                colorPicker.pickOldColor(maskX, maskY, dabPointer);
-            }
-            else {
-                colorPicker.pickColor(maskX, maskY, dabPointer);
+            if (sourceData.isEmpty() ||
+                !sampleGatheredPixel(sourceData.constData(), sourceRect, sourcePixelSize,
+                                     sourceMixOp, maskX, maskY, dabPointer)) {
+
+                if (m_properties->deform_use_old_data) {
+                    colorPicker.pickOldColor(maskX, maskY, dabPointer);
+                }
+                else {
+                    colorPicker.pickColor(maskX, maskY, dabPointer);
+                }
             }
 
             dabPointer += dabPixelSize;
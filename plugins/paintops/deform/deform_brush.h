@@ -214,6 +214,16 @@ public:
         m_properties = properties;
     }
     void initDeformAction();
+
+    /**
+     * Big dabs sample the deformation on a coarse grid. Disabling the
+     * grid forces the exact per-pixel calculation, which is used by
+     * the unittests as a reference.
+     */
+    void setUseDisplacementGrid(bool value) {
+        m_useDisplacementGrid = value;
+    }
+
     QPointF hotSpot(qreal scale, qreal rotation);
 
 private:
@@ -240,6 +250,7 @@ private:
     bool m_firstPaint;
     qreal m_prevX, m_prevY;
     int m_counter;
+    bool m_useDisplacementGrid;
 
     QRectF m_maskRect;
 
@@ -0,0 +1,178 @@
+/*
+ *  Copyright (c) 2019 Krita Foundation
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "KisDeformBrushTest.h"
+
+#include <QtMath>
+
+#include <KoColorSpaceRegistry.h>
+#include <kis_fixed_paint_device.h>
+
+#include "deform_brush.h"
+
+namespace {
+
+KisPaintDeviceSP createGradientDevice()
+{
+    /**
+     * A smooth gradient, so that the difference in the picked colors
+     * is proportional to the difference in the displacement: one level
+     * of the 8-bit color corresponds to about 1.5 px
+     */
+    QImage image(400, 400, QImage::Format_ARGB32);
+    for (int y = 0; y < image.height(); y++) {
+        for (int x = 0; x < image.width(); x++) {
+            image.setPixel(x, y, qRgba(x * 255 / 399, y * 255 / 399, (x + y) * 255 / 798, 255));
+        }
+    }
+
+    KisPaintDeviceSP dev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+    dev->convertFromQImage(image, 0);
+    return dev;
+}
+
+KisFixedPaintDeviceSP paintDab(DeformBrush *brush, KisPaintDeviceSP layer,
+                               qreal rotation, const QPointF &pt,
+                               KisFixedPaintDeviceSP *mask)
+{
+    const qreal scale = 1.0;
+    const QPointF pos = pt - brush->hotSpot(scale, rotation);
+
+    const int x = qFloor(pos.x());
+    const int y = qFloor(pos.y());
+
+    KisFixedPaintDeviceSP dab = new KisFixedPaintDevice(layer->colorSpace());
+    *mask = brush->paintMask(dab, layer, scale, rotation, pt,
+                             pos.x() - x, pos.y() - y, x, y);
+    return dab;
+}
+
+}
+
+void KisDeformBrushTest::testDisplacementGrid_data()
+{
+    QTest::addColumn<int>("action");
+    QTest::addColumn<qreal>("amount");
+    QTest::addColumn<qreal>("aspect");
+    QTest::addColumn<qreal>("rotation");
+
+    QTest::newRow("grow") << int(GROW) << 0.5 << 1.0 << 0.0;
+    QTest::newRow("shrink-ellipse") << int(SHRINK) << 0.5 << 0.5 << 0.3;
+    QTest::newRow("swirl-cw-ellipse") << int(SWIRL_CW) << 0.3 << 0.7 << 1.0;
+    QTest::newRow("swirl-ccw") << int(SWIRL_CCW) << 0.3 << 1.0 << 0.0;
+    QTest::newRow("lens-in") << int(LENS_IN) << 0.5 << 1.0 << 0.0;
+    QTest::newRow("lens-out-ellipse") << int(LENS_OUT) << 0.5 << 0.6 << -0.7;
+}
+
+void KisDeformBrushTest::testDisplacementGrid()
+{
+    QFETCH(int, action);
+    QFETCH(qreal, amount);
+    QFETCH(qreal, aspect);
+    QFETCH(qreal, rotation);
+
+    KisPaintDeviceSP layer = createGradientDevice();
+
+    DeformOption properties;
+    properties.deform_amount = amount;
+    properties.deform_use_bilinear = true;
+    properties.deform_use_counter = false;
+    properties.deform_use_old_data = false;
+    properties.deform_action = action + 1;
+
+    KisBrushSizeOptionProperties sizeProperties;
+    sizeProperties.brush_diameter = 200;
+    sizeProperties.brush_aspect = aspect;
+    sizeProperties.brush_rotation = 0;
+    sizeProperties.brush_scale = 1.0;
+    sizeProperties.brush_spacing = 0.1;
+    sizeProperties.brush_density = 1.0;
+    sizeProperties.brush_jitter_movement = 0;
+    sizeProperties.brush_jitter_movement_enabled = false;
+
+    DeformBrush gridBrush;
+    gridBrush.setProperties(&properties);
+    gridBrush.setSizeProperties(&sizeProperties);
+    gridBrush.initDeformAction();
+
+    DeformBrush exactBrush;
+    exactBrush.setProperties(&properties);
+    exactBrush.setSizeProperties(&sizeProperties);
+    exactBrush.initDeformAction();
+    exactBrush.setUseDisplacementGrid(false);
+
+    const QPointF pt(200.3, 199.6);
+
+    KisFixedPaintDeviceSP gridMask;
+    KisFixedPaintDeviceSP gridDab = paintDab(&gridBrush, layer, rotation, pt, &gridMask);
+
+    KisFixedPaintDeviceSP exactMask;
+    KisFixedPaintDeviceSP exactDab = paintDab(&exactBrush, layer, rotation, pt, &exactMask);
+
+    QVERIFY(gridMask);
+    QVERIFY(exactMask);
+    QCOMPARE(gridDab->bounds(), exactDab->bounds());
+    QCOMPARE(gridMask->bounds(), exactMask->bounds());
+
+    // the dab should be big enough to use the grid
+    QVERIFY(gridDab->bounds().width() * gridDab->bounds().height() >= 64 * 64);
+
+    /**
+     * The grid step is 4 px, so the interpolated displacement differs
+     * from the exact one by a fraction of a pixel. The pixels near the
+     * border of the ellipse are calculated exactly.
+     */
+    const int tolerance = 1;
+
+    const QRect rc = gridDab->bounds();
+    const int pixelSize = gridDab->pixelSize();
+
+    const quint8 *gridMaskPtr = gridMask->data();
+    const quint8 *exactMaskPtr = exactMask->data();
+    const quint8 *gridDabPtr = gridDab->data();
+    const quint8 *exactDabPtr = exactDab->data();
+
+    int numPaintedPixels = 0;
+
+    for (int y = 0; y < rc.height(); y++) {
+        for (int x = 0; x < rc.width(); x++) {
+            QCOMPARE(*gridMaskPtr, *exactMaskPtr);
+
+            if (*gridMaskPtr == OPACITY_OPAQUE_U8) {
+                numPaintedPixels++;
+
+                for (int i = 0; i < pixelSize; i++) {
+                    if (qAbs(int(gridDabPtr[i]) - int(exactDabPtr[i])) > tolerance) {
+                        qDebug() << "Pixel" << x << y << "channel" << i
+                                 << "grid" << gridDabPtr[i]
+                                 << "exact" << exactDabPtr[i];
+                        QFAIL("grid deformation differs from the exact one");
+                    }
+                }
+            }
+
+            gridMaskPtr++;
+            exactMaskPtr++;
+            gridDabPtr += pixelSize;
+            exactDabPtr += pixelSize;
+        }
+    }
+
+    QVERIFY(numPaintedPixels > 0);
+}
+
+QTEST_MAIN(KisDeformBrushTest)